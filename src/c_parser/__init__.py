@@ -1,11 +1,21 @@
-from .core import TypeManager
+from .core import TypeManager, ParseCache, IncludeResolver
 from .type_parser import CTypeParser
 from .data_parser import CDataParser
+from .batch_parser import BatchParser
+from .parallel_decoder import ParallelDecoder
+from .incremental_parser import IncrementalParser
+from .parse_server import ParseServer
 from .core.tree_sitter_utils import TreeSitterUtils
 
 __all__ = [
     'TypeManager',
+    'ParseCache',
+    'IncludeResolver',
     'CTypeParser',
     'CDataParser',
+    'BatchParser',
+    'ParallelDecoder',
+    'IncrementalParser',
+    'ParseServer',
     'TreeSitterUtils'
 ] 
\ No newline at end of file
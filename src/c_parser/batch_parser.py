@@ -0,0 +1,168 @@
+import os
+from concurrent.futures import ProcessPoolExecutor
+from pathlib import Path
+from typing import Dict, Any, Optional, List, Tuple, Union
+from utils.logger import logger
+from .core.tree_sitter_utils import TreeSitterUtils
+from .core.layout_engine import DEFAULT_ABI
+from .core.type_manager import TypeManager
+from .data_parser import CDataParser
+
+logger = logger.bind(name="BatchParser")
+
+# 工作进程内的解析器，由 _init_worker 创建，在进程生命周期内复用
+_worker_parser: Optional[CDataParser] = None
+
+
+def _create_parser(type_info: Optional[Dict[str, Any]], abi: str, macros: Dict[str, Any]) -> CDataParser:
+    """创建解析单个文件所用的CDataParser，ABI和预定义宏与单文件的 analyze 一致"""
+    type_manager = TypeManager(type_info, abi=abi)
+    type_manager.define_macros(macros)
+    return CDataParser(type_manager)
+
+
+def _init_worker(type_info: Optional[Dict[str, Any]], abi: str, macros: Dict[str, Any]) -> None:
+    """工作进程初始化：创建本进程独占的tree-sitter解析器和CDataParser"""
+    global _worker_parser
+    # fork得到的进程继承了父进程的Parser对象，丢弃后重新创建
+    TreeSitterUtils.reset_parser()
+    _worker_parser = _create_parser(type_info, abi, macros)
+
+
+def _parse_in_worker(file_path: str) -> Tuple[str, Optional[Dict[str, Any]], Optional[Dict[str, Any]], Optional[str]]:
+    """在工作进程中解析单个文件
+
+    Returns:
+        (文件路径, 该文件新增的类型信息, 变量信息, 错误信息)
+    """
+    return _parse_with(_worker_parser, file_path)
+
+
+def _parse_with(parser: CDataParser, file_path: str) -> Tuple[str, Optional[Dict[str, Any]], Optional[Dict[str, Any]], Optional[str]]:
+    """使用给定解析器解析单个文件，解析前清理上一个文件留下的状态"""
+    parser.type_manager.reset_current_type_info()
+    parser.data_manager.clear()
+    parser.current_file = None
+    try:
+        data = parser.parse_file(Path(file_path))
+    except Exception as e:
+        return file_path, None, None, str(e)
+    return file_path, parser.type_manager.export_types(scope='current'), data['variables'], None
+
+
+class BatchParser:
+    """多文件并行解析器
+
+    将一组C文件分发到进程池中解析，每个工作进程拥有独立的tree-sitter
+    Parser和CDataParser。源文件中的 #include 不展开，共享的头文件由调用方预先解析后
+    通过 type_info 传入。各文件的类型信息按文件路径排序后依次通过
+    TypeManager.merge_type_info 合并，结果与工作进程数量和完成顺序无关。
+    同名类型定义不一致时保留排序靠前的文件中的定义，并记录冲突。
+
+    用法示例：
+    ```python
+    batch = BatchParser(type_info=TypeManager().export_types(), jobs=8)
+    result = batch.parse_directory(Path('data'))
+    result['variables']['data/a.c']
+    ```
+    """
+
+    DEFAULT_PATTERN = '*.c'
+
+    def __init__(self, type_info: Optional[Dict[str, Any]] = None, jobs: Optional[int] = None,
+                 abi: str = DEFAULT_ABI, macros: Optional[Dict[str, Any]] = None):
+        """初始化批量解析器
+
+        Args:
+            type_info: 所有文件共享的类型信息（例如预先解析的头文件），可选
+            jobs: 工作进程数量，默认为CPU核数；为1时在当前进程中顺序解析
+            abi: 目标平台ABI
+            macros: 预定义宏 {宏名称: 值}，登记方式同 TypeManager.define_macros
+        """
+        self.type_info = type_info
+        self.jobs = jobs or os.cpu_count() or 1
+        self.abi = abi
+        self.macros = dict(macros or {})
+
+    @classmethod
+    def collect_files(cls, directory: Path, pattern: str = DEFAULT_PATTERN,
+                      recursive: bool = True) -> List[Path]:
+        """收集目录下需要解析的文件，按路径排序"""
+        directory = Path(directory)
+        matches = directory.rglob(pattern) if recursive else directory.glob(pattern)
+        return sorted(path for path in matches if path.is_file())
+
+    def parse_directory(self, directory: Path, pattern: str = DEFAULT_PATTERN,
+                        recursive: bool = True) -> Dict[str, Any]:
+        """解析目录下的所有匹配文件"""
+        return self.parse_files(self.collect_files(directory, pattern, recursive))
+
+    def parse_files(self, files: List[Union[str, Path]]) -> Dict[str, Any]:
+        """并行解析多个文件并合并结果
+
+        Args:
+            files: 文件列表
+
+        Returns:
+            合并后的结果，包含以下内容：
+            - structs/unions/enums/typedefs: 合并后的类型定义
+            - pointer_types/macro_definitions: 合并后的指针类型和宏定义
+            - variables: 文件路径 -> 该文件的变量信息
+            - conflicts: 定义不一致的类型及其来源文件
+            - errors: 解析失败的文件 -> 错误信息
+        """
+        paths = sorted(str(path) for path in files)
+        logger.info(f"Parsing {len(paths)} files with {min(self.jobs, max(len(paths), 1))} workers")
+
+        results = self._run(paths)
+        return self._merge_results(results)
+
+    def _run(self, paths: List[str]) -> List[Tuple[str, Optional[Dict[str, Any]], Optional[Dict[str, Any]], Optional[str]]]:
+        """执行解析，返回与输入顺序一致的结果列表"""
+        if not paths:
+            return []
+
+        initargs = (self.type_info, self.abi, self.macros)
+        if self.jobs == 1 or len(paths) == 1:
+            parser = _create_parser(*initargs)
+            return [_parse_with(parser, path) for path in paths]
+
+        workers = min(self.jobs, len(paths))
+        # 每个任务的开销很小，按批提交以减少进程间通信
+        chunksize = max(1, len(paths) // (workers * 4))
+        with ProcessPoolExecutor(max_workers=workers, initializer=_init_worker, initargs=initargs) as executor:
+            return list(executor.map(_parse_in_worker, paths, chunksize=chunksize))
+
+    def _merge_results(self, results) -> Dict[str, Any]:
+        """按文件顺序合并各文件的解析结果"""
+        merged = TypeManager()
+        variables = {}
+        conflicts = []
+        errors = {}
+
+        for file_path, types, file_variables, error in results:
+            if error is not None:
+                logger.error(f"Failed to parse {file_path}: {error}")
+                errors[file_path] = error
+                continue
+            for conflict in merged.merge_type_info(types, overwrite=False):
+                conflict['file'] = file_path
+                conflicts.append(conflict)
+            variables[file_path] = file_variables
+
+        for conflict in conflicts:
+            logger.warning(f"Conflicting definition of {conflict['kind']} {conflict['name']} "
+                           f"in {conflict['file']}, keeping the first one")
+
+        exported = merged.export_types(scope='current')
+        return {
+            'structs': merged.find_types_by_kind('struct', scope='current'),
+            'unions': merged.find_types_by_kind('union', scope='current'),
+            'enums': merged.find_types_by_kind('enum', scope='current'),
+            'typedefs': merged.find_types_by_kind('typedef', scope='current'),
+            'pointer_types': sorted(exported['pointer_types']),
+            'macro_definitions': exported['macro_definitions'],
+            'variables': variables,
+            'conflicts': conflicts,
+            'errors': errors,
+        }
@@ -2,6 +2,25 @@ from .tree_sitter_utils import TreeSitterUtils
 from .expression_parser import ExpressionParser
 # ValueParser已合并到CDataParser中，不再需要单独导入
 from .type_manager import TypeManager
+from .parse_cache import ParseCache
+from .include_resolver import IncludeResolver
+from .output_writer import StreamingJsonWriter, TypeTable, json_default
+from .layout_engine import LayoutEngine, TypeLayout, FieldLayout, AbiProfile, ABI_PROFILES, get_abi_profile
+from .binary_codec import BinaryDecoder, BinaryEncoder
+from .value_records import StructValue, to_plain
+from .columnar import StructColumns, write_columns, read_columns
+from .source_chunker import SourceChunker, SourceChunk
+from .struct_specializer import StructSpecializer
+from .type_database import TypeDatabase, write_type_database
+from .type_ref import TypeRef
+from .type_layer import TypeLayer
+from .conditional_evaluator import ConditionalEvaluator
+from .structural_diff import SnapshotBuilder, Snapshot, diff_snapshots, format_diff
 
-__all__ = ['TreeSitterUtils', 'ExpressionParser', 'TypeManager']
+__all__ = ['TreeSitterUtils', 'ExpressionParser', 'TypeManager', 'ParseCache', 'IncludeResolver', 'StreamingJsonWriter', 'TypeTable', 'json_default',
+           'LayoutEngine', 'TypeLayout', 'FieldLayout', 'AbiProfile', 'ABI_PROFILES', 'get_abi_profile',
+           'BinaryDecoder', 'BinaryEncoder', 'StructValue', 'to_plain',
+           'StructColumns', 'write_columns', 'read_columns', 'SourceChunker', 'SourceChunk',
+           'StructSpecializer', 'TypeDatabase', 'write_type_database', 'TypeRef', 'TypeLayer',
+           'ConditionalEvaluator', 'SnapshotBuilder', 'Snapshot', 'diff_snapshots', 'format_diff']
 
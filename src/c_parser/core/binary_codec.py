@@ -0,0 +1,1008 @@
+import array
+import math
+import mmap
+import struct
+from collections.abc import Mapping
+from functools import partial
+from pathlib import Path
+from typing import Dict, Any, Optional, List, Tuple, Iterator, Union, Callable, Iterable
+from loguru import logger
+from utils.logger import log_gate
+from .layout_engine import LayoutEngine, TypeLayout, FieldLayout, element_count
+from .columnar import StructColumns
+
+logger = logger.bind(name="BinaryCodec")
+
+Buffer = Union[bytes, bytearray, memoryview, mmap.mmap]
+
+# 标准大小的整数格式：(大小, 是否有符号) -> struct格式字符
+_INT_CODES = {
+    (1, True): 'b', (1, False): 'B',
+    (2, True): 'h', (2, False): 'H',
+    (4, True): 'i', (4, False): 'I',
+    (8, True): 'q', (8, False): 'Q',
+}
+_FLOAT_CODES = {4: 'f', 8: 'd'}
+_BYTE_ORDERS = {'little': '<', 'big': '>'}
+
+
+def _reshape(values, shape: Tuple[int, ...]) -> List[Any]:
+    """把扁平序列按多维数组的形状拆分为嵌套列表"""
+    if len(shape) <= 1:
+        return list(values)
+    step = len(values) // shape[0] if shape[0] else 0
+    return [_reshape(values[i * step:(i + 1) * step], shape[1:]) for i in range(shape[0])]
+
+
+def _sign_extend(value: int, width: int) -> int:
+    """位域的符号扩展"""
+    return value - (1 << width) if value >> (width - 1) else value
+
+
+def _c_string(raw: bytes) -> str:
+    """char数组按C字符串解码，截断到第一个NUL"""
+    return raw.split(b'\0', 1)[0].decode('utf-8', errors='replace')
+
+
+def _x87_little(raw: bytes) -> float:
+    """解码x87 80位扩展精度浮点数（小端，12/16字节存储）"""
+    mantissa = int.from_bytes(raw[:8], 'little')
+    sign_exponent = int.from_bytes(raw[8:10], 'little')
+    return _x87_value(mantissa, sign_exponent)
+
+
+def _x87_big(raw: bytes) -> float:
+    """解码x87 80位扩展精度浮点数（大端）"""
+    sign_exponent = int.from_bytes(raw[:2], 'big')
+    mantissa = int.from_bytes(raw[2:10], 'big')
+    return _x87_value(mantissa, sign_exponent)
+
+
+def _x87_value(mantissa: int, sign_exponent: int) -> float:
+    sign = -1.0 if sign_exponent >> 15 else 1.0
+    exponent = sign_exponent & 0x7fff
+    if exponent == 0x7fff:
+        return sign * math.inf if mantissa << 1 == 0 else math.nan
+    if exponent == 0 and mantissa == 0:
+        return sign * 0.0
+    return sign * math.ldexp(mantissa, exponent - 16383 - 63)
+
+
+def _x87_encode(value: float, size: int, byte_order: str) -> bytes:
+    """编码x87 80位扩展精度浮点数，按存储大小补零"""
+    sign = 0x8000 if math.copysign(1.0, value) < 0 else 0
+    if math.isnan(value):
+        sign_exponent, mantissa = sign | 0x7fff, 0xC000000000000000
+    elif math.isinf(value):
+        sign_exponent, mantissa = sign | 0x7fff, 1 << 63
+    elif value == 0:
+        sign_exponent, mantissa = sign, 0
+    else:
+        fraction, exponent = math.frexp(abs(value))
+        sign_exponent, mantissa = sign | (exponent - 1 + 16383), int(fraction * (1 << 64))
+    if byte_order == 'little':
+        raw = mantissa.to_bytes(8, 'little') + sign_exponent.to_bytes(2, 'little')
+    else:
+        raw = sign_exponent.to_bytes(2, 'big') + mantissa.to_bytes(8, 'big')
+    return raw.ljust(size, b'\0')
+
+
+def _is_sequence(value: Any) -> bool:
+    return isinstance(value, (list, tuple, array.array, StructColumns))
+
+
+def _positional(value: Any, length: int) -> List[Any]:
+    """按C初始化规则把数组初始化值展开为长度为length的列表，缺少的元素为None
+
+    支持 {[index] = value} 形式的指定初始化（解析结果中为 {index: value}），
+    之后的元素从 index + 1 继续。
+    """
+    result = [None] * length
+    if value is None:
+        return result
+    if not _is_sequence(value):
+        value = (value,)
+    position = 0
+    for item in value:
+        if isinstance(item, Mapping) and len(item) == 1:
+            key = next(iter(item))
+            if isinstance(key, int):
+                position, item = key, item[key]
+        if 0 <= position < length:
+            result[position] = item
+        position += 1
+    return result
+
+
+def _flatten(value: Any, shape: Tuple[int, ...]) -> List[Any]:
+    """把多维数组初始化值展开为扁平列表，支持省略内层花括号的写法"""
+    if len(shape) <= 1:
+        return _positional(value, shape[0] if shape else 1)
+    rows = _positional(value, shape[0])
+    if not any(_is_sequence(row) for row in rows):
+        # int a[2][3] = {1, 2, 3, 4, 5, 6};
+        return _positional(value, element_count(shape))
+    result = []
+    for row in rows:
+        result.extend(_flatten(row, shape[1:]))
+    return result
+
+
+def _bit_span(field: FieldLayout) -> Tuple[int, int]:
+    """位域实际占用的字节范围 [start, end)，相对于结构体起始位置"""
+    first = field.offset * 8 + field.bit_offset
+    return first // 8, (first + field.bit_size + 7) // 8
+
+
+class CompiledType:
+    """编译后的类型解码计划
+
+    整个类型（包括嵌套的结构体、联合体成员和数组）对应一个 struct.Struct 格式，
+    填充字节用 'x' 跳过；build 是生成的函数，把 unpack 得到的扁平元组
+    组装成与 CDataParser._fill_field_data 相同结构的值，不再逐字段解析类型。
+    """
+
+    __slots__ = ('type_name', 'array_size', 'size', 'format', 'struct', 'build', 'source')
+
+    def __init__(self, type_name: str, array_size: List[Any], packer: struct.Struct,
+                 build: Callable[[tuple], Any], source: str):
+        self.type_name = type_name
+        self.array_size = array_size
+        self.size = packer.size
+        self.format = packer.format
+        self.struct = packer
+        self.build = build
+        self.source = source
+
+    def __repr__(self) -> str:
+        return f"CompiledType({self.type_name!r}, size={self.size})"
+
+    def decode(self, buffer: Buffer, offset: int = 0) -> Any:
+        """从缓冲区的指定偏移解码一个值"""
+        return self.build(self.struct.unpack_from(buffer, offset))
+
+    def decode_many(self, buffer: Buffer) -> List[Any]:
+        """解码缓冲区中连续存放的所有记录，缓冲区长度必须是记录大小的整数倍"""
+        if not self.size:
+            return []
+        return list(map(self.build, self.struct.iter_unpack(buffer)))
+
+    def iter_decode(self, buffer: Buffer) -> Iterator[Any]:
+        """逐条解码缓冲区中连续存放的记录"""
+        if self.size:
+            for values in self.struct.iter_unpack(buffer):
+                yield self.build(values)
+
+
+class _FormatBuilder:
+    """按偏移顺序拼接 struct 格式，记录每一项在解包结果中的下标"""
+
+    def __init__(self, prefix: str):
+        self.prefix = prefix
+        self.codes: List[str] = []
+        self.position = 0
+        self.count = 0
+        self.namespace: Dict[str, Any] = {}
+
+    def pad_to(self, offset: int) -> None:
+        if offset > self.position:
+            self.codes.append(f"{offset - self.position}x")
+            self.position = offset
+
+    def item(self, offset: int, code: str, size: int, values: int = 1) -> int:
+        """在offset处追加一项，返回其第一个值的下标"""
+        if offset < self.position:
+            raise ValueError(f"布局字段重叠: offset {offset} < {self.position}")
+        self.pad_to(offset)
+        index = self.count
+        self.codes.append(code)
+        self.position = offset + size
+        self.count += values
+        return index
+
+    def helper(self, prefix: str, value: Any) -> str:
+        """把辅助对象放入生成代码的命名空间，返回其名称"""
+        name = f"_{prefix}{len(self.namespace)}"
+        self.namespace[name] = value
+        return name
+
+
+class BinaryDecoder:
+    """把内存转储、Flash镜像等二进制数据按解析得到的结构体布局解码
+
+    每个类型只编译一次：布局来自 LayoutEngine，整个记录对应一个
+    struct.Struct，解码数组时直接在缓冲区（例如mmap）上 iter_unpack，不复制数据。
+
+    用法示例：
+    ```python
+    decoder = BinaryDecoder(type_manager, abi='ARM_EABI')
+    records = decoder.decode_file('flash.bin', 'struct Record', offset=0x1000, count=512)
+    value = decoder.decode('struct Header', blob)
+    ```
+    """
+
+    def __init__(self, type_manager, abi: Optional[str] = None, byte_order: Optional[str] = None,
+                 union_members: str = 'first', char_strings: bool = True):
+        """初始化解码器
+
+        Args:
+            type_manager: 类型管理器
+            abi: 目标ABI名称，None表示类型管理器的默认ABI
+            byte_order: 字节序 little / big，None表示ABI的字节序
+            union_members: 联合体解码方式：first 只解码第一个成员（与 _fill_field_data 相同），
+                all 解码所有成员
+            char_strings: char数组是否解码为字符串（截断到NUL）
+        """
+        if union_members not in ('first', 'all'):
+            raise ValueError(f"union_members 只能是 first 或 all: {union_members}")
+        self.type_manager = type_manager
+        self.engine: LayoutEngine = type_manager.get_layout_engine(abi)
+        self.byte_order = byte_order or self.engine.abi.byte_order
+        if self.byte_order not in _BYTE_ORDERS:
+            raise ValueError(f"未知的字节序: {self.byte_order}")
+        self.union_members = union_members
+        self.char_strings = char_strings
+        self._compiled: Dict[Tuple[str, Tuple[Any, ...]], CompiledType] = {}
+
+    def clear(self) -> None:
+        """清空编译结果，类型定义变化后调用"""
+        self._compiled.clear()
+
+    def compile(self, type_name: str, array_size: Optional[List[Any]] = None) -> CompiledType:
+        """编译类型的解码计划
+
+        Args:
+            type_name: 类型名称
+            array_size: 数组维度，可选
+
+        Returns:
+            解码计划，同一类型复用
+        """
+        key = (type_name, tuple(array_size or ()))
+        compiled = self._compiled.get(key)
+        if compiled is None:
+            compiled = self._compiled[key] = self._compile(type_name, list(array_size or ()))
+        return compiled
+
+    def size_of(self, type_name: str, array_size: Optional[List[Any]] = None) -> int:
+        """类型（或数组）占用的字节数"""
+        return self.compile(type_name, array_size).size
+
+    def decode(self, type_name: str, data: Buffer, offset: int = 0,
+               array_size: Optional[List[Any]] = None) -> Any:
+        """解码单个值
+
+        Args:
+            type_name: 类型名称
+            data: 二进制数据
+            offset: 起始偏移
+            array_size: 数组维度，可选
+
+        Returns:
+            解码结果：结构体为字典，数组为列表
+        """
+        return self.compile(type_name, array_size).decode(data, offset)
+
+    def decode_array(self, type_name: str, data: Buffer, offset: int = 0,
+                     count: Optional[int] = None) -> List[Any]:
+        """解码连续存放的记录数组
+
+        Args:
+            type_name: 元素类型名称
+            data: 二进制数据
+            offset: 起始偏移
+            count: 记录数量，None表示解码到数据末尾能容纳的所有记录
+
+        Returns:
+            记录列表
+        """
+        compiled = self.compile(type_name)
+        with memoryview(data) as view:
+            with self._record_view(view, compiled.size, offset, count) as records:
+                return compiled.decode_many(records)
+
+    def iter_decode(self, type_name: str, data: Buffer, offset: int = 0,
+                    count: Optional[int] = None) -> Iterator[Any]:
+        """逐条解码连续存放的记录，适合边解码边输出"""
+        compiled = self.compile(type_name)
+        with memoryview(data) as view:
+            with self._record_view(view, compiled.size, offset, count) as records:
+                yield from compiled.iter_decode(records)
+
+    def decode_file(self, path: Union[str, Path], type_name: str, offset: int = 0,
+                    count: Optional[int] = None) -> List[Any]:
+        """通过mmap解码文件中连续存放的记录
+
+        Args:
+            path: 文件路径
+            type_name: 元素类型名称
+            offset: 起始偏移
+            count: 记录数量，None表示解码到文件末尾
+
+        Returns:
+            记录列表
+        """
+        with open(path, 'rb') as f:
+            if Path(path).stat().st_size == 0:
+                return []
+            with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mapped:
+                return self.decode_array(type_name, mapped, offset, count)
+
+    def iter_decode_file(self, path: Union[str, Path], type_name: str, offset: int = 0,
+                         count: Optional[int] = None) -> Iterator[Any]:
+        """通过mmap逐条解码文件中的记录，内存占用与文件大小无关"""
+        with open(path, 'rb') as f:
+            if Path(path).stat().st_size == 0:
+                return
+            with mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ) as mapped:
+                yield from self.iter_decode(type_name, mapped, offset, count)
+
+    @staticmethod
+    def _record_view(view: memoryview, size: int, offset: int, count: Optional[int]) -> memoryview:
+        """截取包含完整记录的切片（不复制）"""
+        available = max(len(view) - offset, 0)
+        if count is None:
+            count = available // size if size else 0
+        elif count * size > available:
+            raise ValueError(f"数据不足：需要 {count * size} 字节，偏移 {offset} 之后只有 {available} 字节")
+        return view[offset:offset + count * size]
+
+    def _compile(self, type_name: str, array_size: List[Any]) -> CompiledType:
+        builder = _FormatBuilder(_BYTE_ORDERS[self.byte_order])
+        expression = self._emit(builder, type_name, array_size, 0)
+        size = self.engine.size_of(type_name) * (element_count(array_size) if array_size else 1)
+        builder.pad_to(size)
+
+        packer = struct.Struct(builder.prefix + ''.join(builder.codes))
+        source = f"lambda v: {expression}"
+        namespace = dict(builder.namespace, _reshape=_reshape, _sx=_sign_extend,
+                         _x87_little=_x87_little, _x87_big=_x87_big)
+        build = eval(compile(source, f"<decoder {type_name}>", 'eval'), namespace)
+        if log_gate.debug:
+            logger.debug(f"编译解码器 {type_name}: size={packer.size}, format={packer.format}")
+        return CompiledType(type_name, array_size, packer, build, source)
+
+    def _emit(self, builder: _FormatBuilder, type_name: str, dimensions: List[Any], offset: int) -> str:
+        """生成在offset处解码类型的表达式，并把需要的格式项追加到builder"""
+        category, detail = self.engine.classify(type_name)
+        if category == 'array':
+            element, inner = detail
+            return self._emit(builder, element, list(dimensions) + list(inner), offset)
+
+        count = element_count(dimensions) if dimensions else 1
+        shape = tuple(d if isinstance(d, int) else (0 if d == 'dynamic' else 1) for d in dimensions)
+        if dimensions and count == 0:
+            return '[]'
+        element_size = self.engine.size_of(type_name)
+
+        if category in ('struct', 'union'):
+            if not dimensions:
+                return self._emit_composite(builder, detail, offset)
+            element = self.compile(type_name)
+            index = builder.item(offset, f"{element_size * count}s", element_size * count)
+            decode_many = builder.helper('records', element.decode_many)
+            expression = f"{decode_many}(v[{index}])"
+            return expression if len(shape) == 1 else f"_reshape({expression}, {shape!r})"
+
+        scalar = self._scalar_code(category, detail, element_size)
+        if scalar is None:
+            return 'None'
+        code, convert = scalar
+
+        if self.char_strings and category == 'basic' and detail[0] == 'char' \
+                and dimensions and len(shape) <= 2 and shape[-1]:
+            # char数组按字符串解码，二维数组为字符串列表
+            rows = count // shape[-1]
+            index = builder.item(offset, f"{shape[-1]}s" * rows, count, rows)
+            c_string = builder.helper('cstr', _c_string)
+            if len(shape) == 1:
+                return f"{c_string}(v[{index}])"
+            return f"[{c_string}(x) for x in v[{index}:{index + rows}]]"
+
+        if not dimensions:
+            index = builder.item(offset, code, element_size)
+            return f"{convert}(v[{index}])" if convert else f"v[{index}]"
+
+        formats = code * count if code.endswith('s') else f"{count}{code}"
+        index = builder.item(offset, formats, element_size * count, count)
+        values = f"v[{index}:{index + count}]"
+        if convert:
+            values = f"[{convert}(x) for x in {values}]"
+        if len(shape) > 1:
+            return f"_reshape({values}, {shape!r})"
+        return values if convert else f"list({values})"
+
+    def _scalar_code(self, category: str, detail: Any, size: int) -> Optional[Tuple[str, Optional[str]]]:
+        """标量类型的 (struct格式, 转换函数名)，无法解码时返回None"""
+        if size <= 0:
+            return None
+        if category == 'pointer':
+            return _INT_CODES.get((size, False), f"{size}s"), None
+        if category == 'enum':
+            return _INT_CODES.get((size, True), f"{size}s"), None
+        if category != 'basic':
+            return None
+        canonical, signed = detail
+        if canonical == 'bool':
+            return '?', None
+        if canonical in ('float', 'double', 'long double'):
+            if size in _FLOAT_CODES:
+                return _FLOAT_CODES[size], None
+            # x87扩展精度（ILP32为12字节、LP64为16字节存储）
+            return f"{size}s", ('_x87_little' if self.byte_order == 'little' else '_x87_big')
+        code = _INT_CODES.get((size, signed))
+        return (code, None) if code else None
+
+    def _emit_composite(self, builder: _FormatBuilder, layout: TypeLayout, base: int) -> str:
+        """生成结构体/联合体的字典表达式"""
+        if layout.kind == 'union':
+            if not layout.fields:
+                return '{}'
+            if self.union_members == 'all' and len(layout.fields) > 1:
+                index = builder.item(base, f"{layout.size}s", layout.size)
+                entries = []
+                for field in layout.fields:
+                    member = builder.helper('member', self.compile(field.type, field.array_size).decode)
+                    entries.append((field.name, f"{member}(v[{index}])"))
+                return self._dict_expression(entries)
+            first = layout.fields[0]
+            return self._dict_expression([(first.name, self._emit(builder, first.type, first.array_size or [],
+                                                                   base))])
+
+        entries = []
+        fields = layout.fields
+        i = 0
+        while i < len(fields):
+            field = fields[i]
+            if not field.is_bitfield:
+                entries.append((field.name, self._emit(builder, field.type, field.array_size or [],
+                                                       base + field.offset)))
+                i += 1
+                continue
+            # 实际占用的字节范围重叠的相邻位域合并为一个整数读取
+            group = [field]
+            start, end = _bit_span(field)
+            i += 1
+            while i < len(fields) and fields[i].is_bitfield and _bit_span(fields[i])[0] < end:
+                group.append(fields[i])
+                end = max(end, _bit_span(fields[i])[1])
+                i += 1
+            entries.extend(self._emit_bitfields(builder, group, base, start, end - start))
+        return self._dict_expression(entries)
+
+    def _emit_bitfields(self, builder: _FormatBuilder, group: List[FieldLayout], base: int, start: int,
+                        length: int) -> List[Tuple[Optional[str], str]]:
+        code = _INT_CODES.get((length, False))
+        index = builder.item(base + start, code or f"{length}s", length)
+        storage = f"v[{index}]"
+        if code is None:
+            to_int = builder.helper('int', lambda raw, order=self.byte_order: int.from_bytes(raw, order))
+            storage = f"{to_int}({storage})"
+
+        entries = []
+        for field in group:
+            position = field.offset * 8 + field.bit_offset - start * 8
+            shift = position if self.byte_order == 'little' else length * 8 - position - field.bit_size
+            expression = f"({storage} >> {shift} & {(1 << field.bit_size) - 1})"
+            category, detail = self.engine.classify(field.type)
+            if category == 'enum' or (category == 'basic' and detail[1] and detail[0] != 'bool'):
+                expression = f"_sx({expression}, {field.bit_size})"
+            entries.append((field.name, expression))
+        return entries
+
+    @staticmethod
+    def _dict_expression(entries: List[Tuple[Optional[str], str]]) -> str:
+        """拼接字典表达式；匿名的嵌套结构体/联合体成员展开到外层"""
+        parts = []
+        for name, expression in entries:
+            if name:
+                parts.append(f"{name!r}: {expression}")
+            elif expression.startswith('{'):
+                parts.append(f"**{expression}")
+        return '{' + ', '.join(parts) + '}'
+
+
+class CompiledEncoder:
+    """编译后的类型编码计划
+
+    与 CompiledType 相对：flatten 是生成的函数，把 parsed_value 形式的值
+    （结构体为字典或按位置的列表，数组为列表）展开为与 struct.Struct 格式一一对应的元组，
+    缺少的字段和元素按C语言规则补0。结构体数组逐个元素直接写入目标缓冲区。
+    """
+
+    __slots__ = ('type_name', 'array_size', 'size', 'format', 'struct', 'flatten', 'source', 'element', 'shape')
+
+    def __init__(self, type_name: str, array_size: List[Any], packer: struct.Struct,
+                 flatten: Optional[Callable[[Any], tuple]], source: str,
+                 element: Optional['CompiledEncoder'] = None, shape: Tuple[int, ...] = ()):
+        self.type_name = type_name
+        self.array_size = array_size
+        self.size = packer.size
+        self.format = packer.format
+        self.struct = packer
+        self.flatten = flatten
+        self.source = source
+        self.element = element
+        self.shape = shape
+
+    def __repr__(self) -> str:
+        return f"CompiledEncoder({self.type_name!r}, size={self.size})"
+
+    def pack_into(self, buffer: Union[bytearray, memoryview, mmap.mmap], offset: int, value: Any) -> None:
+        """把一个值写入缓冲区的指定偏移"""
+        if self.element is not None:
+            self.element.pack_many_into(buffer, offset, _flatten(value, self.shape))
+        elif self.size:
+            self.struct.pack_into(buffer, offset, *self.flatten(value))
+
+    def pack_many_into(self, buffer: Union[bytearray, memoryview, mmap.mmap], offset: int,
+                       values: Iterable[Any]) -> int:
+        """把多个值连续写入缓冲区，返回写入结束的偏移"""
+        pack_into = self.struct.pack_into
+        flatten = self.flatten
+        size = self.size
+        for value in values:
+            pack_into(buffer, offset, *flatten(value))
+            offset += size
+        return offset
+
+    def pack_array(self, value: Any, shape: Tuple[int, ...]) -> bytearray:
+        """把（多维）数组编码为字节，作为外层记录中的一项"""
+        buffer = bytearray(self.size * element_count(shape))
+        self.pack_many_into(buffer, 0, _flatten(value, shape))
+        return buffer
+
+    def encode(self, value: Any) -> bytes:
+        """编码一个值"""
+        buffer = bytearray(self.size)
+        self.pack_into(buffer, 0, value)
+        return bytes(buffer)
+
+    def encode_many(self, values: List[Any]) -> bytearray:
+        """把记录列表编码到一个预先分配的缓冲区"""
+        buffer = bytearray(self.size * len(values))
+        self.pack_many_into(buffer, 0, values)
+        return buffer
+
+
+class _FlattenBuilder(_FormatBuilder):
+    """在格式之外记录每一项的取值表达式和生成函数的语句"""
+
+    def __init__(self, prefix: str):
+        super().__init__(prefix)
+        self.lines: List[str] = []
+        self.values: List[str] = []
+
+    def variable(self) -> str:
+        return f"s{len(self.lines)}"
+
+
+class BinaryEncoder:
+    """把解析得到的初始化值（parsed_value）按结构体布局编码为编译器生成的字节镜像
+
+    与 BinaryDecoder 相对，编码计划按类型编译一次；批量编码时先计算所有变量的偏移，
+    再写入一个预先分配的 bytearray，不需要经过C编译器。
+
+    用法示例：
+    ```python
+    encoder = BinaryEncoder(type_manager, abi='ARM_EABI')
+    blob = encoder.encode('struct Config', {'id': 1, 'gain': [1.0, 2.0]})
+    image = encoder.encode_variables(parser.get_simplified_output())
+    Path('calib.bin').write_bytes(image['data'])
+    ```
+    """
+
+    def __init__(self, type_manager, abi: Optional[str] = None, byte_order: Optional[str] = None,
+                 strict: bool = True):
+        """初始化编码器
+
+        Args:
+            type_manager: 类型管理器，字符串形式的值（宏、枚举常量、表达式）通过它求值
+            abi: 目标ABI名称，None表示类型管理器的默认ABI
+            byte_order: 字节序 little / big，None表示ABI的字节序
+            strict: 遇到无法求值的值（例如指针初始化为 &symbol）时是否抛出ValueError，
+                否则写入0并记录警告
+        """
+        self.type_manager = type_manager
+        self.engine: LayoutEngine = type_manager.get_layout_engine(abi)
+        self.byte_order = byte_order or self.engine.abi.byte_order
+        if self.byte_order not in _BYTE_ORDERS:
+            raise ValueError(f"未知的字节序: {self.byte_order}")
+        self.strict = strict
+        self._compiled: Dict[Tuple[str, Tuple[Any, ...]], CompiledEncoder] = {}
+        self._converters: Dict[Tuple[str, int], Callable[[Any], Any]] = {}
+
+    def clear(self) -> None:
+        """清空编译结果，类型定义变化后调用"""
+        self._compiled.clear()
+
+    def compile(self, type_name: str, array_size: Optional[List[Any]] = None) -> CompiledEncoder:
+        """编译类型的编码计划
+
+        Args:
+            type_name: 类型名称
+            array_size: 数组维度，可选
+
+        Returns:
+            编码计划，同一类型复用
+        """
+        key = (type_name, tuple(array_size or ()))
+        compiled = self._compiled.get(key)
+        if compiled is None:
+            compiled = self._compiled[key] = self._compile(type_name, list(array_size or ()))
+        return compiled
+
+    def size_of(self, type_name: str, array_size: Optional[List[Any]] = None) -> int:
+        """类型（或数组）占用的字节数"""
+        return self.compile(type_name, array_size).size
+
+    def encode(self, type_name: str, value: Any, array_size: Optional[List[Any]] = None) -> bytes:
+        """编码单个值
+
+        Args:
+            type_name: 类型名称
+            value: parsed_value 形式的值
+            array_size: 数组维度，可选
+
+        Returns:
+            字节镜像
+        """
+        return self.compile(type_name, array_size).encode(value)
+
+    def encode_into(self, buffer: Union[bytearray, memoryview, mmap.mmap], offset: int, type_name: str,
+                    value: Any, array_size: Optional[List[Any]] = None) -> int:
+        """把值写入已有缓冲区
+
+        Returns:
+            写入的字节数
+        """
+        compiled = self.compile(type_name, array_size)
+        compiled.pack_into(buffer, offset, value)
+        return compiled.size
+
+    def encode_array(self, type_name: str, values: List[Any]) -> bytearray:
+        """把同一类型的记录列表编码为连续存放的数组"""
+        return self.compile(type_name).encode_many(values)
+
+    def encode_variables(self, variables: Union[Dict[str, Any], List[Dict[str, Any]]]) -> Dict[str, Any]:
+        """把多个变量编码到一个字节镜像中
+
+        变量按顺序存放，每个变量按其类型的对齐要求对齐。先计算全部偏移，
+        再写入一个预先分配的 bytearray。
+
+        Args:
+            variables: get_simplified_output() 的结果、parse_file() 的完整结果，
+                或包含 name/type/array_size/parsed_value 的变量列表
+
+        Returns:
+            {'data': bytearray, 'symbols': [{'name', 'type', 'offset', 'size'}], 'skipped': [变量名]}
+        """
+        placements = []
+        skipped = []
+        offset = 0
+        for var in self._iter_variables(variables):
+            value = var.get('parsed_value')
+            dimensions = self._dimensions(var.get('array_size'), value)
+            compiled = self.compile(var.get('type', ''), dimensions)
+            if not compiled.size:
+                logger.warning(f"跳过未知类型或大小为0的变量: {var.get('name')} ({var.get('type')})")
+                skipped.append(var.get('name'))
+                continue
+            alignment = self.engine.alignment_of(var['type']) or 1
+            offset = (offset + alignment - 1) // alignment * alignment
+            placements.append((var, compiled, offset))
+            offset += compiled.size
+
+        data = bytearray(offset)
+        symbols = []
+        for var, compiled, position in placements:
+            try:
+                compiled.pack_into(data, position, var.get('parsed_value'))
+            except (ValueError, TypeError, struct.error) as e:
+                raise ValueError(f"变量 {var.get('name')} 编码失败: {e}") from e
+            symbols.append({'name': var.get('name'), 'type': var['type'], 'offset': position,
+                            'size': compiled.size})
+
+        logger.info(f"编码 {len(symbols)} 个变量，共 {len(data)} 字节")
+        return {'data': data, 'symbols': symbols, 'skipped': skipped}
+
+    @staticmethod
+    def _iter_variables(variables: Union[Dict[str, Any], List[Dict[str, Any]]]) -> Iterator[Dict[str, Any]]:
+        """遍历简化输出、完整输出（按分类存放）或变量列表中的变量"""
+        if isinstance(variables, dict):
+            variables = variables.get('variables', [])
+        if isinstance(variables, dict):
+            for category in ('struct_vars', 'array_vars', 'pointer_vars', 'variables'):
+                yield from variables.get(category, [])
+            return
+        yield from variables
+
+    @staticmethod
+    def _dimensions(array_size: Optional[List[Any]], value: Any) -> List[Any]:
+        """数组维度，尚未确定的动态维度按初始化值推断"""
+        dimensions = list(array_size or [])
+        current = value
+        for i, dimension in enumerate(dimensions):
+            if not isinstance(dimension, int):
+                dimensions[i] = len(current) if _is_sequence(current) else 1
+            current = current[0] if _is_sequence(current) and len(current) else None
+        return dimensions
+
+    def _resolve(self, value: Any) -> Union[int, float]:
+        """把初始化值转换为数值：None为0，字符串按常量表达式求值（宏、枚举常量）"""
+        if value is None:
+            return 0
+        if isinstance(value, (int, float)):
+            return value
+        if isinstance(value, str):
+            try:
+                result, kind = self.type_manager.evaluate_expression(value)
+            except Exception:
+                result, kind = None, None
+            if kind == 'number' and isinstance(result, (int, float)):
+                return result
+            if len(value) == 1:
+                # 字符字面量解析失败时保留为去掉引号的单个字符
+                return ord(value)
+        if self.strict:
+            raise ValueError(f"无法编码的值: {value!r}")
+        logger.warning(f"无法编码的值 {value!r}，写入0")
+        return 0
+
+    def _converter(self, kind: str, size: int) -> Callable[[Any], Any]:
+        """标量的转换函数：整数按C语言规则截断为无符号存储值"""
+        key = (kind, size)
+        converter = self._converters.get(key)
+        if converter is not None:
+            return converter
+        resolve = self._resolve
+        if kind == 'float':
+            def converter(value):
+                return value if value.__class__ is float else float(resolve(value))
+        elif kind == 'long double':
+            order = self.byte_order
+
+            def converter(value):
+                return _x87_encode(float(resolve(value)), size, order)
+        elif kind == 'bool':
+            def converter(value):
+                return bool(resolve(value))
+        else:
+            mask = (1 << size * 8) - 1
+            if (size, False) in _INT_CODES:
+                def converter(value):
+                    return (value if value.__class__ is int else int(resolve(value))) & mask
+            else:
+                order = self.byte_order
+
+                def converter(value):
+                    return ((value if value.__class__ is int else int(resolve(value))) & mask).to_bytes(size, order)
+        self._converters[key] = converter
+        return converter
+
+    def _char_rows(self, value: Any, shape: Tuple[int, ...]) -> List[bytes]:
+        """char数组的每一行编码为字节串：字符串按UTF-8编码，数值列表逐个截断为字节"""
+        rows = [value] if len(shape) == 1 else _flatten(value, shape[:-1])
+        to_int = self._converter('int', 1)
+        result = []
+        for row in rows:
+            if row is None:
+                result.append(b'')
+            elif isinstance(row, str):
+                result.append(row.encode('utf-8'))
+            elif isinstance(row, (bytes, bytearray)):
+                result.append(bytes(row))
+            else:
+                result.append(bytes(map(to_int, _positional(row, shape[-1]))))
+        return result
+
+    def _compile(self, type_name: str, array_size: List[Any]) -> CompiledEncoder:
+        element_type, dimensions = type_name, list(array_size)
+        category, detail = self.engine.classify(element_type)
+        while category == 'array':
+            element_type, dimensions = detail[0], dimensions + list(detail[1])
+            category, detail = self.engine.classify(element_type)
+        size = self.engine.size_of(type_name) * (element_count(array_size) if array_size else 1)
+        prefix = _BYTE_ORDERS[self.byte_order]
+
+        if category in ('struct', 'union') and dimensions:
+            # 结构体数组不展开为一个大格式，逐个元素写入
+            element = self.compile(element_type)
+            shape = tuple(d if isinstance(d, int) else 0 for d in dimensions)
+            return CompiledEncoder(type_name, array_size, struct.Struct(f"{prefix}{size}x"), None, '',
+                                   element if element.size else None, shape)
+
+        builder = _FlattenBuilder(prefix)
+        self._emit(builder, element_type, dimensions, 0, 'v')
+        builder.pad_to(size)
+        packer = struct.Struct(builder.prefix + ''.join(builder.codes))
+
+        body = ''.join(f"    {line}\n" for line in builder.lines)
+        values = ', '.join(builder.values)
+        source = f"def flatten(v):\n{body}    return ({values}{',' if len(builder.values) == 1 else ''})\n"
+        namespace = dict(builder.namespace)
+        exec(compile(source, f"<encoder {type_name}>", 'exec'), namespace)
+        if log_gate.debug:
+            logger.debug(f"编译编码器 {type_name}: size={packer.size}, format={packer.format}")
+        return CompiledEncoder(type_name, array_size, packer, namespace['flatten'], source)
+
+    def _emit(self, builder: _FlattenBuilder, type_name: str, dimensions: List[Any], offset: int,
+              source: str) -> None:
+        """把在offset处编码source的格式项和取值表达式追加到builder"""
+        category, detail = self.engine.classify(type_name)
+        if category == 'array':
+            element, inner = detail
+            return self._emit(builder, element, list(dimensions) + list(inner), offset, source)
+
+        count = element_count(dimensions) if dimensions else 1
+        shape = tuple(d if isinstance(d, int) else (0 if d == 'dynamic' else 1) for d in dimensions)
+        if dimensions and count == 0:
+            return
+        element_size = self.engine.size_of(type_name)
+
+        if category in ('struct', 'union'):
+            if not dimensions:
+                return self._emit_composite(builder, detail, offset, source)
+            element = self.compile(type_name)
+            builder.item(offset, f"{element_size * count}s", element_size * count)
+            pack_array = builder.helper('records', partial(element.pack_array, shape=shape))
+            builder.values.append(f"{pack_array}({source})")
+            return
+
+        scalar = self._scalar_code(category, detail, element_size)
+        if scalar is None:
+            # 未知类型保持为0
+            return
+        code, convert = scalar
+        convert = builder.helper('convert', convert)
+
+        if category == 'basic' and detail[0] == 'char' and dimensions and shape[-1]:
+            rows = count // shape[-1]
+            builder.item(offset, f"{shape[-1]}s" * rows, count, rows)
+            char_rows = builder.helper('chars', partial(self._char_rows, shape=shape))
+            builder.values.append(f"*{char_rows}({source})")
+            return
+
+        if not dimensions:
+            builder.item(offset, code, element_size)
+            builder.values.append(f"{convert}({source})")
+            return
+
+        formats = code * count if code.endswith('s') else f"{count}{code}"
+        builder.item(offset, formats, element_size * count, count)
+        flatten = builder.helper('flatten', partial(_flatten, shape=shape))
+        builder.values.append(f"*map({convert}, {flatten}({source}))")
+
+    def _scalar_code(self, category: str, detail: Any, size: int) -> Optional[Tuple[str, Callable[[Any], Any]]]:
+        """标量类型的 (struct格式, 转换函数)，无法编码时返回None"""
+        if size <= 0:
+            return None
+        if category in ('pointer', 'enum'):
+            return _INT_CODES.get((size, False), f"{size}s"), self._converter('int', size)
+        if category != 'basic':
+            return None
+        canonical, _ = detail
+        if canonical == 'bool':
+            return '?', self._converter('bool', size)
+        if canonical in ('float', 'double', 'long double'):
+            if size in _FLOAT_CODES:
+                return _FLOAT_CODES[size], self._converter('float', size)
+            return f"{size}s", self._converter('long double', size)
+        return _INT_CODES.get((size, False), f"{size}s"), self._converter('int', size)
+
+    def _emit_composite(self, builder: _FlattenBuilder, layout: TypeLayout, base: int, source: str) -> None:
+        """结构体按字段逐个展开；联合体按实际初始化的成员编码为一项字节串"""
+        if layout.kind == 'union':
+            if layout.fields and layout.size:
+                builder.item(base, f"{layout.size}s", layout.size)
+                union = builder.helper('union', self._union_encoder(layout))
+                builder.values.append(f"{union}({source})")
+            return
+
+        values = builder.variable()
+        select = builder.helper('fields', self._field_selector(layout))
+        builder.lines.append(f"{values} = {select}({source})")
+
+        fields = layout.fields
+        i = 0
+        while i < len(fields):
+            field = fields[i]
+            if not field.is_bitfield:
+                self._emit(builder, field.type, field.array_size or [], base + field.offset, f"{values}[{i}]")
+                i += 1
+                continue
+            # 与解码相同：实际占用的字节范围重叠的相邻位域合并为一个整数
+            group = [(i, field)]
+            start, end = _bit_span(field)
+            i += 1
+            while i < len(fields) and fields[i].is_bitfield and _bit_span(fields[i])[0] < end:
+                group.append((i, fields[i]))
+                end = max(end, _bit_span(fields[i])[1])
+                i += 1
+            self._emit_bitfields(builder, group, values, base, start, end - start)
+
+    def _emit_bitfields(self, builder: _FlattenBuilder, group: List[Tuple[int, FieldLayout]], values: str,
+                        base: int, start: int, length: int) -> None:
+        code = _INT_CODES.get((length, False))
+        builder.item(base + start, code or f"{length}s", length)
+        to_int = builder.helper('int', self._converter('int', 8))
+        parts = []
+        for index, field in group:
+            position = field.offset * 8 + field.bit_offset - start * 8
+            shift = position if self.byte_order == 'little' else length * 8 - position - field.bit_size
+            parts.append(f"({to_int}({values}[{index}]) & {(1 << field.bit_size) - 1}) << {shift}")
+        expression = ' | '.join(parts)
+        if code is None:
+            expression = f"({expression}).to_bytes({length}, {self.byte_order!r})"
+        builder.values.append(expression)
+
+    def _field_selector(self, layout: TypeLayout) -> Callable[[Any], List[Any]]:
+        """生成按字段顺序取出结构体初始化值的函数
+
+        字典按字段名取值；列表按位置取值，可包含 {.field = value}（解析结果中为 {field: value}），
+        之后的值从该字段的下一个字段继续。匿名的嵌套结构体/联合体成员从外层字典取值。
+        """
+        fields = layout.fields
+        count = len(fields)
+        names = {field.name: i for i, field in enumerate(fields) if field.name}
+        anonymous = [i for i, field in enumerate(fields)
+                     if not field.name and self.engine.classify(field.type)[0] in ('struct', 'union')]
+        order = [i for i, field in enumerate(fields) if field.name or i in anonymous]
+        position_of = {index: position for position, index in enumerate(order)}
+
+        def select(value: Any) -> List[Any]:
+            result = [None] * count
+            if value is None:
+                return result
+            if isinstance(value, Mapping):
+                for name, item in value.items():
+                    index = names.get(name)
+                    if index is not None:
+                        result[index] = item
+                for index in anonymous:
+                    result[index] = value
+                return result
+            if not _is_sequence(value):
+                value = (value,)
+            position = 0
+            for item in value:
+                if isinstance(item, Mapping) and len(item) == 1:
+                    index = names.get(next(iter(item)))
+                    if index is not None:
+                        position, item = position_of[index], next(iter(item.values()))
+                if position < len(order):
+                    result[order[position]] = item
+                position += 1
+            return result
+
+        return select
+
+    def _union_encoder(self, layout: TypeLayout) -> Callable[[Any], bytes]:
+        """生成联合体的编码函数：字典按出现的成员名选择成员，否则为第一个成员"""
+        fields = [field for field in layout.fields if field.name]
+        names = {field.name: i for i, field in enumerate(fields)}
+        if not fields:
+            return lambda value: b''
+        members: Dict[int, CompiledEncoder] = {}
+
+        def encode(value: Any) -> bytes:
+            index = 0
+            if isinstance(value, Mapping):
+                for name, item in value.items():
+                    if name in names:
+                        index, value = names[name], item
+                        break
+                else:
+                    value = None
+            elif _is_sequence(value):
+                items = list(value)
+                value = items[0] if items else None
+                if isinstance(value, Mapping) and len(value) == 1 and next(iter(value)) in names:
+                    name, value = next(iter(value.items()))
+                    index = names[name]
+            member = members.get(index)
+            if member is None:
+                member = members[index] = self.compile(fields[index].type, fields[index].array_size)
+            return member.encode(value)
+
+        return encode
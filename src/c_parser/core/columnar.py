@@ -0,0 +1,341 @@
+import array
+import json
+import struct
+import sys
+from collections.abc import Sequence
+from pathlib import Path
+from typing import Dict, Any, List, Optional, Tuple, Union
+from loguru import logger
+from utils.metrics import timed_phase
+
+logger = logger.bind(name="Columnar")
+
+__all__ = ['StructColumns', 'ColumnBuilder', 'numeric_typecode', 'write_columns', 'read_columns']
+
+# 整数按 (size, signed) 选择array类型码，同宽度时优先使用较短的类型
+_INT_TYPECODES = {(array.array(code).itemsize, code.islower()): code for code in 'qQlLiIhHbB'}
+_FLOAT_TYPECODES = {'float': 'f', 'double': 'd'}
+
+# 展开为独立列的定长数组字段的最大长度，更长的数组整体保存在对象列中
+MAX_FLATTENED_ARRAY = 64
+
+# 紧凑二进制格式：魔数、版本、头部长度，头部为JSON，列数据按8字节对齐
+_MAGIC = b'SCOL'
+_VERSION = 1
+_PREFIX = struct.Struct('<4sBxxxI')
+_ALIGNMENT = 8
+
+ColumnKey = Tuple[Union[str, int], ...]
+
+
+def numeric_typecode(type_info: Dict[str, Any], basic_types: Dict[str, Dict[str, Any]]) -> Optional[str]:
+    """获取基本数值类型对应的array类型码
+
+    Args:
+        type_info: resolve_type 的结果
+        basic_types: TypeManager.BASIC_TYPES
+
+    Returns:
+        类型码，不是基本数值类型时返回None
+    """
+    base_type = type_info.get('base_type')
+    if base_type in _FLOAT_TYPECODES:
+        return _FLOAT_TYPECODES[base_type]
+    basic_info = basic_types.get(base_type)
+    if not basic_info:
+        return None
+    return _INT_TYPECODES.get((basic_info['size'], basic_info['signed']))
+
+
+def _column_path(keys: ColumnKey) -> str:
+    """列名：字段用.连接，数组下标写成[i]"""
+    path = ''
+    for key in keys:
+        if isinstance(key, int):
+            path += f'[{key}]'
+        else:
+            path += f'.{key}' if path else key
+    return path
+
+
+class StructColumns(Sequence):
+    """结构体数组的列式存储（struct-of-arrays）
+
+    每个叶子字段一列，嵌套结构体字段按路径展开（``pos.x``），短的定长数值数组
+    按下标展开（``gain[0]``）。数值列为 array.array，其余字段（指针、字符串、
+    联合体、表达式）保存在列表中。
+
+    按下标访问时重新组装为dict，与行式结果的元素相同；未初始化的数值字段按C语义为0。
+    JSON输出为 ``{"type", "length", "columns"}``，见 json_default。
+    """
+
+    def __init__(self, type_name: str, length: int, columns: Dict[str, Union[array.array, List[Any]]],
+                 keys: Dict[str, ColumnKey]):
+        self.type_name = type_name
+        self.length = length
+        self.columns = columns
+        self.keys = keys
+
+    def __len__(self) -> int:
+        return self.length
+
+    def __getitem__(self, index):
+        if isinstance(index, slice):
+            return [self[i] for i in range(*index.indices(self.length))]
+        if index < 0:
+            index += self.length
+        if not 0 <= index < self.length:
+            raise IndexError(index)
+        row: Dict[Any, Any] = {}
+        for path, column in self.columns.items():
+            _assign(row, self.keys[path], column[index])
+        return row
+
+    def __eq__(self, other: Any) -> bool:
+        if isinstance(other, StructColumns):
+            return (self.type_name, self.length, self.keys) == (other.type_name, other.length, other.keys) \
+                and all(list(column) == list(other.columns[path]) for path, column in self.columns.items())
+        if isinstance(other, list):
+            return list(self) == other
+        return NotImplemented
+
+    def __repr__(self) -> str:
+        return f"StructColumns({self.type_name!r}, length={self.length}, columns={list(self.columns)})"
+
+    def column(self, path: str) -> Union[array.array, List[Any]]:
+        """获取一列，path 为 columns 中的列名"""
+        return self.columns[path]
+
+    @property
+    def nbytes(self) -> int:
+        """数值列占用的字节数"""
+        return sum(len(column) * column.itemsize for column in self.columns.values()
+                   if isinstance(column, array.array))
+
+    def to_dict(self) -> Dict[str, Any]:
+        """转换为可JSON序列化的列式表示"""
+        return {
+            'type': self.type_name,
+            'length': self.length,
+            'columns': {path: column.tolist() if isinstance(column, array.array) else column
+                        for path, column in self.columns.items()},
+        }
+
+
+def _assign(row: Dict[Any, Any], keys: ColumnKey, value: Any) -> None:
+    """按列路径把值放回嵌套的dict/list"""
+    target: Any = row
+    for position, key in enumerate(keys):
+        last = position == len(keys) - 1
+        next_is_index = not last and isinstance(keys[position + 1], int)
+        if isinstance(key, int):
+            # 展开的数组下标从0连续，按顺序追加
+            if last:
+                target.append(value)
+                return
+            if key == len(target):
+                target.append([] if next_is_index else {})
+            target = target[key]
+        elif last:
+            target[key] = value
+        else:
+            if key not in target:
+                target[key] = [] if next_is_index else {}
+            target = target[key]
+
+
+def _extract(row: Any, keys: ColumnKey) -> Any:
+    """按列路径从一行中取值，缺少的字段返回None"""
+    value = row
+    for key in keys:
+        try:
+            value = value[key]
+        except (KeyError, IndexError, TypeError):
+            return None
+    return value
+
+
+class ColumnBuilder:
+    """按结构体定义逐行构建 StructColumns
+
+    列结构在创建时由类型定义展开一次，每行只做按路径取值和追加。
+
+    用法示例：
+    ```python
+    builder = ColumnBuilder(type_manager, info)
+    for row in rows:
+        builder.append(row)
+    columns = builder.build()
+    ```
+    """
+
+    def __init__(self, type_manager, info: Dict[str, Any]):
+        """初始化
+
+        Args:
+            type_manager: TypeManager，用于解析字段类型
+            info: 结构体定义（包含 name 和 fields）
+        """
+        self.type_manager = type_manager
+        self.type_name = info.get('name') or ''
+        self.length = 0
+        # (列名, 键路径, 类型码或None, 列)
+        self._leaves: List[Tuple[str, ColumnKey, Optional[str], Union[array.array, List[Any]]]] = []
+        self._plan(info, ())
+
+    def _plan(self, info: Dict[str, Any], prefix: ColumnKey) -> None:
+        """展开结构体字段为叶子列"""
+        for field in info.get('fields', []):
+            name = field.get('name')
+            if name is None:
+                continue
+            keys = prefix + (name,)
+            field_type = self.type_manager.resolve_type_shared(field['type'])
+            array_size = field.get('array_size')
+            typecode = None
+            if not field_type['is_pointer']:
+                if field_type['is_enum']:
+                    typecode = 'i'
+                else:
+                    typecode = numeric_typecode(field_type, self.type_manager.BASIC_TYPES)
+
+            if field_type['is_pointer'] or field_type['is_union']:
+                self._add_leaf(keys, None)
+            elif array_size:
+                # char 数组通常以字符串初始化，不按下标展开
+                if (len(array_size) == 1 and isinstance(array_size[0], int)
+                        and 0 < array_size[0] <= MAX_FLATTENED_ARRAY and typecode
+                        and field_type.get('base_type') != 'char'):
+                    for index in range(array_size[0]):
+                        self._add_leaf(keys + (index,), typecode)
+                else:
+                    self._add_leaf(keys, None)
+            elif field_type['is_struct'] and (field_type.get('info') or {}).get('fields'):
+                self._plan(field_type['info'], keys)
+            else:
+                self._add_leaf(keys, typecode)
+
+    def _add_leaf(self, keys: ColumnKey, typecode: Optional[str]) -> None:
+        column = array.array(typecode) if typecode else []
+        self._leaves.append((_column_path(keys), keys, typecode, column))
+
+    def append(self, row: Any) -> None:
+        """追加一行（结构体值）"""
+        for position, (path, keys, typecode, column) in enumerate(self._leaves):
+            value = _extract(row, keys)
+            if typecode is None:
+                column.append(value)
+                continue
+            try:
+                column.append(0 if value is None else value)
+            except (TypeError, OverflowError):
+                # 表达式字符串或超出范围的值：该列改为对象列
+                column = column.tolist()
+                column.append(value)
+                self._leaves[position] = (path, keys, None, column)
+        self.length += 1
+
+    def build(self) -> StructColumns:
+        """生成 StructColumns"""
+        return StructColumns(self.type_name, self.length,
+                             {path: column for path, _, _, column in self._leaves},
+                             {path: keys for path, keys, _, _ in self._leaves})
+
+
+def write_columns(columns: StructColumns, path: Union[str, Path]) -> None:
+    """导出列式数据
+
+    扩展名为 .parquet 时使用 pyarrow 写出Parquet文件（需要安装pyarrow），
+    其他扩展名写出紧凑二进制格式：JSON头部描述列，数值列为原始字节，对象列为JSON。
+
+    Args:
+        columns: 列式数据
+        path: 输出文件路径
+    """
+    with timed_phase('export'):
+        _write_columns(columns, Path(path))
+
+
+def _write_columns(columns: StructColumns, path: Path) -> None:
+    if path.suffix == '.parquet':
+        _write_parquet(columns, path)
+        return
+
+    header_columns = []
+    blobs = []
+    offset = 0
+    for name, column in columns.columns.items():
+        if isinstance(column, array.array):
+            data = column.tobytes()
+            typecode = column.typecode
+        else:
+            data = json.dumps(column, ensure_ascii=False, default=str).encode('utf-8')
+            typecode = None
+        header_columns.append({'path': name, 'keys': list(columns.keys[name]), 'typecode': typecode,
+                               'offset': offset, 'nbytes': len(data)})
+        padding = -len(data) % _ALIGNMENT
+        blobs.append(data + b'\0' * padding)
+        offset += len(data) + padding
+
+    header = json.dumps({'type': columns.type_name, 'length': columns.length,
+                         'byteorder': sys.byteorder, 'columns': header_columns},
+                        ensure_ascii=False).encode('utf-8')
+    header += b' ' * (-(len(header) + _PREFIX.size) % _ALIGNMENT)
+    with open(path, 'wb') as f:
+        f.write(_PREFIX.pack(_MAGIC, _VERSION, len(header)))
+        f.write(header)
+        for blob in blobs:
+            f.write(blob)
+    logger.info(f"Exported {len(header_columns)} columns of {columns.type_name} to {path}")
+
+
+def read_columns(path: Union[str, Path]) -> StructColumns:
+    """读取 write_columns 写出的紧凑二进制文件
+
+    Args:
+        path: 文件路径
+
+    Returns:
+        StructColumns
+    """
+    data = Path(path).read_bytes()
+    magic, version, header_size = _PREFIX.unpack_from(data)
+    if magic != _MAGIC or version != _VERSION:
+        raise ValueError(f"Not a columnar file: {path}")
+    header = json.loads(data[_PREFIX.size:_PREFIX.size + header_size])
+    base = _PREFIX.size + header_size
+    view = memoryview(data)
+
+    columns: Dict[str, Union[array.array, List[Any]]] = {}
+    keys: Dict[str, ColumnKey] = {}
+    for entry in header['columns']:
+        chunk = view[base + entry['offset']:base + entry['offset'] + entry['nbytes']]
+        if entry['typecode']:
+            column = array.array(entry['typecode'])
+            column.frombytes(chunk)
+            if header['byteorder'] != sys.byteorder:
+                column.byteswap()
+        else:
+            column = json.loads(bytes(chunk))
+        columns[entry['path']] = column
+        keys[entry['path']] = tuple(entry['keys'])
+    return StructColumns(header['type'], header['length'], columns, keys)
+
+
+def _write_parquet(columns: StructColumns, path: Path) -> None:
+    """使用pyarrow写出Parquet，对象列的值编码为JSON字符串"""
+    try:
+        import pyarrow
+        import pyarrow.parquet
+    except ImportError as e:
+        raise RuntimeError("Parquet export requires pyarrow") from e
+
+    arrays = {}
+    for name, column in columns.columns.items():
+        if isinstance(column, array.array):
+            arrays[name] = pyarrow.array(column)
+        else:
+            arrays[name] = pyarrow.array([json.dumps(value, ensure_ascii=False, default=str) for value in column])
+    table = pyarrow.table(arrays).replace_schema_metadata({'type': columns.type_name})
+    pyarrow.parquet.write_table(table, str(path))
+    logger.info(f"Exported {len(arrays)} columns of {columns.type_name} to {path}")
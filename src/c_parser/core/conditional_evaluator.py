@@ -0,0 +1,191 @@
+from typing import Dict, Any, Iterator, Optional, Set, Tuple
+from tree_sitter import Node
+from loguru import logger
+from utils.logger import log_gate
+from utils.metrics import count
+from .tree_sitter_utils import TreeSitterUtils
+from .expression_engine import EvaluationError, INT
+
+logger = logger.bind(name="ConditionalEvaluator")
+
+__all__ = ['ConditionalEvaluator', 'CONDITIONAL_NODES']
+
+# 条件编译块（#if / #ifdef / #ifndef），#elif / #elifdef 作为其分支出现
+CONDITIONAL_NODES = frozenset({'preproc_if', 'preproc_ifdef', 'preproc_ifndef'})
+# 条件编译块中表示后续分支的子节点
+_ALTERNATIVE_NODES = frozenset({'preproc_elif', 'preproc_elifdef', 'preproc_else'})
+# 缓存中表示宏未定义的值
+_UNDEFINED = object()
+
+
+class _PreprocessorSymbols:
+    """#if 条件求值使用的符号视图
+
+    与预处理器的规则一致：未定义的标识符（包括枚举常量）值为0；
+    已定义的宏通过 TypeManager 的符号表求值，无法求值时条件无法判定。
+    """
+
+    __slots__ = ('evaluator',)
+
+    def __init__(self, evaluator: 'ConditionalEvaluator'):
+        self.evaluator = evaluator
+
+    def lookup(self, name: str):
+        if not self.evaluator.is_defined(name):
+            return 0, INT
+        value = self.evaluator.type_manager.symbols.lookup(name)
+        if value is None:
+            raise EvaluationError(f"macro is not a constant: {name}")
+        return value
+
+    def is_defined(self, name: str) -> bool:
+        return self.evaluator.is_defined(name)
+
+
+class ConditionalEvaluator:
+    """按已定义的宏判定条件编译块中成立的分支
+
+    #ifdef / #ifndef 按宏是否定义判定，#if / #elif 的条件由表达式引擎编译求值
+    （支持 defined 运算符）。宏来自 TypeManager：配置的宏
+    （ParserConfig.macro_definitions、命令行 -D，见 TypeManager.define_macros）
+    和解析到该位置为止的 #define。
+
+    条件无法判定时（例如函数式宏调用、值不是常量的宏），该块从这个分支开始
+    的所有分支都保留，与不求值时相同，不会丢失类型定义。
+
+    判定结果按 (条件文本, 条件引用的宏的值) 缓存，同一宏集合下重复出现的条件
+    （例如RTOS配置头文件中的 #if configUSE_XXX == 1）只求值一次；
+    缓存键包含宏的值，宏集合不同时不会误用，同一对象可以在多个文件间复用。
+
+    用法示例：
+    ```python
+    evaluator = ConditionalEvaluator(type_manager)
+    for child in evaluator.active_children(node):   # node 为 preproc_if 等
+        parser._parse_tree(child)
+    ```
+    """
+
+    # 判定结果缓存的最大条目数，超出后整体清空
+    MAX_CACHED = 65536
+
+    def __init__(self, type_manager):
+        """初始化
+
+        Args:
+            type_manager: TypeManager，提供宏定义和表达式编译
+        """
+        self.type_manager = type_manager
+        self._symbols = _PreprocessorSymbols(self)
+        # 函数式宏（#define F(x) ...）不登记到类型表，只记录名称用于 defined / #ifdef
+        self.function_macros: Set[str] = set()
+        self._results: Dict[Tuple[str, Tuple[Any, ...]], Optional[bool]] = {}
+
+    def is_defined(self, name: str) -> bool:
+        """宏是否已定义"""
+        return self.type_manager.has_macro(name) or name in self.function_macros
+
+    def define_function_macro(self, name: str) -> None:
+        """记录函数式宏的名称"""
+        self.function_macros.add(name)
+
+    def active_children(self, node: Node) -> Iterator[Node]:
+        """条件编译块中需要遍历的子节点
+
+        只产生成立的分支中的节点，不成立的分支不遍历。某个分支的条件无法判定时，
+        产生该分支及之后所有分支的节点。
+
+        Args:
+            node: preproc_if / preproc_ifdef 节点
+
+        Yields:
+            分支中的子节点，按源码顺序（包含条件表达式节点，调用方按普通节点忽略）
+        """
+        decided = True
+        while node is not None:
+            taken = self.evaluate(node) if decided else None
+            if taken is None:
+                decided = False
+            alternative = None
+            for child in TreeSitterUtils.iter_children(node):
+                if child.type in _ALTERNATIVE_NODES:
+                    alternative = child
+                elif taken is not False:
+                    yield child
+            if taken:
+                return
+            if taken is False:
+                count('preproc_skipped_branches')
+            node = alternative
+
+    def evaluate(self, node: Node) -> Optional[bool]:
+        """判定单个分支的条件
+
+        Args:
+            node: preproc_if / preproc_ifdef / preproc_elif / preproc_elifdef / preproc_else 节点
+
+        Returns:
+            成立返回True，不成立返回False，无法判定返回None
+        """
+        if node.type == 'preproc_else':
+            return True
+        if node.type in ('preproc_ifdef', 'preproc_ifndef', 'preproc_elifdef'):
+            name = node.child_by_field_name('name')
+            if name is None:
+                return None
+            defined = self.is_defined(name.text.decode('utf8'))
+            # 第一个子节点为指令本身：#ifdef / #ifndef / #elifdef / #elifndef
+            return not defined if node.children[0].type.endswith('ndef') else defined
+        condition = node.child_by_field_name('condition')
+        if condition is None:
+            return None
+        return self.evaluate_condition(condition.text.decode('utf8'))
+
+    def evaluate_condition(self, text: str) -> Optional[bool]:
+        """求值 #if / #elif 的条件表达式
+
+        Returns:
+            条件是否成立，无法判定时返回None
+        """
+        text = text.replace('\\\n', ' ').strip()
+        try:
+            compiled = self.type_manager.symbols.compile(text)
+        except EvaluationError as e:
+            if log_gate.debug:
+                logger.debug(f"Cannot compile condition {text!r}: {e}")
+            return None
+
+        key = self._cache_key(text, compiled.names)
+        if key is not None and key in self._results:
+            count('preproc_condition_cache_hits')
+            return self._results[key]
+
+        try:
+            result: Optional[bool] = bool(compiled.evaluate(self._symbols)[0])
+        except EvaluationError as e:
+            if log_gate.debug:
+                logger.debug(f"Cannot evaluate condition {text!r}: {e}")
+            result = None
+        if key is not None:
+            if len(self._results) >= self.MAX_CACHED:
+                self._results.clear()
+            self._results[key] = result
+        return result
+
+    def _cache_key(self, text: str, names: Set[str]) -> Optional[Tuple[str, Tuple[Any, ...]]]:
+        """由条件文本和引用的宏的值组成缓存键
+
+        宏的值是引用其他宏的表达式时，结果还取决于间接引用的宏，不缓存，返回None。
+        """
+        values = []
+        for name in sorted(names):
+            if name in self.function_macros:
+                values.append((name, '()'))
+                continue
+            if not self.type_manager.has_macro(name):
+                values.append((name, _UNDEFINED))
+                continue
+            value = self.type_manager.get_macro_definition(name)
+            if isinstance(value, str) and value.strip():
+                return None
+            values.append((name, value))
+        return text, tuple(values)
@@ -1,4 +1,4 @@
-from typing import Dict, Any, List, Optional
+from typing import Dict, Any, List, Optional, Tuple
 from utils.logger import logger 
 from .type_manager import TypeManager
 
@@ -15,18 +15,48 @@ class DataManager:
             'pointer_vars': [], # 指针变量
             'array_vars': [],   # 数组变量
         }
+        # 流式输出：设置后变量直接写出，不再保存在 variables 中
+        self.writers = []
+        self.variable_counts = {category: 0 for category in self.variables}
         
-    def add_variable(self, var_info: Dict[str, Any]) -> None:
-        """添加变量定义"""
+    def add_writer(self, writer) -> None:
+        """添加流式输出，writer需提供 write_variable(var_info, category)"""
+        self.writers.append(writer)
+        
+    def classify_variable(self, var_info: Dict[str, Any]) -> str:
+        """获取变量所属的分类"""
         if var_info.get('is_pointer'):
-            self.variables['pointer_vars'].append(var_info)
+            return 'pointer_vars'
         elif var_info.get('array_size'):
-            self.variables['array_vars'].append(var_info)
+            return 'array_vars'
         elif self.type_manager.is_struct_type(var_info['type']):
-            self.variables['struct_vars'].append(var_info)
-        else:
-            self.variables['variables'].append(var_info)
+            return 'struct_vars'
+        return 'variables'
+        
+    def add_variable(self, var_info: Dict[str, Any]) -> None:
+        """添加变量定义"""
+        category = self.classify_variable(var_info)
+        self.variable_counts[category] += 1
+        if self.writers:
+            for writer in self.writers:
+                writer.write_variable(var_info, category)
+            return
+        self.variables[category].append(var_info)
             
+    def replace_variables(self, ranges: Dict[str, Tuple[int, int]], entries: List[Tuple[str, Dict[str, Any]]]) -> None:
+        """把各分类中 [begin, end) 范围内的变量替换为 entries 中同分类的变量
+        
+        增量解析时原地更新修改过的声明对应的变量，其余变量对象和顺序保持不变。
+        
+        Args:
+            ranges: 分类 -> (begin, end)
+            entries: (分类, 变量信息) 列表，按源码顺序
+        """
+        for category, (begin, end) in ranges.items():
+            self.variables[category][begin:end] = [var_info for entry_category, var_info in entries
+                                                   if entry_category == category]
+        self.variable_counts = {category: len(items) for category, items in self.variables.items()}
+        
     def get_type_info(self) -> Dict[str, Any]:
         """获取类型信息"""
         return {
@@ -55,4 +85,5 @@ class DataManager:
             'struct_vars': [],
             'pointer_vars': [],
             'array_vars': [],
-        }
\ No newline at end of file
+        }
+        self.variable_counts = {category: 0 for category in self.variables}
\ No newline at end of file
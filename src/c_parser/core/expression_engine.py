@@ -0,0 +1,630 @@
+import re
+from typing import Dict, Any, Optional, List, Tuple, Union, Callable
+from loguru import logger
+
+logger = logger.bind(name="ExpressionEngine")
+
+# 求值结果的C类型：整数为 (位宽, 是否有符号)，浮点统一为 DOUBLE
+INT = (32, True)
+UINT = (32, False)
+LONG = (64, True)
+ULONG = (64, False)
+DOUBLE = 'double'
+
+CType = Union[Tuple[int, bool], str]
+Value = Tuple[Union[int, float], CType]
+
+
+class EvaluationError(Exception):
+    """表达式无法在编译期求值（语法错误、未知标识符、除零等）"""
+
+
+# 可以组成类型转换的C关键字
+_TYPE_KEYWORDS = {
+    'unsigned', 'signed', 'int', 'char', 'short', 'long', 'float', 'double',
+    'void', '_Bool', 'bool', 'const', 'volatile', 'struct', 'union', 'enum'
+}
+
+_TOKEN_RE = re.compile(r'''
+    \s*(?:
+        (?P<float>(?:\d+\.\d*|\.\d+|\d+(?=[eE]))(?:[eE][+-]?\d+)?[fFlL]?)
+      | (?P<int>(?:0[xX][0-9a-fA-F]+|0[bB][01]+|\d+)[uUlL]*)
+      | (?P<char>'(?:\\.|[^\\'])+')
+      | (?P<string>"(?:\\.|[^\\"])*")
+      | (?P<ident>[A-Za-z_]\w*)
+      | (?P<op><<|>>|<=|>=|==|!=|&&|\|\||[-+*/%&|^~!<>()?:])
+    )''', re.VERBOSE)
+
+_BINARY_PRECEDENCE = {
+    '||': 1, '&&': 2, '|': 3, '^': 4, '&': 5,
+    '==': 6, '!=': 6, '<': 7, '>': 7, '<=': 7, '>=': 7,
+    '<<': 8, '>>': 8, '+': 9, '-': 9, '*': 10, '/': 10, '%': 10,
+}
+
+_CHAR_ESCAPES = {'n': 10, 't': 9, 'r': 13, '0': 0, 'a': 7, 'b': 8, 'f': 12, 'v': 11,
+                 '\\': 92, "'": 39, '"': 34, '?': 63}
+
+
+def wrap(value: Union[int, float], ctype: CType) -> Union[int, float]:
+    """按C类型截断数值（无符号回绕、有符号补码）"""
+    if ctype == DOUBLE:
+        return float(value)
+    bits, signed = ctype
+    value = int(value) & ((1 << bits) - 1)
+    if signed and value >> (bits - 1):
+        value -= 1 << bits
+    return value
+
+
+def type_for_int(value: int, based: bool = True) -> CType:
+    """无后缀整数常量的类型，十六进制/八进制常量可以是无符号类型"""
+    candidates = (INT, UINT, LONG, ULONG) if based else (INT, LONG, ULONG)
+    for ctype in candidates:
+        bits, signed = ctype
+        low, high = (-(1 << (bits - 1)), (1 << (bits - 1)) - 1) if signed else (0, (1 << bits) - 1)
+        if low <= value <= high:
+            return ctype
+    return ULONG
+
+
+def _promote(ctype: CType) -> CType:
+    """整数提升"""
+    if ctype == DOUBLE or ctype[0] >= 32:
+        return ctype
+    return INT
+
+
+def _common_type(left: CType, right: CType) -> CType:
+    """常用算术转换"""
+    if left == DOUBLE or right == DOUBLE:
+        return DOUBLE
+    left, right = _promote(left), _promote(right)
+    if left == right:
+        return left
+    if left[1] == right[1]:
+        return left if left[0] >= right[0] else right
+    unsigned, signed = (left, right) if not left[1] else (right, left)
+    # 有符号类型更宽时可以表示无符号类型的所有值
+    return unsigned if unsigned[0] >= signed[0] else signed
+
+
+def _parse_int_literal(text: str) -> Value:
+    body = text.rstrip('uUlL')
+    suffix = text[len(body):].lower()
+    try:
+        if body[:2] in ('0x', '0X'):
+            value, based = int(body[2:], 16), True
+        elif body[:2] in ('0b', '0B'):
+            value, based = int(body[2:], 2), True
+        elif len(body) > 1 and body[0] == '0':
+            value, based = int(body, 8), True
+        else:
+            value, based = int(body), False
+    except ValueError:
+        raise EvaluationError(f"invalid integer literal: {text}")
+
+    if 'u' in suffix:
+        ctype = ULONG if 'l' in suffix or value > 0xFFFFFFFF else UINT
+    elif 'l' in suffix:
+        ctype = LONG if value <= 0x7FFFFFFFFFFFFFFF else ULONG
+    else:
+        ctype = type_for_int(value, based)
+    return wrap(value, ctype), ctype
+
+
+def _parse_char_literal(text: str) -> Value:
+    body = text[1:-1]
+    if len(body) == 1:
+        return ord(body), INT
+    if body[0] == '\\':
+        escape = body[1:]
+        if escape in _CHAR_ESCAPES:
+            return _CHAR_ESCAPES[escape], INT
+        try:
+            if escape[0] in 'xX':
+                return wrap(int(escape[1:], 16), (8, True)), INT
+            if all(c in '01234567' for c in escape):
+                return wrap(int(escape, 8), (8, True)), INT
+        except (ValueError, IndexError):
+            pass
+    raise EvaluationError(f"unsupported character literal: {text}")
+
+
+def tokenize(text: str) -> List[Tuple[str, str]]:
+    """将表达式切分为 (kind, text) 列表"""
+    tokens = []
+    pos = 0
+    end = len(text.rstrip())
+    while pos < end:
+        match = _TOKEN_RE.match(text, pos)
+        if not match or match.end() == pos:
+            raise EvaluationError(f"unexpected character at {pos}: {text!r}")
+        kind = match.lastgroup
+        tokens.append((kind, match.group(kind)))
+        pos = match.end()
+    return tokens
+
+
+class _Parser:
+    """递归下降解析，输出嵌套元组形式的语法树"""
+
+    def __init__(self, tokens: List[Tuple[str, str]], is_type: Callable[[str], Optional[CType]]):
+        self.tokens = tokens
+        self.pos = 0
+        self.is_type = is_type
+
+    def peek(self, offset: int = 0) -> Tuple[Optional[str], Optional[str]]:
+        index = self.pos + offset
+        return self.tokens[index] if index < len(self.tokens) else (None, None)
+
+    def take(self) -> Tuple[str, str]:
+        token = self.peek()
+        if token[0] is None:
+            raise EvaluationError("unexpected end of expression")
+        self.pos += 1
+        return token
+
+    def expect(self, text: str) -> None:
+        kind, value = self.take()
+        if value != text:
+            raise EvaluationError(f"expected {text!r}, got {value!r}")
+
+    def parse(self):
+        node = self.conditional()
+        if self.peek()[0] is not None:
+            raise EvaluationError(f"unexpected token {self.peek()[1]!r}")
+        return node
+
+    def conditional(self):
+        node = self.binary(1)
+        if self.peek()[1] == '?':
+            self.take()
+            when_true = self.conditional()
+            self.expect(':')
+            when_false = self.conditional()
+            node = ('cond', node, when_true, when_false)
+        return node
+
+    def binary(self, min_precedence: int):
+        left = self.unary()
+        while True:
+            kind, op = self.peek()
+            precedence = _BINARY_PRECEDENCE.get(op) if kind == 'op' else None
+            if precedence is None or precedence < min_precedence:
+                return left
+            self.take()
+            right = self.binary(precedence + 1)
+            left = ('bin', op, left, right)
+
+    def unary(self):
+        kind, value = self.peek()
+        if kind == 'op' and value in ('-', '+', '~', '!'):
+            self.take()
+            return ('un', value, self.unary())
+        if kind == 'ident' and value == 'sizeof':
+            self.take()
+            return self.sizeof()
+        if kind == 'ident' and value == 'defined':
+            self.take()
+            return self.defined()
+        if value == '(':
+            cast_type = self.try_cast()
+            if cast_type is not None:
+                return ('cast', cast_type, self.unary())
+        return self.primary()
+
+    def type_name(self, start: int) -> Tuple[Optional[CType], int]:
+        """识别从 start 开始、以 ')' 结束的类型名，返回 (类型, ')' 的位置)"""
+        words = []
+        pointer = False
+        index = start
+        while index < len(self.tokens):
+            kind, value = self.tokens[index]
+            if kind == 'ident' and not pointer:
+                words.append(value)
+            elif value == '*' and words:
+                pointer = True
+            elif value == ')':
+                break
+            else:
+                return None, index
+            index += 1
+        if not words or index >= len(self.tokens):
+            return None, index
+        if pointer:
+            return ULONG, index
+        if all(word in _TYPE_KEYWORDS for word in words):
+            return _keyword_type(words), index
+        if len(words) == 1:
+            return self.is_type(words[0]), index
+        return None, index
+
+    def try_cast(self) -> Optional[CType]:
+        ctype, close = self.type_name(self.pos + 1)
+        if ctype is None:
+            return None
+        # 类型名后必须紧跟操作数，否则是普通括号表达式
+        next_kind, next_value = self.tokens[close + 1] if close + 1 < len(self.tokens) else (None, None)
+        if next_kind is None or (next_kind == 'op' and next_value not in ('(', '-', '+', '~', '!')):
+            return None
+        self.pos = close + 1
+        return ctype
+
+    def sizeof(self):
+        if self.peek()[1] == '(':
+            ctype, close = self.type_name(self.pos + 1)
+            if ctype is not None:
+                self.pos = close + 1
+                return ('const', (_type_size(ctype), ULONG))
+        raise EvaluationError("sizeof is only supported for type names")
+
+    def defined(self):
+        parenthesized = self.peek()[1] == '('
+        if parenthesized:
+            self.take()
+        kind, name = self.take()
+        if kind != 'ident':
+            raise EvaluationError("defined requires an identifier")
+        if parenthesized:
+            self.expect(')')
+        return ('defined', name)
+
+    def primary(self):
+        kind, value = self.take()
+        if kind == 'int':
+            return ('const', _parse_int_literal(value))
+        if kind == 'float':
+            return ('const', (float(value.rstrip('fFlL')), DOUBLE))
+        if kind == 'char':
+            return ('const', _parse_char_literal(value))
+        if kind == 'ident':
+            if self.peek()[1] == '(':
+                raise EvaluationError(f"function-like macro call: {value}")
+            return ('name', value)
+        if value == '(':
+            node = self.conditional()
+            self.expect(')')
+            return node
+        raise EvaluationError(f"unexpected token {value!r}")
+
+
+def _keyword_type(words: List[str]) -> CType:
+    """由C类型关键字组合得到类型"""
+    if 'double' in words or 'float' in words:
+        return DOUBLE
+    unsigned = 'unsigned' in words
+    if 'char' in words or words in (['bool'], ['_Bool']):
+        return (8, not unsigned and 'bool' not in words and '_Bool' not in words)
+    if 'short' in words:
+        return (16, not unsigned)
+    if 'long' in words:
+        return (64, not unsigned)
+    return (32, not unsigned)
+
+
+def _type_size(ctype: CType) -> int:
+    return 8 if ctype == DOUBLE else ctype[0] // 8
+
+
+def _binary(op: str, left: Value, right: Value) -> Value:
+    (lv, lt), (rv, rt) = left, right
+    if op in ('<<', '>>'):
+        if lt == DOUBLE or rt == DOUBLE:
+            raise EvaluationError("shift of floating point value")
+        ctype = _promote(lt)
+        if rv < 0 or rv >= ctype[0]:
+            raise EvaluationError(f"invalid shift count: {rv}")
+        return wrap(lv << rv if op == '<<' else lv >> rv, ctype), ctype
+
+    ctype = _common_type(lt, rt)
+    if ctype == DOUBLE:
+        lv, rv = float(lv), float(rv)
+    else:
+        lv, rv = wrap(lv, ctype), wrap(rv, ctype)
+
+    if op in ('==', '!=', '<', '>', '<=', '>='):
+        result = {'==': lv == rv, '!=': lv != rv, '<': lv < rv,
+                  '>': lv > rv, '<=': lv <= rv, '>=': lv >= rv}[op]
+        return int(result), INT
+    if op == '+':
+        return wrap(lv + rv, ctype), ctype
+    if op == '-':
+        return wrap(lv - rv, ctype), ctype
+    if op == '*':
+        return wrap(lv * rv, ctype), ctype
+    if op in ('/', '%'):
+        if rv == 0:
+            raise EvaluationError("division by zero")
+        if ctype == DOUBLE:
+            if op == '%':
+                raise EvaluationError("% of floating point value")
+            return lv / rv, ctype
+        # C的整数除法向零截断，余数与被除数同号
+        quotient = abs(lv) // abs(rv)
+        if (lv < 0) != (rv < 0):
+            quotient = -quotient
+        if op == '/':
+            return wrap(quotient, ctype), ctype
+        return wrap(lv - rv * quotient, ctype), ctype
+    if ctype == DOUBLE:
+        raise EvaluationError(f"bitwise {op} of floating point value")
+    if op == '&':
+        return wrap(lv & rv, ctype), ctype
+    if op == '|':
+        return wrap(lv | rv, ctype), ctype
+    if op == '^':
+        return wrap(lv ^ rv, ctype), ctype
+    raise EvaluationError(f"unsupported operator {op}")
+
+
+def _unary(op: str, operand: Value) -> Value:
+    value, ctype = operand
+    if op == '!':
+        return int(not value), INT
+    ctype = _promote(ctype)
+    if op == '-':
+        return wrap(-value, ctype), ctype
+    if op == '+':
+        return wrap(value, ctype), ctype
+    if ctype == DOUBLE:
+        raise EvaluationError("~ of floating point value")
+    return wrap(~value, ctype), ctype
+
+
+def _cast(ctype: CType, operand: Value) -> Value:
+    value, _ = operand
+    if ctype == DOUBLE:
+        return float(value), DOUBLE
+    # 浮点转整数向零截断
+    return wrap(int(value), ctype), ctype
+
+
+class CompiledExpression:
+    """编译后的表达式
+
+    语法树在编译时折叠为闭包，不含标识符的子表达式直接折叠为常量。
+    求值时通过 symbols.lookup(name) 获取标识符的值。
+    """
+
+    def __init__(self, text: str, is_type: Callable[[str], Optional[CType]] = lambda name: None):
+        """编译表达式
+
+        Args:
+            text: C表达式文本
+            is_type: 判断标识符是否为类型名（用于类型转换），返回类型或None
+
+        Raises:
+            EvaluationError: 语法错误
+        """
+        self.text = text
+        self.names = set()
+        tree = _Parser(tokenize(text), is_type).parse()
+        self._constant, self._fn = self._compile(tree)
+
+    @property
+    def is_constant(self) -> bool:
+        """表达式是否不依赖任何标识符"""
+        return self._fn is None
+
+    def evaluate(self, symbols) -> Value:
+        """求值
+
+        Args:
+            symbols: 提供 lookup(name) -> Optional[Value] 和 is_defined(name) 的符号表
+
+        Returns:
+            (数值, C类型)
+
+        Raises:
+            EvaluationError: 无法求值
+        """
+        if self._fn is None:
+            return self._constant
+        return self._fn(symbols)
+
+    def _compile(self, node) -> Tuple[Optional[Value], Optional[Callable]]:
+        """返回 (常量, None) 或 (None, 求值函数)"""
+        kind = node[0]
+        if kind == 'const':
+            return node[1], None
+
+        if kind == 'name':
+            name = node[1]
+            self.names.add(name)
+
+            def lookup(symbols):
+                value = symbols.lookup(name)
+                if value is None:
+                    raise EvaluationError(f"unknown identifier: {name}")
+                return value
+            return None, lookup
+
+        if kind == 'defined':
+            name = node[1]
+            self.names.add(name)
+            return None, lambda symbols: (int(symbols.is_defined(name)), INT)
+
+        if kind == 'un':
+            op = node[1]
+            constant, fn = self._compile(node[2])
+            if fn is None:
+                return _unary(op, constant), None
+            return None, lambda symbols: _unary(op, fn(symbols))
+
+        if kind == 'cast':
+            ctype = node[1]
+            constant, fn = self._compile(node[2])
+            if fn is None:
+                return _cast(ctype, constant), None
+            return None, lambda symbols: _cast(ctype, fn(symbols))
+
+        if kind == 'cond':
+            parts = [self._compile(child) for child in node[1:]]
+            if all(fn is None for _, fn in parts):
+                condition, when_true, when_false = (constant for constant, _ in parts)
+                return (when_true if condition[0] else when_false), None
+            evaluators = [self._as_function(constant, fn) for constant, fn in parts]
+            condition, when_true, when_false = evaluators
+            return None, lambda symbols: when_true(symbols) if condition(symbols)[0] else when_false(symbols)
+
+        # 二元运算
+        op = node[1]
+        (left_constant, left_fn), (right_constant, right_fn) = self._compile(node[2]), self._compile(node[3])
+        if op in ('&&', '||'):
+            left = self._as_function(left_constant, left_fn)
+            right = self._as_function(right_constant, right_fn)
+            if op == '&&':
+                fn = lambda symbols: (int(bool(left(symbols)[0]) and bool(right(symbols)[0])), INT)
+            else:
+                fn = lambda symbols: (int(bool(left(symbols)[0]) or bool(right(symbols)[0])), INT)
+            if left_fn is None and right_fn is None:
+                return fn(None), None
+            return None, fn
+
+        if left_fn is None and right_fn is None:
+            return _binary(op, left_constant, right_constant), None
+        left = self._as_function(left_constant, left_fn)
+        right = self._as_function(right_constant, right_fn)
+        return None, lambda symbols: _binary(op, left(symbols), right(symbols))
+
+    @staticmethod
+    def _as_function(constant: Optional[Value], fn: Optional[Callable]) -> Callable:
+        if fn is not None:
+            return fn
+        return lambda symbols: constant
+
+
+def value_of(raw: Any) -> Optional[Value]:
+    """将Python数值转换为带类型的值，非数值返回None"""
+    if isinstance(raw, bool):
+        return int(raw), INT
+    if isinstance(raw, int):
+        return wrap(raw, type_for_int(raw)), type_for_int(raw)
+    if isinstance(raw, float):
+        return raw, DOUBLE
+    return None
+
+
+class SymbolTable:
+    """常量表达式求值使用的符号表
+
+    由宏定义和枚举常量组成。宏和枚举值的文本表达式在首次使用时编译一次，
+    解析出的常量值被缓存，宏被重新定义、枚举或类型信息被替换时调用
+    invalidate() 清除缓存。
+
+    符号来源由两个函数提供，不复制原始字典：
+    - macro_lookup(name): 返回宏值（数值或表达式文本），未定义时返回None
+    - enum_source(): 返回 {枚举名: {枚举常量: 值}}，仅在缓存失效后调用
+    """
+
+    # 编译缓存的最大条目数，超出后整体清空
+    MAX_COMPILED = 65536
+
+    def __init__(self, macro_lookup: Callable[[str], Any],
+                 enum_source: Callable[[], Dict[str, Dict[str, Any]]],
+                 type_lookup: Callable[[str], Optional[CType]] = lambda name: None,
+                 compiled_cache: Optional[Dict[str, Any]] = None):
+        """初始化符号表
+
+        Args:
+            macro_lookup: 宏查找函数
+            enum_source: 枚举值来源
+            type_lookup: 类型名查找函数，用于类型转换和sizeof
+            compiled_cache: 共享的编译缓存，可选；共享者的 type_lookup 必须一致
+        """
+        self._macro_lookup = macro_lookup
+        self._enum_source = enum_source
+        self._type_lookup = type_lookup
+        self._compiled: Dict[str, Union[CompiledExpression, EvaluationError]] = (
+            compiled_cache if compiled_cache is not None else {}
+        )
+        self._values: Dict[str, Value] = {}
+        self._enum_constants: Optional[Dict[str, Any]] = None
+        self._resolving = set()
+
+    def invalidate(self) -> None:
+        """清除已解析的常量值（编译结果与符号无关，继续保留）"""
+        self._values.clear()
+        self._enum_constants = None
+
+    def compile(self, text: str) -> CompiledExpression:
+        """编译表达式，结果按文本缓存
+
+        Raises:
+            EvaluationError: 语法错误
+        """
+        compiled = self._compiled.get(text)
+        if compiled is None:
+            if len(self._compiled) >= self.MAX_COMPILED:
+                self._compiled.clear()
+            try:
+                compiled = CompiledExpression(text, self._type_lookup)
+            except EvaluationError as e:
+                compiled = e
+            self._compiled[text] = compiled
+        if isinstance(compiled, EvaluationError):
+            raise compiled
+        return compiled
+
+    def lookup(self, name: str) -> Optional[Value]:
+        """获取标识符的常量值，未知标识符返回None
+
+        Raises:
+            EvaluationError: 宏循环引用
+        """
+        value = self._values.get(name)
+        if value is not None:
+            return value
+
+        if self._enum_constants is None:
+            self._enum_constants = {
+                key: raw for values in self._enum_source().values() for key, raw in values.items()
+            }
+        # 与原有的变量替换规则一致：枚举常量优先于宏
+        if name in self._enum_constants:
+            raw = self._enum_constants[name]
+        else:
+            raw = self._macro_lookup(name)
+            if raw is None:
+                return None
+
+        value = value_of(raw)
+        if value is None:
+            if not isinstance(raw, str) or not raw.strip():
+                return None
+            if name in self._resolving:
+                raise EvaluationError(f"recursive macro: {name}")
+            self._resolving.add(name)
+            try:
+                value = self.compile(raw.strip()).evaluate(self)
+            except EvaluationError:
+                return None
+            finally:
+                self._resolving.discard(name)
+
+        self._values[name] = value
+        return value
+
+    def is_defined(self, name: str) -> bool:
+        """宏是否已定义（用于 defined 运算符）"""
+        return self._macro_lookup(name) is not None
+
+    def evaluate(self, text: str) -> Union[int, float]:
+        """求值表达式，返回Python数值
+
+        Raises:
+            EvaluationError: 无法求值
+        """
+        return self.compile(text).evaluate(self)[0]
+
+
+# dict_symbols 创建的临时符号表共享同一编译缓存
+_dict_compiled_cache: Dict[str, Any] = {}
+
+
+def dict_symbols(enum_values: Optional[Dict[str, Dict[str, Any]]] = None,
+                 macro_values: Optional[Dict[str, Any]] = None) -> SymbolTable:
+    """由普通字典构造一次性的符号表，类型转换只识别C类型关键字"""
+    macros = macro_values or {}
+    enums = enum_values or {}
+    return SymbolTable(macros.get, lambda: enums, compiled_cache=_dict_compiled_cache)
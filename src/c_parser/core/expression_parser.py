@@ -1,59 +1,65 @@
-from typing import Dict, Any, Tuple, Optional
+import re
+from typing import Dict, Any, Tuple, Optional, Union
 from loguru import logger
+from utils.logger import log_gate
+from .expression_engine import SymbolTable, EvaluationError, dict_symbols
 
 class ExpressionParser:
     """表达式解析和计算工具类"""
     
+    # 整数字面量：十六进制、二进制、八进制、十进制，可带 U/L 后缀
+    _INT_LITERAL_RE = re.compile(rb'(?:0[xX]([0-9a-fA-F]+)|0[bB]([01]+)|(0[0-7]*)|([1-9][0-9]*))[uUlL]*')
+    # 十进制浮点字面量，可带 f/l 后缀
+    _FLOAT_LITERAL_RE = re.compile(rb'(?:[0-9]+\.[0-9]*|\.[0-9]+|[0-9]+(?=[eE]))(?:[eE][+-]?[0-9]+)?[fFlL]?')
+    
     @staticmethod
     def parse(expr, enum_values=None, macro_values=None):
-        """解析表达式，返回结果和类型"""
+        """解析表达式，返回结果和类型
+        
+        Args:
+            expr: 表达式文本
+            enum_values: {枚举名: {枚举常量: 值}}，可选
+            macro_values: {宏名: 值}，可选
+            
+        Returns:
+            (结果, 类型)，类型为 'number'、'string' 或 'expression'
+        """
+        return ExpressionParser.evaluate(expr, dict_symbols(enum_values, macro_values))
+    
+    @staticmethod
+    def evaluate(expr, symbols: SymbolTable):
+        """使用符号表求值表达式
+        
+        按C语言语义计算（整数位宽、无符号回绕、类型转换），不使用eval。
+        无法求值时返回替换已知标识符后的表达式文本。
+        
+        Args:
+            expr: 表达式文本
+            symbols: 符号表，例如 TypeManager.symbols
+            
+        Returns:
+            (结果, 类型)，类型为 'number'、'string' 或 'expression'
+        """
         if isinstance(expr, bytes):
             expr = expr.decode('utf8')
         expr = expr.strip()
         
-        # 检查合并enum_values
-        if enum_values:
-            enum_values = {k: v for d in enum_values.values() for k, v in d.items()}
-            
-        logger.debug(f"=== Parsing Expression ===")
-        logger.debug(f"Input expression: {expr}")
-        # logger.debug(f"Available enum values: {enum_values}")
-        # logger.debug(f"Available macro values: {macro_values}")
-        
         # 1. 检查字符串字面量
         if expr.startswith(("'", '"')) and expr.endswith(("'", '"')):
-            logger.debug(f"Detected string literal: {expr}")
-            # 返回去除引号的字符串内容
             return expr[1:-1], 'string'
         
         # 2. 检查数字字面量
-        try:
-            value = ExpressionParser._parse_number(expr)
-            logger.debug(f"Parsed number: {value}")
+        value = ExpressionParser.parse_number_literal(expr.encode('utf8'))
+        if value is not None:
             return value, 'number'
-        except ValueError:
-            logger.warning(f"Failed to parse number: {expr}")
         
-        # 3. 处理表达式
+        # 3. 编译并求值表达式
         try:
-            # 首先替换所有变量
-            processed_expr = ExpressionParser._replace_variables(expr, enum_values, macro_values)
-            logger.debug(f"After variable replacement: {processed_expr}")
-            
-            # 然后尝试计算表达式
-            result = ExpressionParser._evaluate(processed_expr)
-            logger.debug(f"After evaluation: {result}")
-            
-            if isinstance(result, (int, float)):
-                logger.debug(f"Final result (number): {result}")
-                return result, 'number'
-            
-            logger.debug(f"Final result (expression): {result}")
-            return result, 'expression'
-            
-        except Exception as e:
-            logger.exception(f"Failed to parse expression: {expr}, error: {e}")
-            return expr, 'expression'
+            return symbols.evaluate(expr), 'number'
+        except EvaluationError as e:
+            if log_gate.debug:
+                logger.debug(f"Cannot evaluate expression {expr!r}: {e}")
+            return ExpressionParser._replace_variables(expr, symbols), 'expression'
     
     @staticmethod
     def _parse_number(expr):
@@ -79,97 +85,56 @@ class ExpressionParser:
         except ValueError:
             raise ValueError(f"Invalid number format: {expr}")
     
+    @classmethod
+    def parse_number_literal(cls, text: bytes) -> Optional[Union[int, float]]:
+        """快速解析单个数字字面量
+        
+        只处理简单的字面量，结果与 _parse_number 一致，不记录日志。
+        用于大型初始化列表的批量解析。
+        
+        Args:
+            text: 字面量文本（tree-sitter节点的原始字节）
+            
+        Returns:
+            数值，无法识别时返回None，调用方应回退到 parse()
+        """
+        match = cls._INT_LITERAL_RE.fullmatch(text)
+        if match:
+            hex_digits, bin_digits, oct_digits, dec_digits = match.groups()
+            if dec_digits is not None:
+                return int(dec_digits)
+            if hex_digits is not None:
+                return int(hex_digits, 16)
+            if oct_digits is not None:
+                return int(oct_digits, 8)
+            return int(bin_digits, 2)
+        if cls._FLOAT_LITERAL_RE.fullmatch(text):
+            return float(text.rstrip(b'fFlL'))
+        return None
+    
     @staticmethod
-    def _replace_variables(expr, enum_values=None, macro_values=None):
-        """替换表达式中的变量引用"""
+    def _replace_variables(expr, symbols: SymbolTable):
+        """替换表达式中能够求值的标识符，用于无法整体求值的表达式"""
         if not expr:
             return expr
         
-        logger.debug(f"--- Variable Replacement ---")
-        logger.debug(f"Input: {expr}")
-        
-        # 标准化运算符
-        expr = ' '.join(expr.split())  # 标准化空格
+        # 标准化空格和运算符
+        expr = ' '.join(expr.split())
         for op in ['<<', '>>', '|', '&', '^', '~', '+', '-', '*', '/', '(', ')']:
             expr = expr.replace(op, f" {op} ")
-        logger.debug(f"After operator normalization: {expr}")
         
-        # 分割并处理每个标记
-        tokens = [t for t in expr.split() if t]
-        logger.debug(f"Tokens: {tokens}")
         processed_tokens = []
-        
-        for token in tokens:
-            logger.debug(f"Processing token: {token}")
-            # 保留运算符
-            if token in ['<<', '>>', '|', '&', '^', '~', '+', '-', '*', '/', '(', ')']:
-                logger.debug(f"Operator token: {token}")
-                processed_tokens.append(token)
-                continue
-            
-            # 替换变量
-            value = None
-            if enum_values and token in enum_values:
-                value = enum_values[token]
-                logger.debug(f"Found enum value: {token} = {value}")
-            elif macro_values and token in macro_values:
-                value = macro_values[token]
-                logger.debug(f"Found macro value: {token} = {value}")
-            
+        for token in expr.split():
+            try:
+                value = symbols.lookup(token)
+            except EvaluationError:
+                value = None
             if value is not None:
-                if isinstance(value, (int, float)):
-                    processed_tokens.append(str(value))
-                    logger.debug(f"Added numeric value: {value}")
-                else:
-                    # 递归处理引用的值
-                    result, _ = ExpressionParser.parse(str(value), enum_values, macro_values)
-                    processed_tokens.append(str(result))
-                    logger.debug(f"Added processed value: {result}")
-            else:
-                # 尝试解析为数字
-                try:
-                    value = ExpressionParser._parse_number(token)
-                    processed_tokens.append(str(value))
-                    logger.debug(f"Parsed as number: {value}")
-                except ValueError:
-                    processed_tokens.append(token)
-                    logger.debug(f"Kept as is: {token}")
-        
-        result = ' '.join(processed_tokens)
-        logger.debug(f"Final processed expression: {result}")
-        return result
-    
-    @staticmethod
-    def _evaluate(expr):
-        """计算表达式的值"""
-        try:
-            logger.debug(f"--- Expression Evaluation ---")
-            logger.debug(f"Input: {expr}")
-            
-            # 检查是否所有token都是数值或运算符
-            tokens = expr.split()
-            operators = {'<<', '>>', '|', '&', '^', '~', '+', '-', '*', '/', '(', ')'}
-            logger.debug(f"Tokens: {tokens}")
-            
-            # 确保所有非运算符的token都是数字
-            for token in tokens:
-                if token not in operators:
-                    try:
-                        float(token)
-                        logger.debug(f"Valid numeric token: {token}")
-                    except ValueError:
-                        logger.debug(f"Non-numeric token found: {token}")
-                        return expr
-            
-            # 计算表达式
+                processed_tokens.append(str(value[0]))
+                continue
             try:
-                result = eval(expr)
-            except ZeroDivisionError:
-                logger.debug("Division by zero detected, returning original expression")
-                return expr
-            logger.debug(f"Evaluation result: {result}")
-            return result
-            
-        except Exception as e:
-            logger.exception(f"Failed to evaluate expression: {expr}, error: {e}")
-            return expr 
\ No newline at end of file
+                processed_tokens.append(str(ExpressionParser._parse_number(token)))
+            except ValueError:
+                processed_tokens.append(token)
+        
+        return ' '.join(processed_tokens)
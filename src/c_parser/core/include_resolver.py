@@ -0,0 +1,235 @@
+import re
+from pathlib import Path
+from typing import Dict, Any, Optional, List, Set, Tuple, Union
+from loguru import logger
+
+logger = logger.bind(name="IncludeResolver")
+
+
+class IncludeResolver:
+    """头文件包含关系解析器
+
+    负责在一次解析会话中：
+    1. 按C语言规则查找包含文件（引号形式先查当前目录，再查include_paths）
+    2. 保证每个头文件最多解析一次，处理菱形和循环包含
+    3. 在调用tree-sitter之前识别 #pragma once 和经典的包含保护宏
+    4. 记录解析得到的包含关系图
+
+    用法示例：
+    ```python
+    resolver = IncludeResolver(['sdk/include'])
+    path = resolver.resolve('common_types.h', Path('src/app.h'))
+    if path and not resolver.should_skip(path):
+        resolver.mark_parsed(path)
+        ...
+    resolver.get_include_graph()
+    ```
+    """
+
+    PRAGMA_ONCE = '#pragma once'
+
+    _COMMENT_RE = re.compile(r'//[^\n]*|/\*.*?\*/', re.DOTALL)
+    _DIRECTIVE_RE = re.compile(r'^\s*#\s*(\w+)(.*)$', re.MULTILINE)
+    _IFNDEF_RE = re.compile(r'^\s*(\w+)\s*$')
+    _IF_NOT_DEFINED_RE = re.compile(r'^\s*!\s*defined\s*\(?\s*(\w+)\s*\)?\s*$')
+    _DEFINE_RE = re.compile(r'^\s*(\w+)(\s.*)?$')
+    _INCLUDE_RE = re.compile(r'^\s*#\s*include\s*([<"])([^>"]+)[>"]', re.MULTILINE)
+
+    def __init__(self, include_paths: Optional[List[Union[str, Path]]] = None):
+        """初始化解析器
+
+        Args:
+            include_paths: 包含文件搜索路径（对应ParserConfig.include_paths）
+        """
+        self.include_paths = [Path(p) for p in (include_paths or [])]
+        self.reset()
+
+    def reset(self) -> None:
+        """开始新的解析会话"""
+        self._parsed: List[Path] = []
+        self._parsed_set: Set[Path] = set()
+        self._defined_guards: Set[str] = set()
+        self._guard_cache: Dict[Path, Optional[str]] = {}
+        self._edges: Dict[Path, List[Path]] = {}
+        self._skipped: Dict[Path, str] = {}
+        self._unresolved: List[Tuple[Path, str]] = []
+        self._unresolved_set: Set[Tuple[Path, str]] = set()
+
+    @classmethod
+    def parse_include_directives(cls, text: str) -> List[Tuple[str, bool]]:
+        """提取源码中的 #include 指令
+
+        Args:
+            text: 源代码文本
+
+        Returns:
+            (包含文件名, 是否为尖括号形式) 列表
+        """
+        return [(match.group(2), match.group(1) == '<') for match in cls._INCLUDE_RE.finditer(text)]
+
+    def resolve(self, include: str, including_file: Optional[Path] = None,
+                is_system: bool = False) -> Optional[Path]:
+        """查找包含文件
+
+        Args:
+            include: #include 中的文件名
+            including_file: 包含该文件的源文件
+            is_system: 是否为尖括号形式（不搜索当前目录）
+
+        Returns:
+            规范化后的文件路径，找不到时返回None
+        """
+        candidates = []
+        if including_file is not None and not is_system:
+            candidates.append(Path(including_file).parent / include)
+        candidates.extend(path / include for path in self.include_paths)
+
+        for candidate in candidates:
+            if candidate.is_file():
+                return candidate.resolve()
+
+        if including_file is not None:
+            # 计算缓存键时预先遍历包含闭包，同一条 #include 会查找两次，只记录一次
+            entry = (Path(including_file).resolve(), include)
+            if entry not in self._unresolved_set:
+                self._unresolved_set.add(entry)
+                self._unresolved.append(entry)
+        return None
+
+    def add_edge(self, including_file: Path, included_file: Path) -> None:
+        """记录包含关系"""
+        including_file = Path(including_file).resolve()
+        included_file = Path(included_file).resolve()
+        edges = self._edges.setdefault(including_file, [])
+        if included_file not in edges:
+            edges.append(included_file)
+
+    def mark_parsed(self, path: Path, text: Optional[str] = None) -> None:
+        """标记文件已在本次会话中解析
+
+        Args:
+            path: 文件路径
+            text: 文件内容，可选，提供时用于识别包含保护宏
+        """
+        path = Path(path).resolve()
+        if path not in self._parsed_set:
+            self._parsed_set.add(path)
+            self._parsed.append(path)
+
+        guard = self._get_guard(path, text)
+        if guard and guard != self.PRAGMA_ONCE:
+            self._defined_guards.add(guard)
+
+    def is_parsed(self, path: Path) -> bool:
+        """检查文件是否已在本次会话中解析"""
+        return Path(path).resolve() in self._parsed_set
+
+    def should_skip(self, path: Path, defined_macros: Optional[Dict[str, Any]] = None) -> bool:
+        """判断包含文件是否无需解析
+
+        已解析过的文件直接跳过；采用经典保护宏的文件在保护宏已定义时跳过
+        （例如同一头文件的另一份拷贝已经解析，或保护宏由配置预先定义）。
+
+        Args:
+            path: 包含文件路径
+            defined_macros: 当前已定义的宏，可选
+
+        Returns:
+            需要跳过时返回True
+        """
+        path = Path(path).resolve()
+        if path in self._parsed_set:
+            self._skipped.setdefault(path, 'already parsed')
+            return True
+
+        guard = self._get_guard(path)
+        if guard and guard != self.PRAGMA_ONCE:
+            if guard in self._defined_guards or (defined_macros and guard in defined_macros):
+                self._skipped.setdefault(path, f"guard {guard} defined")
+                return True
+        return False
+
+    def get_include_graph(self) -> Dict[str, Any]:
+        """获取本次会话解析的包含关系图
+
+        Returns:
+            包含以下内容的字典：
+            - files: 按解析顺序排列的文件
+            - edges: 文件 -> 其包含的文件
+            - skipped: 被跳过的文件及原因
+            - unresolved: 找不到的包含文件
+        """
+        return {
+            'files': [str(path) for path in self._parsed],
+            'edges': {str(src): [str(dst) for dst in dsts] for src, dsts in self._edges.items()},
+            'skipped': {str(path): reason for path, reason in self._skipped.items()},
+            'unresolved': [{'file': str(src), 'include': name} for src, name in self._unresolved],
+        }
+
+    def _get_guard(self, path: Path, text: Optional[str] = None) -> Optional[str]:
+        """获取文件的包含保护（结果按文件缓存）"""
+        if path in self._guard_cache:
+            return self._guard_cache[path]
+        if text is None:
+            try:
+                text = path.read_text(encoding='utf-8', errors='ignore')
+            except OSError:
+                return None
+        guard = self.detect_guard(text)
+        self._guard_cache[path] = guard
+        return guard
+
+    @classmethod
+    def detect_guard(cls, text: str) -> Optional[str]:
+        """识别头文件的包含保护
+
+        支持以下形式：
+        - #pragma once
+        - #ifndef X / #define X ... #endif
+        - #if !defined(X) / #define X ... #endif
+
+        Args:
+            text: 头文件内容
+
+        Returns:
+            PRAGMA_ONCE、保护宏名称，或None（没有包含保护）
+        """
+        directives = [
+            (match.group(1), match.group(2))
+            for match in cls._DIRECTIVE_RE.finditer(cls._COMMENT_RE.sub('', text))
+        ]
+        if not directives:
+            return None
+
+        for name, args in directives:
+            if name == 'pragma' and args.strip() == 'once':
+                return cls.PRAGMA_ONCE
+
+        if len(directives) < 3 or directives[-1][0] != 'endif':
+            return None
+
+        (first, first_args), (second, second_args) = directives[0], directives[1]
+        if first == 'ifndef':
+            match = cls._IFNDEF_RE.match(first_args)
+        elif first == 'if':
+            match = cls._IF_NOT_DEFINED_RE.match(first_args)
+        else:
+            return None
+        if not match:
+            return None
+        guard = match.group(1)
+
+        define_match = cls._DEFINE_RE.match(second_args)
+        if second != 'define' or not define_match or define_match.group(1) != guard:
+            return None
+
+        # 保护块必须覆盖整个文件：开头的条件在最后的 #endif 处闭合
+        depth = 0
+        for index, (name, _) in enumerate(directives):
+            if name in ('if', 'ifdef', 'ifndef'):
+                depth += 1
+            elif name == 'endif':
+                depth -= 1
+                if depth == 0 and index != len(directives) - 1:
+                    return None
+        return guard
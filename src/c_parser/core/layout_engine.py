@@ -0,0 +1,707 @@
+from typing import Dict, Any, Optional, List, Tuple, FrozenSet, Union
+from loguru import logger
+from utils.logger import log_gate
+from utils.metrics import timed_phase
+from .resolution_cache import ResolutionCache
+
+logger = logger.bind(name="LayoutEngine")
+
+
+class AbiProfile:
+    """目标平台ABI：基本类型的大小、对齐和位域布局规则
+
+    基本类型使用规范名称：char、short、int、long、long long、float、double、
+    long double、bool、void 和 pointer（所有指针及 size_t 等指针宽度的整数）。
+    """
+
+    __slots__ = ('name', 'sizes', 'alignments', 'enum_size', 'ms_bitfields',
+                 'byte_order', 'char_signed', 'max_alignment', 'description')
+
+    def __init__(self, name: str, sizes: Dict[str, int], alignments: Dict[str, int],
+                 enum_size: int = 4, ms_bitfields: bool = False,
+                 byte_order: str = 'little', char_signed: bool = True, description: str = ''):
+        """初始化ABI配置
+
+        Args:
+            name: ABI名称
+            sizes: 规范类型名到大小的映射
+            alignments: 规范类型名到对齐的映射，缺省时与大小相同
+            enum_size: 枚举类型的大小和对齐
+            ms_bitfields: 是否使用MSVC的位域布局规则
+            byte_order: 字节序，little 或 big
+            char_signed: 不带signed/unsigned的char是否有符号
+            description: 说明
+        """
+        self.name = name
+        self.sizes = dict(sizes)
+        self.alignments = {key: alignments.get(key, max(size, 1)) for key, size in self.sizes.items()}
+        self.enum_size = enum_size
+        self.ms_bitfields = ms_bitfields
+        self.byte_order = byte_order
+        self.char_signed = char_signed
+        self.max_alignment = max(self.alignments.values())
+        self.description = description
+
+    @property
+    def pointer_size(self) -> int:
+        return self.sizes['pointer']
+
+    def __repr__(self) -> str:
+        return f"AbiProfile({self.name!r})"
+
+    def to_dict(self) -> Dict[str, Any]:
+        """导出为可JSON序列化的字典"""
+        return {
+            'name': self.name,
+            'sizes': dict(self.sizes),
+            'alignments': dict(self.alignments),
+            'enum_size': self.enum_size,
+            'ms_bitfields': self.ms_bitfields,
+            'byte_order': self.byte_order,
+            'char_signed': self.char_signed,
+            'description': self.description,
+        }
+
+
+def _profile(name: str, description: str, long: int, long_long_align: int, double_align: int,
+             long_double: Tuple[int, int], pointer: int, ms_bitfields: bool = False,
+             char_signed: bool = True) -> AbiProfile:
+    sizes = {
+        'void': 0, 'char': 1, 'bool': 1, 'short': 2, 'int': 4, 'long': long, 'long long': 8,
+        'float': 4, 'double': 8, 'long double': long_double[0], 'pointer': pointer,
+    }
+    alignments = {
+        'void': 1, 'long long': long_long_align, 'double': double_align,
+        'long double': long_double[1],
+    }
+    return AbiProfile(name, sizes, alignments, ms_bitfields=ms_bitfields, char_signed=char_signed,
+                      description=description)
+
+
+ABI_PROFILES: Dict[str, AbiProfile] = {
+    profile.name: profile for profile in (
+        _profile('ILP32', 'i386 System V：int/long/指针32位，long long和double按4字节对齐',
+                 long=4, long_long_align=4, double_align=4, long_double=(12, 4), pointer=4),
+        _profile('LP64', 'x86-64/AArch64 Linux：long和指针64位',
+                 long=8, long_long_align=8, double_align=8, long_double=(16, 16), pointer=8),
+        _profile('LLP64', 'Windows x64：long为32位、指针64位，MSVC位域规则',
+                 long=4, long_long_align=8, double_align=8, long_double=(8, 8), pointer=8,
+                 ms_bitfields=True),
+        _profile('ARM_EABI', '32位ARM AAPCS：指针32位，long long和double按8字节对齐，char无符号',
+                 long=4, long_long_align=8, double_align=8, long_double=(8, 8), pointer=4,
+                 char_signed=False),
+    )
+}
+
+ABI_ALIASES = {
+    'X86': 'ILP32', 'I386': 'ILP32',
+    'X86_64': 'LP64', 'AMD64': 'LP64', 'AARCH64': 'LP64',
+    'WIN64': 'LLP64', 'MSVC': 'LLP64',
+    'ARM': 'ARM_EABI', 'EABI': 'ARM_EABI', 'AAPCS': 'ARM_EABI',
+}
+
+DEFAULT_ABI = 'LP64'
+
+
+def get_abi_profile(abi: Union[str, AbiProfile, None] = None) -> AbiProfile:
+    """按名称获取ABI配置（不区分大小写，支持 x86_64、win64、arm 等别名）
+
+    Args:
+        abi: ABI名称或AbiProfile对象，None表示默认的LP64
+
+    Returns:
+        ABI配置
+
+    Raises:
+        ValueError: 未知的ABI名称
+    """
+    if isinstance(abi, AbiProfile):
+        return abi
+    key = (abi or DEFAULT_ABI).upper().replace('-', '_')
+    key = ABI_ALIASES.get(key, key)
+    if key not in ABI_PROFILES:
+        raise ValueError(f"未知的ABI: {abi}，可选: {', '.join(ABI_PROFILES)}")
+    return ABI_PROFILES[key]
+
+
+# 定宽整数和指针宽度整数对应的规范类型
+_FIXED_WIDTH_TYPES = {
+    'int8_t': 'char', 'uint8_t': 'char',
+    'int16_t': 'short', 'uint16_t': 'short',
+    'int32_t': 'int', 'uint32_t': 'int',
+    'int64_t': 'long long', 'uint64_t': 'long long',
+    'size_t': 'pointer', 'ssize_t': 'pointer', 'ptrdiff_t': 'pointer',
+    'intptr_t': 'pointer', 'uintptr_t': 'pointer',
+    '_Bool': 'bool', 'bool': 'bool', 'wchar_t': 'int',
+}
+_UNSIGNED_TYPEDEFS = frozenset(('uint8_t', 'uint16_t', 'uint32_t', 'uint64_t', 'size_t', 'uintptr_t'))
+_TYPE_QUALIFIERS = frozenset(('signed', 'unsigned', 'const', 'volatile', 'restrict', 'static', 'register'))
+_CANONICAL_TYPES = frozenset(('void', 'char', 'bool', 'short', 'int', 'long', 'long long',
+                              'float', 'double', 'long double'))
+
+
+def canonical_basic_type(type_name: str) -> Optional[str]:
+    """获取基本类型的规范名称，例如 unsigned long int -> long、uint32_t -> int
+
+    Args:
+        type_name: 类型名称
+
+    Returns:
+        规范名称，不是基本类型时返回None
+    """
+    canonical = _FIXED_WIDTH_TYPES.get(type_name)
+    if canonical:
+        return canonical
+    words = type_name.split()
+    remaining = [word for word in words if word not in _TYPE_QUALIFIERS]
+    if not remaining:
+        # 单独的 signed / unsigned 即 int
+        return 'int' if words and len(words) != len(remaining) else None
+    if len(remaining) == 1:
+        canonical = _FIXED_WIDTH_TYPES.get(remaining[0])
+        if canonical:
+            return canonical
+    if 'int' in remaining and len(remaining) > 1:
+        remaining.remove('int')
+    key = ' '.join(remaining)
+    return key if key in _CANONICAL_TYPES else None
+
+
+def is_signed_type(type_name: str, canonical: str, abi: 'AbiProfile') -> bool:
+    """判断基本类型是否有符号
+
+    Args:
+        type_name: 原始类型名称
+        canonical: canonical_basic_type 返回的规范名称
+        abi: 目标ABI，决定不带signed/unsigned的char是否有符号
+    """
+    words = type_name.split()
+    if 'unsigned' in words or canonical == 'bool':
+        return False
+    if 'signed' in words:
+        return True
+    base = words[-1] if words else type_name
+    if base in _UNSIGNED_TYPEDEFS:
+        return False
+    return abi.char_signed if canonical == 'char' and base == 'char' else True
+
+
+def split_array_suffix(type_name: str) -> Tuple[str, List[Any]]:
+    """拆分类型名中的数组维度，例如 int[2][3] -> ('int', [2, 3])"""
+    base, _, rest = type_name.partition('[')
+    dimensions = []
+    for part in rest.rstrip(']').split(']['):
+        value = part.strip()
+        try:
+            dimensions.append(int(value, 0))
+        except ValueError:
+            dimensions.append(value or 'dynamic')
+    return base.strip(), dimensions
+
+
+def _align_up(value: int, alignment: int) -> int:
+    return (value + alignment - 1) // alignment * alignment if alignment > 1 else value
+
+
+def element_count(dimensions) -> int:
+    """数组元素总数：柔性数组(dynamic)不占空间，无法求值的维度按1计算"""
+    count = 1
+    for dimension in dimensions or ():
+        if isinstance(dimension, int):
+            count *= dimension
+        elif dimension == 'dynamic':
+            count *= 0
+    return count
+
+
+class FieldLayout:
+    """字段布局：字节偏移、占用大小，位域的位偏移与位宽"""
+
+    __slots__ = ('name', 'type', 'offset', 'size', 'alignment', 'bit_offset', 'bit_size',
+                 'array_size', 'index')
+
+    def __init__(self, name: Optional[str], type: str, offset: int, size: int, alignment: int,
+                 bit_offset: Optional[int] = None, bit_size: Optional[int] = None,
+                 array_size: Optional[List[Any]] = None, index: int = -1):
+        self.name = name
+        self.type = type
+        self.offset = offset
+        self.size = size
+        self.alignment = alignment
+        self.bit_offset = bit_offset
+        self.bit_size = bit_size
+        self.array_size = array_size
+        self.index = index  # 在原字段列表中的位置
+
+    @property
+    def is_bitfield(self) -> bool:
+        return self.bit_size is not None
+
+    def __repr__(self) -> str:
+        return f"FieldLayout({self.name!r}, offset={self.offset}, size={self.size})"
+
+    def to_dict(self) -> Dict[str, Any]:
+        """导出为可JSON序列化的字典"""
+        result = {
+            'name': self.name,
+            'type': self.type,
+            'offset': self.offset,
+            'size': self.size,
+            'alignment': self.alignment,
+        }
+        if self.array_size:
+            result['array_size'] = list(self.array_size)
+        if self.bit_size is not None:
+            result['bit_offset'] = self.bit_offset
+            result['bit_size'] = self.bit_size
+        return result
+
+
+class TypeLayout:
+    """结构体/联合体的布局表
+
+    fields 按声明顺序保存每个字段的布局（零宽位域不占字段），
+    padding 列出所有填充空洞（包括结尾填充），每项为 {'offset', 'size'}。
+    """
+
+    __slots__ = ('name', 'kind', 'size', 'alignment', 'fields', 'padding', 'packed', 'abi', '_by_name')
+
+    def __init__(self, name: Optional[str], kind: str, size: int, alignment: int,
+                 fields: List[FieldLayout], padding: List[Dict[str, int]],
+                 packed: bool = False, abi: str = DEFAULT_ABI):
+        self.name = name
+        self.kind = kind
+        self.size = size
+        self.alignment = alignment
+        self.fields = fields
+        self.padding = padding
+        self.packed = packed
+        self.abi = abi
+        self._by_name = {field.name: field for field in fields if field.name}
+
+    def field(self, name: str) -> Optional[FieldLayout]:
+        """按名称获取字段布局"""
+        return self._by_name.get(name)
+
+    def __repr__(self) -> str:
+        return f"TypeLayout({self.name!r}, size={self.size}, alignment={self.alignment})"
+
+    def to_dict(self) -> Dict[str, Any]:
+        """导出为可JSON序列化的字典"""
+        return {
+            'name': self.name,
+            'kind': self.kind,
+            'abi': self.abi,
+            'size': self.size,
+            'alignment': self.alignment,
+            'packed': self.packed,
+            'fields': [field.to_dict() for field in self.fields],
+            'padding': [dict(hole) for hole in self.padding],
+        }
+
+
+class LayoutEngine:
+    """按目标ABI计算类型大小、对齐和结构体布局表
+
+    类型定义从 TypeManager 读取，每个类型的布局只计算一次；结果按依赖的类型名
+    缓存，类型重新注册时由 TypeManager 调用 invalidate 精确失效。
+
+    用法示例：
+    ```python
+    engine = type_manager.get_layout_engine('ARM_EABI')
+    layout = engine.layout('struct Packet')
+    layout.field('crc').offset
+    engine.offset_of('struct Packet', 'header.length')
+    ```
+    """
+
+    def __init__(self, type_manager, abi: Union[str, AbiProfile, None] = DEFAULT_ABI):
+        """初始化布局引擎
+
+        Args:
+            type_manager: 类型管理器
+            abi: 目标ABI名称或配置
+        """
+        self.type_manager = type_manager
+        self.abi = get_abi_profile(abi)
+        self._cache = ResolutionCache()
+        self._in_progress = set()
+        self._layouts_in_progress = set()
+
+    def clear(self) -> None:
+        """清空布局缓存"""
+        self._cache.clear()
+
+    def invalidate(self, names) -> int:
+        """失效依赖给定类型名（清理后的名称）的布局结果"""
+        return self._cache.invalidate(names)
+
+    def size_of(self, type_name: str) -> int:
+        """获取类型大小（字节），未知类型返回0"""
+        self.type_manager._sync_cache()
+        return self._type_info(type_name)[0]
+
+    def alignment_of(self, type_name: str) -> int:
+        """获取类型对齐（字节），未知类型返回1"""
+        self.type_manager._sync_cache()
+        return self._type_info(type_name)[1]
+
+    def layout(self, type_name: str) -> Optional[TypeLayout]:
+        """获取结构体/联合体的布局表
+
+        Args:
+            type_name: 类型名称，可以是typedef名称
+
+        Returns:
+            布局表，不是结构体或联合体时返回None
+        """
+        self.type_manager._sync_cache()
+        with timed_phase('layout'):
+            return self._layout(type_name)
+
+    def offset_of(self, type_name: str, field_path: str) -> Optional[int]:
+        """计算字段相对于类型起始位置的字节偏移
+
+        Args:
+            type_name: 结构体/联合体类型名称
+            field_path: 字段名，嵌套字段用点号分隔，例如 header.length
+
+        Returns:
+            字节偏移，字段不存在时返回None
+        """
+        offset = 0
+        current = type_name
+        for name in field_path.split('.'):
+            layout = self.layout(current) if current else None
+            field = layout.field(name) if layout else None
+            if field is None:
+                return None
+            offset += field.offset
+            current = field.type
+        return offset
+
+    def classify(self, type_name: str) -> Tuple[str, Any]:
+        """确定类型的类别，供二进制编解码使用
+
+        Args:
+            type_name: 类型名称
+
+        Returns:
+            (类别, 详情)：
+            ('basic', (规范名称, 是否有符号))、('pointer', None)、('enum', None)、
+            ('struct' 或 'union', TypeLayout)、('array', (元素类型, 维度列表))、('unknown', None)
+        """
+        manager = self.type_manager
+        manager._sync_cache()
+        name = type_name.strip()
+        seen = set()
+        while name and name not in seen:
+            seen.add(name)
+            if name.endswith('*') or name == 'function_pointer':
+                return 'pointer', None
+            if name.endswith(']') and '[' in name:
+                return 'array', split_array_suffix(name)
+            canonical = canonical_basic_type(name)
+            if canonical:
+                return 'basic', (canonical, is_signed_type(name, canonical, self.abi))
+            if name.startswith('enum '):
+                return 'enum', None
+            clean = manager._clean_type_name(name)
+            if not name.startswith(('struct ', 'union ')):
+                typedef = manager.find_type_by_name(clean, 'typedef')
+                if typedef:
+                    real_type = typedef.get('real_type')
+                    if real_type in ('pointer', 'function_pointer') or str(typedef.get('type', '')).endswith('*'):
+                        return 'pointer', None
+                    if real_type == 'array':
+                        element = typedef.get('element_type') or typedef.get('base_type') or ''
+                        return 'array', (element, list(typedef.get('array_size') or [1]))
+                    name = typedef.get('base_type') or typedef.get('type')
+                    continue
+                if manager._get_type_kind(clean) == 'pointer':
+                    return 'pointer', None
+                alias = manager.TYPE_ALIASES.get(clean)
+                if alias:
+                    name = alias.get('base_type', '') if isinstance(alias, dict) else alias
+                    continue
+            layout = self._layout(name)
+            if layout is not None:
+                return layout.kind, layout
+            if manager.get_enum_info(name):
+                return 'enum', None
+            break
+        return 'unknown', None
+
+    def layout_fields(self, kind: str, fields: List[Dict[str, Any]], name: Optional[str] = None,
+                      attributes: Optional[Dict[str, Any]] = None) -> TypeLayout:
+        """计算字段列表的布局（不缓存），解析器登记类型前使用
+
+        Args:
+            kind: struct 或 union
+            fields: 字段列表
+            name: 类型名称
+            attributes: 类型属性：packed、aligned（字节）、pack（#pragma pack 的值）
+
+        Returns:
+            布局表
+        """
+        return self._layout_fields(kind, fields, name, attributes or {})[0]
+
+    def field_size(self, field: Dict[str, Any]) -> int:
+        """字段占用的字节数（位域为其存储类型的大小）"""
+        size, _, count, _ = self._field_type(field)
+        return size if field.get('bit_field') is not None else size * count
+
+    def field_alignment(self, field: Dict[str, Any]) -> int:
+        """字段类型的自然对齐"""
+        return self._field_type(field)[1]
+
+    def _layout(self, type_name: str) -> Optional[TypeLayout]:
+        key = type_name.strip()
+        cached = self._cache.get('layout', key)
+        if cached is not ResolutionCache.MISSING:
+            return cached
+        entry, kind, deps = self._find_composite(key)
+        layout = None
+        if entry is not None:
+            layout, field_deps = self._layout_entry(entry, kind)
+            deps = deps | field_deps
+        return self._cache.put('layout', key, layout, deps)
+
+    def _layout_entry(self, entry: Dict[str, Any], kind: str) -> Tuple[TypeLayout, FrozenSet[str]]:
+        name = entry.get('name')
+        if not entry.get('fields'):
+            # 只有大小信息的类型（例如从外部JSON加载、没有字段列表）
+            layout = TypeLayout(name, kind, entry.get('size', 0) or 0, entry.get('alignment', 1) or 1,
+                                [], [], abi=self.abi.name)
+            return layout, frozenset()
+        if name in self._layouts_in_progress:
+            logger.warning(f"类型递归包含自身: {name}")
+            return TypeLayout(name, kind, 0, 1, [], [], abi=self.abi.name), frozenset()
+        self._layouts_in_progress.add(name)
+        try:
+            return self._layout_fields(kind, entry['fields'], name, entry.get('attributes') or {})
+        finally:
+            self._layouts_in_progress.discard(name)
+
+    def _find_composite(self, type_name: str) -> Tuple[Optional[Dict[str, Any]], Optional[str], FrozenSet[str]]:
+        """查找结构体/联合体定义，沿typedef链和类型别名查找"""
+        manager = self.type_manager
+        seen = set()
+        name = type_name
+        while name and name not in seen:
+            seen.add(name)
+            clean = manager._clean_type_name(name)
+            if name.startswith('union '):
+                entry = manager.get_union_info(name)
+                return (entry or None), 'union', self._clean_names(seen)
+            if not name.startswith(('struct ', 'enum ')):
+                typedef = manager.find_type_by_name(clean, 'typedef')
+                if typedef:
+                    if typedef.get('real_type') in ('pointer', 'function_pointer', 'array'):
+                        break
+                    name = typedef.get('base_type') or typedef.get('type')
+                    continue
+                alias = manager.TYPE_ALIASES.get(clean)
+                if alias:
+                    name = alias.get('base_type', '') if isinstance(alias, dict) else alias
+                    continue
+            for kind, finder in (('struct', manager.get_struct_info), ('union', manager.get_union_info)):
+                entry = finder(name)
+                if entry:
+                    return entry, kind, self._clean_names(seen)
+            break
+        return None, None, self._clean_names(seen)
+
+    def _clean_names(self, names) -> FrozenSet[str]:
+        return frozenset(self.type_manager._clean_type_name(name) for name in names)
+
+    def _type_info(self, type_name: str) -> Tuple[int, int, FrozenSet[str]]:
+        """类型的 (大小, 对齐, 依赖的类型名)"""
+        key = type_name.strip()
+        cached = self._cache.get('type', key)
+        if cached is not ResolutionCache.MISSING:
+            return cached
+        if key in self._in_progress:
+            return 0, 1, frozenset((self.type_manager._clean_type_name(key),))
+        self._in_progress.add(key)
+        try:
+            size, alignment, deps = self._compute_type(key)
+        finally:
+            self._in_progress.discard(key)
+        return self._cache.put('type', key, (size, alignment, deps), deps)
+
+    def _compute_type(self, name: str) -> Tuple[int, int, FrozenSet[str]]:
+        abi = self.abi
+        pointer = (abi.sizes['pointer'], abi.alignments['pointer'], frozenset())
+        if not name:
+            return 0, 1, frozenset()
+        if name.endswith('*') or name == 'function_pointer':
+            return pointer
+        if name.endswith(']') and '[' in name:
+            base, dimensions = split_array_suffix(name)
+            size, alignment, deps = self._type_info(base)
+            return size * element_count(dimensions), alignment, deps
+
+        canonical = canonical_basic_type(name)
+        if canonical:
+            return abi.sizes[canonical], abi.alignments[canonical], frozenset()
+
+        manager = self.type_manager
+        clean = manager._clean_type_name(name)
+        deps = {clean}
+        if name.startswith('enum '):
+            return abi.enum_size, abi.enum_size, frozenset(deps)
+        if not name.startswith(('struct ', 'union ')):
+            typedef = manager.find_type_by_name(clean, 'typedef')
+            if typedef:
+                real_type = typedef.get('real_type')
+                if real_type in ('pointer', 'function_pointer') or str(typedef.get('type', '')).endswith('*'):
+                    return pointer[0], pointer[1], frozenset(deps)
+                if real_type == 'array':
+                    element = typedef.get('element_type') or typedef.get('base_type')
+                    size, alignment, element_deps = self._type_info(element or '')
+                    count = element_count(typedef.get('array_size')) if typedef.get('array_size') else 1
+                    return size * count, alignment, frozenset(deps | element_deps)
+                base = typedef.get('base_type') or typedef.get('type')
+                if base and base != name:
+                    size, alignment, base_deps = self._type_info(base)
+                    return size, alignment, frozenset(deps | base_deps)
+            elif manager._get_type_kind(clean) == 'pointer':
+                return pointer[0], pointer[1], frozenset(deps)
+            elif clean in manager.TYPE_ALIASES:
+                alias = manager.TYPE_ALIASES[clean]
+                if isinstance(alias, dict):
+                    alias = alias.get('base_type', '')
+                if alias and alias != name:
+                    size, alignment, alias_deps = self._type_info(alias)
+                    return size, alignment, frozenset(deps | alias_deps)
+
+        layout = self._layout(name)
+        if layout is not None:
+            return layout.size, layout.alignment, frozenset(deps | self._cache.dependencies('layout', name))
+        if manager.get_enum_info(name):
+            return abi.enum_size, abi.enum_size, frozenset(deps)
+        basic = manager.BASIC_TYPES.get(name)
+        if basic:
+            return basic['size'], basic['alignment'], frozenset(deps)
+        if log_gate.debug:
+            logger.debug(f"未知类型，大小按0计算: {name}")
+        return 0, 1, frozenset(deps)
+
+    def _field_type(self, field: Dict[str, Any]) -> Tuple[int, int, int, FrozenSet[str]]:
+        """字段的 (元素大小, 元素对齐, 元素个数, 依赖的类型名)"""
+        size, alignment, deps = self._type_info(field.get('type') or '')
+        return size, alignment, element_count(field.get('array_size')), deps
+
+    def _layout_fields(self, kind: str, fields: List[Dict[str, Any]], name: Optional[str],
+                       attributes: Dict[str, Any]) -> Tuple[TypeLayout, FrozenSet[str]]:
+        abi = self.abi
+        packed = bool(attributes.get('packed'))
+        pack = attributes.get('pack')
+        is_union = kind == 'union'
+        deps = set()
+        layouts = []
+        bit_pos = 0         # 结构体：已占用的位数
+        union_size = 0
+        struct_alignment = 1
+        ms_unit = None      # MSVC位域：当前存储单元 (起始字节, 单元大小, 已用位数)
+
+        for index, field in enumerate(fields):
+            if not isinstance(field, dict):
+                continue
+            elem_size, elem_alignment, count, field_deps = self._field_type(field)
+            deps |= field_deps
+            field_attributes = field.get('attributes') or {}
+
+            alignment = 1 if packed or field_attributes.get('packed') else elem_alignment
+            if pack:
+                alignment = min(alignment, pack)
+            if field_attributes.get('aligned'):
+                alignment = max(alignment, field_attributes['aligned'])
+            alignment = max(alignment, 1)
+
+            width = field.get('bit_field')
+            if width is not None and not isinstance(width, int):
+                logger.warning(f"无法求值的位域宽度，按普通字段处理: {field.get('name')}: {width}")
+                width = None
+
+            if is_union:
+                size = elem_size if width is not None else elem_size * count
+                union_size = max(union_size, size)
+                if width is None or (width and field.get('name')):
+                    struct_alignment = max(struct_alignment, alignment)
+                if width == 0:
+                    continue
+                layouts.append(FieldLayout(field.get('name'), field.get('type') or '', 0, size, alignment,
+                                           0 if width is not None else None, width,
+                                           field.get('array_size'), index))
+                continue
+
+            if width is None:
+                ms_unit = None
+                offset = _align_up((bit_pos + 7) // 8, alignment)
+                size = elem_size * count
+                bit_pos = (offset + size) * 8
+                struct_alignment = max(struct_alignment, alignment)
+                layouts.append(FieldLayout(field.get('name'), field.get('type') or '', offset, size, alignment,
+                                           array_size=field.get('array_size'), index=index))
+                continue
+
+            if abi.ms_bitfields:
+                # MSVC：相同大小类型的相邻位域共享存储单元，否则开始新单元
+                if width == 0:
+                    ms_unit = None
+                    continue
+                if ms_unit and ms_unit[1] == elem_size and ms_unit[2] + width <= elem_size * 8:
+                    start, _, used = ms_unit
+                else:
+                    start, used = _align_up((bit_pos + 7) // 8, alignment), 0
+                    struct_alignment = max(struct_alignment, alignment)
+                ms_unit = (start, elem_size, used + width)
+                bit_pos = max(bit_pos, (start + elem_size) * 8)
+                layouts.append(FieldLayout(field.get('name'), field.get('type') or '', start, elem_size,
+                                           alignment, used, width, index=index))
+                continue
+
+            # System V：位域紧接上一个位域，跨越其类型的存储单元边界时对齐到下一个单元；
+            # packed 和 #pragma pack 下GCC不移动跨越边界的位域
+            unit_bits = elem_size * 8
+            if width == 0:
+                if elem_alignment:
+                    bit_pos = _align_up(bit_pos, elem_alignment * 8)
+                continue
+            if not packed and not pack and unit_bits and \
+                    bit_pos // unit_bits != (bit_pos + width - 1) // unit_bits:
+                bit_pos = _align_up(bit_pos, alignment * 8)
+            unit_alignment = alignment if unit_bits else 1
+            offset = (bit_pos // 8) // unit_alignment * unit_alignment
+            bit_offset = bit_pos - offset * 8
+            bit_pos += width
+            if field.get('name'):
+                struct_alignment = max(struct_alignment, alignment)
+            layouts.append(FieldLayout(field.get('name'), field.get('type') or '', offset,
+                                       (bit_offset + width + 7) // 8, alignment, bit_offset, width,
+                                       index=index))
+
+        if attributes.get('aligned'):
+            struct_alignment = max(struct_alignment, attributes['aligned'])
+        used_bytes = union_size if is_union else (bit_pos + 7) // 8
+        size = _align_up(used_bytes, struct_alignment)
+        padding = self._padding_holes(layouts, size) if not is_union else (
+            [{'offset': union_size, 'size': size - union_size}] if size > union_size else [])
+        layout = TypeLayout(name, kind, size, struct_alignment, layouts, padding, packed, abi.name)
+        return layout, frozenset(deps)
+
+    @staticmethod
+    def _padding_holes(layouts: List[FieldLayout], size: int) -> List[Dict[str, int]]:
+        """计算结构体中未被任何字段占用的字节区间"""
+        holes = []
+        cursor = 0
+        for field in sorted(layouts, key=lambda item: item.offset):
+            if field.offset > cursor:
+                holes.append({'offset': cursor, 'size': field.offset - cursor})
+            cursor = max(cursor, field.offset + field.size)
+        if size > cursor:
+            holes.append({'offset': cursor, 'size': size - cursor})
+        return holes
@@ -0,0 +1,196 @@
+import array
+import json
+from collections.abc import Mapping
+from typing import Dict, Any, Optional, TextIO, Tuple
+from loguru import logger
+from utils.metrics import timed_phase
+from .value_records import StructValue
+from .columnar import StructColumns
+from .type_ref import TypeRef
+
+logger = logger.bind(name="OutputWriter")
+
+
+def json_default(value: Any) -> Any:
+    """JSON编码的后备转换：typed array 输出为列表，结构体值（StructValue）输出为对象，
+    列式结构体数组（StructColumns）输出为列式对象，类型引用（TypeRef）输出为完整的类型信息，
+    其他对象输出为字符串"""
+    if isinstance(value, array.array):
+        return value.tolist()
+    if isinstance(value, TypeRef):
+        return dict(value.resolve())
+    if isinstance(value, StructValue):
+        return dict(value.items())
+    if isinstance(value, StructColumns):
+        return value.to_dict()
+    return str(value)
+
+
+class TypeTable:
+    """reference 输出模式的类型表
+
+    变量的类型信息输出时去掉结构体/联合体/枚举定义（info），改为 ``info_ref``
+    引用类型表中的条目，同一个定义只输出一次。键为定义的名称，
+    不同定义同名时追加 ``#序号``。
+
+    用法示例：
+    ```python
+    table = TypeTable()
+    output = {'variables': variables, 'type_table': table.types}
+    # type_table 放在最后，编码变量时填充
+    json.dumps(output, default=table.json_default)
+    ```
+    """
+
+    def __init__(self):
+        self.types: Dict[str, Any] = {}
+        # 定义对象 id -> (定义, 键)
+        self._keys: Dict[int, Tuple[Dict[str, Any], str]] = {}
+
+    def add(self, info: Dict[str, Any]) -> str:
+        """登记类型定义，返回引用键"""
+        entry = self._keys.get(id(info))
+        if entry is not None and entry[0] is info:
+            return entry[1]
+        name = info.get('name') or 'anonymous'
+        key = name
+        number = 1
+        while key in self.types:
+            number += 1
+            key = f"{name}#{number}"
+        self.types[key] = info
+        self._keys[id(info)] = (info, key)
+        return key
+
+    def reference(self, typeinfo: Mapping) -> Dict[str, Any]:
+        """类型信息的引用形式"""
+        record = dict(typeinfo)
+        info = record.pop('info', None)
+        if info:
+            record['info_ref'] = self.add(info)
+        return record
+
+    def json_default(self, value: Any) -> Any:
+        """JSON编码的后备转换，类型引用输出为引用形式，其他值与 json_default 相同"""
+        if isinstance(value, TypeRef):
+            return self.reference(value)
+        return json_default(value)
+
+
+class StreamingJsonWriter:
+    """变量信息的流式JSON输出
+
+    变量解析完成后立即写出，不在内存中保留，内存占用与变量数量无关。
+    单个变量也通过 JSONEncoder.iterencode 分块写出，不会生成完整的JSON字符串。
+
+    支持两种格式：
+    - ndjson: 每行一个变量
+    - json: 增量写出的JSON对象 {"variables": [...], ...}，close() 时补全结尾
+
+    用法示例：
+    ```python
+    with open('out.ndjson', 'w') as f:
+        writer = StreamingJsonWriter(f, 'ndjson')
+        parser = CDataParser()
+        parser.add_output_writer(writer)
+        parser.parse_file(Path('calib.c'))
+        writer.close()
+    ```
+    """
+
+    FORMATS = ('ndjson', 'json')
+
+    def __init__(self, stream: TextIO, format: str = 'ndjson', simplified: bool = False,
+                 indent: Optional[int] = None, type_table: Optional[TypeTable] = None):
+        """初始化输出
+
+        Args:
+            stream: 输出流
+            format: 输出格式，ndjson 或 json
+            simplified: 是否只输出 name/type/array_size/parsed_value
+            indent: json格式下单个变量的缩进，默认紧凑输出
+            type_table: reference 模式的类型表，变量的类型信息按引用输出，
+                        类型表在 close() 时作为 type_table 写出
+        """
+        if format not in self.FORMATS:
+            raise ValueError(f"Unsupported stream format: {format}")
+        self.stream = stream
+        self.format = format
+        self.simplified = simplified
+        self.count = 0
+        self._closed = False
+        self.type_table = type_table
+        self._encoder = json.JSONEncoder(
+            ensure_ascii=False,
+            default=type_table.json_default if type_table is not None else json_default,
+            indent=indent if format == 'json' else None
+        )
+
+    def write_variable(self, var_info: Dict[str, Any], category: Optional[str] = None) -> None:
+        """写出一个变量
+
+        Args:
+            var_info: 变量信息
+            category: 变量分类（与DataManager.variables的键相同），非精简模式下写入记录
+        """
+        record = self.simplify_variable(var_info) if self.simplified else dict(var_info)
+        if record is None:
+            return
+        if category and not self.simplified:
+            record['category'] = category
+
+        with timed_phase('export'):
+            if self.format == 'json':
+                self.stream.write('{"variables": [\n' if self.count == 0 else ',\n')
+            self._write_value(record)
+            if self.format == 'ndjson':
+                self.stream.write('\n')
+            self.count += 1
+            # 让下游尽早看到输出
+            self.stream.flush()
+
+    def close(self, extra: Optional[Dict[str, Any]] = None) -> None:
+        """结束输出
+
+        Args:
+            extra: json格式下附加在variables之后的顶层字段（例如类型定义），
+                   ndjson格式下作为最后一行写出
+        """
+        if self._closed:
+            return
+        self._closed = True
+        if self.type_table is not None:
+            extra = dict(extra or {}, type_table=self.type_table.types)
+
+        if self.format == 'json':
+            self.stream.write('{"variables": [' if self.count == 0 else '\n')
+            self.stream.write(']')
+            for key, value in (extra or {}).items():
+                self.stream.write(f",\n{json.dumps(key)}: ")
+                self._write_value(value)
+            self.stream.write('}\n')
+        elif extra:
+            self._write_value(extra)
+            self.stream.write('\n')
+        self.stream.flush()
+        logger.debug(f"Streamed {self.count} variables")
+
+    @staticmethod
+    def simplify_variable(var_info: Dict[str, Any]) -> Optional[Dict[str, Any]]:
+        """生成精简的变量信息，字段与 CDataParser.get_simplified_output 一致"""
+        if not var_info.get('name'):
+            return None
+        simplified = {
+            'name': var_info['name'],
+            'type': var_info.get('type', ''),
+            'array_size': var_info.get('array_size', []),
+            'parsed_value': var_info.get('parsed_value')
+        }
+        if not simplified['array_size']:
+            del simplified['array_size']
+        return simplified
+
+    def _write_value(self, value: Any) -> None:
+        """分块编码并写出"""
+        for chunk in self._encoder.iterencode(value):
+            self.stream.write(chunk)
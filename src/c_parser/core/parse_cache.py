@@ -0,0 +1,171 @@
+import hashlib
+import marshal
+import os
+import sys
+import tempfile
+from pathlib import Path
+from typing import Dict, Any, Iterable, Optional, List, Tuple, Union
+from loguru import logger
+from utils.logger import log_gate
+
+logger = logger.bind(name="ParseCache")
+
+
+class ParseCache:
+    """头文件解析结果的磁盘缓存
+
+    缓存键由头文件及其所有包含文件的内容、解析时生效的宏定义和条件编译的
+    判定方式共同决定，与文件路径无关，因此不同目录下相同的SDK头文件可以共享缓存。
+    缓存值是该头文件（含其包含文件）向TypeManager新增的类型信息，
+    格式与 TypeManager.export_types() 相同，另外记录新定义的函数式宏名称
+    （function_macros），使用marshal序列化。
+
+    用法示例：
+    ```python
+    cache = ParseCache('.struct_converter_cache')
+    parser = CTypeParser(parse_cache=cache)
+    parser.parse_declarations(Path('sdk/types.h'))  # 冷启动：解析并写入缓存
+    parser.parse_declarations(Path('sdk/types.h'))  # 热启动：直接读取缓存
+    ```
+    """
+
+    DEFAULT_DIR = '.struct_converter_cache'
+
+    # 文件头：魔数 + 格式版本，解析逻辑或存储格式变化时递增版本
+    MAGIC = b'SCPC'
+    FORMAT_VERSION = 4
+
+    def __init__(self, cache_dir: Union[str, Path] = DEFAULT_DIR):
+        """初始化缓存
+
+        Args:
+            cache_dir: 缓存目录，不存在时在首次写入时创建
+        """
+        self.cache_dir = Path(cache_dir)
+        self.hits = 0
+        self.misses = 0
+
+    def make_key(self, contents: List[bytes], macros: Optional[Dict[str, Any]] = None,
+                 abi: Optional[str] = None, evaluate_conditions: bool = True,
+                 function_macros: Iterable[str] = (), pack_state: Optional[Tuple[Any, ...]] = None) -> str:
+        """计算缓存键
+
+        Args:
+            contents: 头文件及其包含文件的内容，按遍历顺序排列
+            macros: 解析时生效的宏定义
+            abi: 目标ABI名称，结构体大小和字段偏移随ABI变化
+            evaluate_conditions: 是否只解析条件编译块中成立的分支
+            function_macros: 解析前已定义的函数式宏名称，影响 #ifdef / defined 的判定
+            pack_state: 解析前的 #pragma pack 状态（CTypeParser.get_pack_state），影响结构体布局
+
+        Returns:
+            十六进制的sha256摘要
+        """
+        digest = hashlib.sha256()
+        digest.update(self.MAGIC)
+        digest.update(bytes([self.FORMAT_VERSION]))
+        # marshal格式随Python版本变化
+        digest.update(f"{sys.version_info[0]}.{sys.version_info[1]}".encode('ascii'))
+
+        for content in contents:
+            digest.update(len(content).to_bytes(8, 'little'))
+            digest.update(content)
+
+        for name, value in sorted((macros or {}).items(), key=lambda item: str(item[0])):
+            digest.update(f"\0{name}={value!r}".encode('utf8'))
+
+        if abi:
+            digest.update(f"\0abi={abi}".encode('utf8'))
+
+        digest.update(f"\0conditions={int(bool(evaluate_conditions))}".encode('ascii'))
+        for name in sorted(function_macros):
+            digest.update(f"\0{name}()".encode('utf8'))
+
+        if pack_state is not None:
+            digest.update(f"\0pack={pack_state!r}".encode('utf8'))
+
+        return digest.hexdigest()
+
+    def load(self, key: str) -> Optional[Dict[str, Any]]:
+        """读取缓存条目
+
+        Args:
+            key: 缓存键
+
+        Returns:
+            缓存的类型信息，未命中或条目损坏时返回None
+        """
+        path = self._entry_path(key)
+        try:
+            data = path.read_bytes()
+        except OSError:
+            self.misses += 1
+            return None
+
+        header = self.MAGIC + bytes([self.FORMAT_VERSION])
+        if not data.startswith(header):
+            logger.warning(f"Ignoring cache entry with unknown format: {path}")
+            self.misses += 1
+            return None
+
+        try:
+            payload = marshal.loads(data[len(header):])
+        except (EOFError, ValueError, TypeError) as e:
+            logger.warning(f"Ignoring corrupted cache entry {path}: {e}")
+            self.misses += 1
+            return None
+
+        self.hits += 1
+        return payload
+
+    def store(self, key: str, payload: Dict[str, Any]) -> bool:
+        """写入缓存条目
+
+        写入临时文件后原子替换，多个进程可以安全地共享同一缓存目录。
+
+        Args:
+            key: 缓存键
+            payload: 要缓存的类型信息
+
+        Returns:
+            写入成功返回True
+        """
+        try:
+            data = marshal.dumps(payload)
+        except ValueError as e:
+            logger.warning(f"Type info is not cacheable: {e}")
+            return False
+
+        path = self._entry_path(key)
+        try:
+            path.parent.mkdir(parents=True, exist_ok=True)
+            fd, tmp_name = tempfile.mkstemp(dir=str(path.parent), suffix='.tmp')
+            try:
+                with os.fdopen(fd, 'wb') as f:
+                    f.write(self.MAGIC + bytes([self.FORMAT_VERSION]))
+                    f.write(data)
+                os.replace(tmp_name, str(path))
+            except BaseException:
+                os.unlink(tmp_name)
+                raise
+        except OSError as e:
+            logger.warning(f"Failed to write cache entry {path}: {e}")
+            return False
+
+        if log_gate.debug:
+            logger.debug(f"Stored cache entry: {path}")
+        return True
+
+    def clear(self) -> None:
+        """删除所有缓存条目"""
+        if not self.cache_dir.exists():
+            return
+        for entry in self.cache_dir.glob('*/*.bin'):
+            try:
+                entry.unlink()
+            except OSError as e:
+                logger.warning(f"Failed to remove cache entry {entry}: {e}")
+
+    def _entry_path(self, key: str) -> Path:
+        """缓存条目路径，按键的前两位分目录"""
+        return self.cache_dir / key[:2] / f"{key}.bin"
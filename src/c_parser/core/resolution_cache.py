@@ -0,0 +1,108 @@
+from typing import Dict, Any, Iterable, Set, Tuple, FrozenSet
+
+
+class ResolutionCache:
+    """类型解析结果缓存
+
+    按 (类别, 类型名) 保存解析结果，例如类型种类、类型定义、typedef链解析结果。
+    每个结果记录计算时查询过的类型名（清理后的名称），某个类型被注册或
+    更新时只失效依赖它的结果，其他结果继续有效。
+
+    用法示例：
+    ```python
+    cache = ResolutionCache()
+    cache.put('kind', 'MyInt', 'typedef', {'MyInt'})
+    cache.get('kind', 'MyInt')       # 'typedef'
+    cache.invalidate(['MyInt'])      # 依赖 MyInt 的结果全部失效
+    ```
+    """
+
+    MISSING = object()
+
+    def __init__(self):
+        self._entries: Dict[Tuple[str, str], Tuple[Any, FrozenSet[str]]] = {}
+        self._dependents: Dict[str, Set[Tuple[str, str]]] = {}
+        self.hits = 0
+        self.misses = 0
+
+    def __len__(self) -> int:
+        return len(self._entries)
+
+    def __contains__(self, key: Tuple[str, str]) -> bool:
+        return key in self._entries
+
+    def get(self, category: str, name: str, default: Any = MISSING) -> Any:
+        """获取缓存的结果
+
+        Args:
+            category: 结果类别
+            name: 类型名称
+            default: 未命中时的返回值，默认为 ResolutionCache.MISSING
+
+        Returns:
+            缓存的结果（结果本身可能是None）
+        """
+        entry = self._entries.get((category, name))
+        if entry is None:
+            self.misses += 1
+            return default
+        self.hits += 1
+        return entry[0]
+
+    def dependencies(self, category: str, name: str) -> FrozenSet[str]:
+        """获取结果依赖的类型名，未缓存时返回空集合"""
+        entry = self._entries.get((category, name))
+        return entry[1] if entry is not None else frozenset()
+
+    def put(self, category: str, name: str, value: Any, depends_on: Iterable[str]) -> Any:
+        """缓存结果
+
+        Args:
+            category: 结果类别
+            name: 类型名称
+            value: 结果
+            depends_on: 计算结果时查询过的类型名
+
+        Returns:
+            value，便于直接返回
+        """
+        key = (category, name)
+        if key in self._entries:
+            self._discard(key)
+        depends_on = frozenset(depends_on)
+        self._entries[key] = (value, depends_on)
+        for dependency in depends_on:
+            self._dependents.setdefault(dependency, set()).add(key)
+        return value
+
+    def invalidate(self, names: Iterable[str]) -> int:
+        """失效依赖给定类型名的所有结果
+
+        Args:
+            names: 发生变化的类型名（清理后的名称）
+
+        Returns:
+            失效的结果数量
+        """
+        removed = 0
+        for name in names:
+            for key in self._dependents.pop(name, ()):
+                if key in self._entries:
+                    self._discard(key)
+                    removed += 1
+        return removed
+
+    def clear(self) -> None:
+        """清空缓存"""
+        self._entries.clear()
+        self._dependents.clear()
+
+    def _discard(self, key: Tuple[str, str]) -> None:
+        """移除一个结果及其依赖记录"""
+        _, depends_on = self._entries.pop(key)
+        for dependency in depends_on:
+            dependents = self._dependents.get(dependency)
+            if dependents is not None:
+                dependents.discard(key)
+                if not dependents:
+                    del self._dependents[dependency]
@@ -0,0 +1,138 @@
+import re
+from typing import BinaryIO, Iterator, NamedTuple, Optional
+from loguru import logger
+from utils.logger import log_gate
+
+logger = logger.bind(name="SourceChunker")
+
+__all__ = ['SourceChunk', 'SourceChunker']
+
+# 影响顶层边界判断的词法单元：完整的注释、字符串、预处理行和括号/分号。
+# 后三个分支只匹配未结束的注释/字符串开头，表示需要读取更多数据
+_TOKENS = re.compile(rb'''
+    (?P<comment>/\*.*?\*/|//[^\n]*)
+  | (?P<string>"(?:[^"\\\n]|\\.)*"|'(?:[^'\\\n]|\\.)*')
+  | (?P<directive>^[ \t]*\#(?:[^\n\\]|\\.)*)
+  | (?P<punct>[{}()\[\];])
+  | (?P<open_comment>/\*)
+  | (?P<open_string>["'])
+''', re.S | re.M | re.X)
+
+_CONDITIONAL = re.compile(rb'[ \t]*#[ \t]*(if|ifdef|ifndef|endif)\b')
+
+
+class SourceChunk(NamedTuple):
+    """按顶层声明边界切分出的一段源码"""
+    data: bytes
+    # 第一个字节在文件中的偏移
+    offset: int
+    # 第一行在文件中的行号（从0开始）
+    line: int
+
+
+class SourceChunker:
+    """把C源文件按顶层声明边界切分为多个可独立解析的块
+
+    只做轻量的词法扫描：跳过注释和字符串，记录括号深度和预处理条件深度。
+    两者都为0时，分号和预处理行的结尾是安全的切分点，切分点之前的内容作为一个
+    translation_unit 交给tree-sitter解析，类型定义按源码顺序登记后对后面的块可见。
+
+    每次只预读 read_size 字节，块累积到 chunk_size 后在最近的切分点切出，
+    内存占用与块大小和最大的单个声明相关，与文件大小无关。
+    整个文件被 #if/#endif 包围时没有安全的切分点，退化为一个块。
+
+    用法示例：
+    ```python
+    with open('calib.c', 'rb') as f:
+        for chunk in SourceChunker(f):
+            tree = TreeSitterUtils.parse_bytes(chunk.data)
+    ```
+    """
+
+    DEFAULT_CHUNK_SIZE = 4 << 20
+    READ_SIZE = 1 << 20
+
+    def __init__(self, stream: BinaryIO, chunk_size: int = DEFAULT_CHUNK_SIZE,
+                 read_size: Optional[int] = None):
+        """初始化
+
+        Args:
+            stream: 以二进制模式打开的源文件
+            chunk_size: 块的目标大小（字节），块在达到该大小后的第一个切分点结束
+            read_size: 每次读取的字节数，默认 READ_SIZE
+        """
+        if chunk_size <= 0:
+            raise ValueError(f"Invalid chunk size: {chunk_size}")
+        self.stream = stream
+        self.chunk_size = chunk_size
+        self.read_size = read_size or min(self.READ_SIZE, chunk_size)
+
+    def __iter__(self) -> Iterator[SourceChunk]:
+        buffer = bytearray()
+        # 已扫描到的位置、最近的切分点（相对buffer），括号深度和预处理条件深度
+        scanned = cut = 0
+        depth = conditional = 0
+        offset = line = 0
+        eof = False
+
+        while not eof:
+            block = self.stream.read(self.read_size)
+            eof = not block
+            buffer += block
+
+            # 扫描位置停在最后一个完整词法单元之后，剩余部分（可能是被截断的 // 或 /*）下次重新扫描
+            for match in _TOKENS.finditer(buffer, scanned):
+                kind = match.lastgroup
+                if kind in ('open_comment', 'open_string') or (
+                        match.end() == len(buffer) and (kind == 'directive' or match.group().startswith(b'//'))):
+                    # 未结束的字符串遇到换行即为错误写法，不再等待后面的数据
+                    if kind == 'open_string' and buffer.find(b'\n', match.start()) != -1:
+                        scanned = match.end()
+                        continue
+                    if not eof:
+                        break
+                scanned = match.end()
+                if kind == 'punct':
+                    token = match.group()
+                    if token in b'{([':
+                        depth += 1
+                    elif token in b'})]':
+                        depth = max(depth - 1, 0)
+                    elif depth == 0 and conditional == 0:
+                        cut = scanned
+                elif kind == 'directive':
+                    directive = _CONDITIONAL.match(match.group())
+                    if directive:
+                        conditional += -1 if directive.group(1) == b'endif' else 1
+                        conditional = max(conditional, 0)
+                    if depth == 0 and conditional == 0:
+                        cut = scanned
+            else:
+                # 没有等待更多数据的词法单元：之后的逗号、数字等不需要重新扫描，
+                # 否则大的初始化列表每次预读都从头扫描，总耗时与文件大小的平方成正比
+                scanned = self._rescan_start(buffer, scanned)
+
+            if cut >= self.chunk_size or (eof and buffer):
+                end = len(buffer) if eof else cut
+                with memoryview(buffer) as view:
+                    data = bytes(view[:end])
+                del buffer[:end]
+                if log_gate.debug:
+                    logger.debug(f"Chunk at byte {offset}: {len(data)} bytes")
+                yield SourceChunk(data, offset, line)
+                offset += len(data)
+                line += data.count(b'\n')
+                scanned -= end
+                cut = 0
+
+    @staticmethod
+    def _rescan_start(buffer: bytearray, scanned: int) -> int:
+        """下次扫描的起点：只保留末尾可能与后面的数据组成词法单元的部分
+
+        末尾的 / 可能是注释的开头；行首的空白之后可能是预处理指令。
+        """
+        end = max(len(buffer) - 1 if buffer.endswith(b'/') else len(buffer), scanned)
+        start = end
+        while start > scanned and buffer[start - 1] in b' \t':
+            start -= 1
+        return start if start == 0 or buffer[start - 1] == 0x0a else end
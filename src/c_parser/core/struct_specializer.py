@@ -0,0 +1,126 @@
+from typing import Dict, Any, Callable, List, Mapping, Optional, Set, Tuple
+from loguru import logger
+from utils.logger import log_gate
+from utils.metrics import count
+from .value_records import record_class, build_record
+
+logger = logger.bind(name="StructSpecializer")
+
+__all__ = ['StructSpecializer']
+
+# 生成的函数签名：decode(raw, wrap, fill)，wrap/fill 分别处理数组字段和嵌套结构体字段
+Decoder = Callable[[List[Any], Callable, Callable], Mapping]
+
+
+class StructSpecializer:
+    """为每个结构体/联合体类型生成专用的填充函数
+
+    通用的填充流程对每个元素的每个字段都要查询字段类型、判断字段种类。
+    字段布局在类型解析完成后就固定了，这里按类型定义生成一个Python函数，
+    字段名、字段种类和嵌套字段的变量信息在生成时确定，绑定为函数的常量，
+    每个元素只做按下标取值和赋值，结果与通用流程相同。
+
+    生成的函数缓存在 TypeManager 的解析缓存中（get_derived），结构体或任何
+    字段类型被重新注册时失效。函数不引用解析器，嵌套字段通过调用时传入的
+    wrap/fill 处理，同一个类型表的多个解析器可以共享。
+
+    联合体按初始化时选中的成员分别生成。
+
+    用法示例：
+    ```python
+    specializer = StructSpecializer(type_manager)
+    decode = specializer.decoder(info)
+    value = decode(raw_data, parser._wapper_raw_data, parser._fill_field_data)
+    print(specializer.source(info))
+    ```
+    """
+
+    CATEGORY = 'decoder'
+
+    def __init__(self, type_manager):
+        """初始化
+
+        Args:
+            type_manager: TypeManager，用于解析字段类型和缓存生成的函数
+        """
+        self.type_manager = type_manager
+
+    def decoder(self, info: Dict[str, Any], fields: Optional[List[Dict[str, Any]]] = None) -> Decoder:
+        """获取类型定义对应的填充函数
+
+        Args:
+            info: 结构体/联合体定义（包含 name 和 fields）
+            fields: 参与填充的字段，默认为全部字段；联合体传入选中的成员
+
+        Returns:
+            decode(raw, wrap, fill) 函数
+        """
+        if fields is None:
+            fields = info['fields']
+        key = self._key(info, fields)
+        # 同名但不是同一个定义对象（例如手工构造的类型信息）时重新生成
+        entry = self.type_manager.get_derived(self.CATEGORY, key, lambda: self._generate(info, fields),
+                                              lambda cached: cached[0] is info and cached[1] == len(fields))
+        return entry[2]
+
+    def source(self, info: Dict[str, Any], fields: Optional[List[Dict[str, Any]]] = None) -> str:
+        """获取生成的函数源码，用于调试和检查"""
+        return self.decoder(info, fields).source
+
+    @staticmethod
+    def _key(info: Dict[str, Any], fields: List[Dict[str, Any]]) -> str:
+        name = info.get('name') or ''
+        if info.get('kind') == 'union' and fields:
+            return f"{name}::{fields[0]['name']}"
+        return name
+
+    def _generate(self, info: Dict[str, Any],
+                  fields: List[Dict[str, Any]]) -> Tuple[Tuple[Dict[str, Any], int, Decoder], Set[str]]:
+        """生成填充函数
+
+        Returns:
+            ((info, 字段数量, 函数), 依赖的类型名)
+        """
+        name = info.get('name') or ''
+        namespace: Dict[str, Any] = {'_build': build_record, '_cls': record_class(info)}
+        depends_on = set(self.type_manager.type_dependencies(name)) if name else set()
+        depends_on.add(name)
+
+        # 函数体只有每个字段几行，直接逐行拼接：生成发生在解析过程中，
+        # 不为此加载和渲染Jinja2模板（jinja2 是包的依赖，但c_parser中没有使用模板）
+        lines = ['def decode(raw, wrap, fill):', '    n = len(raw)', '    result = {}']
+        for index, field in enumerate(fields):
+            field_type = self.type_manager.resolve_type_shared(field['type'])
+            depends_on |= self.type_manager.type_dependencies(field['type'])
+            array_size = field['array_size']
+            namespace[f'_name{index}'] = field['name']
+
+            lines.append(f"    # {field['name']!r}: {field['type']!r}")
+            lines.append(f'    if n <= {index}:')
+            lines.append('        return _build(_cls, result)')
+            if (field_type['is_struct'] or field_type['is_union']) and (array_size or not field_type['is_pointer']):
+                namespace[f'_info{index}'] = {
+                    'name': field['name'],
+                    'type': field['type'],
+                    'array_size': array_size,
+                    'typeinfo': field_type,
+                }
+                helper = 'wrap' if array_size else 'fill'
+                lines.append(f'    result[_name{index}] = {helper}(raw[{index}], _info{index})')
+            else:
+                # 指定初始化的字段以 {name: value} 出现在原始列表中
+                lines.append(f'    value = raw[{index}]')
+                lines.append('    if isinstance(value, dict):')
+                lines.append('        result.update(value)')
+                lines.append('    else:')
+                lines.append(f'        result[_name{index}] = value')
+        lines.append('    return _build(_cls, result)')
+        source = '\n'.join(lines) + '\n'
+
+        exec(compile(source, f'<decoder {name}>', 'exec'), namespace)
+        decode = namespace['decode']
+        decode.source = source
+        count('specialized_types')
+        if log_gate.debug:
+            logger.debug(f"Generated decoder for {name} ({len(fields)} fields)")
+        return (info, len(fields), decode), depends_on
@@ -0,0 +1,515 @@
+import array
+import hashlib
+import json
+import re
+from collections import deque
+from collections.abc import Mapping, Sequence
+from typing import Dict, Any, Iterable, Iterator, Optional, List, Tuple
+from loguru import logger
+from utils.metrics import count, timed_phase
+
+logger = logger.bind(name="StructuralDiff")
+
+__all__ = ['SnapshotBuilder', 'Snapshot', 'diff_snapshots', 'format_diff']
+
+_DIGEST_SIZE = 16
+# 保存在哈希树中、直接参与父节点编码的值类型
+_SCALAR_TYPES = frozenset({int, float, str, bool, type(None)})
+# 数组摘要树每个节点的子节点数量
+_FANOUT = 64
+_MISSING = object()
+# 查找类型定义时忽略的限定符
+_QUALIFIERS = frozenset({'const', 'volatile', 'restrict', 'static', 'extern'})
+# 类型解析器为匿名结构体/联合体生成的名称：__anon_struct_<行>_<列>_<内容哈希>
+_ANONYMOUS_NAME = re.compile(r'\b__anon_(struct|union)_\d+_\d+_([0-9a-f]+)\b')
+
+
+def _hash(data: bytes) -> bytes:
+    return hashlib.blake2b(data, digest_size=_DIGEST_SIZE).digest()
+
+
+class StructHash:
+    """结构体/联合体值的哈希节点：字段名 -> 子节点（标量直接保存值）"""
+
+    __slots__ = ('digest', 'fields')
+
+    def __init__(self, digest: bytes, fields: Dict[Any, Any]):
+        self.digest = digest
+        self.fields = fields
+
+
+class ArrayHash:
+    """数组值的哈希节点：只保存各层摘要，不保存元素
+
+    元素按 chunk_size 个一组计算摘要（第0层），之后每 _FANOUT 个摘要合并为上一层的
+    一个摘要，直到只剩一个。第 L 层的第 i 个节点覆盖第 [i*F^L, (i+1)*F^L) 组元素。
+    """
+
+    __slots__ = ('digest', 'length', 'levels')
+
+    def __init__(self, length: int, levels: List[List[bytes]]):
+        self.length = length
+        self.levels = levels
+        root = levels[-1][0] if levels[-1] else b''
+        self.digest = _hash(b'[%d]' % length + root)
+
+
+def _digest_of(node: Any) -> Any:
+    """子节点在父节点编码中的表示：标量为自身，复合值为其摘要"""
+    if type(node) in _SCALAR_TYPES:
+        return node
+    return node.digest
+
+
+class _ValueHasher:
+    """把解析得到的值转换为哈希树"""
+
+    def __init__(self, chunk_size: int):
+        self.chunk_size = chunk_size
+
+    def tree(self, value: Any) -> Any:
+        """值的哈希节点：标量返回值本身，结构体返回 StructHash，数组返回 ArrayHash"""
+        if type(value) in _SCALAR_TYPES:
+            return value
+        if isinstance(value, Mapping):
+            fields = {name: self.tree(field) for name, field in value.items()}
+            encoded = repr([(name, _digest_of(node)) for name, node in fields.items()])
+            return StructHash(_hash(b'{' + encoded.encode('utf-8', 'surrogatepass')), fields)
+        if isinstance(value, (Sequence, array.array)) and not isinstance(value, (str, bytes)):
+            return self.array(value)
+        return repr(value)
+
+    def token(self, value: Any) -> Any:
+        """数组元素在分组编码中的表示，元素本身不保留"""
+        if type(value) in _SCALAR_TYPES:
+            return value
+        return _digest_of(self.tree(value))
+
+    def array(self, value: Any) -> ArrayHash:
+        items = value.tolist() if isinstance(value, array.array) else value
+        length = len(items)
+        size = self.chunk_size
+        token = self.token
+        level = [_hash(repr([token(item) for item in items[start:start + size]]).encode('utf-8', 'surrogatepass'))
+                 for start in range(0, length, size)]
+        levels = [level]
+        while len(level) > 1:
+            level = [_hash(b''.join(level[start:start + _FANOUT])) for start in range(0, len(level), _FANOUT)]
+            levels.append(level)
+        return ArrayHash(length, levels)
+
+
+class Snapshot:
+    """一次解析结果的结构哈希
+
+    types: (kind, name) -> {'own': 定义本身的摘要, 'merkle': 含引用类型的摘要, 'layout': 布局概要}
+    variables: 变量名 -> {'category', 'type', 'array_size', 'value': 哈希树, 'digest'}
+    摘要按 类型/变量 -> 分区 -> 根 逐层合并，diff_snapshots 从根开始比较。
+    """
+
+    def __init__(self, chunk_size: int, types: Dict[Tuple[str, str], Dict[str, Any]],
+                 variables: Dict[str, Dict[str, Any]]):
+        self.chunk_size = chunk_size
+        self.types = types
+        self.variables = variables
+        self.types_digest = _hash(repr(sorted((key, entry['merkle'], repr(entry['layout']))
+                                              for key, entry in types.items())).encode('utf-8', 'surrogatepass'))
+        self.variables_digest = _hash(repr(sorted((name, entry['digest'])
+                                                  for name, entry in variables.items())).encode('utf-8', 'surrogatepass'))
+        self.digest = _hash(self.types_digest + self.variables_digest)
+
+
+class SnapshotBuilder:
+    """在解析过程中计算结构哈希（作为 DataManager 的流式输出）
+
+    每个变量解析完成后立即转换为哈希树，数组只保留分组摘要，变量值本身不保存，
+    内存占用与元素数量的 1/chunk_size 成正比。解析结束后调用 finish() 计算
+    类型的摘要，得到 Snapshot。
+
+    用法示例：
+    ```python
+    builder = SnapshotBuilder()
+    parser.add_output_writer(builder)
+    parser.parse_file_chunked(path)
+    snapshot = builder.finish(parser.type_manager)
+    ```
+    """
+
+    # 数组每组的元素数量，变化范围按组对齐
+    CHUNK_SIZE = 64
+
+    def __init__(self, chunk_size: int = CHUNK_SIZE):
+        """初始化
+
+        Args:
+            chunk_size: 数组每组的元素数量，两个快照必须相同才能比较
+        """
+        self.chunk_size = chunk_size
+        self._hasher = _ValueHasher(chunk_size)
+        self.variables: Dict[str, Dict[str, Any]] = {}
+        # 变量的声明类型（原始名称），finish() 从这些类型开始查找引用的类型
+        self._roots: List[str] = []
+        self.count = 0
+
+    def write_variable(self, var_info: Dict[str, Any], category: str) -> None:
+        """计算变量的哈希树（DataManager 流式输出接口）"""
+        with timed_phase('hash'):
+            value = self._hasher.tree(var_info.get('parsed_value'))
+        declared_type = var_info.get('type')
+        if isinstance(declared_type, str):
+            self._roots.append(declared_type)
+        declaration = (_anonymous_name(declared_type), var_info.get('array_size'))
+        name = var_info.get('name') or 'anonymous'
+        key = name
+        number = 1
+        while key in self.variables:
+            number += 1
+            key = f"{name}#{number}"
+        self.variables[key] = {
+            'category': category,
+            'type': declaration[0],
+            'array_size': declaration[1],
+            'value': value,
+            'digest': _hash(repr((declaration, _digest_of(value))).encode('utf-8', 'surrogatepass')),
+        }
+        self.count += 1
+
+    def finish(self, type_manager) -> Snapshot:
+        """计算类型的摘要并生成快照
+
+        只计算 type_manager 自身层中的类型和变量引用的类型，见 _hash_types。
+
+        Args:
+            type_manager: 解析使用的 TypeManager
+
+        Returns:
+            Snapshot
+        """
+        with timed_phase('hash'):
+            types = _hash_types(type_manager, self._roots)
+        count('snapshot_variables', len(self.variables))
+        return Snapshot(self.chunk_size, types, self.variables)
+
+
+def _anonymous_name(value: Any) -> Any:
+    """去掉匿名类型名称中的行号和列号，只保留内容哈希"""
+    if isinstance(value, str) and '__anon_' in value:
+        return _ANONYMOUS_NAME.sub(r'__anon_\1_\2', value)
+    return value
+
+
+def _canonical(value: Any) -> Any:
+    """去掉位置信息，行号变化不视为定义变化
+
+    匿名类型的名称和对它的引用（typedef的基础类型、字段类型）同样去掉行号和列号。
+    """
+    if isinstance(value, dict):
+        return {key: _canonical(item) for key, item in value.items() if key != 'location'}
+    if isinstance(value, (list, tuple)):
+        return [_canonical(item) for item in value]
+    return _anonymous_name(value)
+
+
+def _references(entry: Dict[str, Any]) -> List[str]:
+    """类型定义直接引用的类型名（typedef的基础类型、字段类型）"""
+    names = []
+    for key in ('base_type', 'type'):
+        if isinstance(entry.get(key), str):
+            names.append(entry[key])
+
+    def visit(fields):
+        for field in fields or ():
+            if isinstance(field, dict):
+                if isinstance(field.get('type'), str):
+                    names.append(field['type'])
+                visit(field.get('nested_fields'))
+    visit(entry.get('fields'))
+    return names
+
+
+def _layout_summary(type_manager, name: str) -> Optional[Dict[str, Any]]:
+    try:
+        layout = type_manager.get_type_layout(name)
+    except Exception as e:
+        logger.warning(f"Cannot compute layout of {name}: {e}")
+        return None
+    if layout is None:
+        return None
+    fields = {}
+    for field in layout.to_dict()['fields']:
+        fields[field['name']] = [field['offset'], field.get('bit_offset')] if 'bit_size' in field else field['offset']
+    return {'size': layout.size, 'alignment': layout.alignment, 'fields': fields}
+
+
+def _type_names(type_name: str) -> Iterator[str]:
+    """类型字符串可能对应的条目名称：原样，以及去掉限定符和指针后的名称"""
+    yield type_name
+    words = [word for word in type_name.replace('*', ' ').split() if word not in _QUALIFIERS]
+    if words:
+        yield ' '.join(words)
+
+
+def _hash_types(type_manager, roots: Iterable[str] = ()) -> Dict[Tuple[str, str], Dict[str, Any]]:
+    """计算每个类型定义的摘要
+
+    own 只包含定义本身；merkle 还包含引用的类型的 merkle 摘要，
+    引用的类型（包括间接引用的）变化时随之变化。循环引用处使用 own。
+
+    只计算 type_manager 自身层中的类型以及它们和 roots（变量的声明类型）
+    引用的类型。两个版本 fork 自同一个底层（例如 --types 指定的SDK类型库）时，
+    底层中没有被引用的类型不可能不同，不反序列化、不计算布局。
+
+    匿名类型的键使用去掉行号和列号的名称，内容相同的匿名类型只保留最先登记的一个。
+    """
+    types: Dict[Tuple[str, str], Dict[str, Any]] = {}
+    by_name: Dict[str, Tuple[str, str]] = {}
+    # 按登记顺序处理自身的类型，再处理变量的声明类型，引用的类型排在后面
+    pending = deque(entry.get('name') for entry in type_manager.own_types() if isinstance(entry, dict))
+    pending.extend(roots)
+    seen = set()
+    while pending:
+        type_name = pending.popleft()
+        if not isinstance(type_name, str):
+            continue
+        for name in _type_names(type_name):
+            if name in seen:
+                continue
+            seen.add(name)
+            for entry in type_manager.types_named(name):
+                if not isinstance(entry, dict) or entry.get('name') != name:
+                    continue
+                key = (str(entry.get('kind')), _anonymous_name(name))
+                if key in types:
+                    # 与类型查找一致，同键保留最先登记的定义
+                    continue
+                encoded = json.dumps(_canonical(entry), sort_keys=True, default=str, ensure_ascii=False)
+                types[key] = {'own': _hash(encoded.encode('utf-8', 'surrogatepass')), 'entry': entry}
+                by_name.setdefault(name, key)
+                pending.extend(_references(entry))
+
+    visiting = set()
+
+    def merkle(key: Tuple[str, str]) -> bytes:
+        record = types[key]
+        digest = record.get('merkle')
+        if digest is not None:
+            return digest
+        if key in visiting:
+            return record['own']
+        visiting.add(key)
+        children = []
+        for name in _references(record['entry']):
+            child = by_name.get(name)
+            if child is not None and child != key:
+                children.append(merkle(child))
+        visiting.discard(key)
+        record['merkle'] = digest = _hash(record['own'] + b''.join(children))
+        return digest
+
+    for key in types:
+        merkle(key)
+    for (kind, _), record in types.items():
+        name = record.pop('entry')['name']
+        record['layout'] = _layout_summary(type_manager, name) if kind in ('struct', 'union') else None
+    return types
+
+
+def _changed_ranges(old: ArrayHash, new: ArrayHash, chunk_size: int) -> List[List[int]]:
+    """从根开始比较两个数组的摘要树，只展开摘要不同的节点
+
+    Returns:
+        变化的元素下标范围 [start, end)，按组对齐，按新数组的下标（超出旧数组的部分为新增元素）
+    """
+    top = min(len(old.levels), len(new.levels)) - 1
+    width = max(len(old.levels[top]), len(new.levels[top]))
+    candidates = range(width)
+    compared = 0
+    for level in range(top, -1, -1):
+        old_level, new_level = old.levels[level], new.levels[level]
+        differing = [index for index in candidates
+                     if index >= len(old_level) or index >= len(new_level) or old_level[index] != new_level[index]]
+        compared += len(candidates)
+        if level == 0:
+            candidates = differing
+            break
+        below = max(len(old.levels[level - 1]), len(new.levels[level - 1]))
+        candidates = [child for index in differing
+                      for child in range(index * _FANOUT, min((index + 1) * _FANOUT, below))]
+    count('diff_digests_compared', compared)
+
+    length = max(old.length, new.length)
+    ranges: List[List[int]] = []
+    for index in candidates:
+        start, end = index * chunk_size, min((index + 1) * chunk_size, length)
+        if ranges and ranges[-1][1] == start:
+            ranges[-1][1] = end
+        else:
+            ranges.append([start, end])
+    return ranges
+
+
+def _describe(node: Any) -> Any:
+    """报告中值的表示：标量为值本身，复合值为其种类"""
+    if node is _MISSING:
+        return None
+    if type(node) in _SCALAR_TYPES:
+        return node
+    return '<struct>' if isinstance(node, StructHash) else f'<array[{node.length}]>'
+
+
+def _diff_values(path: str, old: Any, new: Any, chunk_size: int, changes: List[Dict[str, Any]]) -> None:
+    if isinstance(old, StructHash) and isinstance(new, StructHash):
+        if old.digest == new.digest:
+            return
+        names = list(old.fields) + [name for name in new.fields if name not in old.fields]
+        for name in names:
+            _diff_values(f"{path}.{name}", old.fields.get(name, _MISSING), new.fields.get(name, _MISSING),
+                         chunk_size, changes)
+        return
+    if isinstance(old, ArrayHash) and isinstance(new, ArrayHash):
+        if old.digest == new.digest:
+            return
+        change = {'path': path, 'ranges': _changed_ranges(old, new, chunk_size)}
+        if old.length != new.length:
+            change['length'] = [old.length, new.length]
+        changes.append(change)
+        return
+    # 与哈希编码一致：1、1.0 和 True 视为不同的值
+    if type(old) is type(new) and (old is _MISSING or type(old) in _SCALAR_TYPES) and repr(old) == repr(new):
+        return
+    changes.append({'path': path, 'old': _describe(old), 'new': _describe(new)})
+
+
+def _diff_types(old: Snapshot, new: Snapshot) -> Dict[str, List[Any]]:
+    report: Dict[str, List[Any]] = {'added': [], 'removed': [], 'changed': [], 'affected': [], 'layout': []}
+
+    def name_of(key):
+        return {'kind': key[0], 'name': key[1]}
+
+    for key in old.types:
+        if key not in new.types:
+            report['removed'].append(name_of(key))
+    for key, entry in new.types.items():
+        previous = old.types.get(key)
+        if previous is None:
+            report['added'].append(name_of(key))
+            continue
+        if previous['merkle'] != entry['merkle']:
+            # changed：定义本身变化；affected：只有引用的类型变化
+            report['changed' if previous['own'] != entry['own'] else 'affected'].append(name_of(key))
+        if previous['layout'] != entry['layout'] and previous['layout'] and entry['layout']:
+            report['layout'].append(dict(name_of(key), **_diff_layout(previous['layout'], entry['layout'])))
+    return report
+
+
+def _diff_layout(old: Dict[str, Any], new: Dict[str, Any]) -> Dict[str, Any]:
+    result: Dict[str, Any] = {}
+    for key in ('size', 'alignment'):
+        if old[key] != new[key]:
+            result[key] = [old[key], new[key]]
+    fields = {}
+    for name in list(old['fields']) + [name for name in new['fields'] if name not in old['fields']]:
+        before, after = old['fields'].get(name), new['fields'].get(name)
+        if before != after:
+            fields[name] = [before, after]
+    if fields:
+        result['fields'] = fields
+    return result
+
+
+def _diff_variables(old: Snapshot, new: Snapshot) -> Dict[str, List[Any]]:
+    report: Dict[str, List[Any]] = {'added': [], 'removed': [], 'changed': []}
+    report['removed'] = [name for name in old.variables if name not in new.variables]
+    for name, entry in new.variables.items():
+        previous = old.variables.get(name)
+        if previous is None:
+            report['added'].append(name)
+            continue
+        if previous['digest'] == entry['digest']:
+            continue
+        change: Dict[str, Any] = {'name': name, 'category': entry['category']}
+        for key in ('type', 'array_size'):
+            if previous[key] != entry[key]:
+                change[key] = [previous[key], entry[key]]
+        changes: List[Dict[str, Any]] = []
+        _diff_values(name, previous['value'], entry['value'], new.chunk_size, changes)
+        change['changes'] = changes
+        report['changed'].append(change)
+    return report
+
+
+def diff_snapshots(old: Snapshot, new: Snapshot) -> Dict[str, Any]:
+    """比较两个快照
+
+    从根摘要开始逐层比较，摘要相同的分区、类型、变量、字段和数组区间直接跳过，
+    不展开也不逐个元素比较。
+
+    Args:
+        old: 旧版本的快照
+        new: 新版本的快照
+
+    Returns:
+        差异报告：identical；types 的 added/removed/changed/affected/layout；
+        variables 的 added/removed/changed（每项的 changes 列出变化的字段路径，
+        数组为变化的元素范围 ranges，按 chunk_size 对齐）
+
+    Raises:
+        ValueError: 两个快照的 chunk_size 不同
+    """
+    if old.chunk_size != new.chunk_size:
+        raise ValueError(f"Snapshots use different chunk sizes: {old.chunk_size} != {new.chunk_size}")
+    report: Dict[str, Any] = {
+        'identical': old.digest == new.digest,
+        'chunk_size': new.chunk_size,
+        'types': {'added': [], 'removed': [], 'changed': [], 'affected': [], 'layout': []},
+        'variables': {'added': [], 'removed': [], 'changed': []},
+    }
+    if report['identical']:
+        return report
+    if old.types_digest != new.types_digest:
+        report['types'] = _diff_types(old, new)
+    if old.variables_digest != new.variables_digest:
+        report['variables'] = _diff_variables(old, new)
+    return report
+
+
+def _format_ranges(ranges: List[List[int]]) -> str:
+    return ', '.join(f"[{start}:{end}]" for start, end in ranges)
+
+
+def format_diff(report: Dict[str, Any]) -> str:
+    """把差异报告格式化为文本，每行一项：+ 新增、- 删除、~ 变化、! 布局变化"""
+    if report['identical']:
+        return "无差异"
+    lines = []
+    types = report['types']
+    for entry in types['added']:
+        lines.append(f"+ {entry['kind']} {entry['name']}")
+    for entry in types['removed']:
+        lines.append(f"- {entry['kind']} {entry['name']}")
+    for entry in types['changed']:
+        lines.append(f"~ {entry['kind']} {entry['name']}")
+    for entry in types['affected']:
+        lines.append(f"~ {entry['kind']} {entry['name']}（引用的类型变化）")
+    for entry in types['layout']:
+        parts = [f"{key} {entry[key][0]} -> {entry[key][1]}" for key in ('size', 'alignment') if key in entry]
+        parts.extend(f"{name} @{offsets[0]} -> @{offsets[1]}" for name, offsets in entry.get('fields', {}).items())
+        lines.append(f"! {entry['kind']} {entry['name']}: {', '.join(parts)}")
+    variables = report['variables']
+    for name in variables['added']:
+        lines.append(f"+ {name}")
+    for name in variables['removed']:
+        lines.append(f"- {name}")
+    for entry in variables['changed']:
+        if 'type' in entry or 'array_size' in entry:
+            declaration = {key: entry[key] for key in ('type', 'array_size') if key in entry}
+            lines.append(f"~ {entry['name']}: 声明 {declaration}")
+        for change in entry['changes']:
+            if 'ranges' in change:
+                line = f"~ {change['path']}{_format_ranges(change['ranges'])}"
+                if 'length' in change:
+                    line += f"（长度 {change['length'][0]} -> {change['length'][1]}）"
+            else:
+                line = f"~ {change['path']}: {change['old']!r} -> {change['new']!r}"
+            lines.append(line)
+    return '\n'.join(lines)
@@ -1,7 +1,12 @@
-from typing import Dict, Any, Optional, List, Tuple, Union
+import threading
+import time
+from contextlib import contextmanager
+from typing import Dict, Any, Optional, List, Tuple, Union, Iterator
 from pathlib import Path
+import tree_sitter
 from tree_sitter import Language, Parser, Node
 from loguru import logger
+from utils.logger import log_gate
 from config import TreeSitterConfig
 
 logger = logger.bind(name="TreeSitterUtils")
@@ -12,6 +17,19 @@ class TreeSitterUtils:
     _instance = None
     _parser = None
     _language = None
+    # Parser对象不是线程安全的，多线程（例如常驻服务）共用时逐个解析
+    _parse_lock = threading.Lock()
+    # 启动各阶段耗时（毫秒），见 get_startup_timings
+    _startup_timings: Dict[str, float] = {}
+    
+    # 提取用的查询，首次使用时按当前语言编译一次，见 get_query
+    QUERIES = {
+        # 枚举值列表中的枚举项，名称和值通过字段读取
+        'enumerators': '(enumerator_list (enumerator) @enumerator)',
+        # 声明器中的类型名，按源码顺序第一个即为typedef声明的名称（例如函数指针）
+        'type_names': '(type_identifier) @name',
+    }
+    _queries: Dict[str, Any] = {}
     
     @classmethod
     def get_instance(cls, config: Optional[TreeSitterConfig] = None) -> 'TreeSitterUtils':
@@ -19,6 +37,17 @@ class TreeSitterUtils:
         if not cls._instance:
             cls._instance = cls(config)
         return cls._instance
+    
+    @classmethod
+    def reset_parser(cls) -> None:
+        """丢弃当前进程的解析器实例
+        
+        Parser对象不能在线程或进程间共享。子进程调用后，下一次 get_instance()
+        会为本进程创建新的Parser，已加载的语言库继续复用。
+        """
+        cls._instance = None
+        cls._parser = None
+        cls._parse_lock = threading.Lock()
         
     def __init__(self, config: Optional[TreeSitterConfig] = None):
         """初始化工具类
@@ -30,156 +59,278 @@ class TreeSitterUtils:
             return
             
         self.config = config or TreeSitterConfig()
-        TreeSitterUtils._parser = Parser()
+        with self._timed('create_parser'):
+            TreeSitterUtils._parser = Parser()
         self._init_language()
         
+    @classmethod
+    def get_startup_timings(cls) -> Dict[str, float]:
+        """本进程加载语言库各阶段的耗时（毫秒），未经过的阶段不出现
+        
+        阶段包括 create_parser、check_grammar、build_library、load_library/load_wheel、set_language。
+        """
+        return dict(cls._startup_timings)
+
+    @classmethod
+    @contextmanager
+    def _timed(cls, phase: str):
+        """记录一个启动阶段的耗时"""
+        started = time.perf_counter()
+        try:
+            yield
+        finally:
+            cls._startup_timings[phase] = round((time.perf_counter() - started) * 1000, 3)
+
     def _init_language(self):
         """初始化tree-sitter C语言支持"""
         try:
-            # 构建语言库
+            # 语言库在进程内只加载一次
             if not TreeSitterUtils._language:
-                Language.build_library(
-                    # 生成动态库文件
-                    self.config.get_library_path(),
-                    # 语言定义文件路径
-                    [self.config.c_parser_path]
-                )
-                # 加载语言
-                TreeSitterUtils._language = Language(
-                    self.config.get_library_path(),
-                    self.config.language_name
-                )
+                TreeSitterUtils._language = self._load_language()
+                TreeSitterUtils._queries = {}
                 
-            # 设置解析器语言
-            TreeSitterUtils._parser.set_language(TreeSitterUtils._language)
+            # 设置解析器语言（tree-sitter 0.22 起改为 language 属性）
+            with self._timed('set_language'):
+                if hasattr(TreeSitterUtils._parser, 'set_language'):
+                    TreeSitterUtils._parser.set_language(TreeSitterUtils._language)
+                else:
+                    TreeSitterUtils._parser.language = TreeSitterUtils._language
             logger.info("Tree-sitter language initialized successfully")
             
         except Exception as e:
             logger.error(f"Failed to initialize tree-sitter language: {e}")
             raise
 
+    def _load_language(self) -> Language:
+        """加载C语言定义
+        
+        只有语法源码（tree-sitter-c）比编译好的库新、或库不存在时才重新编译；
+        之后优先加载编译好的库，没有库时使用 tree_sitter_c wheel 提供的语言。
+        """
+        library = Path(self.config.get_library_path())
+        with self._timed('check_grammar'):
+            needs_build = self._needs_build(library)
+        build_error = None
+        if needs_build:
+            try:
+                with self._timed('build_library'):
+                    Language.build_library(
+                        # 生成动态库文件
+                        str(library),
+                        # 语言定义文件路径
+                        [self.config.c_parser_path]
+                    )
+            except Exception as e:
+                # 没有编译器时退回到已有的库或wheel
+                build_error = e
+                logger.warning(f"Failed to build tree-sitter grammar: {e}")
+        
+        if library.exists():
+            with self._timed('load_library'):
+                return Language(str(library), self.config.language_name)
+        
+        with self._timed('load_wheel'):
+            language = self._load_wheel_language()
+        if language is None:
+            raise RuntimeError(
+                f"No tree-sitter C grammar available: {library} not found, tree_sitter_c is not installed"
+                + (f" and building failed: {build_error}" if build_error else
+                   f" and no grammar source at {self.config.c_parser_path}"))
+        return language
+
+    def _needs_build(self, library: Path) -> bool:
+        """语法源码存在且比编译好的库新时需要重新编译"""
+        if not hasattr(Language, 'build_library'):
+            return False
+        source_dir = Path(self.config.c_parser_path) / 'src'
+        if not source_dir.is_dir():
+            return False
+        sources = [path for pattern in ('*.c', '*.cc', '*.h') for path in source_dir.glob(pattern)]
+        if not sources:
+            return False
+        if not library.exists():
+            return True
+        library_mtime = library.stat().st_mtime
+        return any(path.stat().st_mtime > library_mtime for path in sources)
+
+    def _load_wheel_language(self) -> Optional[Language]:
+        """加载 tree_sitter_c wheel 提供的语言，未安装时返回None"""
+        try:
+            import tree_sitter_c
+        except ImportError:
+            return None
+        pointer = tree_sitter_c.language()
+        try:
+            # tree-sitter >= 0.22
+            return Language(pointer)
+        except TypeError:
+            return Language(pointer, self.config.language_name)
+
     @staticmethod
-    def parse(source: Union[str, Path]) -> Node:
-        """解析源代码或源文件（自适应）
+    def parse(source: Union[str, bytes, Path]) -> Node:
+        """解析源代码或源文件
+        
+        按参数类型区分，不再根据字符串内容猜测是否为路径：
+        Path 为文件路径，bytes 为UTF-8源码，str 为源代码文本。
         
         Args:
-            source: 源代码字符串或文件路径
+            source: 文件路径（Path）、源码字节或源代码字符串
             
         Returns:
-            Node: AST根节点
+            Tree: 语法树
         """
         try:
-            # 检查是否为文件路径
-            if isinstance(source, (str, Path)):
-                # 尝试判断是否为文件路径
-                if isinstance(source, Path) or (isinstance(source, str) and TreeSitterUtils._looks_like_file_path(source)):
-                    # 作为文件路径处理
-                    if isinstance(source, str):
-                        source = Path(source)
-                    
-                    # 读取文件内容
-                    source_text = source.read_text(encoding='utf8', errors='ignore')
-                    logger.debug(f"Parsing file: {source}")
-                else:
-                    # 作为源代码字符串处理
-                    source_text = source
-                    logger.debug("Parsing source code string")
-            else:
-                raise ValueError(f"Unsupported source type: {type(source)}")
-            
-            # 添加调试信息
-            logger.debug(f"Source text length: {len(source_text)}")
-            logger.debug(f"Source text preview: {source_text[:200]}...")
-            
-            # 将源码转换为bytes
-            source_bytes = bytes(source_text, 'utf8')
-            # 解析生成语法树
-            tree = TreeSitterUtils._parser.parse(source_bytes)
-            return tree
-            
+            if isinstance(source, Path):
+                return TreeSitterUtils.parse_path(source)
+            if isinstance(source, bytes):
+                return TreeSitterUtils.parse_bytes(source)
+            if isinstance(source, str):
+                return TreeSitterUtils.parse_text(source)
+            raise ValueError(f"Unsupported source type: {type(source)}")
         except Exception as e:
             logger.exception(f"Failed to parse source: {e}")
             raise
     
     @staticmethod
-    def parse_source_code(source_text: str) -> Node:
-        """直接解析源代码字符串
+    def read_source(path: Union[str, Path]) -> bytes:
+        """读取源文件的原始字节，不做解码
+        
+        返回的bytes同时交给tree-sitter和节点文本切片使用，整个解析过程只有这一份源码。
+        
+        Args:
+            path: 文件路径
+            
+        Returns:
+            bytes: 文件内容
+        """
+        with open(path, 'rb') as f:
+            return f.read()
+    
+    @staticmethod
+    def parse_path(path: Union[str, Path]) -> Node:
+        """解析源文件
+        
+        Args:
+            path: 文件路径
+            
+        Returns:
+            Tree: 语法树
+        """
+        if log_gate.debug:
+            logger.debug(f"Parsing file: {path}")
+        return TreeSitterUtils.parse_bytes(TreeSitterUtils.read_source(path))
+    
+    @staticmethod
+    def parse_text(source_text: str) -> Node:
+        """解析源代码字符串
         
         Args:
             source_text: 源代码字符串
             
         Returns:
-            Node: AST根节点
+            Tree: 语法树
         """
-        try:
-            # 添加调试信息
+        if log_gate.debug:
             logger.debug(f"Source text length: {len(source_text)}")
             logger.debug(f"Source text preview: {source_text[:200]}...")
-            
-            # 将源码转换为bytes
-            source_bytes = bytes(source_text, 'utf8')
-            # 解析生成语法树
-            tree = TreeSitterUtils._parser.parse(source_bytes)
-            return tree
-            
-        except Exception as e:
-            logger.exception(f"Failed to parse source code: {e}")
-            raise
+        return TreeSitterUtils.parse_bytes(source_text.encode('utf8'))
+    
+    # 兼容旧的调用方式
+    parse_source_code = parse_text
 
     @staticmethod
-    def _looks_like_file_path(source: str) -> bool:
-        """判断字符串是否看起来像文件路径
-        
+    def parse_bytes(source_bytes: bytes, old_tree=None):
+        """解析UTF-8源码字节
+
         Args:
-            source: 待检查的字符串
-            
+            source_bytes: 源码字节
+            old_tree: 已通过 edit_tree 同步过修改的旧语法树，tree-sitter 会复用其中未改变的部分
+
         Returns:
-            bool: 如果看起来像文件路径返回True，否则返回False
+            Tree: 语法树
         """
-        # 快速检查：如果包含C语言关键字或语法，肯定不是文件路径
-        c_keywords = ['int', 'char', 'float', 'double', 'struct', 'union', 'enum', 'typedef', 
-                     'if', 'else', 'for', 'while', 'return', '#include', '{', '}', ';']
-        if any(keyword in source for keyword in c_keywords):
-            return False
-        
-        # 如果字符串很长（超过256字符），很可能不是文件路径
-        if len(source) > 256:
-            return False
-        
-        # 如果包含换行符，肯定不是文件路径
-        if '\n' in source or '\r' in source:
-            return False
-        
-        # 检查是否包含常见的C/C++文件扩展名
-        if '.' in source and source.count('.') <= 3:  # 避免误判浮点数
-            extensions = ['.c', '.h', '.cpp', '.hpp', '.cc', '.cxx']
-            if any(source.lower().endswith(ext) for ext in extensions):
-                return True
-        
-        # 检查是否包含路径分隔符（但不包含其他非路径字符）
-        if ('/' in source or '\\' in source) and not any(c in source for c in ['=', '(', ')', '{', '}', ';']):
-            return True
-        
-        # 检查是否存在作为文件（只对短字符串进行文件系统检查）
-        if len(source) < 100:
-            try:
-                path = Path(source)
-                return path.exists() and path.is_file()
-            except:
-                return False
-        
-        return False
+        with TreeSitterUtils._parse_lock:
+            if old_tree is None:
+                return TreeSitterUtils._parser.parse(source_bytes)
+            return TreeSitterUtils._parser.parse(source_bytes, old_tree)
+
+    @staticmethod
+    def compute_edit(old_bytes: bytes, new_bytes: bytes) -> Optional[Dict[str, Any]]:
+        """计算把旧源码变为新源码的单个编辑区间（去掉公共前缀和后缀）
+
+        Args:
+            old_bytes: 旧源码
+            new_bytes: 新源码
+
+        Returns:
+            Tree.edit 的参数字典，内容相同时返回None
+        """
+        if old_bytes == new_bytes:
+            return None
+        limit = min(len(old_bytes), len(new_bytes))
+        # 二分查找公共前缀/后缀长度，比较在C层完成
+        low, high = 0, limit
+        while low < high:
+            middle = (low + high + 1) // 2
+            if old_bytes[:middle] == new_bytes[:middle]:
+                low = middle
+            else:
+                high = middle - 1
+        prefix = low
+        low, high = 0, limit - prefix
+        while low < high:
+            middle = (low + high + 1) // 2
+            if old_bytes[len(old_bytes) - middle:] == new_bytes[len(new_bytes) - middle:]:
+                low = middle
+            else:
+                high = middle - 1
+        suffix = low
+
+        old_end = len(old_bytes) - suffix
+        new_end = len(new_bytes) - suffix
+        return {
+            'start_byte': prefix,
+            'old_end_byte': old_end,
+            'new_end_byte': new_end,
+            'start_point': TreeSitterUtils._point_at(old_bytes, prefix),
+            'old_end_point': TreeSitterUtils._point_at(old_bytes, old_end),
+            'new_end_point': TreeSitterUtils._point_at(new_bytes, new_end),
+        }
+
+    @staticmethod
+    def edit_tree(tree, old_bytes: bytes, new_bytes: bytes) -> Optional[Dict[str, Any]]:
+        """把源码的修改同步到旧语法树，之后可将其传给 parse_bytes 增量解析
+
+        Returns:
+            编辑区间（compute_edit 的结果），内容相同时返回None
+        """
+        edit = TreeSitterUtils.compute_edit(old_bytes, new_bytes)
+        if edit is not None:
+            tree.edit(**edit)
+        return edit
+
     @staticmethod
-    def get_node_text(node: Node) -> str:
+    def _point_at(source_bytes: bytes, offset: int) -> Tuple[int, int]:
+        """字节偏移对应的 (行, 列)，列按字节计数"""
+        row = source_bytes.count(b'\n', 0, offset)
+        return row, offset - (source_bytes.rfind(b'\n', 0, offset) + 1)
+
+    @staticmethod
+    def get_node_text(node: Node, source: Optional[memoryview] = None) -> str:
         """获取节点文本
         
+        传入源码的memoryview时按字节范围直接从中解码，不经过 node.text 生成的中间bytes。
+        
         Args:
             node: AST节点
+            source: 生成该语法树的源码（memoryview），可选
             
         Returns:
             str: 节点文本
         """
         try:
+            if source is not None:
+                return str(source[node.start_byte:node.end_byte], 'utf8')
             return node.text.decode('utf8')
         except:
             return ""
@@ -198,4 +349,71 @@ class TreeSitterUtils:
         try:
             return node.child_by_field_name(field)
         except:
-            return None 
\ No newline at end of file
+            return None 
+
+    @classmethod
+    def get_query(cls, name: str) -> Any:
+        """获取预编译的查询，同一语言只编译一次
+        
+        Args:
+            name: QUERIES 中的查询名称
+            
+        Returns:
+            tree_sitter.Query
+        """
+        query = cls._queries.get(name)
+        if query is None:
+            cls.get_instance()
+            source = cls.QUERIES[name]
+            try:
+                # tree-sitter >= 0.23
+                query = tree_sitter.Query(cls._language, source)
+            except (TypeError, AttributeError):
+                query = cls._language.query(source)
+            cls._queries[name] = query
+        return query
+
+    @classmethod
+    def captures(cls, name: str, node: Node) -> List[Tuple[Node, str]]:
+        """在节点子树中执行查询，遍历由tree-sitter完成
+        
+        Args:
+            name: QUERIES 中的查询名称
+            node: 查询范围的根节点
+            
+        Returns:
+            (节点, 捕获名) 列表，按源码顺序
+        """
+        query = cls.get_query(name)
+        if hasattr(query, 'captures'):
+            result = query.captures(node)
+        else:
+            # tree-sitter >= 0.25 通过 QueryCursor 执行
+            result = tree_sitter.QueryCursor(query).captures(node)
+        if isinstance(result, dict):
+            # tree-sitter >= 0.23 按捕获名分组返回
+            result = [(captured, capture) for capture, nodes in result.items() for captured in nodes]
+        return sorted(result, key=lambda item: item[0].start_byte)
+
+    @classmethod
+    def first_capture(cls, name: str, node: Node) -> Optional[Node]:
+        """查询结果中按源码顺序的第一个节点，没有结果时返回None"""
+        result = cls.captures(name, node)
+        return result[0][0] if result else None
+
+    @staticmethod
+    def iter_children(node: Node) -> Iterator[Node]:
+        """用TreeCursor逐个访问子节点，不生成子节点列表
+        
+        Args:
+            node: AST节点
+            
+        Yields:
+            子节点，按源码顺序
+        """
+        cursor = node.walk()
+        if not cursor.goto_first_child():
+            return
+        yield cursor.node
+        while cursor.goto_next_sibling():
+            yield cursor.node
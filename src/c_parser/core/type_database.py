@@ -0,0 +1,311 @@
+import json
+import marshal
+import mmap
+import struct
+import zlib
+from pathlib import Path
+from typing import Dict, Any, Optional, List, Set, Tuple, Union
+from loguru import logger
+from utils.metrics import timed_phase
+from .type_index import TypeIndex
+
+logger = logger.bind(name="TypeDatabase")
+
+__all__ = ['TypeDatabase', 'write_type_database']
+
+# 文件格式：魔数、版本、头部长度，头部为JSON（计数、各段位置），各段按8字节对齐：
+#   strings  所有键和条目内容的字节
+#   types    每个类型一条 (内容偏移, 内容长度)，内容为marshal序列化的类型字典
+#   macros   每个宏一条 (内容偏移, 内容长度)，内容为marshal序列化的 (名称, 值)
+#   keys     每个索引键一条 (键偏移, 键长度, 记录列表起点, 记录数量)
+#   slots    开放寻址的哈希表，值为 keys 的下标+1，0表示空
+#   postings 记录下标列表
+_MAGIC = b'STDB'
+_VERSION = 1
+_PREFIX = struct.Struct('<4sBxxxI')
+_ALIGNMENT = 8
+_RECORD = struct.Struct('<II')
+_KEY = struct.Struct('<IIII')
+_SLOT = struct.Struct('<I')
+
+# 索引键的前缀，与 TypeIndex 的各个查询对应
+_BY_KEY = b'K'
+_BY_NAME = b'N'
+_BY_KIND = b'T'
+_BY_ATTRIBUTE = b'A'
+_BY_SIZE = b'S'
+_BY_FIELD = b'F'
+_MACRO = b'M'
+
+
+def _key(tag: bytes, *parts: Any) -> bytes:
+    return b'\0'.join([tag] + [str(part).encode('utf-8', 'surrogatepass') for part in parts])
+
+
+def _hash(key: bytes) -> int:
+    return zlib.crc32(key)
+
+
+def write_type_database(type_info: Dict[str, Any], path: Union[str, Path]) -> Dict[str, int]:
+    """把 TypeManager.export_types() 格式的类型信息写成二进制类型库
+
+    Args:
+        type_info: 类型信息（types、pointer_types、macro_definitions）
+        path: 输出文件路径
+
+    Returns:
+        写入的类型、宏和索引键数量
+    """
+    with timed_phase('export'):
+        return _write_type_database(type_info, Path(path))
+
+
+def _write_type_database(type_info: Dict[str, Any], path: Path) -> Dict[str, int]:
+    strings = bytearray()
+
+    def add_string(data: bytes) -> Tuple[int, int]:
+        offset = len(strings)
+        strings.extend(data)
+        return offset, len(data)
+
+    postings: Dict[bytes, List[int]] = {}
+    types = bytearray()
+    aliases = []
+    for position, entry in enumerate(type_info.get('types', [])):
+        types += _RECORD.pack(*add_string(marshal.dumps(entry)))
+        if not isinstance(entry, dict):
+            continue
+        name = entry.get('name')
+        kind = entry.get('kind')
+        if isinstance(name, str):
+            postings.setdefault(_key(_BY_NAME, name), []).append(position)
+            if isinstance(kind, str):
+                # 同键只保留最先出现的条目，与 TypeIndex.get 一致
+                postings.setdefault(_key(_BY_KEY, kind, name), [position])
+                if kind == 'typedef' and isinstance(entry.get('type'), str):
+                    aliases.append([name, entry['type']])
+        if isinstance(kind, str):
+            postings.setdefault(_key(_BY_KIND, kind), []).append(position)
+        for attribute_name in TypeIndex._attribute_names(entry):
+            postings.setdefault(_key(_BY_ATTRIBUTE, attribute_name), []).append(position)
+        if isinstance(entry.get('size'), int):
+            postings.setdefault(_key(_BY_SIZE, entry['size']), []).append(position)
+        for field_name in TypeIndex._field_names(entry):
+            postings.setdefault(_key(_BY_FIELD, field_name), []).append(position)
+    type_count = len(types) // _RECORD.size
+
+    macros = bytearray()
+    for position, (name, value) in enumerate(type_info.get('macro_definitions', {}).items()):
+        macros += _RECORD.pack(*add_string(marshal.dumps((name, value))))
+        postings[_key(_MACRO, name)] = [position]
+    macro_count = len(macros) // _RECORD.size
+
+    # 装载因子不超过1/2，查找平均只探测一到两次
+    slot_count = 1
+    while slot_count < 2 * len(postings):
+        slot_count <<= 1
+    slots = [0] * slot_count
+    keys = bytearray()
+    records = []
+    for number, (key, positions) in enumerate(postings.items()):
+        keys += _KEY.pack(*add_string(key), len(records), len(positions))
+        records.extend(positions)
+        slot = _hash(key) & (slot_count - 1)
+        while slots[slot]:
+            slot = (slot + 1) & (slot_count - 1)
+        slots[slot] = number + 1
+
+    sections = [
+        ('strings', bytes(strings)),
+        ('types', bytes(types)),
+        ('macros', bytes(macros)),
+        ('keys', bytes(keys)),
+        ('slots', struct.pack(f'<{slot_count}I', *slots)),
+        ('postings', struct.pack(f'<{len(records)}I', *records)),
+    ]
+    layout = {}
+    offset = 0
+    for name, data in sections:
+        layout[name] = [offset, len(data)]
+        offset += len(data) + (-len(data) % _ALIGNMENT)
+
+    header = json.dumps({
+        'types': type_count,
+        'macros': macro_count,
+        'slots': slot_count,
+        'marshal_version': marshal.version,
+        'pointer_types': sorted(type_info.get('pointer_types', [])),
+        'aliases': aliases,
+        'sections': layout,
+    }, ensure_ascii=False).encode('utf-8')
+    header += b' ' * (-(len(header) + _PREFIX.size) % _ALIGNMENT)
+    with open(path, 'wb') as f:
+        f.write(_PREFIX.pack(_MAGIC, _VERSION, len(header)))
+        f.write(header)
+        for _, data in sections:
+            f.write(data)
+            f.write(b'\0' * (-len(data) % _ALIGNMENT))
+    logger.info(f"Wrote type database {path}: {type_count} types, {macro_count} macros, {len(postings)} keys")
+    return {'types': type_count, 'macros': macro_count, 'keys': len(postings)}
+
+
+class TypeDatabase:
+    """以mmap方式打开的二进制类型库，按需查询，不加载全部条目
+
+    由 write_type_database 从 export_types() 的结果生成。打开时只读取头部，
+    查询通过文件中的哈希索引定位记录，只反序列化命中的条目；
+    同一条目多次查询返回同一个字典（调用方不应修改）。
+
+    查询接口与 TypeIndex 相同，TypeManager 把它作为全局类型层的第一个索引，
+    见 TypeManager 的 type_database 参数。
+
+    用法示例：
+    ```python
+    write_type_database(type_manager.export_types(), 'sdk.stdb')
+    with TypeDatabase('sdk.stdb') as database:
+        manager = TypeManager(type_database=database)
+        manager.get_struct_info('struct Cal')
+    ```
+    """
+
+    def __init__(self, path: Union[str, Path]):
+        """打开类型库
+
+        Args:
+            path: write_type_database 写出的文件
+        """
+        self.path = Path(path)
+        with open(self.path, 'rb') as f:
+            self._mmap = mmap.mmap(f.fileno(), 0, access=mmap.ACCESS_READ)
+        try:
+            self._view = memoryview(self._mmap)
+            magic, version, header_size = _PREFIX.unpack_from(self._view)
+            if magic != _MAGIC or version != _VERSION:
+                raise ValueError(f"Not a type database: {path}")
+            header = json.loads(bytes(self._view[_PREFIX.size:_PREFIX.size + header_size]))
+            if header['marshal_version'] > marshal.version:
+                raise ValueError(f"Type database {path} was written by a newer Python, rebuild it")
+        except Exception:
+            self.close()
+            raise
+
+        base = _PREFIX.size + header_size
+        self._sections = {name: base + offset for name, (offset, _) in header['sections'].items()}
+        self._type_count = header['types']
+        self._macro_count = header['macros']
+        self._slot_mask = header['slots'] - 1
+        self.pointer_types: Set[str] = set(header['pointer_types'])
+        self.aliases: Dict[str, str] = dict(header['aliases'])
+        # 已反序列化的条目，保证同一条目返回同一个对象
+        self._entries: Dict[int, Any] = {}
+
+    @staticmethod
+    def is_database(path: Union[str, Path]) -> bool:
+        """检查文件是否为类型库（按魔数判断）"""
+        try:
+            with open(path, 'rb') as f:
+                return f.read(len(_MAGIC)) == _MAGIC
+        except OSError:
+            return False
+
+    def close(self) -> None:
+        """关闭文件映射，之后不能再查询"""
+        view = getattr(self, '_view', None)
+        if view is not None:
+            view.release()
+            self._view = None
+        if self._mmap is not None:
+            self._mmap.close()
+            self._mmap = None
+
+    def __enter__(self) -> 'TypeDatabase':
+        return self
+
+    def __exit__(self, *exc_info) -> None:
+        self.close()
+
+    def __len__(self) -> int:
+        return self._type_count
+
+    @property
+    def index(self) -> 'TypeDatabase':
+        """查询接口与 TypeIndex 相同，作为 TypeManager 的底层时直接使用本对象"""
+        return self
+
+    @property
+    def macro_count(self) -> int:
+        """宏定义数量"""
+        return self._macro_count
+
+    def _record(self, section: str, index: int) -> memoryview:
+        offset, size = _RECORD.unpack_from(self._view, self._sections[section] + index * _RECORD.size)
+        start = self._sections['strings'] + offset
+        return self._view[start:start + size]
+
+    def _positions(self, key: bytes) -> List[int]:
+        """查询索引键对应的记录下标"""
+        slot = _hash(key) & self._slot_mask
+        strings = self._sections['strings']
+        while True:
+            number, = _SLOT.unpack_from(self._view, self._sections['slots'] + slot * _SLOT.size)
+            if not number:
+                return []
+            offset, size, first, count = _KEY.unpack_from(self._view, self._sections['keys'] + (number - 1) * _KEY.size)
+            if self._view[strings + offset:strings + offset + size] == key:
+                start = self._sections['postings'] + first * _SLOT.size
+                return list(struct.unpack_from(f'<{count}I', self._view, start))
+            slot = (slot + 1) & self._slot_mask
+
+    def entry(self, index: int) -> Any:
+        """按下标获取类型条目"""
+        entry = self._entries.get(index)
+        if entry is None:
+            entry = self._entries[index] = marshal.loads(self._record('types', index))
+        return entry
+
+    def _entries_for(self, key: bytes) -> List[Dict[str, Any]]:
+        return [self.entry(index) for index in self._positions(key)]
+
+    def get(self, kind: str, name: str) -> Optional[Dict[str, Any]]:
+        """按 (kind, name) 查找条目"""
+        positions = self._positions(_key(_BY_KEY, kind, name))
+        return self.entry(positions[0]) if positions else None
+
+    def by_name(self, name: str) -> List[Dict[str, Any]]:
+        """按名称查找所有条目"""
+        return self._entries_for(_key(_BY_NAME, name))
+
+    def by_kind(self, kind: str) -> List[Dict[str, Any]]:
+        """按种类查找所有条目"""
+        return self._entries_for(_key(_BY_KIND, kind))
+
+    def by_attribute(self, attribute_name: str) -> List[Dict[str, Any]]:
+        """查找attributes中包含指定属性的所有条目"""
+        return self._entries_for(_key(_BY_ATTRIBUTE, attribute_name))
+
+    def by_size(self, size: int) -> List[Dict[str, Any]]:
+        """按大小查找所有条目"""
+        return self._entries_for(_key(_BY_SIZE, size))
+
+    def by_field(self, field_name: str) -> List[Dict[str, Any]]:
+        """查找包含指定字段名的所有条目"""
+        return self._entries_for(_key(_BY_FIELD, field_name))
+
+    def has_macro(self, name: str) -> bool:
+        """检查宏是否存在"""
+        return bool(self._positions(_key(_MACRO, name)))
+
+    def macro(self, name: str) -> Any:
+        """获取宏的值，未定义时返回None"""
+        positions = self._positions(_key(_MACRO, name))
+        if not positions:
+            return None
+        return marshal.loads(self._record('macros', positions[0]))[1]
+
+    def types(self) -> List[Any]:
+        """按原始顺序获取所有类型条目（反序列化全部条目）"""
+        return [self.entry(index) for index in range(self._type_count)]
+
+    def macros(self) -> Dict[str, Any]:
+        """获取所有宏定义（反序列化全部宏）"""
+        return dict(marshal.loads(self._record('macros', index)) for index in range(self._macro_count))
@@ -0,0 +1,184 @@
+from typing import Dict, Any, Optional, List, Tuple, Iterable
+
+
+class TypeIndex:
+    """类型列表的哈希索引
+
+    类型列表仍然是唯一的数据源，索引只保存条目的引用：
+    - (kind, name) -> 条目（同键保留最先注册的条目，与线性扫描的结果一致）
+    - name -> 条目列表
+    - kind / 属性名 / 大小 / 字段名 -> 条目列表
+
+    用法示例：
+    ```python
+    index = TypeIndex(type_list)
+    index.get('struct', 'struct Point')
+    index.by_field('next')
+    ```
+    """
+
+    def __init__(self, entries: Optional[List[Dict[str, Any]]] = None):
+        """初始化索引
+
+        Args:
+            entries: 要建立索引的类型列表，可选
+        """
+        self._source = None
+        self.clear()
+        if entries is not None:
+            self.rebuild(entries)
+
+    def clear(self) -> None:
+        """清空索引"""
+        self._by_key: Dict[Tuple[str, str], Dict[str, Any]] = {}
+        self._by_name: Dict[str, List[Dict[str, Any]]] = {}
+        self._by_kind: Dict[str, List[Dict[str, Any]]] = {}
+        self._by_attribute: Dict[str, List[Dict[str, Any]]] = {}
+        self._by_size: Dict[int, List[Dict[str, Any]]] = {}
+        self._by_field: Dict[str, List[Dict[str, Any]]] = {}
+        self._count = 0
+
+    def __len__(self) -> int:
+        return self._count
+
+    def rebuild(self, entries: List[Dict[str, Any]]) -> None:
+        """根据类型列表重建索引
+
+        Args:
+            entries: 类型列表，索引会记住该列表用于过期检查
+        """
+        self.clear()
+        self._source = entries
+        for entry in entries:
+            self.add(entry)
+
+    def is_stale(self, entries: List[Dict[str, Any]]) -> bool:
+        """检查索引是否落后于给定的类型列表
+
+        直接修改列表（例如替换列表对象或绕过TypeManager追加条目）
+        会导致列表与索引不一致，此时需要重建。
+        """
+        return self._source is not entries or self._count != len(entries)
+
+    def add(self, entry: Dict[str, Any]) -> None:
+        """添加条目到索引"""
+        if not isinstance(entry, dict):
+            self._count += 1
+            return
+
+        name = entry.get('name')
+        kind = entry.get('kind')
+
+        if isinstance(name, str):
+            self._by_name.setdefault(name, []).append(entry)
+            if isinstance(kind, str):
+                self._by_key.setdefault((kind, name), entry)
+        if isinstance(kind, str):
+            self._by_kind.setdefault(kind, []).append(entry)
+
+        for attribute_name in self._attribute_names(entry):
+            self._by_attribute.setdefault(attribute_name, []).append(entry)
+
+        size = entry.get('size')
+        if isinstance(size, int):
+            self._by_size.setdefault(size, []).append(entry)
+
+        for field_name in self._field_names(entry):
+            self._by_field.setdefault(field_name, []).append(entry)
+
+        self._count += 1
+
+    def discard(self, entry: Dict[str, Any]) -> None:
+        """从索引中移除条目（按对象身份匹配）"""
+        if not isinstance(entry, dict):
+            self._count -= 1
+            return
+
+        name = entry.get('name')
+        kind = entry.get('kind')
+
+        if isinstance(name, str):
+            self._remove_from(self._by_name, name, entry)
+            if isinstance(kind, str) and self._by_key.get((kind, name)) is entry:
+                # 同键的下一个条目接替
+                replacement = next(
+                    (e for e in self._by_name.get(name, []) if e.get('kind') == kind),
+                    None
+                )
+                if replacement is not None:
+                    self._by_key[(kind, name)] = replacement
+                else:
+                    del self._by_key[(kind, name)]
+        if isinstance(kind, str):
+            self._remove_from(self._by_kind, kind, entry)
+
+        for attribute_name in self._attribute_names(entry):
+            self._remove_from(self._by_attribute, attribute_name, entry)
+
+        size = entry.get('size')
+        if isinstance(size, int):
+            self._remove_from(self._by_size, size, entry)
+
+        for field_name in self._field_names(entry):
+            self._remove_from(self._by_field, field_name, entry)
+
+        self._count -= 1
+
+    def get(self, kind: str, name: str) -> Optional[Dict[str, Any]]:
+        """按 (kind, name) 查找条目"""
+        return self._by_key.get((kind, name))
+
+    def by_name(self, name: str) -> List[Dict[str, Any]]:
+        """按名称查找所有条目"""
+        return self._by_name.get(name, [])
+
+    def by_kind(self, kind: str) -> List[Dict[str, Any]]:
+        """按种类查找所有条目"""
+        return self._by_kind.get(kind, [])
+
+    def by_attribute(self, attribute_name: str) -> List[Dict[str, Any]]:
+        """查找attributes中包含指定属性的所有条目"""
+        return self._by_attribute.get(attribute_name, [])
+
+    def by_size(self, size: int) -> List[Dict[str, Any]]:
+        """按大小查找所有条目"""
+        return self._by_size.get(size, [])
+
+    def by_field(self, field_name: str) -> List[Dict[str, Any]]:
+        """查找包含指定字段名的所有条目"""
+        return self._by_field.get(field_name, [])
+
+    @staticmethod
+    def _remove_from(table: Dict[Any, List[Dict[str, Any]]], key: Any, entry: Dict[str, Any]) -> None:
+        """从索引表中移除条目"""
+        bucket = table.get(key)
+        if not bucket:
+            return
+        for i, candidate in enumerate(bucket):
+            if candidate is entry:
+                del bucket[i]
+                break
+        if not bucket:
+            del table[key]
+
+    @staticmethod
+    def _attribute_names(entry: Dict[str, Any]) -> Iterable[str]:
+        """获取条目的属性名列表"""
+        attributes = entry.get('attributes')
+        if isinstance(attributes, dict):
+            return list(attributes.keys())
+        return []
+
+    @staticmethod
+    def _field_names(entry: Dict[str, Any]) -> Iterable[str]:
+        """获取条目的字段名集合（去重）"""
+        fields = entry.get('fields')
+        if not isinstance(fields, list):
+            return []
+        names = []
+        for field in fields:
+            if isinstance(field, dict):
+                field_name = field.get('name')
+                if isinstance(field_name, str) and field_name not in names:
+                    names.append(field_name)
+        return names
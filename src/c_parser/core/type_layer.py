@@ -0,0 +1,54 @@
+from typing import Dict, Any, Optional, List, Iterable
+from .type_index import TypeIndex
+
+__all__ = ['TypeLayer']
+
+
+class TypeLayer:
+    """冻结的类型层：类型列表及其索引、指针类型和宏定义
+
+    由 TypeManager.freeze() 把全局层和当前文件层原样移入，不复制列表和字典，
+    之后不再修改，多个 TypeManager（包括不同线程中的）可以共享同一层。
+    查询接口与 TypeDatabase 相同，两者都可以作为 TypeManager 的底层。
+    """
+
+    __slots__ = ('_types', 'index', 'pointer_types', '_macros')
+
+    def __init__(self, types: List[Dict[str, Any]], pointer_types: Iterable[str] = (),
+                 macros: Optional[Dict[str, Any]] = None, index: Optional[TypeIndex] = None):
+        """初始化
+
+        Args:
+            types: 类型列表，移交给本层后调用方不应再修改
+            pointer_types: 指针类型名
+            macros: 宏定义，同样移交给本层
+            index: 已与 types 同步的索引，可选，默认新建
+        """
+        self._types = types
+        self.index = index if index is not None and not index.is_stale(types) else TypeIndex(types)
+        self.pointer_types = frozenset(pointer_types)
+        self._macros = macros if macros is not None else {}
+
+    def __len__(self) -> int:
+        return len(self._types)
+
+    @property
+    def macro_count(self) -> int:
+        """宏定义数量"""
+        return len(self._macros)
+
+    def has_macro(self, name: str) -> bool:
+        """检查宏是否存在"""
+        return name in self._macros
+
+    def macro(self, name: str) -> Any:
+        """获取宏的值，未定义时返回None"""
+        return self._macros.get(name)
+
+    def types(self) -> List[Dict[str, Any]]:
+        """本层的全部类型（按注册顺序）"""
+        return list(self._types)
+
+    def macros(self) -> Dict[str, Any]:
+        """本层的全部宏定义"""
+        return dict(self._macros)
@@ -1,6 +1,15 @@
-from typing import Dict, Any, Optional, List, Set, Tuple, Union
+from typing import Dict, Any, Optional, List, Set, Tuple, Union, Callable, Iterable, FrozenSet
 import json
+import threading
 from loguru import logger
+from utils.logger import log_gate
+from .type_index import TypeIndex
+from .type_database import TypeDatabase
+from .type_layer import TypeLayer
+from .resolution_cache import ResolutionCache
+from .layout_engine import LayoutEngine, TypeLayout, DEFAULT_ABI, get_abi_profile
+from .expression_engine import SymbolTable, DOUBLE
+from .expression_parser import ExpressionParser
 
 
 class TypeManager:
@@ -79,8 +88,15 @@ class TypeManager:
         'size_t': '%zu',
     }
     
-    def __init__(self, type_info: Optional[Dict[str, Any]] = None):
-        """初始化类型管理器"""
+    def __init__(self, type_info: Optional[Dict[str, Any]] = None, abi: str = DEFAULT_ABI,
+                 type_database: Optional[TypeDatabase] = None):
+        """初始化类型管理器
+
+        Args:
+            type_info: 初始的全局类型信息，可选
+            abi: 默认目标ABI（ILP32、LP64、LLP64、ARM_EABI），决定类型大小、对齐和结构体布局
+            type_database: 以mmap方式打开的二进制类型库，作为全局类型层的底层按需查询，可选
+        """
         # 统一类型存储
         self._global_types = []  # 全局类型列表
         self._global_pointer_types = set()
@@ -90,11 +106,32 @@ class TypeManager:
         self._current_pointer_types = set()
         self._current_macro_definitions = {}
         
-        # 性能优化缓存
-        self._kind_cache = {}
-        self._find_cache = {}
+        # 类型索引，查询时按需与类型列表同步
+        self._global_index = TypeIndex(self._global_types)
+        self._current_index = TypeIndex(self._current_types)
+        # 冻结的底层（TypeLayer 或 TypeDatabase），从下到上排列，导出时排在全局类型列表之前，按名称查找时排在之后。
+        # 列表本身也在多个对象之间共享，只整体替换，不原地修改，见 freeze
+        self._layers: List[Any] = [type_database] if type_database is not None else []
+        self._freeze_lock = threading.Lock()
+        
+        # 类型解析结果缓存（类型种类、类型定义、typedef链），按依赖的类型名失效
+        self._resolution_cache = ResolutionCache()
+        self._alias_count = len(self.TYPE_ALIASES)
+        
+        # 各目标ABI的布局引擎，按需创建，随解析缓存一起失效
+        self.abi = get_abi_profile(abi).name
+        self._layout_engines: Dict[str, LayoutEngine] = {}
+        
+        # 常量表达式求值使用的符号表，直接读取宏定义和枚举，不复制
+        self._symbols = SymbolTable(self._lookup_macro, self.get_enum_values, self._lookup_symbol_type)
+        
+        # 增量解析时记录单个声明引起的变化，见 begin_changes
+        self._change_journal: Optional[Dict[str, Any]] = None
         
         # 初始化全局类型信息
+        if type_database is not None:
+            self.TYPE_ALIASES.update(type_database.aliases)
+            self._alias_count = len(self.TYPE_ALIASES)
         if type_info:
             self._load_type_info(type_info)
         
@@ -112,28 +149,88 @@ class TypeManager:
     @property
     def struct_types(self):
         """获取所有结构体类型"""
-        return [t for t in self._global_types + self._current_types if t.get('kind') == 'struct']
+        return self._find_in_index('struct')
 
     @property
     def union_types(self):
         """获取所有联合体类型"""
-        return [t for t in self._global_types + self._current_types if t.get('kind') == 'union']
+        return self._find_in_index('union')
 
     @property
     def enum_types(self):
         """获取所有枚举类型"""
-        return [t for t in self._global_types + self._current_types if t.get('kind') == 'enum']
+        return self._find_in_index('enum')
 
     @property
     def typedef_types(self):
         """获取所有类型别名"""
-        return [t for t in self._global_types + self._current_types if t.get('kind') == 'typedef']
+        return self._find_in_index('typedef')
+
+    def _get_indexes(self, scope: str = 'all') -> List[TypeIndex]:
+        """获取指定范围的类型索引，索引过期时自动重建
+        
+        Args:
+            scope: 查询范围，'all'/'global'/'current'
+            
+        Returns:
+            与类型列表拼接顺序一致的索引列表（冻结层和全局在前），按名称查找使用 _lookup_indexes()
+        """
+        if self._global_index.is_stale(self._global_types):
+            self._global_index.rebuild(self._global_types)
+        if self._current_index.is_stale(self._current_types):
+            self._current_index.rebuild(self._current_types)
+        
+        if scope == 'current':
+            return [self._current_index]
+        indexes = [layer.index for layer in self._layers] + [self._global_index]
+        if scope == 'global':
+            return indexes
+        return indexes + [self._current_index]
+
+    def _lookup_indexes(self, scope: str = 'all') -> List[TypeIndex]:
+        """按名称查找时使用的索引顺序：当前文件、全局，然后由上到下的各冻结层
+
+        与宏定义的覆盖规则一致，fork出的对象重新定义的类型覆盖冻结层中的同名类型。
+        """
+        self._get_indexes('current')
+        indexes = []
+        if scope in ('all', 'current'):
+            indexes.append(self._current_index)
+        if scope in ('all', 'global'):
+            indexes.append(self._global_index)
+            indexes.extend(layer.index for layer in reversed(self._layers))
+        return indexes
+
+    def _find_in_index(self, kind: str, scope: str = 'all') -> List[Dict[str, Any]]:
+        """通过索引获取指定种类的所有类型"""
+        result = []
+        for index in self._get_indexes(scope):
+            result.extend(index.by_kind(kind))
+        return result
+
+    def _lookup_type(self, kind: str, names: List[str], scope: str = 'all') -> Optional[Dict[str, Any]]:
+        """通过索引按 (kind, name) 查找类型，依次尝试候选名称"""
+        for index in self._lookup_indexes(scope):
+            for name in names:
+                entry = index.get(kind, name)
+                if entry is not None:
+                    return entry
+        return None
+
+    def _search_names(self, type_name: str, prefix: str) -> List[str]:
+        """生成查找时使用的候选名称（原始名称、清理后的名称、带前缀的名称）"""
+        clean_name = self._clean_type_name(type_name)
+        return list(dict.fromkeys([type_name, clean_name, f"{prefix} {clean_name}"]))
 
     def _load_type_info(self, type_info: Dict[str, Any]) -> None:
         """加载类型信息"""
         try:
-            logger.info(f"Loading type info: {type_info}")
-            self._global_types.extend(type_info.get('types', []))
+            types = type_info.get('types', [])
+            logger.info(f"Loading type info: {len(types)} types, "
+                        f"{len(type_info.get('macro_definitions', {}))} macros")
+            self._global_types.extend(types)
+            for entry in types:
+                self._global_index.add(entry)
             # 处理指针类型和宏定义
             self._global_pointer_types.update(type_info.get('pointer_types', set()))
             self._global_macro_definitions.update(type_info.get('macro_definitions', {}))
@@ -144,11 +241,52 @@ class TypeManager:
         
         # 清理缓存，因为类型信息已更新
         self._clear_cache()
+        self._symbols.invalidate()
+
+    def cache_stats(self) -> Dict[str, Tuple[int, int]]:
+        """获取类型缓存的累计命中情况
+        
+        Returns:
+            缓存名称 -> (命中次数, 未命中次数)：type_resolution 为类型解析缓存，
+            layout 为所有布局引擎的合计
+        """
+        layout_hits = sum(engine._cache.hits for engine in self._layout_engines.values())
+        layout_misses = sum(engine._cache.misses for engine in self._layout_engines.values())
+        return {
+            'type_resolution': (self._resolution_cache.hits, self._resolution_cache.misses),
+            'layout': (layout_hits, layout_misses),
+        }
 
     def _clear_cache(self) -> None:
         """清理性能缓存"""
-        self._kind_cache.clear()
-        self._find_cache.clear()
+        self._resolution_cache.clear()
+        self._alias_count = len(self.TYPE_ALIASES)
+        for engine in self._layout_engines.values():
+            engine.clear()
+
+    def _invalidate_types(self, names) -> None:
+        """类型定义发生变化，失效依赖这些类型的解析结果
+
+        Args:
+            names: 发生变化的类型名称
+        """
+        names = {self._clean_type_name(name) for name in names}
+        self._resolution_cache.invalidate(names)
+        for engine in self._layout_engines.values():
+            engine.invalidate(names)
+
+    def _sync_cache(self) -> ResolutionCache:
+        """检查解析缓存是否仍然有效并返回缓存
+
+        绕过TypeManager直接修改类型列表，或其他实例修改了共享的TYPE_ALIASES时，
+        无法确定受影响的类型，清空缓存。
+        """
+        if (self._alias_count != len(self.TYPE_ALIASES)
+                or self._global_index.is_stale(self._global_types)
+                or self._current_index.is_stale(self._current_types)):
+            self._get_indexes()
+            self._clear_cache()
+        return self._resolution_cache
 
     def add_macro_definition(self, name: str, value: Any) -> None:
         """添加宏定义
@@ -157,7 +295,127 @@ class TypeManager:
             name: 宏名称
             value: 宏值
         """
+        # 只有重新定义才会使已解析的常量失效，新增宏不影响
+        previous = self._lookup_macro(name)
+        if self._change_journal is not None:
+            self._change_journal['macros'].setdefault(name, self._current_macro_definitions.get(name))
         self._current_macro_definitions[name] = value
+        if previous is not None and previous != value:
+            self._symbols.invalidate()
+
+    def define_macros(self, definitions: Dict[str, Any]) -> None:
+        """登记配置的宏（ParserConfig.macro_definitions、命令行 -D）到全局层
+
+        文本值与 #define 一样按C表达式求值，数值直接保存；None 表示只定义不赋值，
+        保存为空字符串。配置的宏参与条件编译的判定和解析缓存的键。
+
+        Args:
+            definitions: {宏名称: 值}
+        """
+        for name, value in definitions.items():
+            if value is None:
+                value = ''
+            elif isinstance(value, str) and value.strip():
+                number, value_type = self.evaluate_expression(value)
+                if value_type == 'number':
+                    value = number
+            self._global_macro_definitions[name] = value
+        self._symbols.invalidate()
+
+    @property
+    def symbols(self) -> SymbolTable:
+        """常量表达式求值使用的符号表"""
+        return self._symbols
+
+    def evaluate_expression(self, expr: Union[str, bytes]) -> Tuple[Any, str]:
+        """使用当前的宏定义和枚举值求值C常量表达式
+        
+        与 ExpressionParser.parse 的返回值相同，但不复制宏和枚举字典，
+        表达式和宏的值都会被缓存。
+        
+        Args:
+            expr: 表达式文本
+            
+        Returns:
+            (结果, 类型)，类型为 'number'、'string' 或 'expression'
+        """
+        return ExpressionParser.evaluate(expr, self._symbols)
+
+    def _lookup_macro(self, name: str) -> Any:
+        """查找宏定义，未定义时返回None"""
+        value = self._current_macro_definitions.get(name)
+        if value is None:
+            value = self._global_macro_definitions.get(name)
+        if value is None:
+            # 上层的定义覆盖下层
+            for layer in reversed(self._layers):
+                value = layer.macro(name)
+                if value is not None:
+                    break
+        return value
+
+    def _global_type_list(self) -> List[Dict[str, Any]]:
+        """全局类型列表，包含冻结的各层（类型库的条目全部反序列化）"""
+        if not self._layers:
+            return self._global_types
+        types = []
+        for layer in self._layers:
+            types.extend(layer.types())
+        return types + self._global_types
+
+    def own_types(self) -> List[Dict[str, Any]]:
+        """本对象自身的全局层和当前文件层的类型，不包括冻结的共享层和类型库"""
+        return self._global_types + self._current_types
+
+    def types_named(self, name: str) -> List[Dict[str, Any]]:
+        """按条目名称精确查找所有层中的类型，顺序与 export_types() 一致
+
+        类型库只反序列化匹配的条目。
+        """
+        result = []
+        for index in self._get_indexes('all'):
+            result.extend(index.by_name(name))
+        return result
+
+    def _global_macros(self) -> Dict[str, Any]:
+        """全局宏定义，包含冻结的各层"""
+        if not self._layers:
+            return self._global_macro_definitions
+        macros = {}
+        for layer in self._layers:
+            macros.update(layer.macros())
+        macros.update(self._global_macro_definitions)
+        return macros
+
+    def _global_pointer_names(self) -> Set[str]:
+        """全局指针类型名，包含冻结的各层"""
+        if not self._layers:
+            return self._global_pointer_types
+        return self._global_pointer_types.union(*(layer.pointer_types for layer in self._layers))
+
+    def type_statistics(self, scope: str = 'global') -> Dict[str, int]:
+        """类型、指针类型和宏定义的数量，不反序列化类型库的条目
+
+        Args:
+            scope: 'global' 或 'current'
+        """
+        if scope == 'current':
+            return {'types': len(self._current_types), 'pointer_types': len(self._current_pointer_types),
+                    'macro_definitions': len(self._current_macro_definitions)}
+        return {'types': len(self._global_types) + sum(len(layer) for layer in self._layers),
+                'pointer_types': len(self._global_pointer_names()),
+                'macro_definitions': len(self._global_macro_definitions)
+                + sum(layer.macro_count for layer in self._layers)}
+
+    def _lookup_symbol_type(self, name: str):
+        """类型转换中使用的类型名对应的求值类型，非数值类型返回None"""
+        real_type = self.get_real_type(name)
+        info = self.BASIC_TYPES.get(real_type)
+        if not info or not info['size']:
+            return None
+        if real_type in ('float', 'double', 'long double'):
+            return DOUBLE
+        return (info['size'] * 8, info['signed'])
 
     def export_types(self, scope: str = 'all'):
         """导出所有类型信息
@@ -174,16 +432,16 @@ class TypeManager:
             pointer_types = list(self._current_pointer_types)
             macro_definitions = self._current_macro_definitions.copy()
         elif scope == 'global':
-            all_types = self._global_types
-            pointer_types = list(self._global_pointer_types)
-            macro_definitions = self._global_macro_definitions.copy()
+            all_types = self._global_type_list()
+            pointer_types = list(self._global_pointer_names())
+            macro_definitions = self._global_macros().copy()
         elif scope == 'all':
             # 合并全局和当前文件的类型
-            all_types = self._global_types + self._current_types
+            all_types = self._global_type_list() + self._current_types
             # 合并指针类型
-            pointer_types = list(self._global_pointer_types.union(self._current_pointer_types))
+            pointer_types = list(self._global_pointer_names().union(self._current_pointer_types))
             # 合并宏定义
-            macro_definitions = self._global_macro_definitions.copy()
+            macro_definitions = self._global_macros().copy()
             macro_definitions.update(self._current_macro_definitions)
         else:
             logger.warning(f"Invalid scope '{scope}', using 'all' instead")
@@ -209,97 +467,56 @@ class TypeManager:
             for typedef in type_info['typedef_types']:
                 if isinstance(typedef, dict) and 'name' in typedef and 'base_type' in typedef:
                     self.TYPE_ALIASES[typedef['name']] = typedef['base_type']
+            self._clear_cache()
 
     def reset_type_info(self):
         """重置所有类型信息（包括全局和当前文件）"""
         # 重置统一存储
         self._global_types = []
         self._current_types = []
+        self._layers = []
         self._global_pointer_types = set()
         self._global_macro_definitions = {}
         self._current_pointer_types = set()
         self._current_macro_definitions = {}
+        self._global_index.rebuild(self._global_types)
+        self._current_index.rebuild(self._current_types)
+        self._symbols.invalidate()
+        self._clear_cache()
 
     def get_struct_info(self, struct_name: str = None) -> Dict[str, Any]:
         """获取结构体信息"""
         if struct_name:
             # 尝试多种名称格式进行查找
-            search_names = [
-                struct_name,  # 原始名称
-                self._clean_type_name(struct_name),  # 清理后的名称
-                f"struct {self._clean_type_name(struct_name)}"  # 加上struct前缀
-            ]
-            
-            # 去重
-            search_names = list(dict.fromkeys(search_names))
-            
-            # 先获取所有结构体，然后手动过滤
-            all_structs = self.find_types_by_jsonpath("$[?(@.kind=='struct')]")
-            
-            for struct in all_structs:
-                if struct.get('name') in search_names:
-                    return struct
-            
-            return {}
+            search_names = self._search_names(struct_name, 'struct')
+            return self._lookup_type('struct', search_names) or {}
         else:
             # 返回所有结构体
-            return self.find_types_by_jsonpath("$[?(@.kind=='struct')]")
+            return self._find_in_index('struct')
     
     def get_union_info(self, union_name: str = None) -> Dict[str, Any]:
         """获取联合体信息"""
         if union_name:
             # 尝试多种名称格式进行查找
-            search_names = [
-                union_name,  # 原始名称
-                self._clean_type_name(union_name),  # 清理后的名称
-                f"union {self._clean_type_name(union_name)}"  # 加上union前缀
-            ]
-            
-            # 去重
-            search_names = list(dict.fromkeys(search_names))
-            
-            # 先获取所有联合体，然后手动过滤
-            all_unions = self.find_types_by_jsonpath("$[?(@.kind=='union')]")
-            
-            for union in all_unions:
-                if union.get('name') in search_names:
-                    return union
-            
-            return {}
+            search_names = self._search_names(union_name, 'union')
+            return self._lookup_type('union', search_names) or {}
         else:
             # 返回所有联合体
-            return self.find_types_by_jsonpath("$[?(@.kind=='union')]")
+            return self._find_in_index('union')
     
     def get_enum_info(self, enum_name: str = None) -> Dict[str, Any]:
         """获取枚举信息"""
         if enum_name:
             # 尝试多种名称格式进行查找
-            search_names = [
-                enum_name,  # 原始名称
-                self._clean_type_name(enum_name),  # 清理后的名称
-                f"enum {self._clean_type_name(enum_name)}"  # 加上enum前缀
-            ]
-            
-            # 去重
-            search_names = list(dict.fromkeys(search_names))
-            
-            # 先获取所有枚举，然后手动过滤
-            all_enums = self.find_types_by_jsonpath("$[?(@.kind=='enum')]")
-            
-            for enum in all_enums:
-                if enum.get('name') in search_names:
-                    return enum
-            
-            return {}
+            search_names = self._search_names(enum_name, 'enum')
+            return self._lookup_type('enum', search_names) or {}
         else:
             # 合并全局和当前文件的信息
-            enums = self.find_types_by_jsonpath("$[?(@.kind=='enum')]")
             merged_values = {}
-            for enum in enums:
-                if isinstance(enum, dict):
-                    name = enum.get('name')
-                    if name:
-                        merged_values[name] = enum.get('values', {})
+            for enum in self._find_in_index('enum'):
+                name = enum.get('name')
+                if name:
+                    merged_values[name] = enum.get('values', {})
             return merged_values
          
     def get_type_info(self, type_name: str) -> Dict[str, Any]:
@@ -330,10 +547,9 @@ class TypeManager:
             return enum_info
             
         # 尝试查找typedef
-        query = f"$[?(@.kind=='typedef' && @.name=='{clean_name}')]"
-        results = self.find_types_by_jsonpath(query)
-        if results:
-            return results[0]
+        typedef_info = self._lookup_type('typedef', [clean_name])
+        if typedef_info:
+            return typedef_info
             
         # 如果都没找到，返回空字典
         return {}
@@ -345,10 +561,15 @@ class TypeManager:
             if macro_name in self._current_macro_definitions:
                 return self._current_macro_definitions[macro_name]
             # 然后查找全局定义
-            return self._global_macro_definitions.get(macro_name, macro_name)
+            if macro_name in self._global_macro_definitions:
+                return self._global_macro_definitions[macro_name]
+            for layer in reversed(self._layers):
+                if layer.has_macro(macro_name):
+                    return layer.macro(macro_name)
+            return macro_name
         else:
             # 合并全局和当前文件的信息
-            merged_info = self._global_macro_definitions.copy()
+            merged_info = self._global_macros().copy()
             merged_info.update(self._current_macro_definitions)
             return merged_info
     
@@ -362,22 +583,23 @@ class TypeManager:
             找到的类型信息，如果没找到返回None
         """
         # 检查缓存
-        if type_name in self._find_cache:
-            return self._find_cache[type_name]
+        cache = self._sync_cache()
+        result = cache.get('find', type_name)
+        if result is not cache.MISSING:
+            return result
         
         clean_name = self._clean_type_name(type_name)
         result = None
         
-        # 搜索所有类型定义
-        all_types = self._current_types + self._global_types
-        for type_info in all_types:
-            if type_info.get('name') == clean_name:
-                result = type_info
+        # 搜索所有类型定义，当前文件优先，其次是全局类型和各冻结层/类型库
+        for index in self._lookup_indexes():
+            matches = index.by_name(clean_name)
+            if matches:
+                result = matches[0]
                 break
         
         # 缓存结果
-        self._find_cache[type_name] = result
-        return result
+        return cache.put('find', type_name, result, (clean_name,))
     
     def _get_type_kind(self, type_name: str) -> Optional[str]:
         """获取类型的种类
@@ -389,10 +611,13 @@ class TypeManager:
             类型种类，如果未找到返回None
         """
         # 检查缓存
-        if hasattr(self, '_kind_cache') and type_name in self._kind_cache:
-            return self._kind_cache[type_name]
+        cache = self._sync_cache()
+        result = cache.get('kind', type_name)
+        if result is not cache.MISSING:
+            return result
         
         result = None
+        depends_on = {self._clean_type_name(type_name)}
         
         # 处理带前缀的类型名称
         if type_name.startswith('struct '):
@@ -411,7 +636,8 @@ class TypeManager:
             if clean_name in self.BASIC_TYPES:
                 result = 'basic'
             # 检查指针类型
-            elif clean_name in self._current_pointer_types or clean_name in self._global_pointer_types:
+            elif (clean_name in self._current_pointer_types or clean_name in self._global_pointer_types
+                  or any(clean_name in layer.pointer_types for layer in self._layers)):
                 result = 'pointer'
             else:
                 # 查找自定义类型
@@ -425,13 +651,10 @@ class TypeManager:
                         if isinstance(alias_type, dict):
                             alias_type = alias_type.get('base_type', '')
                         result = self._get_type_kind(alias_type)
+                        depends_on |= cache.dependencies('kind', alias_type)
         
         # 缓存结果
-        if not hasattr(self, '_kind_cache'):
-            self._kind_cache = {}
-        self._kind_cache[type_name] = result
-        
-        return result
+        return cache.put('kind', type_name, result, depends_on)
     
     def is_basic_type(self, type_name: str, visited: Set[str] = None) -> bool:
         """判断是否为基本类型"""
@@ -543,14 +766,22 @@ class TypeManager:
         return False
         
     def get_real_type(self, type_name: str, visited: Set[str] = None) -> str:
-        """获取类型的实际类型（解析别名）"""
-        if visited is None:
-            visited = set()
-        
+        """获取类型的实际类型（解析一层别名）"""
         # 如果输入是字典，提取 base_type
         if isinstance(type_name, dict):
             type_name = type_name.get('base_type', '')
         
+        if visited is None:
+            cache = self._sync_cache()
+            result = cache.get('real', type_name)
+            if result is cache.MISSING:
+                result = cache.put('real', type_name, self._get_real_type(type_name, set()),
+                                   (self._clean_type_name(type_name),))
+            return result
+        return self._get_real_type(type_name, visited)
+    
+    def _get_real_type(self, type_name: str, visited: Set[str]) -> str:
+        """get_real_type 的实现（不经过缓存）"""
         # 对于复合类型（数组、指针），先提取基础类型名
         original_type = type_name
         clean_base_type = self._clean_type_name(type_name)
@@ -571,20 +802,13 @@ class TypeManager:
             # 对于别名，需要重构完整类型
             return self._reconstruct_type(original_type, clean_base_type, alias_type)
         
-        # 使用新的统一存储方式查找类型别名
-        # 优先检查当前文件的类型别名
-        for typedef in self._current_types:
-            if typedef.get('kind') == 'typedef' and typedef.get('name') == clean_base_type:
-                base_type = typedef.get('base_type', '')
-                if base_type != clean_base_type:  # 避免自引用
-                    return self._reconstruct_type(original_type, clean_base_type, base_type)
-        
-        # 然后检查全局类型别名
-        for typedef in self._global_types:
-            if typedef.get('kind') == 'typedef' and typedef.get('name') == clean_base_type:
-                base_type = typedef.get('base_type', '')
-                if base_type != clean_base_type:  # 避免自引用
-                    return self._reconstruct_type(original_type, clean_base_type, base_type)
+        # 使用类型索引查找类型别名，优先检查当前文件，然后检查全局
+        typedef = self._lookup_type('typedef', [clean_base_type], scope='current') \
+            or self._lookup_type('typedef', [clean_base_type], scope='global')
+        if typedef:
+            base_type = typedef.get('base_type', '')
+            if base_type != clean_base_type:  # 避免自引用
+                return self._reconstruct_type(original_type, clean_base_type, base_type)
             
         return original_type
     
@@ -620,21 +844,25 @@ class TypeManager:
     
     def _clean_type_name(self, type_name: str) -> str:
         """清理类型名称，移除前缀和修饰符"""
-        logger.debug(f"Cleaning type name: {type_name}")
+        if log_gate.debug:
+            logger.debug(f"Cleaning type name: {type_name}")
         
         if isinstance(type_name, dict):
             type_name = type_name.get('base_type', '')
-            logger.debug(f"Extracted base_type from dict: {type_name}")
+            if log_gate.debug:
+                logger.debug(f"Extracted base_type from dict: {type_name}")
         
         # 移除 struct/union/enum 前缀
         clean_name = type_name.replace('struct ', '').replace('union ', '').replace('enum ', '')
-        logger.debug(f"After removing prefixes: {clean_name}")
+        if log_gate.debug:
+            logger.debug(f"After removing prefixes: {clean_name}")
         
         # 处理数组类型：提取基础类型，移除数组维度
         # 例如: int[10] -> int, char[100][50] -> char
         if '[' in clean_name and ']' in clean_name:
             base_type = clean_name.split('[')[0].strip()
-            logger.debug(f"Extracted array base type: {base_type}")
+            if log_gate.debug:
+                logger.debug(f"Extracted array base type: {base_type}")
             clean_name = base_type
         
         # 处理指针类型：保留指针符号但统一格式
@@ -645,10 +873,12 @@ class TypeManager:
             pointer_count = len([p for p in parts[1:] if not p.strip()])
             if pointer_count > 0:
                 clean_name = base_part + '*' * pointer_count
-                logger.debug(f"Normalized pointer type: {clean_name}")
+                if log_gate.debug:
+                    logger.debug(f"Normalized pointer type: {clean_name}")
         
         result = clean_name.strip()
-        logger.debug(f"Final cleaned name: {result}")
+        if log_gate.debug:
+            logger.debug(f"Final cleaned name: {result}")
         return result
     
     def get_printf_format(self, type_name: str) -> str:
@@ -682,9 +912,10 @@ class TypeManager:
 
     def resolve_type(self, type_name: str, base_info: Optional[Dict] = None) -> Dict[str, Any]:
         """解析类型名称，返回完整的类型信息"""
-        logger.debug(f"\nResolving type: {type_name}")
-        if base_info:
-            logger.debug(f"Base info: {json.dumps(base_info, indent=2)}")
+        if log_gate.debug:
+            logger.debug(f"Resolving type: {type_name}")
+            if base_info:
+                logger.debug(f"Base info: {json.dumps(base_info, indent=2)}")
         
         # 创建基础类型信息
         type_info = {
@@ -706,29 +937,17 @@ class TypeManager:
         if base_info:
             type_info.update(base_info)
         
-        # 处理指针类型
-        base_type = type_name
-        pointer_level = type_info.get('pointer_level', 0)
-        
-        # 处理类型名中的指针
-        while base_type.endswith('*'):
-            base_type = base_type[:-1].strip()
-            pointer_level += 1
-        
-        # 解析类型
-        resolved_type = self.get_real_type(base_type)
-        
-        # 如果解析后的类型也是指针
-        while resolved_type.endswith('*'):
-            resolved_type = resolved_type[:-1].strip()
-            pointer_level += 1
+        # 沿typedef链解析到最终类型（结果缓存）
+        resolution = self._resolve_base(type_name)
+        resolved_type = resolution['base_type']
+        pointer_level = type_info.get('pointer_level', 0) + resolution['pointer_level']
         
         # 获取基础类型的信息
         type_info.update({
-            'is_basic': self.is_basic_type(resolved_type),
-            'is_struct': self.is_struct_type(resolved_type) or bool(type_info.get('nested_fields')),
-            'is_union': self.is_union_type(resolved_type),
-            'is_enum': self.is_enum_type(resolved_type),
+            'is_basic': resolution['is_basic'],
+            'is_struct': resolution['is_struct'] or bool(type_info.get('nested_fields')),
+            'is_union': resolution['is_union'],
+            'is_enum': resolution['is_enum'],
             'is_pointer': pointer_level > 0,
             'pointer_level': pointer_level,
             'base_type': resolved_type,
@@ -737,21 +956,130 @@ class TypeManager:
         
         # 获取详细类型信息
         if type_info['is_struct'] and not type_info.get('nested_fields'):
-            type_info['info'] = self.get_struct_info(resolved_type)
-        elif type_info['is_union']:
-            type_info['info'] = self.get_union_info(resolved_type)
-        elif type_info['is_enum']:
-            type_info['info'] = self.get_enum_info(resolved_type)
+            type_info['info'] = resolution['info'] if resolution['is_struct'] else self.get_struct_info(resolved_type)
+        elif type_info['is_union'] or type_info['is_enum']:
+            type_info['info'] = resolution['info']
         
-        logger.debug(f"Final resolved type info: {json.dumps(type_info, indent=2)}")
+        if log_gate.debug:
+            logger.debug(f"Final resolved type info: {json.dumps(type_info, indent=2)}")
         return type_info
 
+    def resolve_type_shared(self, type_name: str) -> Dict[str, Any]:
+        """与 resolve_type(type_name) 相同，但结果按类型名缓存，所有调用方共享同一个字典
+        
+        填充结构体数组时每个元素的每个字段都要解析字段类型，共享结果避免为每次调用创建新字典。
+        结果在依赖的类型变化时失效。调用方不应修改返回的字典。
+        
+        Args:
+            type_name: 类型名称
+            
+        Returns:
+            类型信息字典（只读）
+        """
+        cache = self._sync_cache()
+        shared = cache.get('resolved', type_name)
+        if shared is not cache.MISSING:
+            return shared
+        type_info = self.resolve_type(type_name)
+        return cache.put('resolved', type_name, type_info, cache.dependencies('resolve', type_name))
+
+    def type_dependencies(self, type_name: str) -> FrozenSet[str]:
+        """resolve_type_shared(type_name) 的结果依赖的类型名，这些类型变化时结果失效"""
+        self.resolve_type_shared(type_name)
+        return self._sync_cache().dependencies('resolved', type_name)
+
+    def get_derived(self, category: str, type_name: str,
+                    factory: Callable[[], Tuple[Any, Iterable[str]]],
+                    valid: Optional[Callable[[Any], bool]] = None) -> Any:
+        """获取由类型定义派生的对象（例如生成的解码函数），与解析结果使用同一缓存
+        
+        依赖的任何类型被注册或更新时失效，下次获取时重新调用 factory。
+        
+        Args:
+            category: 派生对象的类别，不能与解析结果的类别重复
+            type_name: 类型名称
+            factory: 返回 (派生对象, 依赖的类型名) 的函数
+            valid: 检查缓存的对象是否适用于本次调用，返回False时重新生成
+            
+        Returns:
+            派生对象
+        """
+        cache = self._sync_cache()
+        value = cache.get(category, type_name)
+        if value is not cache.MISSING and (valid is None or valid(value)):
+            return value
+        value, depends_on = factory()
+        return cache.put(category, type_name, value, depends_on)
+
+    def _resolve_base(self, type_name: str) -> Dict[str, Any]:
+        """沿typedef链把类型解析到最终的基础类型，结果按类型名缓存
+        
+        结果依赖链上经过的所有类型，其中任何一个类型被注册或更新时失效。
+        
+        Args:
+            type_name: 类型名称，可以带指针后缀
+            
+        Returns:
+            包含以下内容的字典（调用方不应修改）：
+            - base_type: 最终的基础类型
+            - pointer_level: 类型名和typedef链上累计的指针级别
+            - is_basic/is_struct/is_union/is_enum: 基础类型的种类
+            - info: 结构体、联合体或枚举的定义
+        """
+        cache = self._sync_cache()
+        resolution = cache.get('resolve', type_name)
+        if resolution is not cache.MISSING:
+            return resolution
+        
+        # 处理类型名中的指针
+        current = type_name
+        pointer_level = 0
+        while current.endswith('*'):
+            current = current[:-1].strip()
+            pointer_level += 1
+        
+        seen = {self._clean_type_name(current)}
+        depends_on = set(seen)
+        while True:
+            resolved = self.get_real_type(current)
+            # 如果解析后的类型也是指针
+            while resolved.endswith('*'):
+                resolved = resolved[:-1].strip()
+                pointer_level += 1
+            if resolved == current:
+                break
+            current = resolved
+            clean_name = self._clean_type_name(current)
+            depends_on.add(clean_name)
+            # typedef struct X X 之类的同名引用在这里结束
+            if clean_name in seen:
+                break
+            seen.add(clean_name)
+        
+        resolution = {
+            'base_type': current,
+            'pointer_level': pointer_level,
+            'is_basic': self.is_basic_type(current),
+            'is_struct': self.is_struct_type(current),
+            'is_union': self.is_union_type(current),
+            'is_enum': self.is_enum_type(current),
+            'info': None
+        }
+        if resolution['is_struct']:
+            resolution['info'] = self.get_struct_info(current)
+        elif resolution['is_union']:
+            resolution['info'] = self.get_union_info(current)
+        elif resolution['is_enum']:
+            resolution['info'] = self.get_enum_info(current)
+        depends_on |= cache.dependencies('kind', current)
+        return cache.put('resolve', type_name, resolution, depends_on)
+
     def export_global_type_info(self) -> Dict[str, Any]:
         """导出全局类型信息"""
         return {
-            'types': self._global_types,
-            'pointer_types': list(self._global_pointer_types),
-            'macro_definitions': self._global_macro_definitions
+            'types': self._global_type_list(),
+            'pointer_types': list(self._global_pointer_names()),
+            'macro_definitions': self._global_macros()
         }
 
     def export_current_type_info(self) -> Dict[str, Any]:
@@ -762,59 +1090,240 @@ class TypeManager:
             'macro_definitions': self._current_macro_definitions
         }
 
+    def get_current_state(self) -> Tuple[int, Dict[str, Any], Set[str]]:
+        """记录当前文件类型信息的状态，配合 export_current_delta 使用
+
+        Returns:
+            (类型数量, 宏定义副本, 指针类型副本)
+        """
+        return (
+            len(self._current_types),
+            self._current_macro_definitions.copy(),
+            set(self._current_pointer_types)
+        )
+
+    def export_current_delta(self, state: Tuple[int, Dict[str, Any], Set[str]]) -> Dict[str, Any]:
+        """导出自 get_current_state 记录以来新增的当前文件类型信息
+
+        Args:
+            state: get_current_state 返回的状态
+
+        Returns:
+            与 export_types 格式相同的类型信息字典
+        """
+        type_count, macro_definitions, pointer_types = state
+        return {
+            'types': self._current_types[type_count:],
+            'pointer_types': sorted(self._current_pointer_types - pointer_types),
+            'macro_definitions': {
+                name: value for name, value in self._current_macro_definitions.items()
+                if name not in macro_definitions or macro_definitions[name] != value
+            }
+        }
+
     def reset_current_type_info(self) -> None:
         """重置当前文件的类型信息"""
         # 重置统一存储
         self._current_types = []
         self._current_pointer_types = set()
         self._current_macro_definitions = {}
+        self._current_index.rebuild(self._current_types)
+        self._clear_cache()
+        self._symbols.invalidate()
+
+    def freeze(self) -> None:
+        """把全局层和当前文件层冻结为只读的共享层
+        
+        两层的列表、索引和字典原样移入 TypeLayer，不复制，耗时与类型数量无关；
+        本对象的全局层和当前文件层换成新的空层，之后的注册和合并只写入新的层。
+        冻结的层不再修改，可以被 fork 出的多个对象（包括其他线程中的）共享。
+        
+        按名称的查询、类型解析和 export_types() 的结果不变；冻结前的当前文件类型
+        之后属于底层，按 'current' 范围的查询（export_types(scope='current')、
+        export_current_type_info()）只返回冻结之后注册的类型，
+        reset_current_type_info / revert_changes 也只影响冻结之后的当前文件层。
+        """
+        with self._freeze_lock:
+            layers = [TypeLayer(types, pointer_types, macros, index) for types, pointer_types, macros, index in (
+                (self._global_types, self._global_pointer_types, self._global_macro_definitions, self._global_index),
+                (self._current_types, self._current_pointer_types, self._current_macro_definitions,
+                 self._current_index),
+            ) if types or pointer_types or macros]
+            if not layers:
+                return
+            # 列表可能与其他对象共享，整体替换
+            self._layers = self._layers + layers
+            self._global_types, self._current_types = [], []
+            self._global_pointer_types, self._current_pointer_types = set(), set()
+            self._global_macro_definitions, self._current_macro_definitions = {}, {}
+            self._global_index = TypeIndex(self._global_types)
+            self._current_index = TypeIndex(self._current_types)
+            self._change_journal = None
+
+    def fork(self, macro_definitions: Optional[Dict[str, Any]] = None) -> 'TypeManager':
+        """创建以本对象当前全部类型为底层的TypeManager（写时复制的类型环境）
+        
+        先 freeze() 本对象，新对象共享冻结的各层，不复制类型表；新对象的全局层和
+        当前文件层为空，写入只进入自己的层，互不影响，解析结果缓存独立。
+        fork 可以嵌套（例如公共SDK -> 各目标配置 -> 各文件），每层只保存相对下层的增量；
+        丢弃新对象不影响本对象。常驻服务用它为每个请求提供独立的类型环境，头文件类型只加载一次。
+        
+        Args:
+            macro_definitions: 新对象全局层的宏定义（例如某个目标配置的 ParserConfig.macro_definitions），
+                               覆盖底层的同名宏
+        
+        Returns:
+            新的TypeManager
+        """
+        self.freeze()
+        other = TypeManager(abi=self.abi)
+        other._layers = self._layers
+        if macro_definitions:
+            other.define_macros(macro_definitions)
+        return other
+
+    def begin_changes(self) -> Dict[str, Any]:
+        """开始记录当前文件类型信息的变化
+
+        增量解析时逐个声明调用，记录该声明新增的类型和定义的宏，
+        声明被修改或删除后可以通过 revert_changes 撤销。
+
+        Returns:
+            变化记录，传给 end_changes
+        """
+        self._change_journal = {'type_count': len(self._current_types), 'macros': {}}
+        return self._change_journal
+
+    def end_changes(self, journal: Dict[str, Any]) -> Dict[str, Any]:
+        """结束记录
+
+        Args:
+            journal: begin_changes 返回的记录
+
+        Returns:
+            {'types': 新增的类型条目, 'macros': {宏名称: 定义前的值（未定义为None）}}
+        """
+        self._change_journal = None
+        return {'types': self._current_types[journal['type_count']:], 'macros': journal['macros']}
+
+    def revert_changes(self, changes: List[Dict[str, Any]]) -> None:
+        """撤销 end_changes 返回的变化（按相反顺序），只失效受影响类型的解析结果
+
+        Args:
+            changes: end_changes 返回值的列表，按记录的先后顺序
+        """
+        index = self._get_indexes('current')[0]
+        removed: Dict[int, Dict[str, Any]] = {}
+        macros_changed = False
+        for change in reversed(changes):
+            for entry in change['types']:
+                removed[id(entry)] = entry
+            for name, previous in change['macros'].items():
+                macros_changed = True
+                if previous is None:
+                    self._current_macro_definitions.pop(name, None)
+                else:
+                    self._current_macro_definitions[name] = previous
+        
+        if removed:
+            for entry in removed.values():
+                index.discard(entry)
+            self._current_types[:] = [entry for entry in self._current_types if id(entry) not in removed]
+            names = {entry.get('name') for entry in removed.values() if isinstance(entry.get('name'), str)}
+            self._current_pointer_types.difference_update(
+                entry['name'] for entry in removed.values()
+                if entry.get('kind') == 'typedef' and str(entry.get('type', '')).endswith('*')
+            )
+            self._invalidate_types(names)
+        if macros_changed or any(entry.get('kind') == 'enum' for entry in removed.values()):
+            self._symbols.invalidate()
 
     def is_typedef_type(self, type_name: str) -> bool:
         """检查是否是typedef类型"""
         clean_name = self._clean_type_name(type_name)
         
-        # 使用新的统一存储方式查找
-        return any(t.get('kind') == 'typedef' and t.get('name') == clean_name 
-                  for t in self._current_types + self._global_types)
+        # 使用类型索引查找
+        return self._lookup_type('typedef', [clean_name]) is not None
 
     def is_anonymous_type(self, type_name: str) -> bool:
         """检查是否是匿名类型"""
         return not type_name or type_name.startswith('anonymous_')
 
-    def merge_type_info(self, other_type_info: Dict[str, Any], to_global: bool = False) -> None:
+    def merge_type_info(self, other_type_info: Dict[str, Any], to_global: bool = False,
+                        overwrite: bool = True) -> List[Dict[str, Any]]:
         """合并其他类型信息
         
+        同一 (kind, name) 的类型内容相同时直接跳过；内容不同时视为冲突，
+        按 overwrite 决定更新已有类型还是保留已有类型。
+        
         Args:
             other_type_info: 要合并的类型信息
             to_global: 是否合并到全局类型信息
+            overwrite: 冲突时是否用新的定义更新已有类型
+            
+        Returns:
+            冲突列表，每项包含 kind、name、existing 和 incoming
         """
+        conflicts = []
         try:
             # 选择目标存储
             target_types = self._global_types if to_global else self._current_types
+            self._get_indexes()
+            target_index = self._global_index if to_global else self._current_index
             target_pointer_types = self._global_pointer_types if to_global else self._current_pointer_types
             target_macro_definitions = self._global_macro_definitions if to_global else self._current_macro_definitions
             
+            changed_names = set()
+            
             # 处理统一格式的类型列表
             for type_info in other_type_info.get('types', {}):
                 if isinstance(type_info, dict) and 'kind' in type_info and 'name' in type_info:
-                    # 检查是否已存在同名类型
-                    existing_type = next((t for t in target_types if t.get('name') == type_info['name']), None)
-                    if existing_type:
-                        # 更新现有类型
-                        existing_type.update(type_info)
-                    else:
+                    # 检查是否已存在同名同类的类型
+                    existing_type = target_index.get(type_info['kind'], type_info['name'])
+                    if existing_type is None:
                         # 添加新类型
                         target_types.append(type_info)
+                        target_index.add(type_info)
+                        changed_names.add(type_info['name'])
+                        continue
+                    
+                    if all(existing_type.get(key) == value for key, value in type_info.items()):
+                        continue
+                    conflicts.append({
+                        'kind': type_info['kind'],
+                        'name': type_info['name'],
+                        'existing': existing_type.copy(),
+                        'incoming': type_info
+                    })
+                    if overwrite:
+                        # 更新现有类型，先移出索引再按新内容重新索引
+                        target_index.discard(existing_type)
+                        existing_type.update(type_info)
+                        target_index.add(existing_type)
+                        changed_names.add(type_info['name'])
             
             # 处理指针类型
-            pointer_types_data = other_type_info.get('pointer_types', set())
-            if isinstance(pointer_types_data, list):
-                target_pointer_types.update(set(pointer_types_data))
-            else:
-                target_pointer_types.update(pointer_types_data)
+            pointer_types_data = set(other_type_info.get('pointer_types', set()))
+            changed_names.update(pointer_types_data - target_pointer_types)
+            target_pointer_types.update(pointer_types_data)
             
-            # 合并宏定义
-            target_macro_definitions.update(other_type_info.get('macro_definitions', {}))
+            # 合并宏定义，冲突时同样遵循 overwrite
+            for name, value in other_type_info.get('macro_definitions', {}).items():
+                if name in target_macro_definitions and target_macro_definitions[name] != value:
+                    conflicts.append({
+                        'kind': 'macro',
+                        'name': name,
+                        'existing': target_macro_definitions[name],
+                        'incoming': value
+                    })
+                    if not overwrite:
+                        continue
+                target_macro_definitions[name] = value
+            
+            # 只失效依赖变化类型的解析结果
+            self._invalidate_types(name for name in changed_names if isinstance(name, str))
+            self._symbols.invalidate()
+            return conflicts
 
         except Exception as e:
             logger.error(f"Failed to merge type info: {e}")
@@ -924,7 +1433,7 @@ class TypeManager:
                 'attributes': details.get('attributes', {}),
                 'visibility': details.get('visibility', 'public'),
                 'storage_class': details.get('storage_class', ''),
-                'packed': details.get('packed', False),
+                'packed': details.get('packed', type_info.get('attributes', {}).get('packed', False)),
                 'kind': type_info.get('kind', ''),
                 'name': type_info.get('name', type_name),
                 'fields': type_info.get('fields', [])
@@ -934,34 +1443,24 @@ class TypeManager:
     def get_enum_values(self, enum_name: str = None) -> Dict[str, Any]:
         """获取枚举值信息"""
         if enum_name:
-            # 使用简单查询
-            query = f"$[?(@.kind=='enum')]"
-            enums = self.find_types_by_jsonpath(query)
-            # 手动过滤
-            filtered = [e for e in enums if e.get('name') == enum_name]
-            if filtered and 'values' in filtered[0]:
-                return {enum_name: filtered[0]['values']}
+            enum = self._lookup_type('enum', [enum_name])
+            if enum and 'values' in enum:
+                return {enum_name: enum['values']}
             return {}
         else:
-            # 使用简单查询
-            query = f"$[?(@.kind=='enum')]"
-            enums = self.find_types_by_jsonpath(query)
-            # 手动过滤有效的枚举
+            # 合并有效的枚举
             merged_values = {}
-            for enum in enums:
+            for enum in self._find_in_index('enum'):
                 if isinstance(enum, dict) and 'name' in enum and enum['name'] and 'values' in enum:
                     merged_values[enum['name']] = enum['values']
             return merged_values
 
     def get_enum_value(self, enum_name: str, value_name: str) -> Optional[Any]:
         """获取枚举值"""
-        # 使用简单查询
-        query = f"$[?(@.kind=='enum')]"
-        enums = self.find_types_by_jsonpath(query)
-        # 手动过滤
-        for enum in enums:
-            if enum.get('name') == enum_name and 'values' in enum and value_name in enum['values']:
-                return enum['values'][value_name]
+        for index in self._lookup_indexes():
+            for enum in index.by_name(enum_name):
+                if enum.get('kind') == 'enum' and value_name in enum.get('values', {}):
+                    return enum['values'][value_name]
         return None
 
     def has_macro(self, name: str) -> bool:
@@ -974,7 +1473,8 @@ class TypeManager:
             如果宏存在返回True，否则返回False
         """
         return (name in self._current_macro_definitions or 
-                name in self._global_macro_definitions)
+                name in self._global_macro_definitions or
+                any(layer.has_macro(name) for layer in self._layers))
 
     def register_type(self, name: str, info: Dict[str, Any]) -> None:
         """注册类型信息
@@ -987,15 +1487,46 @@ class TypeManager:
         if 'name' not in info:
             info['name'] = name
             
-        # 添加到统一存储
+        # 添加到统一存储并更新索引
         self._current_types.append(info)
+        self._get_indexes('current')[0].add(info)
+        self._invalidate_types((name,))
         
         # 处理指针类型
         kind = info.get('kind', '')
+        if kind == 'enum':
+            self._symbols.invalidate()
         type_str = info.get('type', '')
         if kind == 'typedef' and type_str and type_str.endswith('*'):
             self._current_pointer_types.add(name)
 
+    def get_layout_engine(self, abi: Optional[str] = None) -> LayoutEngine:
+        """获取目标ABI的布局引擎
+
+        Args:
+            abi: ABI名称，None表示类型管理器的默认ABI
+
+        Returns:
+            布局引擎，同一ABI复用同一个实例
+        """
+        name = get_abi_profile(abi or self.abi).name
+        engine = self._layout_engines.get(name)
+        if engine is None:
+            engine = self._layout_engines[name] = LayoutEngine(self, name)
+        return engine
+
+    def get_type_layout(self, type_name: str, abi: Optional[str] = None) -> Optional[TypeLayout]:
+        """获取结构体/联合体的布局表（字段偏移、位域位置和填充）
+
+        Args:
+            type_name: 类型名称
+            abi: ABI名称，None表示默认ABI
+
+        Returns:
+            布局表，不是结构体或联合体时返回None
+        """
+        return self.get_layout_engine(abi).layout(type_name)
+
     def get_type_size(self, type_name: str) -> int:
         """获取类型的大小（字节数）
         
@@ -1003,37 +1534,9 @@ class TypeManager:
             type_name: 类型名称
             
         Returns:
-            类型大小（字节数）
+            类型大小（字节数），按默认ABI计算
         """
-        # 清理类型名称
-        clean_name = self._clean_type_name(type_name)
-        
-        # 处理指针类型
-        if self.is_pointer_type(type_name):
-            return 8  # 64位系统上指针大小为8字节
-        
-        # 获取实际类型
-        real_type = self.get_real_type(clean_name)
-        
-        # 处理基本类型
-        if real_type in self.BASIC_TYPES:
-            return self.BASIC_TYPES[real_type]['size']
-        
-        # 处理结构体类型
-        if self.is_struct_type(real_type):
-            struct_info = self.get_struct_info(real_type)
-            return struct_info.get('size', 0)
-        
-        # 处理联合体类型
-        if self.is_union_type(real_type):
-            union_info = self.get_union_info(real_type)
-            return union_info.get('size', 0)
-        
-        # 处理枚举类型
-        if self.is_enum_type(real_type):
-            return 4  # 枚举类型默认大小为4字节
-        
-        return 0
+        return self.get_layout_engine().size_of(type_name)
 
     def get_type_alignment(self, type_name: str) -> int:
         """获取类型的对齐要求（字节数）
@@ -1042,78 +1545,22 @@ class TypeManager:
             type_name: 类型名称
             
         Returns:
-            类型对齐要求（字节数）
+            类型对齐要求（字节数），按默认ABI计算
         """
-        # 清理类型名称
-        clean_name = self._clean_type_name(type_name)
-        
-        # 处理指针类型
-        if self.is_pointer_type(type_name):
-            return 8  # 64位系统上指针对齐为8字节
-        
-        # 获取实际类型
-        real_type = self.get_real_type(clean_name)
-        
-        # 处理基本类型
-        if real_type in self.BASIC_TYPES:
-            return self.BASIC_TYPES[real_type]['alignment']
-        
-        # 处理结构体类型
-        if self.is_struct_type(real_type):
-            struct_info = self.get_struct_info(real_type)
-            return struct_info.get('alignment', 0)
-        
-        # 处理联合体类型
-        if self.is_union_type(real_type):
-            union_info = self.get_union_info(real_type)
-            return union_info.get('alignment', 0)
-        
-        # 处理枚举类型
-        if self.is_enum_type(real_type):
-            return 4  # 枚举类型默认对齐为4字节
-        
-        return 0
+        return self.get_layout_engine().alignment_of(type_name)
 
     def calculate_field_offset(self, type_name: str, field_name: str) -> int:
         """计算结构体字段的偏移量
         
         Args:
             type_name: 结构体类型名称
-            field_name: 字段名称
+            field_name: 字段名称，嵌套字段用点号分隔
             
         Returns:
-            字段偏移量（字节数）
+            字段偏移量（字节数），字段不存在时返回0
         """
-        if not self.is_struct_type(type_name):
-            return 0
-        
-        struct_info = self.get_struct_info(type_name)
-        fields = struct_info.get('fields', [])
-        
-        current_offset = 0
-        max_alignment = 1
-        
-        for field in fields:
-            if not isinstance(field, dict):
-                continue
-            
-            field_type = field.get('type', '')
-            field_alignment = self.get_type_alignment(field_type)
-            
-            # 更新最大对齐要求
-            max_alignment = max(max_alignment, field_alignment)
-            
-            # 计算当前字段的对齐后偏移量
-            current_offset = (current_offset + field_alignment - 1) & ~(field_alignment - 1)
-            
-            # 如果找到目标字段，返回其偏移量
-            if field.get('name') == field_name:
-                return current_offset
-            
-            # 更新偏移量
-            current_offset += self.get_type_size(field_type)
-        
-        return 0
+        offset = self.get_layout_engine().offset_of(type_name, field_name)
+        return offset if offset is not None else 0
 
     def get_field_info(self, type_name: str, field_name: str) -> Dict[str, Any]:
         """获取结构体或联合体字段的信息
@@ -1133,16 +1580,12 @@ class TypeManager:
         else:
             return {}
         
-        # 清理类型名称
-        clean_name = self._clean_type_name(type_name)
+        # 通过索引查找类型定义
+        type_info = self._lookup_type(kind, self._search_names(type_name, kind))
         
-        # 简化查询，避免复杂嵌套
-        query = "$[?(@.kind=='" + kind + "' && @.name=='" + clean_name + "')]"
-        results = self.find_types_by_jsonpath(query)
-        
-        if results and 'fields' in results[0]:
-            # 手动查找字段
-            for field in results[0]['fields']:
+        if type_info and 'fields' in type_info:
+            # 查找字段
+            for field in type_info['fields']:
                 if isinstance(field, dict) and field.get('name') == field_name:
                     field_info = field.copy()
                     if kind == 'struct':
@@ -1164,11 +1607,18 @@ class TypeManager:
             如果类型是紧凑布局返回True，否则返回False
         """
         type_info = self.get_type_details(type_name)
-        return type_info.get('packed', False)
+        if type_info.get('packed', False):
+            return True
+        # 结构体属性中的 packed（__attribute__((packed))），沿typedef查找
+        layout = self.get_type_layout(type_name)
+        return bool(layout is not None and layout.packed)
 
     def find_types_by_jsonpath(self, query: str, scope: str = 'all') -> List[Dict[str, Any]]:
         """使用jsonpath查询类型
         
+        通用但较慢的查询方式，每次调用都会解析表达式并扫描类型列表。
+        常规查找请使用基于索引的 get_*_info / find_types_by_* 方法。
+        
         Args:
             query: jsonpath查询表达式
             scope: 查询范围，'all'/'global'/'current'
@@ -1183,12 +1633,12 @@ class TypeManager:
             if scope == 'current':
                 data_source = self._current_types
             elif scope == 'global':
-                data_source = self._global_types
+                data_source = self._global_type_list()
             elif scope == 'all':
-                data_source = self._global_types + self._current_types
+                data_source = self._global_type_list() + self._current_types
             else:
                 logger.warning(f"Invalid scope '{scope}', using 'all' instead")
-                data_source = self._global_types + self._current_types
+                data_source = self._global_type_list() + self._current_types
             
             # 处理复杂查询 - 分解为简单查询
             if '&&' in query:
@@ -1277,9 +1727,9 @@ class TypeManager:
         if scope == 'current':
             data_source = self._current_types
         elif scope == 'global':
-            data_source = self._global_types
+            data_source = self._global_type_list()
         else:
-            data_source = self._global_types + self._current_types
+            data_source = self._global_type_list() + self._current_types
         
         # 解析简单查询
         if query.startswith("$[?(@.kind==") and query.endswith(")]"):
@@ -1306,21 +1756,17 @@ class TypeManager:
         """
         clean_name = self._clean_type_name(name)
         
-        # 构建JSONPath查询
-        if kind:
-            query = f"$[?(@.name=='{clean_name}' && @.kind=='{kind}')]"
-        else:
-            query = f"$[?(@.name=='{clean_name}')]"
-        
-        # 优先查找当前文件
-        results = self.find_types_by_jsonpath(query, scope='current')
-        if results:
-            return results[0]
-        
-        # 然后查找全局定义
-        results = self.find_types_by_jsonpath(query, scope='global')
-        if results:
-            return results[0]
+        # 优先查找当前文件，然后查找全局定义
+        for scope in ('current', 'global'):
+            if kind:
+                result = self._lookup_type(kind, [clean_name], scope=scope)
+                if result:
+                    return result
+            else:
+                for index in self._lookup_indexes(scope):
+                    matches = index.by_name(clean_name)
+                    if matches:
+                        return matches[0]
         
         return None
 
@@ -1335,33 +1781,29 @@ class TypeManager:
         Returns:
             匹配的类型列表
         """
-        query = f"$[?(@.kind=='{kind}')]"
-        return self.find_types_by_jsonpath(query, scope=scope)
+        return self._find_in_index(kind, scope=scope)
 
     def find_types_by_attribute(self, attribute_name: str, attribute_value: Any = None, scope: str = 'all') -> List[Dict[str, Any]]:
         """查找具有指定属性的所有类型定义
         
         Args:
             attribute_name: 属性名称
-            attribute_value: 属性值，如果为None则只检查属性是否存在
+            attribute_value: 属性值，如果为None则只检查属性是否存在且为真
             scope: 查询范围，'all'/'global'/'current'
             
         Returns:
             匹配的类型列表
         """
-        if attribute_value is None:
-            query = f"$[?(@.attributes && @.attributes.{attribute_name})]"
-        else:
-            # 处理不同类型的属性值
-            if isinstance(attribute_value, str):
-                query = f"$[?(@.attributes && @.attributes.{attribute_name}=='{attribute_value}')]"
-            elif isinstance(attribute_value, bool):
-                value_str = 'true' if attribute_value else 'false'
-                query = f"$[?(@.attributes && @.attributes.{attribute_name}=={value_str})]"
-            else:
-                query = f"$[?(@.attributes && @.attributes.{attribute_name}=={attribute_value})]"
-        
-        return self.find_types_by_jsonpath(query, scope=scope)
+        results = []
+        for index in self._get_indexes(scope):
+            for type_info in index.by_attribute(attribute_name):
+                value = type_info['attributes'][attribute_name]
+                if attribute_value is None:
+                    if value:
+                        results.append(type_info)
+                elif value == attribute_value:
+                    results.append(type_info)
+        return results
 
     def find_types_by_field(self, field_name: str, field_type: str = None, scope: str = 'all') -> List[Dict[str, Any]]:
         """查找包含指定字段的所有结构体或联合体
@@ -1374,21 +1816,18 @@ class TypeManager:
         Returns:
             匹配的类型列表
         """
-        # 修复查询语法，使用更简单的表达式避免复杂嵌套
-        if field_type:
-            # 由于JSONPath的复杂性，这里分两步进行查询
-            query = "$[?(@.kind=='struct' || @.kind=='union')]"
-            results = self.find_types_by_jsonpath(query, scope=scope)
-            # 手动过滤结果
-            return [t for t in results if 'fields' in t and 
-                    any(f.get('name') == field_name and f.get('type') == field_type 
-                        for f in t['fields'] if isinstance(f, dict))]
-        else:
-            query = "$[?(@.kind=='struct' || @.kind=='union')]"
-            results = self.find_types_by_jsonpath(query, scope=scope)
-            # 手动过滤结果
-            return [t for t in results if 'fields' in t and 
-                    any(f.get('name') == field_name for f in t['fields'] if isinstance(f, dict))]
+        results = []
+        for index in self._get_indexes(scope):
+            for type_info in index.by_field(field_name):
+                if type_info.get('kind') not in ('struct', 'union'):
+                    continue
+                if field_type and not any(
+                    isinstance(f, dict) and f.get('name') == field_name and f.get('type') == field_type
+                    for f in type_info['fields']
+                ):
+                    continue
+                results.append(type_info)
+        return results
 
     def find_types_by_size(self, size: int, scope: str = 'all') -> List[Dict[str, Any]]:
         """查找指定大小的所有类型
@@ -1400,8 +1839,9 @@ class TypeManager:
         Returns:
             匹配的类型列表
         """
-        query = f"$[?(@.size=={size})]"
-        results = self.find_types_by_jsonpath(query, scope=scope)
+        results = []
+        for index in self._get_indexes(scope):
+            results.extend(index.by_size(size))
         
         # 检查基本类型
         if scope == 'all' or scope == 'global':
@@ -0,0 +1,76 @@
+from collections.abc import Mapping
+from typing import Dict, Any, Iterator, Optional
+
+__all__ = ['TypeRef']
+
+
+class TypeRef(Mapping):
+    """变量的类型引用，访问时才解析为完整的类型信息
+
+    只保存类型名和变量自身的修饰信息（限定符、存储类、指针层级、数组维度），
+    第一次访问键时调用 TypeManager.resolve_type 并缓存结果。变量存储后
+    调用 release() 丢弃解析结果，之后再访问时重新解析（typedef链解析有缓存），
+    没有初始化器或从不读取类型信息的变量不会解析。
+
+    与 resolve_type 返回的dict可以比较相等；序列化（pickle）时转换为dict，
+    不引用 TypeManager。
+
+    用法示例：
+    ```python
+    typeinfo = TypeRef(type_manager, 'struct Cal', {'pointer_level': 0, 'array_size': [4]})
+    typeinfo['is_struct']   # 此时才解析
+    typeinfo.release()
+    ```
+    """
+
+    __slots__ = ('manager', 'type_name', 'context', '_resolved')
+
+    def __init__(self, manager, type_name: str, context: Optional[Dict[str, Any]] = None):
+        """初始化
+
+        Args:
+            manager: TypeManager
+            type_name: 类型名称
+            context: 传给 resolve_type 的变量修饰信息
+        """
+        self.manager = manager
+        self.type_name = type_name
+        self.context = context
+        self._resolved: Optional[Dict[str, Any]] = None
+
+    def resolve(self) -> Dict[str, Any]:
+        """获取完整的类型信息"""
+        resolved = self._resolved
+        if resolved is None:
+            resolved = self._resolved = self.manager.resolve_type(self.type_name, self.context)
+        return resolved
+
+    @property
+    def is_resolved(self) -> bool:
+        """是否持有解析结果"""
+        return self._resolved is not None
+
+    def release(self) -> None:
+        """丢弃缓存的解析结果，只保留引用"""
+        self._resolved = None
+
+    def __getitem__(self, key: str) -> Any:
+        return self.resolve()[key]
+
+    def get(self, key: str, default: Any = None) -> Any:
+        return self.resolve().get(key, default)
+
+    def __contains__(self, key: object) -> bool:
+        return key in self.resolve()
+
+    def __iter__(self) -> Iterator[str]:
+        return iter(self.resolve())
+
+    def __len__(self) -> int:
+        return len(self.resolve())
+
+    def __repr__(self) -> str:
+        return f"TypeRef({self.type_name!r})"
+
+    def __reduce__(self):
+        return dict, (dict(self.resolve()),)
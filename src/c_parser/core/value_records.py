@@ -0,0 +1,144 @@
+import sys
+from collections.abc import Mapping
+from typing import Dict, Any, Tuple, Iterator
+from .columnar import StructColumns
+
+__all__ = ['StructValue', 'StructValueFactory', 'record_class', 'build_record', 'to_plain']
+
+# 记录类按 (类型名, 字段名) 共享，同一结构体的所有元素使用同一个类
+_record_classes: Dict[Tuple[str, Tuple[Any, ...]], type] = {}
+
+
+class StructValue(Mapping):
+    """结构体/联合体的值
+
+    字段值按定义顺序存放在 __slots__ 中，不为每个元素创建dict，字段名和索引由
+    同一类型的所有元素共享。只读映射接口与解析结果原先使用的dict相同：
+    ``value['x']``、``value.get('x')``、``items()``，与dict比较相等。
+    未初始化的字段不出现在映射中，与部分初始化时的dict结果一致。
+
+    JSON输出时通过 json_default 或 to_plain 转换为dict。
+    """
+
+    __slots__ = ()
+    _type_name: str = ''
+    _fields: Tuple[Any, ...] = ()
+    _index: Dict[Any, int] = {}
+    _slots: Tuple[Any, ...] = ()
+
+    def __getitem__(self, key: Any) -> Any:
+        index = self._index.get(key)
+        if index is None:
+            raise KeyError(key)
+        try:
+            return self._slots[index].__get__(self)
+        except AttributeError:
+            raise KeyError(key) from None
+
+    def __iter__(self) -> Iterator[Any]:
+        for name, slot in zip(self._fields, self._slots):
+            try:
+                slot.__get__(self)
+            except AttributeError:
+                continue
+            yield name
+
+    def __len__(self) -> int:
+        return sum(1 for _ in self)
+
+    def __repr__(self) -> str:
+        return repr(dict(self.items()))
+
+    def __reduce__(self):
+        # 记录类是动态创建的，序列化时按类型名和字段名重新获取
+        return _rebuild, (self._type_name, self._fields, dict(self.items()))
+
+    def to_dict(self) -> Dict[Any, Any]:
+        """递归转换为dict"""
+        return {name: to_plain(value) for name, value in self.items()}
+
+
+def _record_class(type_name: str, fields: Tuple[Any, ...]) -> type:
+    """获取字段固定的记录类"""
+    key = (type_name, fields)
+    cls = _record_classes.get(key)
+    if cls is None:
+        slot_names = tuple(f'_f{i}' for i in range(len(fields)))
+        cls = type('StructValue', (StructValue,), {'__slots__': slot_names})
+        cls._type_name = type_name
+        cls._fields = fields
+        cls._index = {name: i for i, name in reversed(list(enumerate(fields)))}
+        cls._slots = tuple(cls.__dict__[name] for name in slot_names)
+        cls.__qualname__ = f'StructValue[{type_name}]'
+        cls = _record_classes.setdefault(key, cls)
+    return cls
+
+
+def _rebuild(type_name: str, fields: Tuple[Any, ...], values: Dict[Any, Any]) -> Mapping:
+    return build_record(_record_class(type_name, fields), values)
+
+
+def record_class(info: Dict[str, Any]) -> type:
+    """结构体/联合体定义 info 对应的记录类，字段相同的定义共享同一个类"""
+    fields = tuple(sys.intern(f['name']) if isinstance(f.get('name'), str) else f.get('name')
+                   for f in info.get('fields', []))
+    return _record_class(info.get('name') or '', fields)
+
+
+def build_record(cls: type, values: Dict[Any, Any]) -> Mapping:
+    """按字段名填充记录，出现定义之外的键（例如错误的指定初始化）时保留dict"""
+    record = cls.__new__(cls)
+    index, slots = cls._index, cls._slots
+    for name, value in values.items():
+        position = index.get(name)
+        if position is None:
+            return values
+        slots[position].__set__(record, value)
+    return record
+
+
+class StructValueFactory:
+    """按结构体定义创建 StructValue
+
+    定义字典按对象缓存对应的记录类，每个元素只做一次字典查找。
+    """
+
+    def __init__(self):
+        # id(info) -> (info, 记录类)，保留info的引用，id不会被复用
+        self._classes: Dict[int, Tuple[Dict[str, Any], type]] = {}
+
+    def build(self, info: Dict[str, Any], values: Dict[Any, Any]) -> Mapping:
+        """创建结构体/联合体 info 的值
+
+        Args:
+            info: 类型定义（包含 name 和 fields）
+            values: 字段名 -> 值
+
+        Returns:
+            StructValue，values 含有定义之外的键时返回 values 本身
+        """
+        entry = self._classes.get(id(info))
+        if entry is None or entry[0] is not info:
+            entry = self._classes[id(info)] = (info, record_class(info))
+        return build_record(entry[1], values)
+
+
+def to_plain(value: Any) -> Any:
+    """把解析结果中的 StructValue 递归转换为dict，StructColumns 转换为列式dict，
+    其他值原样返回（列表中的元素同样转换）
+
+    Args:
+        value: parsed_value 或其中的一部分
+
+    Returns:
+        只包含dict/list/标量的值
+    """
+    if isinstance(value, StructValue):
+        return value.to_dict()
+    if isinstance(value, StructColumns):
+        return to_plain(value.to_dict())
+    if isinstance(value, list):
+        return [to_plain(item) for item in value]
+    if isinstance(value, dict):
+        return {key: to_plain(item) for key, item in value.items()}
+    return value
@@ -1,14 +1,28 @@
+from collections.abc import Mapping
 from typing import Dict, Any, Optional, List, Tuple, Union
-from utils.logger import logger 
+from utils.logger import logger, log_gate
+from utils.metrics import ParseMetrics, active_metrics, collect_metrics, timed_phase
 from pathlib import Path
 from .core.tree_sitter_utils import TreeSitterUtils
 from .core.data_manager import DataManager
 from .core.expression_parser import ExpressionParser
 from .type_parser import CTypeParser
 from .core.type_manager import TypeManager
+from .core.parse_cache import ParseCache
+from .core.include_resolver import IncludeResolver
+from .core.output_writer import StreamingJsonWriter, json_default
+from .core.value_records import StructValueFactory
+from .core.columnar import ColumnBuilder, StructColumns, numeric_typecode
+from .core.source_chunker import SourceChunker
+from .core.struct_specializer import StructSpecializer
+from .core.type_ref import TypeRef
+from .core.conditional_evaluator import CONDITIONAL_NODES
+from .core.structural_diff import SnapshotBuilder, Snapshot
+from .parallel_decoder import ParallelDecoder
 from tree_sitter import Node
+import array
 import json
-import copy
+import sys
 
 
 class CDataParser:
@@ -22,13 +36,41 @@ class CDataParser:
     5. 集成了原ValueParser的功能
     """
     
-    def __init__(self, type_manager: TypeManager = None):
+    def __init__(self, type_manager: TypeManager = None, parse_cache: ParseCache = None,
+                 include_resolver: IncludeResolver = None, typed_arrays: bool = False,
+                 columnar: bool = False, decode_jobs: int = 1, specialize: bool = True):
+        """初始化数据解析器
+        
+        Args:
+            type_manager: 类型管理器，可选
+            parse_cache: 头文件解析缓存，可选
+            include_resolver: 包含文件解析器，可选
+            typed_arrays: 是否将一维基本数值类型数组保存为 array.array，
+                          大型查找表的内存占用约为列表的1/4到1/8
+            columnar: 是否将一维结构体数组保存为列式的 StructColumns，每个叶子字段一列
+            decode_jobs: 大型数组初始化列表分段解码使用的进程数，1表示不分段，0表示使用所有CPU核，
+                         见 ParallelDecoder
+            specialize: 是否为每个结构体类型生成专用的填充函数，见 StructSpecializer
+        """
         logger.info("=== Initializing CDataParser (Refactored) ===")
         self.type_manager = type_manager or TypeManager()
         self.tree_sitter = TreeSitterUtils.get_instance()
         self.data_manager = DataManager(self.type_manager)
-        self.type_parser = CTypeParser(self.type_manager)
+        self.type_parser = CTypeParser(self.type_manager, parse_cache, include_resolver)
         self.current_file = None
+        self.typed_arrays = typed_arrays
+        self.columnar = columnar
+        self.parallel_decoder = ParallelDecoder(decode_jobs or None) if decode_jobs != 1 else None
+        # parse_file 期间正在收集的统计，见 parse_file_with_metrics
+        self._metrics: Optional[ParseMetrics] = None
+        # 解析期间源码的memoryview，节点文本按字节范围从中切片解码
+        self._source: Optional[memoryview] = None
+        # 分块解析时当前块第一行在文件中的行号
+        self._line_offset = 0
+        # 结构体值使用按类型共享字段名的紧凑记录，见 StructValue
+        self.struct_values = StructValueFactory()
+        # 按结构体类型生成的专用填充函数，specialize=False 时使用通用流程
+        self.specializer = StructSpecializer(self.type_manager) if specialize else None
         
         # 输出类型统计信息
         self._log_initialization_stats()
@@ -36,50 +78,193 @@ class CDataParser:
         
     def _log_initialization_stats(self) -> None:
         """记录初始化统计信息"""
-        type_info = self.data_manager.get_type_info()
+        # 只统计数量，不导出类型表（类型库的条目按需加载）
+        stats = self.type_manager.type_statistics('global')
         logger.info("\nLoaded type definitions:")
-        logger.info(f"- types:   {len(type_info['global']['types'])} items")
-        logger.info(f"- pointer_types:    {len(type_info['global']['pointer_types'])} items")
-        logger.info(f"- macro_definitions:     {len(type_info['global']['macro_definitions'])} items")
+        logger.info(f"- types:   {stats['types']} items")
+        logger.info(f"- pointer_types:    {stats['pointer_types']} items")
+        logger.info(f"- macro_definitions:     {stats['macro_definitions']} items")
         
-    def parse_file(self, source: Union[str, Path]) -> Dict[str, Any]:
+    def parse_file(self, source: Union[str, bytes, Path]) -> Dict[str, Any]:
         """解析C文件
         
         解析步骤：
-        1. 读取文件内容
-        2. 解析类型定义（必须先于变量解析）
-        3. 解析全局变量
+        1. 读取文件内容（原始字节，不做解码）
+        2. 生成语法树（每个文件只解析一次）
+        3. 单次遍历translation_unit，按源码顺序解析类型定义和全局变量
         4. 收集和返回结果
         
+        在 collect_metrics() 内调用时记录各阶段的耗时和计数，见 parse_file_with_metrics。
+        明确知道输入类型时使用 parse_path / parse_text。
+        
         Args:
-            source: C文件路径或者文件内容
+            source: C文件路径（Path）、源码字节或源代码字符串；
+                    兼容旧用法，单行且指向已存在文件的字符串按文件路径处理
             
         Returns:
             Dict[str, Any]: 解析结果，包含类型定义和变量信息
         """
-        logger.info(f"\n=== Parsing File: {source} ===")
+        if isinstance(source, str):
+            if not source:
+                raise ValueError("Empty source")
+            path = self._existing_path(source)
+            if path is not None:
+                source = path
+        return self._parse_source(source)
+    
+    def parse_path(self, path: Union[str, Path]) -> Dict[str, Any]:
+        """解析C文件
+        
+        Args:
+            path: 文件路径
+            
+        Returns:
+            Dict[str, Any]: 解析结果，见 parse_file
+        """
+        return self._parse_source(Path(path))
+    
+    def parse_text(self, text: str) -> Dict[str, Any]:
+        """解析C源代码字符串，不检查字符串是否为路径
+        
+        Args:
+            text: 源代码
+            
+        Returns:
+            Dict[str, Any]: 解析结果，见 parse_file
+        """
+        return self._parse_source(text)
+    
+    def parse_file_chunked(self, path: Union[str, Path],
+                           chunk_size: int = SourceChunker.DEFAULT_CHUNK_SIZE) -> Dict[str, Any]:
+        """分块解析大文件，整个文件和完整的语法树都不会同时保存在内存中
+        
+        文件按顶层声明边界切分（见 SourceChunker），每块单独生成语法树并按源码顺序遍历，
+        之前的块登记的类型定义保存在TypeManager中，对后面的块可见。
+        配合 add_output_writer 使用时变量解析后立即写出，峰值内存与块大小和
+        最大的单个声明相关，与文件大小无关。变量的行号为文件中的行号。
+        
+        Args:
+            path: 文件路径
+            chunk_size: 块的目标大小（字节）
+            
+        Returns:
+            Dict[str, Any]: 解析结果，格式与 parse_file 相同
+        """
+        path = Path(path)
+        logger.info(f"\n=== Parsing File In Chunks: {path} ===")
+        self.current_file = str(path)
+        self.type_parser.current_file = self.current_file
+        self._metrics = metrics = active_metrics()
+        cache_before = self._cache_counters() if metrics is not None else None
         
         try:
-            # Step 1: 读取文件
-            if isinstance(source, str):
-                # 如果source是字符串，检查是否为文件路径
-                if Path(source).exists():
-                    text = self._read_file(source)
-                else:
-                    text = source  # 作为源代码字符串处理
-            else:
-                text = self._read_file(source)
+            with open(path, 'rb') as f:
+                chunks = iter(SourceChunker(f, chunk_size))
+                while True:
+                    with timed_phase('read'):
+                        chunk = next(chunks, None)
+                    if chunk is None:
+                        break
+                    with timed_phase('parse'):
+                        tree = self.tree_sitter.parse(chunk.data)
+                    root = tree.root_node if hasattr(tree, 'root_node') else tree
+                    if metrics is not None:
+                        metrics.count('chunks')
+                        metrics.count('source_bytes', len(chunk.data))
+                        metrics.count('top_level_nodes', len(root.children))
+                    self._source = memoryview(chunk.data)
+                    self._line_offset = self.type_parser.line_offset = chunk.line
+                    self._process_ast_node(root)
+                    # 下一块读取前释放本块的语法树和源码
+                    self._source = None
+                    del tree, root, chunk
             
-            # Step 2: 解析类型定义（必须先于变量解析）
-            logger.info("Step 1: Parsing type definitions...")
-            self.type_parser.parse_declarations(text)
+            result = self.data_manager.get_all_data()
+            self._log_parsing_results(result)
+            if metrics is not None:
+                self._record_metrics(metrics, result, cache_before)
+            logger.info("=== Parsing Complete ===\n")
+            return result
             
-            # Step 3: 解析全局变量
-            logger.info("\nStep 2: Parsing global variables...")
-            ast = self.tree_sitter.parse(text)
+        except Exception as e:
+            logger.exception(f"Failed to parse file {path}: {e}")
+            raise
+        finally:
+            self._metrics = None
+            self._source = None
+            self._line_offset = self.type_parser.line_offset = 0
+    
+    def parse_snapshot(self, path: Union[str, Path], chunk_size: int = SnapshotBuilder.CHUNK_SIZE) -> Snapshot:
+        """分块解析文件并计算结构哈希，用于 diff_snapshots 比较两个版本
+        
+        变量解析后只保留哈希树（数组只保留分组摘要），不保存变量值。
+        
+        Args:
+            path: 文件路径
+            chunk_size: 数组每组的元素数量
+            
+        Returns:
+            Snapshot
+        """
+        builder = SnapshotBuilder(chunk_size)
+        self.add_output_writer(builder)
+        try:
+            self.parse_file_chunked(path)
+        finally:
+            self.data_manager.writers.remove(builder)
+        return builder.finish(self.type_manager)
+    
+    @staticmethod
+    def _existing_path(source: str) -> Optional[Path]:
+        """以字符串传入的文件路径：只有单行、长度合理且文件存在时才视为路径
+        
+        源代码字符串不会触发文件系统检查，超长字符串也不会因为路径过长而出错。
+        """
+        if len(source) > 4096 or '\n' in source or '\0' in source:
+            return None
+        try:
+            path = Path(source)
+            return path if path.is_file() else None
+        except (OSError, ValueError):
+            return None
+    
+    def _parse_source(self, source: Union[str, bytes, Path]) -> Dict[str, Any]:
+        """解析文件、源码字节或源代码字符串"""
+        label = source if isinstance(source, Path) else f"<source: {len(source)} characters>"
+        logger.info(f"\n=== Parsing File: {label} ===")
+        self._metrics = metrics = active_metrics()
+        cache_before = self._cache_counters() if metrics is not None else None
+        
+        try:
+            # Step 1: 读取文件，文件内容只保存这一份bytes，语法树和节点文本共用
+            with timed_phase('read'):
+                if isinstance(source, Path):
+                    data = self._read_source(source)
+                elif isinstance(source, (str, bytes)):
+                    data = source
+                else:
+                    raise TypeError(f"Unsupported source type: {type(source)}")
+            self._source = memoryview(data) if isinstance(data, bytes) else None
+            
+            # Step 2: 生成语法树，类型解析和变量解析共享同一棵树
+            logger.info("Step 1: Parsing syntax tree...")
+            with timed_phase('parse'):
+                ast = self.tree_sitter.parse(data)
             # 如果ast是Tree对象，获取其root_node
             if hasattr(ast, 'root_node'):
                 ast = ast.root_node
+            if metrics is not None:
+                source_bytes = len(data) if isinstance(data, bytes) else getattr(ast, 'end_byte', None)
+                if isinstance(source_bytes, int):
+                    metrics.count('source_bytes', source_bytes)
+                metrics.count('top_level_nodes', len(ast.children))
+                descendants = getattr(ast, 'descendant_count', None)
+                if isinstance(descendants, int):
+                    metrics.count('syntax_nodes', descendants)
+            
+            # Step 3: 单次遍历解析类型定义和全局变量
+            logger.info("\nStep 2: Parsing type definitions and global variables...")
+            self.type_parser.current_file = self.current_file or "input_source"
             self._parse_global_variables(ast)
             
             # Step 4: 收集结果
@@ -88,44 +273,107 @@ class CDataParser:
             
             # 输出统计信息
             self._log_parsing_results(result)
+            if metrics is not None:
+                self._record_metrics(metrics, result, cache_before)
             
             logger.info("=== Parsing Complete ===\n")
             return result
             
         except Exception as e:
-            logger.exception(f"Failed to parse file {source}: {e}")
+            logger.exception(f"Failed to parse file {label}: {e}")
             raise
+        finally:
+            self._metrics = None
+            self._source = None
+    
+    def parse_file_with_metrics(self, source: Union[str, Path]) -> Tuple[Dict[str, Any], ParseMetrics]:
+        """解析C文件并返回本次解析的统计
+        
+        Args:
+            source: C文件路径或者文件内容
+            
+        Returns:
+            (解析结果, ParseMetrics)：阶段耗时 read/parse/type_walk/variable_walk/initializer_decode，
+            节点和变量计数，类型缓存命中率和峰值RSS
+        """
+        with collect_metrics() as metrics:
+            with metrics.phase('total'):
+                result = self.parse_file(source)
+        return result, metrics
+    
+    def _cache_counters(self) -> Dict[str, Tuple[int, int]]:
+        """当前各缓存的累计 (命中, 未命中)"""
+        counters = self.type_manager.cache_stats()
+        parse_cache = self.type_parser.parse_cache
+        if parse_cache is not None:
+            counters['header_cache'] = (parse_cache.hits, parse_cache.misses)
+        return counters
+    
+    def _record_metrics(self, metrics: ParseMetrics, result: Dict[str, Any],
+                        cache_before: Dict[str, Tuple[int, int]]) -> None:
+        """记录变量和类型数量，以及本次解析期间各缓存的命中情况"""
+        for category, count in self.data_manager.variable_counts.items():
+            metrics.count(category, count)
+        metrics.count('types', sum(len(result.get(kind, [])) for kind in ('structs', 'unions', 'enums', 'typedefs')))
+        for name, (hits, misses) in self._cache_counters().items():
+            hits_before, misses_before = cache_before.get(name, (0, 0))
+            metrics.record_cache(name, hits - hits_before, misses - misses_before)
     
-    def _read_file(self, file_path: str) -> str:
-        """读取文件内容"""
+    def _read_source(self, file_path: Union[str, Path]) -> bytes:
+        """读取文件的原始字节"""
         file_path_obj = Path(file_path)
         self.current_file = str(file_path_obj)
         
         try:
-            text = file_path_obj.read_text(encoding='utf-8')
-            logger.debug(f"成功读取文件: {file_path_obj}")
-            logger.debug(f"文件内容长度: {len(text)}")
-            logger.debug(f"文件内容预览: {text[:200]}...")
-            return text
+            data = file_path_obj.read_bytes()
+            if log_gate.debug:
+                logger.debug(f"成功读取文件: {file_path_obj}")
+                logger.debug(f"文件内容长度: {len(data)} 字节")
+            return data
         except Exception as e:
             logger.error(f"读取文件失败: {file_path_obj}, 错误: {e}")
             raise
     
+    def _read_file(self, file_path: Union[str, Path]) -> str:
+        """读取文件内容并解码为文本"""
+        return self._read_source(file_path).decode('utf-8')
+    
+    def _node_text(self, node: Node) -> str:
+        """节点文本，解析文件时直接从源码字节中按范围解码"""
+        return self.tree_sitter.get_node_text(node, self._source)
+    
+    def add_output_writer(self, writer) -> None:
+        """添加流式输出，变量解析完成后立即写出而不再保存在DataManager中
+        
+        Args:
+            writer: StreamingJsonWriter 或提供 write_variable(var_info, category) 的对象
+        """
+        self.data_manager.add_writer(writer)
+    
     def _log_parsing_results(self, result: Dict[str, Any]) -> None:
         """记录解析结果统计信息"""
+        # 流式输出时变量不保存在结果中，使用DataManager的计数
+        if self.data_manager.writers:
+            counts = self.data_manager.variable_counts
+        else:
+            counts = {category: len(items) for category, items in result['variables'].items()}
         logger.info("\nParsing results:")
         logger.info(f"- Structs:    {len(result['structs'])} items")
         logger.info(f"- Unions:     {len(result['unions'])} items")
         logger.info(f"- Enums:      {len(result['enums'])} items")
         logger.info(f"- Typedefs:   {len(result['typedefs'])} items")
-        logger.info(f"- Variables:  {len(result['variables']['variables'])} items")
-        logger.info(f"- Arrays:     {len(result['variables']['array_vars'])} items")
-        logger.info(f"- Pointers:   {len(result['variables']['pointer_vars'])} items")
-        logger.info(f"- Struct vars: {len(result['variables']['struct_vars'])} items")
+        logger.info(f"- Variables:  {counts['variables']} items")
+        logger.info(f"- Arrays:     {counts['array_vars']} items")
+        logger.info(f"- Pointers:   {counts['pointer_vars']} items")
+        logger.info(f"- Struct vars: {counts['struct_vars']} items")
         
     def _parse_global_variables(self, ast_node: Node) -> None:
         """解析全局变量定义
         
+        与类型定义的解析合并为一次遍历：顶层节点先交给类型解析器登记其中的
+        类型定义，再判断是否为变量声明。C语言要求类型先定义后使用，按源码
+        顺序处理即可保证变量解析时类型已经登记。
+        
         Args:
             ast_node: AST根节点
         """
@@ -139,23 +387,51 @@ class CDataParser:
             raise
         
     def _process_ast_node(self, node: Node) -> None:
-        """处理AST节点，递归查找变量声明
+        """处理AST节点，登记类型定义并递归查找变量声明
         
         Args:
             node: 要处理的AST节点
         """
         try:
-            for child in node.children:
-                if child.type == 'declaration':
-                    if self._is_variable_declaration(child):
-                        self._parse_variable_declaration(child)
-                elif child.type == 'translation_unit':
-                    self._process_ast_node(child)  # 递归处理
+            for child in TreeSitterUtils.iter_children(node):
+                self._process_top_level_node(child)
             
         except Exception as e:
             logger.exception(f"Failed to process AST node: {e}")
             raise
     
+    def _process_top_level_node(self, node: Node) -> None:
+        """处理单个顶层节点：登记类型定义，变量声明解析后存入DataManager
+        
+        增量解析（IncrementalParser）只对修改过的顶层节点调用。
+        
+        Args:
+            node: translation_unit 的子节点
+        """
+        if node.type == 'translation_unit':
+            self._process_ast_node(node)  # 递归处理
+            return
+        conditions = self.type_parser.conditions
+        if node.type in CONDITIONAL_NODES and conditions is not None:
+            # 条件成立的分支中的声明与顶层声明相同处理
+            for child in conditions.active_children(node):
+                self._process_top_level_node(child)
+            return
+        
+        metrics = self._metrics
+        if metrics is None:
+            # 类型定义（typedef/struct/union/enum/宏）
+            self.type_parser.parse_tree(node)
+            if node.type == 'declaration' and self._is_variable_declaration(node):
+                self._parse_variable_declaration(node)
+            return
+        
+        with metrics.phase('type_walk'):
+            self.type_parser.parse_tree(node)
+        if node.type == 'declaration' and self._is_variable_declaration(node):
+            with metrics.phase('variable_walk'):
+                self._parse_variable_declaration(node)
+    
     def _is_variable_declaration(self, node: Node) -> bool:
         """判断是否为变量声明（而不是函数声明）"""
         try:    
@@ -179,9 +455,10 @@ class CDataParser:
             node: 变量声明的AST节点
         """
         try:
-            node_text = self.tree_sitter.get_node_text(node)
-            display_text = node_text[:100] + '...' if len(node_text) > 100 else node_text
-            logger.info(f"\n=== Parsing Variable Declaration (AST-based): {display_text} ===")
+            if log_gate.debug:
+                node_text = self._node_text(node)
+                display_text = node_text[:100] + '...' if len(node_text) > 100 else node_text
+                logger.debug(f"=== Parsing Variable Declaration (AST-based): {display_text} ===")
             
             # 初始化变量信息
             variable_info = self._init_variable_info(node)
@@ -222,7 +499,8 @@ class CDataParser:
             node: 变量声明的AST节点
             variable_info: 变量信息字典
         """
-        logger.debug(f"Parsing variable from AST node: {node.type}")
+        if log_gate.debug:
+            logger.debug(f"Parsing variable from AST node: {node.type}")
         
         # 第一步：解析类型限定符和存储类
         self._extract_qualifiers_and_storage(node, variable_info)
@@ -246,7 +524,7 @@ class CDataParser:
         """提取类型限定符和存储类信息"""
         for child in node.children:
             if child.type == 'type_qualifier':
-                qualifier = self.tree_sitter.get_node_text(child)
+                qualifier = self._node_text(child)
                 if qualifier == 'const':
                     variable_info['is_const'] = True
                 elif qualifier == 'volatile':
@@ -254,7 +532,7 @@ class CDataParser:
                 elif qualifier == 'restrict':
                     variable_info['is_restrict'] = True
             elif child.type == 'storage_class_specifier':
-                variable_info['storage_class'] = self.tree_sitter.get_node_text(child)
+                variable_info['storage_class'] = self._node_text(child)
     
     def _extract_base_type(self, node: Node, variable_info: Dict[str, Any]) -> None:
         """提取基础类型信息"""
@@ -262,7 +540,7 @@ class CDataParser:
         
         for child in node.children:
             if child.type in ['primitive_type', 'sized_type_specifier', 'type_identifier']:
-                type_parts.append(self.tree_sitter.get_node_text(child))
+                type_parts.append(self._node_text(child))
             elif child.type in ['struct_specifier', 'union_specifier', 'enum_specifier']:
                 # 处理复合类型
                 type_name = self._extract_composite_type_name(child)
@@ -270,10 +548,12 @@ class CDataParser:
                     type_parts.append(type_name)
         
         if type_parts:
-            base_type = ' '.join(type_parts)
+            # 类型名在所有同类型变量之间共享
+            base_type = sys.intern(' '.join(type_parts))
             variable_info['type'] = base_type
   
-            logger.debug(f"Extracted base type: {base_type}")
+            if log_gate.debug:
+                logger.debug(f"Extracted base type: {base_type}")
    
     def _extract_composite_type_name(self, node: Node) -> Optional[str]:
         """提取复合类型名称（struct/union/enum）"""
@@ -282,7 +562,7 @@ class CDataParser:
         # 查找类型标识符
         for child in node.children:
             if child.type == 'type_identifier':
-                name = self.tree_sitter.get_node_text(child)
+                name = self._node_text(child)
                 return f"{prefix} {name}"
         
         # 如果没有名称，可能是匿名类型
@@ -299,21 +579,18 @@ class CDataParser:
             raise ValueError(f"No declarator node found for variable: {variable_info['name']}")
     
     def _find_main_declarator(self, node: Node) -> Optional[Node]:
-        """查找主要的声明符节点"""
-        for child in node.children:
-            if child.type == 'init_declarator':
-                # 从init_declarator中查找声明符
-                for init_child in child.children:
-                    if init_child.type in ['identifier', 'pointer_declarator', 'array_declarator']:
-                        return init_child
-            elif child.type in ['identifier', 'pointer_declarator', 'array_declarator']:
-                return child
+        """查找主要的声明符节点：声明的第一个 declarator 字段，带初始化时取其中的 declarator"""
+        declarator = node.child_by_field_name('declarator')
+        if declarator is not None and declarator.type == 'init_declarator':
+            declarator = declarator.child_by_field_name('declarator')
+        if declarator is not None and declarator.type in ('identifier', 'pointer_declarator', 'array_declarator'):
+            return declarator
         return None
     
     def _parse_declarator_node(self, declarator_node: Node, variable_info: Dict[str, Any]) -> None:
         """解析声明符节点"""
         if declarator_node.type == 'identifier':
-            variable_info['name'] = self.tree_sitter.get_node_text(declarator_node)
+            variable_info['name'] = self._node_text(declarator_node)
             
         elif declarator_node.type == 'pointer_declarator':
             self._parse_pointer_declarator(declarator_node, variable_info)
@@ -333,7 +610,7 @@ class CDataParser:
             
             for child in current_node.children:
                 if child.type == 'identifier':
-                    variable_info['name'] = self.tree_sitter.get_node_text(child)
+                    variable_info['name'] = self._node_text(child)
                     break
                 elif child.type in ['pointer_declarator', 'array_declarator']:
                     next_node = child
@@ -348,7 +625,8 @@ class CDataParser:
         variable_info['is_pointer'] = pointer_level > 0
         variable_info['pointer_level'] = pointer_level
         
-        logger.debug(f"Parsed pointer: level={pointer_level}, name={variable_info['name']}")
+        if log_gate.debug:
+            logger.debug(f"Parsed pointer: level={pointer_level}, name={variable_info['name']}")
     
     def _parse_array_declarator(self, node: Node, variable_info: Dict[str, Any]) -> None:
         """解析数组声明符"""
@@ -365,7 +643,7 @@ class CDataParser:
             next_node = None
             for child in current_node.children:
                 if child.type == 'identifier':
-                    variable_info['name'] = self.tree_sitter.get_node_text(child)
+                    variable_info['name'] = self._node_text(child)
                 elif child.type in ['array_declarator', 'pointer_declarator']:
                     next_node = child
                     break
@@ -381,7 +659,8 @@ class CDataParser:
         
         variable_info['array_size'] = array_sizes
         
-        logger.debug(f"Parsed array: sizes={array_sizes}, name={variable_info['name']}")
+        if log_gate.debug:
+            logger.debug(f"Parsed array: sizes={array_sizes}, name={variable_info['name']}")
     
     def _extract_array_dimension(self, array_node: Node) -> Union[int, str, None]:
         """提取数组维度"""
@@ -399,14 +678,10 @@ class CDataParser:
                 'decimal_literal', 'binary_expression','preproc_arg'
             ] or( array_close[0] and array_close[0] != array_close[1]):
                 try:
-                    raw_value = self.tree_sitter.get_node_text(child)
+                    raw_value = self._node_text(child)
                     
-                    # 使用ExpressionParser解析
-                    parsed_value, value_type = ExpressionParser.parse(
-                        raw_value,
-                        self.type_manager.get_enum_values(),
-                        self.type_manager.get_macro_definition()
-                    )
+                    # 使用TypeManager的符号表解析
+                    parsed_value, value_type = self.type_manager.evaluate_expression(raw_value)
                     
                     if isinstance(parsed_value, (int, float)):
                         array_size = int(parsed_value)
@@ -415,7 +690,7 @@ class CDataParser:
                         
                 except Exception as e:
                     logger.warning(f"Could not parse array size expression: {raw_value}, error: {e}")
-                    array_size = self.tree_sitter.get_node_text(child)
+                    array_size = self._node_text(child)
 
         if array_close[0] != array_close[1]:
             raise ValueError(f"Array dimension mismatch: {array_close}")
@@ -426,7 +701,7 @@ class CDataParser:
         """提取简单标识符（当没有声明符时）"""
         for child in node.children:
             if child.type == 'identifier':
-                variable_info['name'] = self.tree_sitter.get_node_text(child)
+                variable_info['name'] = self._node_text(child)
                 break
     
     def _extract_initializer(self, node: Node, variable_info: Dict[str, Any]) -> None:
@@ -448,8 +723,9 @@ class CDataParser:
                 'number_literal', 'string_literal', 'char_literal'
             ]:
                 variable_info['initializer_node'] = child
-                variable_info['initial_value'] = self.tree_sitter.get_node_text(child)
-                logger.debug(f"Found initializer: {variable_info['initial_value']}")
+                variable_info['initial_value'] = self._node_text(child)
+                if log_gate.debug:
+                    logger.debug(f"Found initializer: {variable_info['initial_value']}")
                 break
     
     def _build_complete_type_info(self, variable_info: Dict[str, Any]) -> None:
@@ -475,10 +751,11 @@ class CDataParser:
             'array_size': array_sizes
         }
         
-        resolved_info = self.type_manager.resolve_type(variable_info['type'], type_context)
-        variable_info['typeinfo'] = resolved_info
+        # 访问时才解析，变量存储后只保留引用，见 TypeRef
+        variable_info['typeinfo'] = TypeRef(self.type_manager, variable_info['type'], type_context)
     
-        logger.debug(f"Built complete type: {variable_info['type']}")
+        if log_gate.debug:
+            logger.debug(f"Built complete type: {variable_info['type']}")
     
     def _parse_initialization_value(self, variable_info: Dict[str, Any]) -> None:
         """解析初始化值"""
@@ -492,7 +769,11 @@ class CDataParser:
             # 根据节点类型进行解析
             if initializer_node.type == 'initializer_list':
                 # 初始化列表：执行两步解析
-                parsed_value = self._parse_initializer_direct(initializer_node, variable_info)
+                if self._metrics is not None:
+                    with self._metrics.phase('initializer_decode'):
+                        parsed_value = self._parse_initializer_direct(initializer_node, variable_info)
+                else:
+                    parsed_value = self._parse_initializer_direct(initializer_node, variable_info)
             else:
                 # 其他类型：直接解析
                 parsed_value = self._parse_value_from_node(initializer_node)
@@ -506,8 +787,10 @@ class CDataParser:
     def _parse_initializer_direct(self, node: Node, variable_info: Dict[str, Any]) -> Any:
         """直接解析初始化器：两步解析法"""
 
-        if variable_info['name'] == "test_data_values":
-            logger.info("")
+        if self.parallel_decoder is not None and variable_info.get('array_size'):
+            parsed_value = self._parse_initializer_parallel(node, variable_info)
+            if parsed_value is not None:
+                return parsed_value
 
         # 第一步：按C语言语法解析原始数据
         raw_data = self._parse_raw_initializer(node)
@@ -523,6 +806,83 @@ class CDataParser:
         
         return parsed_value
         
+    def _parse_initializer_parallel(self, node: Node, variable_info: Dict[str, Any]) -> Optional[Any]:
+        """在多个进程中分段解码大型数组的初始化列表，结果与 _wapper_raw_data 相同
+        
+        Returns:
+            解析结果，不满足分段条件时返回None，由调用方按原流程解码
+        """
+        array_size = variable_info['array_size']
+        # C语言只允许省略第一维，其余维度从初始化器推断时按原流程处理
+        if 'dynamic' in array_size[1:]:
+            return None
+        element_info = dict(variable_info)
+        element_info['array_size'] = array_size[1:]
+        elements = self.parallel_decoder.decode(self, node, element_info)
+        if elements is None:
+            return None
+        
+        del variable_info['initializer_node']
+        if array_size[0] == 'dynamic':
+            array_size[0] = len(elements)
+        elements = elements[:array_size[0]]
+        
+        typeinfo = variable_info['typeinfo']
+        if not self._is_composite_value(typeinfo):
+            if self.typed_arrays and len(array_size) == 1:
+                return self._to_typed_array(elements, typeinfo)
+            return elements
+        if self.columnar and len(array_size) == 1 and typeinfo.get('is_struct'):
+            builder = ColumnBuilder(self.type_manager, typeinfo['info'])
+            for element in elements:
+                builder.append(element)
+            return builder.build()
+        return elements
+    
+    def decode_element_span(self, span: bytes, element_info: Dict[str, Any]) -> List[Any]:
+        """解码初始化列表中一段连续元素的源码，由 ParallelDecoder 的工作进程调用
+        
+        Args:
+            span: 元素的源码（含元素之间的逗号）
+            element_info: 单个元素的变量信息
+            
+        Returns:
+            各元素的值，与完整列表按原流程解码后的对应部分相同
+        """
+        source = b'int __slice[] = {' + span + b'\n};'
+        previous, self._source = self._source, memoryview(source)
+        try:
+            tree = self.tree_sitter.parse(source)
+            root = tree.root_node if hasattr(tree, 'root_node') else tree
+            raw_data = self._parse_raw_initializer(self._find_initializer_list(root))
+        finally:
+            self._source = previous
+        if not self._is_composite_value(element_info['typeinfo']):
+            return raw_data
+        return [self._wapper_raw_data(item, element_info) for item in raw_data]
+    
+    @staticmethod
+    def _find_initializer_list(root: Node) -> Node:
+        """decode_element_span 生成的声明中的初始化列表"""
+        declarator = root.children[0].child_by_field_name('declarator')
+        return declarator.child_by_field_name('value')
+    
+    @staticmethod
+    def _is_composite_value(typeinfo: Dict[str, Any]) -> bool:
+        """元素是否需要按结构体/联合体定义填充"""
+        return (typeinfo.get('is_struct', False) or typeinfo.get('is_union', False)) \
+            and not typeinfo.get('is_pointer', False)
+    
+    def source_view(self, node: Node) -> Tuple[memoryview, int]:
+        """节点所在源码的字节视图
+        
+        Returns:
+            (memoryview, 视图第一个字节在源码中的偏移)
+        """
+        if self._source is not None:
+            return self._source, 0
+        return memoryview(node.text), node.start_byte
+    
     def _wapper_raw_data(self, raw_data: Union[List[Any], Any], variable_info: Dict[str, Any]) -> List[Any]:
         """将原始数据转换为JSON格式"""
 
@@ -531,20 +891,25 @@ class CDataParser:
         is_union = variable_info['typeinfo'].get('is_union', False)
         is_pointer = variable_info['typeinfo'].get('is_pointer', False)
 
+        if array_size and not ((is_struct or is_union) and not is_pointer):
+            # 基本类型数组：元素无需按类型填充，直接截取
+            values = raw_data[:array_size[0]]
+            if self.typed_arrays and len(array_size) == 1:
+                return self._to_typed_array(values, variable_info['typeinfo'])
+            return values
+        
         if array_size:
-            # 变量定义为数组：使用数组展开函数
+            # 变量定义为数组：使用数组展开函数，元素只需要去掉第一维的维度，类型信息共享
             child_size = array_size[0]
-            variable_info_child = copy.deepcopy(variable_info)
-            variable_info_child['array_size'].pop(0)   
+            variable_info_child = dict(variable_info)
+            variable_info_child['array_size'] = array_size[1:]
+            if self.columnar and len(array_size) == 1 and is_struct:
+                return self._to_columns(raw_data[:child_size], variable_info_child)
 
             expanded_data = []
             raw_data_length = len(raw_data)
             for i in range(min(child_size, raw_data_length)):
-                if (is_struct or is_union) and not is_pointer:
-                    data = self._wapper_raw_data(raw_data[i], variable_info_child)
-                else:
-                    data = raw_data[i]
-                expanded_data.append(data) 
+                expanded_data.append(self._wapper_raw_data(raw_data[i], variable_info_child))
             return expanded_data
         
         elif (is_struct or is_union) and not is_pointer:
@@ -552,13 +917,49 @@ class CDataParser:
         else:
             return raw_data
 
+    def _to_typed_array(self, values: List[Any], typeinfo: Dict[str, Any]) -> Union[array.array, List[Any]]:
+        """将一维基本数值类型数组转换为 array.array，无法转换时保持列表"""
+        typecode = numeric_typecode(typeinfo, self.type_manager.BASIC_TYPES)
+        if typecode is None:
+            return values
+        try:
+            return array.array(typecode, values)
+        except (TypeError, OverflowError):
+            # 包含表达式字符串或超出范围的值
+            return values
+    
+    def _to_columns(self, items: List[Any], variable_info: Dict[str, Any]) -> StructColumns:
+        """将一维结构体数组逐个元素填充后写入列，不保留行式的元素"""
+        builder = ColumnBuilder(self.type_manager, variable_info['typeinfo']['info'])
+        for item in items:
+            builder.append(self._fill_field_data(item, variable_info))
+        if log_gate.debug:
+            logger.debug(f"Stored {builder.length} elements of {builder.type_name} as columns")
+        return builder.build()
+    
+    def _parse_fast_literal(self, node: Node) -> Any:
+        """快速解析数字字面量及其取负，跳过ExpressionParser
+        
+        Returns:
+            数值，节点不是简单字面量时返回None
+        """
+        if node.type == 'number_literal':
+            return ExpressionParser.parse_number_literal(node.text)
+        # -1 这类负数字面量在语法树中是一元表达式
+        children = node.children
+        if len(children) == 2 and children[0].type == '-' and children[1].type == 'number_literal':
+            value = ExpressionParser.parse_number_literal(children[1].text)
+            return -value if value is not None else None
+        return None
+    
     def _parse_value_from_node(self, node: Node) -> Any:
         """从AST节点解析值 - 原ValueParser的核心功能"""
         try:
             if not node:
                 return None
                 
-            logger.debug(f"Parsing value from node type: {node.type}")
+            if log_gate.debug:
+                logger.debug(f"Parsing value from node type: {node.type}")
             
             # 根据节点类型进行解析
             if node.type in ['number_literal', 'hex_literal', 'octal_literal', 'binary_literal']:
@@ -599,6 +1000,10 @@ class CDataParser:
                 result.append(nested_value)
             elif child.type == 'sizeof_expression':
                 result.append(child.text.decode('utf8'))
+            elif child.type in ('number_literal', 'unary_expression'):
+                # 数值表的主要元素，只有无法快速解析的才走通用路径
+                value = self._parse_fast_literal(child)
+                result.append(value if value is not None else self._parse_value_from_node(child))
             elif self._is_value_node(child):
                 # 单个值
                 value = self._parse_value_from_node(child)
@@ -606,8 +1011,8 @@ class CDataParser:
         
         return result
     
-    def _fill_field_data(self, raw_data: List[Any], variable_info: Dict[str, Any] = None) -> Dict[str, Any]:
-        """根据结构定义填充数据"""
+    def _fill_field_data(self, raw_data: List[Any], variable_info: Dict[str, Any] = None) -> Mapping:
+        """根据结构定义填充数据，返回按类型共享字段名的 StructValue"""
         info = variable_info['typeinfo'].get('info')
         if not info or 'fields' not in info:
             raise ValueError(f"No  fields found for struct: {variable_info['typeinfo'].get('type', 'unknown')}")
@@ -622,53 +1027,53 @@ class CDataParser:
             fields = union_fields
         else:
             fields = info['fields']
-            
+
+        if self.specializer is not None:
+            return self.specializer.decoder(info, fields)(raw_data, self._wapper_raw_data, self._fill_field_data)
+
         result = {}
         for i in range(min(len(fields), len(raw_data))):
             field = fields[i]
             field_name = field['name']
             array_size = field['array_size']
-            field_type_info = self.type_manager.resolve_type(field['type'])
-            is_struct = field_type_info['is_struct']
-            is_union = field_type_info['is_union']
-            is_pointer = field_type_info['is_pointer']
+            # 字段类型的解析结果按类型名共享，不为每个元素复制
+            field_type_info = self.type_manager.resolve_type_shared(field['type'])
+            is_composite = field_type_info['is_struct'] or field_type_info['is_union']
             field_raw_value = raw_data[i]
 
-            field_variable_info = {
-                'name': field_name, 
-                'type': field['type'], 
-                'array_size': array_size,
-                'typeinfo': field_type_info
-                }
-
-            if array_size and (is_struct or is_union):
-                result[field_name] = self._wapper_raw_data(field_raw_value, field_variable_info)
-            elif (is_struct or is_union) and not is_pointer:
-                result[field_name] = self._fill_field_data(field_raw_value, field_variable_info)
+            if is_composite and (array_size or not field_type_info['is_pointer']):
+                # 只有嵌套的结构体/联合体需要字段的变量信息
+                field_variable_info = {
+                    'name': field_name, 
+                    'type': field['type'], 
+                    'array_size': array_size,
+                    'typeinfo': field_type_info
+                    }
+                if array_size:
+                    result[field_name] = self._wapper_raw_data(field_raw_value, field_variable_info)
+                else:
+                    result[field_name] = self._fill_field_data(field_raw_value, field_variable_info)
             elif isinstance(field_raw_value, dict):
                 result.update(field_raw_value)
             else:
                 result[field_name] = field_raw_value
             
-        return result
+        return self.struct_values.build(info, result)
     def _parse_literal_or_identifier_node(self, node: Node, fallback_handler=None) -> Any:
-        """统一解析字面量和标识符节点 - 使用 ExpressionParser"""
-        text = self.tree_sitter.get_node_text(node)
+        """统一解析字面量和标识符节点 - 使用 TypeManager 的符号表求值"""
+        text = self._node_text(node)
         
         try:
-            # 统一使用 ExpressionParser 处理所有类型
-            value, _ = ExpressionParser.parse(
-                text,
-                self.type_manager.get_enum_values() if self.type_manager else {},
-                self.type_manager.get_macro_definition() if self.type_manager else {}
-            )
+            # 统一使用 TypeManager.evaluate_expression 处理所有类型
+            value, _ = self.type_manager.evaluate_expression(text)
             return value
         except Exception as e:
             # 如果 ExpressionParser 失败，使用后备处理器
             if fallback_handler:
                 return fallback_handler(text)
             else:
-                logger.debug(f"Failed to parse {node.type} '{text}': {e}")
+                if log_gate.debug:
+                    logger.debug(f"Failed to parse {node.type} '{text}': {e}")
                 return text
     
     def _parse_assignment_expression_node(self, node: Node) -> Any:
@@ -689,13 +1094,13 @@ class CDataParser:
                     # 获取字段名 {.field = value}
                     for designator_child in child.children:
                         if designator_child.type == 'field_identifier':
-                            field_name = self.tree_sitter.get_node_text(designator_child)
+                            field_name = self._node_text(designator_child)
                             break
                 elif child.type == 'subscript_designator':
                     # 获取数组索引 {[index] = value}
                     for designator_child in child.children:
                         if designator_child.type in ['number_literal', 'identifier']:
-                            index_text = self.tree_sitter.get_node_text(designator_child)
+                            index_text = self._node_text(designator_child)
                             try:
                                 field_name = int(index_text)
                             except ValueError:
@@ -731,7 +1136,8 @@ class CDataParser:
             dim_length = len(array_sizes)
             current_data = parsed_value
             
-            logger.debug(f"Inferring array sizes for {variable_info['name']}, current sizes: {array_sizes}, data length: {len(current_data)}")
+            if log_gate.debug:
+                logger.debug(f"Inferring array sizes for {variable_info['name']}, current sizes: {array_sizes}, data length: {len(current_data)}")
             
             # 遍历每个维度，推断动态大小
             for i in range(dim_length):
@@ -739,7 +1145,8 @@ class CDataParser:
                 if dim_size == 'dynamic' and isinstance(current_data, list):
                     inferred_size = len(current_data)
                     array_sizes[i] = inferred_size
-                    logger.debug(f"Inferred dimension {i} size: {inferred_size}")
+                    if log_gate.debug:
+                        logger.debug(f"Inferred dimension {i} size: {inferred_size}")
                     
                     # 移动到下一层数据（如果存在嵌套数组）
                     if current_data and isinstance(current_data[0], list):
@@ -749,22 +1156,24 @@ class CDataParser:
                 elif dim_size == 'dynamic':
                     # 如果不是列表，说明是单个元素，推断为1
                     array_sizes[i] = 1
-                    logger.debug(f"Inferred dimension {i} size: 1 (single element)")
+                    if log_gate.debug:
+                        logger.debug(f"Inferred dimension {i} size: 1 (single element)")
                     break
             
-            logger.debug(f"Final array sizes for {variable_info['name']}: {array_sizes}")
+            if log_gate.debug:
+                logger.debug(f"Final array sizes for {variable_info['name']}: {array_sizes}")
             
         except Exception as e:
             logger.warning(f"Failed to infer array dimensions for {variable_info['name']}: {e}")
     
     def _log_and_store_variable(self, variable_info: Dict[str, Any]) -> None:
         """记录和存储变量信息"""
-        logger.info(f"Parsed variable: {variable_info['name']}, "
-                    f"Type: {variable_info.get('type')}, "
-                    f"Value: {variable_info['initial_value']}")
-        
-        if variable_info['parsed_value'] is not None:
-            logger.debug(f"Structured data: {json.dumps(variable_info['parsed_value'], indent=2, default=str)}")
+        if log_gate.debug:
+            logger.debug(f"Parsed variable: {variable_info['name']}, "
+                         f"Type: {variable_info.get('type')}, "
+                         f"Value: {variable_info['initial_value']}")
+            if variable_info['parsed_value'] is not None:
+                logger.debug(f"Structured data: {json.dumps(variable_info['parsed_value'], indent=2, default=json_default)}")
         
         # 创建一个副本用于存储，移除不可序列化的 AST 节点
         storable_info = variable_info.copy()
@@ -772,13 +1181,16 @@ class CDataParser:
             del storable_info['initializer_node']
         
         self.data_manager.add_variable(storable_info)
+        typeinfo = storable_info.get('typeinfo')
+        if isinstance(typeinfo, TypeRef):
+            typeinfo.release()
     
     def _get_node_location(self, node: Node) -> Dict[str, Any]:
         """获取节点位置信息"""
         line, col = node.start_point
         return {
             'file': self.current_file,
-            'line': line + 1,
+            'line': line + 1 + self._line_offset,
             'column': col
         }
     
@@ -874,19 +1286,20 @@ class CDataParser:
             str: JSON字符串或文件路径
         """
         try:
-            simplified_data = self.get_simplified_output()
-            
             if output_path:
-                # 写入文件
-                import json
+                # 逐个变量写入文件，不生成完整的JSON字符串
                 with open(output_path, 'w', encoding='utf-8') as f:
-                    json.dump(simplified_data, f, indent=2, ensure_ascii=False, default=str)
+                    writer = StreamingJsonWriter(f, 'json', simplified=True, indent=2)
+                    for category in ('struct_vars', 'array_vars', 'pointer_vars', 'variables'):
+                        for var in self.data_manager.variables[category]:
+                            writer.write_variable(var)
+                    writer.close()
                 logger.info(f"Simplified data exported to: {output_path}")
                 return output_path
             else:
                 # 返回JSON字符串
-                import json
-                return json.dumps(simplified_data, indent=2, ensure_ascii=False, default=str)
+                simplified_data = self.get_simplified_output()
+                return json.dumps(simplified_data, indent=2, ensure_ascii=False, default=json_default)
                 
         except Exception as e:
             logger.exception(f"Failed to export simplified JSON: {e}")
@@ -0,0 +1,383 @@
+import bisect
+import time
+from pathlib import Path
+from typing import Dict, Any, Optional, List, Tuple, Union
+from utils.logger import logger, log_gate
+from .core.tree_sitter_utils import TreeSitterUtils
+from .core.type_manager import TypeManager
+from .core.layout_engine import DEFAULT_ABI
+from .core.include_resolver import IncludeResolver
+from .data_parser import CDataParser
+
+logger = logger.bind(name="IncrementalParser")
+
+
+class _Declaration:
+    """一个顶层节点的解析结果，以及它对类型表和变量表的影响
+
+    字节范围保存在 _FileState.starts/ends 中，便于二分查找和批量平移。
+    """
+
+    __slots__ = ('row', 'node_type', 'changes', 'variables', 'pack')
+
+    def __init__(self, node, changes: Dict[str, Any], variables: List[Tuple[str, Dict[str, Any]]],
+                 pack: Tuple[Optional[int], Tuple[Optional[int], ...]]):
+        self.row = node.start_point[0]
+        self.node_type = node.type
+        # TypeManager.end_changes 的结果：新增的类型和定义的宏
+        self.changes = changes
+        # (分类, 变量信息)
+        self.variables = variables
+        # 解析该节点之后的 #pragma pack 状态
+        self.pack = pack
+
+    @property
+    def defines_types(self) -> bool:
+        return bool(self.changes['types'] or self.changes['macros'])
+
+    def shift_rows(self, shift: int) -> None:
+        """声明未修改但前面的行数变化：更新记录的行号"""
+        self.row += shift
+        entries = [var for _, var in self.variables] + list(self.changes['types'])
+        for entry in entries:
+            location = entry.get('location')
+            if isinstance(location, dict) and isinstance(location.get('line'), int):
+                location['line'] += shift
+
+
+class _FileState:
+    """单个文件的增量解析状态"""
+
+    __slots__ = ('path', 'parser', 'source', 'tree', 'declarations', 'starts', 'ends', 'counts', 'mtime')
+
+    def __init__(self, path: str, parser: CDataParser, source: bytes, tree, mtime: Optional[int]):
+        self.path = path
+        self.parser = parser
+        self.source = source
+        self.tree = tree
+        self.mtime = mtime
+        self.declarations: List[_Declaration] = []
+        # 与 declarations 一一对应的字节范围，按位置递增
+        self.starts: List[int] = []
+        self.ends: List[int] = []
+        # 分类 -> 每个声明的变量数量，用于定位声明的变量在DataManager列表中的位置
+        self.counts: Dict[str, List[int]] = {category: [] for category in parser.data_manager.variables}
+
+    def set_declarations(self, nodes, declarations: List[_Declaration]) -> None:
+        self.declarations = declarations
+        self.starts = [node.start_byte for node in nodes]
+        self.ends = [node.end_byte for node in nodes]
+        self.counts = {category: self.count_variables(declarations, category) for category in self.counts}
+
+    @staticmethod
+    def count_variables(declarations: List[_Declaration], category: str) -> List[int]:
+        return [sum(1 for entry_category, _ in record.variables if entry_category == category)
+                for record in declarations]
+
+
+class IncrementalParser:
+    """监视模式使用的增量解析器
+
+    每个文件保留上一次的源码、语法树、类型表和按顶层声明记录的解析结果。文件修改后：
+    1. 计算修改区间并通过 Tree.edit 同步到旧树，tree-sitter 复用未修改的部分增量解析；
+    2. 只重新遍历字节范围与修改区间（及 changed_ranges）相交的顶层声明；
+    3. 撤销被修改或删除的声明登记的类型和宏，原地更新 TypeManager 和 DataManager。
+    修改的声明定义了类型或宏时，其后的声明可能依赖它，也会重新遍历。
+
+    用法示例：
+    ```python
+    watcher = IncrementalParser(type_info=header_types)
+    watcher.parse('calib.c')
+    ...  # 编辑器保存文件
+    summary = watcher.update('calib.c')
+    watcher.get_parser('calib.c').get_simplified_output()
+    ```
+    """
+
+    def __init__(self, type_info: Optional[Dict[str, Any]] = None,
+                 include_paths: Optional[List[Union[str, Path]]] = None,
+                 abi: str = DEFAULT_ABI, typed_arrays: bool = False):
+        """初始化增量解析器
+
+        Args:
+            type_info: 所有文件共享的全局类型信息（例如头文件的 export_types()），可选
+            include_paths: 包含文件搜索路径，可选
+            abi: 目标ABI
+            typed_arrays: 一维基本数值类型数组是否保存为 array.array
+        """
+        self.type_info = type_info
+        self.include_paths = [str(path) for path in include_paths or []]
+        self.abi = abi
+        self.typed_arrays = typed_arrays
+        self._files: Dict[str, _FileState] = {}
+
+    @property
+    def files(self) -> List[str]:
+        """已解析的文件"""
+        return list(self._files)
+
+    def get_parser(self, path: Union[str, Path]) -> CDataParser:
+        """文件对应的CDataParser，其中的 TypeManager/DataManager 保存该文件的最新结果"""
+        return self._files[self._key(path)].parser
+
+    def get_result(self, path: Union[str, Path]) -> Dict[str, Any]:
+        """文件的最新解析结果，格式与 CDataParser.parse_file 相同"""
+        return self.get_parser(path).data_manager.get_all_data()
+
+    def forget(self, path: Union[str, Path]) -> None:
+        """丢弃文件的增量状态"""
+        self._files.pop(self._key(path), None)
+
+    def parse(self, path: Union[str, Path], text: Optional[str] = None) -> Dict[str, Any]:
+        """完整解析文件并建立增量状态
+
+        Args:
+            path: 文件路径
+            text: 文件内容，None表示从磁盘读取
+
+        Returns:
+            解析结果，格式与 CDataParser.parse_file 相同
+        """
+        key = self._key(path)
+        source = self._read(key, text)
+        parser = self._create_parser(key)
+        tree = TreeSitterUtils.parse_bytes(source)
+
+        state = _FileState(key, parser, source, tree, self._mtime(key) if text is None else None)
+        nodes = tree.root_node.children
+        state.set_declarations(nodes, [self._walk(state, node) for node in nodes])
+        self._files[key] = state
+        logger.info(f"Parsed {key}: {len(state.declarations)} top-level declarations")
+        return parser.data_manager.get_all_data()
+
+    def update(self, path: Union[str, Path], text: Optional[str] = None) -> Dict[str, Any]:
+        """文件修改后增量更新，文件尚未解析时完整解析
+
+        Args:
+            path: 文件路径
+            text: 文件的新内容，None表示从磁盘读取
+
+        Returns:
+            更新摘要：file、full（是否完整解析）、reparsed/reused（重新遍历/复用的顶层声明数）、
+            changed（重新解析的变量名）、removed（删除的变量名）、types_changed、elapsed_ms
+        """
+        started = time.perf_counter()
+        key = self._key(path)
+        state = self._files.get(key)
+        if state is None:
+            return self._full_update(key, text, started, [])
+
+        source = self._read(key, text)
+        if text is None:
+            state.mtime = self._mtime(key)
+        edit = TreeSitterUtils.edit_tree(state.tree, state.source, source)
+        if edit is None:
+            return self._summary(key, started, reparsed=[], reused=len(state.declarations), removed=[])
+
+        try:
+            tree = TreeSitterUtils.parse_bytes(source, state.tree)
+            return self._apply(state, source, tree, edit, started)
+        except Exception as e:
+            # 状态可能只更新了一部分，丢弃后完整解析
+            logger.warning(f"增量解析失败，重新完整解析 {key}: {e}")
+            previous = [var['name'] for record in state.declarations for _, var in record.variables]
+            self._files.pop(key, None)
+            return self._full_update(key, source.decode('utf-8'), started, previous)
+
+    def poll(self) -> List[Dict[str, Any]]:
+        """检查已解析文件的修改时间，对修改过的文件增量更新
+
+        Returns:
+            每个更新过的文件的摘要
+        """
+        summaries = []
+        for key, state in list(self._files.items()):
+            mtime = self._mtime(key)
+            if mtime is not None and mtime != state.mtime:
+                summaries.append(self.update(key))
+        return summaries
+
+    def _apply(self, state: _FileState, source: bytes, tree, edit: Dict[str, Any],
+               started: float) -> Dict[str, Any]:
+        """复用未修改的顶层声明，只重新遍历修改区间附近的声明
+
+        修改区间由 compute_edit 和 changed_ranges 确定。窗口之外的声明只平移字节范围，
+        整个更新的开销与修改区间的大小相关，与文件大小基本无关。
+        """
+        start, old_end, new_end = edit['start_byte'], edit['old_end_byte'], edit['new_end_byte']
+        delta = new_end - old_end
+        row_delta = edit['new_end_point'][0] - edit['old_end_point'][0]
+        dirty = [(start, new_end)]
+        dirty.extend((r.start_byte, r.end_byte) for r in state.tree.changed_ranges(tree))
+
+        # 新旧坐标的换算：修改区间内的位置换算为区间的边界
+        def old_low(position: int) -> int:
+            return position if position <= start else (position - delta if position >= new_end else start)
+
+        def old_high(position: int) -> int:
+            return position if position < start else (position - delta if position >= new_end else old_end)
+
+        def new_low(position: int) -> int:
+            return position if position <= start else (position + delta if position >= old_end else start)
+
+        def new_high(position: int) -> int:
+            return position if position < start else (position + delta if position >= old_end else new_end)
+
+        # 与修改区间相交的旧声明 [first, last) 和新节点 [lo_node, hi_node) 覆盖相同的源码范围，
+        # 任何一侧越过当前窗口时扩大窗口
+        low, high = min(b for b, _ in dirty), max(e for _, e in dirty)
+        children = tree.root_node.children
+        while True:
+            window = (low, high)
+            first = bisect.bisect_left(state.ends, old_low(low))
+            last = bisect.bisect_right(state.starts, old_high(high))
+            if first < last:
+                low = min(low, new_low(state.starts[first]))
+                high = max(high, new_high(state.ends[last - 1]))
+            lo_node = self._first_node_ending_at(children, low)
+            hi_node = self._first_node_starting_after(children, high)
+            if lo_node < hi_node:
+                low = min(low, children[lo_node].start_byte)
+                high = max(high, children[hi_node - 1].end_byte)
+            if (low, high) == window:
+                break
+        nodes = children[lo_node:hi_node]
+
+        parser = state.parser
+        removed = state.declarations[first:last]
+        parser.type_manager.revert_changes([record.changes for record in removed])
+        state.source, state.tree = source, tree
+        # 重新遍历得到的变量先收集到空列表中，最后替换DataManager中对应的范围
+        variables = parser.data_manager.variables
+        parser.data_manager.variables = {category: [] for category in variables}
+
+        # 修改或删除的声明定义过类型或宏时，其后的声明都需要重新遍历
+        stale = any(record.defines_types for record in removed)
+        parser.type_parser.set_pack_state(state.declarations[first - 1].pack if first else (None, ()))
+        reparsed = []
+        for node in nodes:
+            walked = self._walk(state, node)
+            stale = stale or walked.defines_types
+            reparsed.append(walked)
+
+        tail = state.declarations[last:]
+        if stale and tail:
+            parser.type_manager.revert_changes([record.changes for record in tail])
+            removed.extend(tail)
+            tail_nodes = children[hi_node:]
+            for node in tail_nodes:
+                reparsed.append(self._walk(state, node))
+            nodes = list(nodes) + list(tail_nodes)
+            tail = []
+            replaced = len(state.declarations)
+        else:
+            replaced = last
+            if row_delta:
+                for record in tail:
+                    record.shift_rows(row_delta)
+
+        parser.data_manager.variables = variables
+        entries = [entry for record in reparsed for entry in record.variables]
+        ranges = {}
+        for category, counts in state.counts.items():
+            begin = sum(counts[:first])
+            ranges[category] = (begin, begin + sum(counts[first:replaced]))
+            state.counts[category] = counts[:first] + state.count_variables(reparsed, category) + counts[replaced:]
+        parser.data_manager.replace_variables(ranges, entries)
+
+        shifted_starts = [position + delta for position in state.starts[last:]] if tail else []
+        shifted_ends = [position + delta for position in state.ends[last:]] if tail else []
+        state.declarations = state.declarations[:first] + reparsed + tail
+        state.starts = state.starts[:first] + [node.start_byte for node in nodes] + shifted_starts
+        state.ends = state.ends[:first] + [node.end_byte for node in nodes] + shifted_ends
+        return self._summary(state.path, started, reparsed=reparsed, reused=len(state.declarations) - len(reparsed),
+                             removed=removed)
+
+    @staticmethod
+    def _first_node_ending_at(children, position: int) -> int:
+        """第一个结束位置不早于position的节点下标"""
+        low, high = 0, len(children)
+        while low < high:
+            middle = (low + high) // 2
+            if children[middle].end_byte < position:
+                low = middle + 1
+            else:
+                high = middle
+        return low
+
+    @staticmethod
+    def _first_node_starting_after(children, position: int) -> int:
+        """第一个起始位置晚于position的节点下标"""
+        low, high = 0, len(children)
+        while low < high:
+            middle = (low + high) // 2
+            if children[middle].start_byte <= position:
+                low = middle + 1
+            else:
+                high = middle
+        return low
+
+    def _full_update(self, key: str, text: Optional[str], started: float, previous: List[str]) -> Dict[str, Any]:
+        self.parse(key, text)
+        state = self._files[key]
+        summary = self._summary(key, started, reparsed=state.declarations, reused=0, removed=[])
+        summary['full'] = True
+        summary['removed'] = sorted(set(previous) - set(summary['changed']))
+        return summary
+
+    def _walk(self, state: _FileState, node) -> _Declaration:
+        """解析一个顶层节点，记录它新增的类型、宏和变量"""
+        parser = state.parser
+        variables = parser.data_manager.variables
+        counts = {category: len(items) for category, items in variables.items()}
+        journal = parser.type_manager.begin_changes()
+        try:
+            parser._process_top_level_node(node)
+        finally:
+            changes = parser.type_manager.end_changes(journal)
+        added = [(category, var) for category, items in variables.items() for var in items[counts[category]:]]
+        if log_gate.debug:
+            logger.debug(f"Walked {node.type} [{node.start_byte}, {node.end_byte}): "
+                         f"{len(changes['types'])} types, {len(added)} variables")
+        return _Declaration(node, changes, added, parser.type_parser.get_pack_state())
+
+    def _summary(self, key: str, started: float, reparsed: List[_Declaration], reused: int,
+                 removed: List[_Declaration]) -> Dict[str, Any]:
+        changed = [var['name'] for record in reparsed for _, var in record.variables]
+        removed_names = {var['name'] for record in removed for _, var in record.variables} - set(changed)
+        summary = {
+            'file': key,
+            'full': False,
+            'reparsed': len(reparsed),
+            'reused': reused,
+            'changed': changed,
+            'removed': sorted(name for name in removed_names if name),
+            'types_changed': any(record.defines_types for record in list(reparsed) + list(removed)),
+            'elapsed_ms': round((time.perf_counter() - started) * 1000, 3),
+        }
+        if reparsed or removed:
+            logger.info(f"Updated {key}: {summary['reparsed']} reparsed, {reused} reused "
+                        f"in {summary['elapsed_ms']} ms")
+        return summary
+
+    def _create_parser(self, key: str) -> CDataParser:
+        parser = CDataParser(TypeManager(self.type_info, abi=self.abi), None,
+                             IncludeResolver(self.include_paths), self.typed_arrays)
+        parser.current_file = key
+        parser.type_parser.current_file = key
+        return parser
+
+    @staticmethod
+    def _key(path: Union[str, Path]) -> str:
+        return str(Path(path))
+
+    @staticmethod
+    def _read(key: str, text: Optional[str]) -> bytes:
+        return text.encode('utf-8') if text is not None else Path(key).read_bytes()
+
+    @staticmethod
+    def _mtime(key: str) -> Optional[int]:
+        try:
+            return Path(key).stat().st_mtime_ns
+        except OSError:
+            return None
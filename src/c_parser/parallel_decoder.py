@@ -0,0 +1,130 @@
+import os
+from concurrent.futures import ProcessPoolExecutor
+from concurrent.futures.process import BrokenProcessPool
+from typing import Dict, Any, Optional, List, Tuple
+from tree_sitter import Node
+from utils.logger import logger, log_gate
+from utils.metrics import count
+from .core.tree_sitter_utils import TreeSitterUtils
+from .core.type_manager import TypeManager
+
+logger = logger.bind(name="ParallelDecoder")
+
+# 元素之间的分隔符，不对应结果中的元素
+_SEPARATORS = frozenset({'{', '}', ',', 'comment'})
+
+# 工作进程内的解析器，由 _init_worker 创建，在进程生命周期内复用
+_worker_parser = None
+
+
+def _init_worker(type_info: Dict[str, Any], abi: str, typed_arrays: bool, columnar: bool) -> None:
+    """工作进程初始化：创建本进程独占的tree-sitter解析器和CDataParser"""
+    global _worker_parser
+    from .data_parser import CDataParser
+    # fork得到的进程继承了父进程的Parser对象，丢弃后重新创建
+    TreeSitterUtils.reset_parser()
+    _worker_parser = CDataParser(TypeManager(type_info, abi=abi), typed_arrays=typed_arrays, columnar=columnar)
+
+
+def _decode_in_worker(task: Tuple[bytes, Dict[str, Any]]) -> List[Any]:
+    """在工作进程中解码一段元素"""
+    span, element_info = task
+    return _worker_parser.decode_element_span(span, element_info)
+
+
+class ParallelDecoder:
+    """把单个大型初始化列表分段后在多个进程中解码
+
+    顶层 initializer_list 的元素按字节范围切分为连续的若干段，每段的源码交给
+    工作进程重新解析（只解析这一段）并按元素类型填充，结果按顺序拼接，
+    与单进程解码的结果相同。工作进程使用当前类型表的快照（export_types()）。
+
+    含有指定初始化（``[i] = ...``、``.x = ...``）或无法识别的元素时不分段，
+    由调用方按原流程解码。
+
+    用法示例：
+    ```python
+    decoder = ParallelDecoder(jobs=8)
+    elements = decoder.decode(parser, initializer_node, element_info)
+    ```
+    """
+
+    # 元素数量达到该值时才分段，较小的表进程启动和结果传输的开销更大
+    MIN_ELEMENTS = 20000
+    # 每个工作进程分到的段数，段越多负载越均衡
+    SLICES_PER_JOB = 4
+
+    def __init__(self, jobs: Optional[int] = None, min_elements: int = MIN_ELEMENTS):
+        """初始化
+
+        Args:
+            jobs: 工作进程数量，默认为CPU核数
+            min_elements: 分段解码的最小元素数量
+        """
+        self.jobs = jobs or os.cpu_count() or 1
+        self.min_elements = min_elements
+
+    @staticmethod
+    def split_elements(node: Node) -> Optional[List[Node]]:
+        """获取初始化列表的元素节点
+
+        Returns:
+            元素节点列表，含有指定初始化或无法识别的元素时返回None
+        """
+        elements = []
+        for child in TreeSitterUtils.iter_children(node):
+            if child.type in _SEPARATORS:
+                continue
+            if child.type == 'initializer_pair' or child.type == 'ERROR' or child.type.startswith('preproc'):
+                return None
+            elements.append(child)
+        return elements
+
+    def partition(self, elements: List[Node]) -> List[Tuple[int, int]]:
+        """把元素划分为连续的段
+
+        Returns:
+            每段第一个和最后一个元素的下标 (first, last)
+        """
+        slices = min(len(elements), self.jobs * self.SLICES_PER_JOB)
+        bounds = [len(elements) * i // slices for i in range(slices + 1)]
+        return [(bounds[i], bounds[i + 1] - 1) for i in range(slices)]
+
+    def decode(self, parser, node: Node, element_info: Dict[str, Any]) -> Optional[List[Any]]:
+        """分段解码初始化列表的元素
+
+        Args:
+            parser: 当前的CDataParser，提供源码和类型表
+            node: 顶层 initializer_list 节点
+            element_info: 单个元素的变量信息（数组去掉第一维）
+
+        Returns:
+            按顺序排列的元素值；元素太少、不能分段或工作进程不可用时返回None
+        """
+        if self.jobs < 2:
+            return None
+        elements = self.split_elements(node)
+        if elements is None or len(elements) < self.min_elements:
+            return None
+
+        source, base = parser.source_view(node)
+        # 只传递填充元素需要的信息，不传递语法树节点和完整的初始化器文本
+        element_info = {key: element_info.get(key) for key in ('name', 'type', 'array_size', 'typeinfo')}
+        tasks = [(bytes(source[elements[first].start_byte - base:elements[last].end_byte - base]), element_info)
+                 for first, last in self.partition(elements)]
+        if log_gate.debug:
+            logger.debug(f"Decoding {len(elements)} elements of {element_info.get('name')} "
+                         f"in {len(tasks)} slices on {self.jobs} processes")
+
+        initargs = (parser.type_manager.export_types(), parser.type_manager.abi, parser.typed_arrays, parser.columnar)
+        try:
+            with ProcessPoolExecutor(max_workers=min(self.jobs, len(tasks)), initializer=_init_worker,
+                                     initargs=initargs) as executor:
+                decoded = []
+                for values in executor.map(_decode_in_worker, tasks):
+                    decoded.extend(values)
+        except (OSError, BrokenProcessPool) as e:
+            logger.warning(f"Parallel decoding unavailable, decoding serially: {e}")
+            return None
+        count('parallel_elements', len(decoded))
+        return decoded
@@ -0,0 +1,356 @@
+import json
+import os
+import socketserver
+import threading
+from collections import OrderedDict
+from concurrent.futures import ThreadPoolExecutor, wait
+from pathlib import Path
+from typing import Dict, Any, Optional, List, Tuple, Union, Iterable, Callable
+from utils.logger import logger, log_gate
+from .core.tree_sitter_utils import TreeSitterUtils
+from .core.type_manager import TypeManager
+from .core.parse_cache import ParseCache
+from .core.include_resolver import IncludeResolver
+from .core.layout_engine import DEFAULT_ABI
+from .core.output_writer import json_default
+from .type_parser import CTypeParser
+from .data_parser import CDataParser
+
+logger = logger.bind(name="ParseServer")
+
+# JSON-RPC 2.0 错误码
+PARSE_ERROR = -32700
+INVALID_REQUEST = -32600
+METHOD_NOT_FOUND = -32601
+INVALID_PARAMS = -32602
+SERVER_ERROR = -32000
+
+
+class RpcError(Exception):
+    """请求处理失败，code 为JSON-RPC错误码"""
+
+    def __init__(self, code: int, message: str):
+        super().__init__(message)
+        self.code = code
+
+
+class _Environment:
+    """一组头文件解析得到的类型环境
+
+    头文件的类型加载在 manager 的全局层，resolve_type/layout 直接查询 manager（解析缓存保持热状态），
+    analyze 请求通过 manager.fork() 得到共享冻结类型层的独立TypeManager。
+    """
+
+    __slots__ = ('key', 'manager', 'files', 'mtimes', 'lock')
+
+    def __init__(self, key: Tuple, manager: TypeManager, files: List[str]):
+        self.key = key
+        self.manager = manager
+        self.files = files
+        self.mtimes = [_mtime(path) for path in files]
+        # 解析缓存和布局引擎不是线程安全的，查询 manager 时逐个进行
+        self.lock = threading.Lock()
+
+    def is_fresh(self) -> bool:
+        """环境依赖的文件是否都没有修改"""
+        return all(_mtime(path) == mtime for path, mtime in zip(self.files, self.mtimes))
+
+
+def _mtime(path: str) -> Optional[int]:
+    try:
+        return os.stat(path).st_mtime_ns
+    except OSError:
+        return None
+
+
+class ParseServer:
+    """常驻解析服务
+
+    通过JSON-RPC 2.0（每行一个请求或批量请求）提供解析功能，tree-sitter语言库只加载一次，
+    头文件解析得到的类型环境按 (头文件, 类型文件, include_paths, abi, defines) 缓存，跨请求复用，
+    依赖的文件修改后自动重新解析。请求在线程池中并发处理，响应按完成顺序写出，通过id对应。
+
+    支持的方法（params 均为对象）：
+    - parse: 解析头文件，返回类型信息（与 export_types 格式相同）
+    - analyze: 解析源文件（source 为路径，或 text 为源码），返回与 CDataParser.parse_file 相同的结果，
+      源文件中的 #include 不展开，包含的头文件通过 header/types 提供
+    - resolve_type: 解析类型名（type），返回 TypeManager.resolve_type 的结果
+    - layout: 结构体/联合体布局（type 或 type_names 列表，默认所有结构体和联合体）
+
+    各方法共用的环境参数：header（头文件路径）、types（预先导出的类型信息JSON文件）、
+    include_paths、abi、defines（预定义宏 {名称: 值}，决定条件编译块中解析的分支）。
+
+    用法示例：
+    ```python
+    server = ParseServer(include_paths=['include'])
+    server.handle({'jsonrpc': '2.0', 'id': 1, 'method': 'layout',
+                   'params': {'header': 'types.h', 'type': 'struct Packet'}})
+    server.serve_unix('/tmp/struct-converter.sock')
+    ```
+    """
+
+    def __init__(self, include_paths: Optional[List[Union[str, Path]]] = None,
+                 cache_dir: Optional[Union[str, Path]] = None, abi: str = DEFAULT_ABI,
+                 workers: Optional[int] = None, max_environments: int = 16):
+        """初始化服务
+
+        Args:
+            include_paths: 默认的包含文件搜索路径，请求可通过 include_paths 覆盖
+            cache_dir: 头文件解析缓存目录，可选
+            abi: 默认的目标ABI
+            workers: 处理请求的线程数，默认为CPU核数
+            max_environments: 最多缓存的类型环境数量，超出时丢弃最久未使用的
+        """
+        self.include_paths = [str(p) for p in (include_paths or [])]
+        self.parse_cache = ParseCache(cache_dir) if cache_dir else None
+        self.abi = abi
+        self.max_environments = max_environments
+        self.methods: Dict[str, Callable[[Dict[str, Any]], Any]] = {
+            'parse': self._parse,
+            'analyze': self._analyze,
+            'resolve_type': self._resolve_type,
+            'layout': self._layout,
+        }
+        self._environments: 'OrderedDict[Tuple, _Environment]' = OrderedDict()
+        self._environment_lock = threading.Lock()
+        self._loading: Dict[Tuple, threading.Lock] = {}
+        self._executor = ThreadPoolExecutor(max_workers=workers or os.cpu_count() or 1)
+        # 在处理请求之前加载语言库，之后所有请求复用
+        TreeSitterUtils.get_instance()
+
+    def close(self) -> None:
+        """等待处理中的请求完成并停止线程池"""
+        self._executor.shutdown(wait=True)
+
+    def handle_text(self, text: str) -> Optional[str]:
+        """处理一行JSON文本
+
+        Returns:
+            响应的JSON文本，通知（没有id的请求）返回None
+        """
+        try:
+            message = json.loads(text)
+        except ValueError as e:
+            return self._dumps(self._error(None, PARSE_ERROR, f"Parse error: {e}"))
+        response = self.handle(message)
+        return None if response is None else self._dumps(response)
+
+    def handle(self, message: Union[Dict[str, Any], List[Any]]) -> Optional[Union[Dict[str, Any], List[Any]]]:
+        """处理一个JSON-RPC请求或批量请求
+
+        Returns:
+            响应对象（批量请求返回列表），全部为通知时返回None
+        """
+        if isinstance(message, list):
+            if not message:
+                return self._error(None, INVALID_REQUEST, "Empty batch")
+            responses = [response for response in map(self._handle_one, message) if response is not None]
+            return responses or None
+        return self._handle_one(message)
+
+    def serve(self, lines: Iterable[str], write: Callable[[str], None]) -> None:
+        """处理一个请求流，直到输入结束
+
+        Args:
+            lines: 输入行（每行一个JSON-RPC消息）
+            write: 写出一行响应文本的函数，在多个线程中调用，内部加锁
+        """
+        write_lock = threading.Lock()
+
+        def respond(line: str) -> None:
+            reply = self.handle_text(line)
+            if reply is None:
+                return
+            with write_lock:
+                try:
+                    write(reply + '\n')
+                except OSError as e:
+                    logger.warning(f"Failed to write response: {e}")
+
+        pending = set()
+        for line in lines:
+            if not line.strip():
+                continue
+            pending.add(self._executor.submit(respond, line))
+            # 及时释放已完成的任务，长时间运行时集合保持很小
+            pending = {future for future in pending if not future.done()}
+        wait(pending)
+
+    def serve_stdio(self, stdin, stdout) -> None:
+        """通过标准输入输出提供服务"""
+        def write(text: str) -> None:
+            stdout.write(text)
+            stdout.flush()
+        self.serve(stdin, write)
+
+    def serve_unix(self, path: Union[str, Path]) -> None:
+        """在Unix域套接字上提供服务，每个连接一个线程，直到被中断"""
+        path = str(path)
+        if os.path.exists(path):
+            os.unlink(path)
+        server = _UnixServer(path, _ConnectionHandler)
+        server.parse_server = self
+        logger.info(f"Listening on {path}")
+        try:
+            server.serve_forever()
+        finally:
+            server.server_close()
+            if os.path.exists(path):
+                os.unlink(path)
+
+    def _handle_one(self, request: Any) -> Optional[Dict[str, Any]]:
+        """处理单个请求，所有异常都转换为错误响应"""
+        if not isinstance(request, dict) or not isinstance(request.get('method'), str):
+            return self._error(None, INVALID_REQUEST, "Invalid request")
+        request_id = request.get('id')
+        is_notification = 'id' not in request
+        method = self.methods.get(request['method'])
+        params = request.get('params', {})
+        try:
+            if method is None:
+                raise RpcError(METHOD_NOT_FOUND, f"Method not found: {request['method']}")
+            if not isinstance(params, dict):
+                raise RpcError(INVALID_PARAMS, "params must be an object")
+            if log_gate.debug:
+                logger.debug(f"Request {request_id}: {request['method']}")
+            result = method(params)
+        except RpcError as e:
+            response = self._error(request_id, e.code, str(e))
+        except (KeyError, TypeError, ValueError) as e:
+            response = self._error(request_id, INVALID_PARAMS, f"Invalid params: {e}")
+        except Exception as e:
+            logger.exception(f"Request {request_id} failed: {e}")
+            response = self._error(request_id, SERVER_ERROR, str(e))
+        else:
+            response = {'jsonrpc': '2.0', 'id': request_id, 'result': result}
+        return None if is_notification else response
+
+    @staticmethod
+    def _error(request_id: Any, code: int, message: str) -> Dict[str, Any]:
+        return {'jsonrpc': '2.0', 'id': request_id, 'error': {'code': code, 'message': message}}
+
+    @staticmethod
+    def _dumps(response: Any) -> str:
+        return json.dumps(response, ensure_ascii=False, default=json_default)
+
+    # ---- 类型环境 ----
+
+    def _environment(self, params: Dict[str, Any]) -> _Environment:
+        """获取请求对应的类型环境，没有缓存或依赖的文件已修改时重新解析"""
+        header = params.get('header')
+        types = params.get('types')
+        include_paths = tuple(str(p) for p in params.get('include_paths', self.include_paths))
+        abi = params.get('abi', self.abi)
+        defines = params.get('defines') or {}
+        if not isinstance(defines, dict):
+            raise RpcError(INVALID_PARAMS, "defines must be an object")
+        key = (str(Path(header).resolve()) if header else None,
+               str(Path(types).resolve()) if types else None, include_paths, abi,
+               tuple(sorted((str(name), value) for name, value in defines.items())))
+
+        with self._environment_lock:
+            environment = self._environments.get(key)
+            if environment is not None and environment.is_fresh():
+                self._environments.move_to_end(key)
+                return environment
+            loading = self._loading.setdefault(key, threading.Lock())
+
+        # 同一环境只解析一次，其他请求等待解析结果；不同环境并行解析
+        with loading:
+            with self._environment_lock:
+                environment = self._environments.get(key)
+                if environment is not None and environment.is_fresh():
+                    return environment
+            environment = self._load_environment(key)
+            with self._environment_lock:
+                self._environments[key] = environment
+                self._environments.move_to_end(key)
+                while len(self._environments) > self.max_environments:
+                    self._environments.popitem(last=False)
+                self._loading.pop(key, None)
+        return environment
+
+    def _load_environment(self, key: Tuple) -> _Environment:
+        header, types, include_paths, abi, defines = key
+        files = []
+        type_info = None
+        if types:
+            with open(types, 'r', encoding='utf-8') as f:
+                type_info = json.load(f)
+            files.append(types)
+
+        manager = TypeManager(type_info, abi=abi)
+        manager.define_macros(dict(defines))
+        if header:
+            logger.info(f"Loading type environment: {header}")
+            parser = CTypeParser(manager, self.parse_cache, IncludeResolver(list(include_paths)))
+            if parser.parse_declarations(Path(header)) is None:
+                raise RpcError(SERVER_ERROR, f"Failed to parse header: {header}")
+            files.extend(parser.get_include_graph()['files'] or [header])
+            # 头文件的类型冻结为共享层，analyze 请求通过 fork 共享，不复制类型表
+            manager.freeze()
+        return _Environment(key, manager, files)
+
+    # ---- 方法 ----
+
+    def _parse(self, params: Dict[str, Any]) -> Dict[str, Any]:
+        environment = self._environment(params)
+        exported = environment.manager.export_types()
+        return {
+            'types': exported['types'],
+            'pointer_types': sorted(exported['pointer_types']),
+            'macro_definitions': exported['macro_definitions'],
+            'files': environment.files,
+        }
+
+    def _analyze(self, params: Dict[str, Any]) -> Dict[str, Any]:
+        source, text = params.get('source'), params.get('text')
+        if (source is None) == (text is None):
+            raise RpcError(INVALID_PARAMS, "Exactly one of 'source' and 'text' is required")
+        output_format = params.get('format', 'json')
+        if output_format not in ('json', 'json-simple'):
+            raise RpcError(INVALID_PARAMS, f"Unsupported format: {output_format}")
+
+        environment = self._environment(params)
+        # 源文件中的 #include 不展开，类型来自环境中预先解析的头文件
+        parser = CDataParser(environment.manager.fork(), self.parse_cache,
+                             typed_arrays=bool(params.get('typed_arrays', False)))
+        result = parser.parse_path(source) if source is not None else parser.parse_text(text)
+        if output_format == 'json-simple':
+            return parser.get_simplified_output()
+        return result
+
+    def _resolve_type(self, params: Dict[str, Any]) -> Dict[str, Any]:
+        type_name = params['type']
+        environment = self._environment(params)
+        with environment.lock:
+            return environment.manager.resolve_type(type_name)
+
+    def _layout(self, params: Dict[str, Any]) -> Dict[str, Any]:
+        environment = self._environment(params)
+        manager = environment.manager
+        type_names = [params['type']] if 'type' in params else params.get('type_names')
+        with environment.lock:
+            if type_names is None:
+                type_names = [entry['name'] for entry in manager.export_types()['types']
+                              if entry.get('kind') in ('struct', 'union')]
+            layouts = []
+            for name in type_names:
+                type_layout = manager.get_type_layout(name)
+                if type_layout is None:
+                    raise RpcError(INVALID_PARAMS, f"Not a struct or union: {name}")
+                layouts.append(type_layout.to_dict())
+        return {'abi': manager.abi, 'layouts': layouts}
+
+
+class _UnixServer(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+    daemon_threads = True
+    parse_server: ParseServer
+
+
+class _ConnectionHandler(socketserver.StreamRequestHandler):
+    """一个客户端连接，请求交给 ParseServer 的线程池并发处理"""
+
+    def handle(self) -> None:
+        lines = (line.decode('utf-8', errors='replace') for line in self.rfile)
+        self.server.parse_server.serve(lines, lambda text: self.wfile.write(text.encode('utf-8')))
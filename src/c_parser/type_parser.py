@@ -1,14 +1,28 @@
 import hashlib
+import sys
 from typing import Dict, Any, Optional, List, Tuple, Union
 from pathlib import Path
 import json
 from tree_sitter import Node
-from utils.logger import logger 
+from utils.logger import logger, log_gate
 from .core.type_manager import TypeManager
 from .core.expression_parser import ExpressionParser
 from .core.tree_sitter_utils import TreeSitterUtils
+from .core.parse_cache import ParseCache
+from .core.include_resolver import IncludeResolver
+from .core.conditional_evaluator import ConditionalEvaluator, CONDITIONAL_NODES
 import re
 
+# __attribute__((packed)) / __attribute__((aligned(N))) / __declspec(align(N))
+_PACKED_ATTRIBUTE = re.compile(r'\b(?:__packed__|packed)\b')
+_ALIGNED_ATTRIBUTE = re.compile(r'\b(?:__aligned__|aligned|align)\b\s*(?:\(\s*([^()]*?)\s*\))?')
+_PRAGMA_PACK = re.compile(r'^\s*pack\s*\(\s*(.*?)\s*\)\s*$')
+
+# 字段声明中表示字段类型的子节点
+_FIELD_TYPE_NODES = frozenset(['primitive_type', 'sized_type_specifier', 'type_identifier',
+                               'struct_specifier', 'union_specifier'])
+
+
 class CTypeParser:
     """C语言声明解析器，负责解析类型定义、枚举和宏定义
     
@@ -31,8 +45,17 @@ class CTypeParser:
     macros = declarations['macro_definitions']
     ```
     """
-    def __init__(self, type_manager: TypeManager = None):
-        """初始化类型解析器"""
+    def __init__(self, type_manager: TypeManager = None, parse_cache: ParseCache = None,
+                 include_resolver: IncludeResolver = None, evaluate_conditions: bool = True):
+        """初始化类型解析器
+        
+        Args:
+            type_manager: 类型管理器，可选
+            parse_cache: 头文件解析缓存，可选，未提供时不使用缓存
+            include_resolver: 包含文件解析器，可选，用于指定include_paths
+            evaluate_conditions: 是否按已定义的宏判定条件编译块，只遍历成立的分支；
+                                 False 时遍历所有分支，登记每个分支中的类型
+        """
         # 创建命名日志器
         self.logger = logger.bind(name="TypeParser")
         self.logger.info("=== Initializing CTypeParser ===")
@@ -40,14 +63,157 @@ class CTypeParser:
         # 初始化组件
         self.ts_util = TreeSitterUtils.get_instance()
         self.type_manager = type_manager or TypeManager()
-        
-        # 配置
-        self.pointer_size = 8  # 默认64位系统
+        self.parse_cache = parse_cache
+        self.include_resolver = include_resolver or IncludeResolver()
+        self.conditions = ConditionalEvaluator(self.type_manager) if evaluate_conditions else None
+        # parse_declarations 的嵌套深度，顶层调用开始新的包含解析会话
+        self._include_depth = 0
+        # 计算缓存键时已读取、尚未解析的文件内容，解析时直接使用而不再读取
+        self._read_ahead: Dict[Path, bytes] = {}
+        # 分块解析时当前块第一行在文件中的行号，见 CDataParser.parse_file_chunked
+        self.line_offset = 0
+        
+        # 配置：指针大小与类型管理器的目标ABI一致
+        self.pointer_size = self.type_manager.get_layout_engine().abi.pointer_size
+        
+        # #pragma pack 的当前值和 push/pop 栈
+        self._pack: Optional[int] = None
+        self._pack_stack: List[Optional[int]] = []
         
         self.logger.info("Type parser initialized successfully")
 
+    def get_pack_state(self) -> Tuple[Optional[int], Tuple[Optional[int], ...]]:
+        """当前的 #pragma pack 状态（值和 push 栈），增量解析时用于恢复到某个声明之前的状态"""
+        return self._pack, tuple(self._pack_stack)
+
+    def set_pack_state(self, state: Tuple[Optional[int], Tuple[Optional[int], ...]]) -> None:
+        """恢复 get_pack_state 返回的 #pragma pack 状态"""
+        self._pack, stack = state
+        self._pack_stack = list(stack)
+
     def parse_declarations(self, source: Union[str, Path], tree=None) -> Dict[str, Any]:
-        """解析C语言声明"""
+        """解析C语言声明
+        
+        头文件（Path）在一次会话中最多解析一次，会话由 include_resolver 管理。
+        每次顶层调用开始新的会话，包含关系图只反映本次解析；
+        已登记的类型和宏（包括包含保护宏）保留在类型管理器中。
+        配置了解析缓存时，头文件的解析结果按内容缓存，
+        缓存命中时直接登记缓存的类型信息，不再调用tree-sitter。
+        """
+        if self._include_depth == 0:
+            self.include_resolver.reset()
+        elif isinstance(source, Path) and tree is None and self.include_resolver.is_parsed(source):
+            if log_gate.debug:
+                self.logger.debug(f"文件已解析，跳过: {source}")
+            return self.type_manager.export_types()
+        self._include_depth += 1
+        try:
+            if self.parse_cache is not None and isinstance(source, Path) and tree is None:
+                return self._parse_declarations_cached(source)
+            return self._parse_declarations(source, tree)
+        finally:
+            self._include_depth -= 1
+
+    def _parse_declarations_cached(self, source: Path) -> Dict[str, Any]:
+        """通过解析缓存解析头文件"""
+        try:
+            dependencies, contents = self._collect_dependencies(source)
+        except OSError as e:
+            self.logger.error(f"读取文件失败: {source}, 错误: {e}")
+            return None
+        
+        function_macros = set(self.conditions.function_macros) if self.conditions is not None else set()
+        key = self.parse_cache.make_key(contents, self.type_manager.get_macro_definition(),
+                                       self.type_manager.abi, self.conditions is not None, function_macros,
+                                       self.get_pack_state())
+        cached = self.parse_cache.load(key)
+        if cached is not None:
+            self.logger.info(f"命中解析缓存: {source}")
+            self.current_file = str(source)
+            self._apply_cached_declarations(cached)
+            # 缓存内容等同于解析了整个包含闭包
+            for path in dependencies:
+                self.include_resolver.mark_parsed(path)
+            return self.type_manager.export_types()
+        
+        state = self.type_manager.get_current_state()
+        try:
+            result = self._parse_declarations(source)
+        finally:
+            self._read_ahead.clear()
+        if result is not None:
+            delta = self.type_manager.export_current_delta(state)
+            if self.conditions is not None:
+                delta['function_macros'] = sorted(self.conditions.function_macros - function_macros)
+            # pshpack1.h / poppack.h 这类头文件的作用就是改变之后的 #pragma pack 状态
+            pack, stack = self.get_pack_state()
+            delta['pack_state'] = [pack, list(stack)]
+            self.parse_cache.store(key, delta)
+        return result
+
+    def _collect_dependencies(self, source: Path) -> Tuple[List[Path], List[bytes]]:
+        """收集头文件及其包含闭包，作为缓存键的输入
+        
+        包含文件的查找与 _parse_declarations 一致，找不到的包含文件
+        （例如系统头文件）不参与缓存键计算。本次会话中已解析、解析时会被
+        跳过的文件只以标记的形式参与计算，因为它们不会贡献新的类型。
+        
+        Returns:
+            (需要解析的文件列表, 缓存键输入内容列表)
+        """
+        paths = []
+        contents = []
+        visited = set()
+        
+        def visit(path: Path) -> None:
+            resolved = path.resolve()
+            if resolved in visited:
+                return
+            visited.add(resolved)
+            
+            content = path.read_bytes()
+            if resolved != source.resolve() and self.include_resolver.should_skip(
+                    resolved, self.type_manager.get_macro_definition()):
+                contents.append(b'\0skipped\0' + content)
+                return
+            paths.append(resolved)
+            contents.append(content)
+            self._read_ahead[resolved] = content
+            
+            text = content.decode('utf-8', errors='ignore')
+            for include, is_system in self.include_resolver.parse_include_directives(text):
+                include_path = self.include_resolver.resolve(include, resolved, is_system)
+                if include_path is not None:
+                    self.include_resolver.add_edge(resolved, include_path)
+                    visit(include_path)
+        
+        self._read_ahead.clear()
+        visit(source)
+        return paths, contents
+
+    def get_include_graph(self) -> Dict[str, Any]:
+        """获取本次会话解析的包含关系图"""
+        return self.include_resolver.get_include_graph()
+
+    def _apply_cached_declarations(self, cached: Dict[str, Any]) -> None:
+        """登记缓存中的类型信息，效果与重新解析相同"""
+        for type_info in cached.get('types', []):
+            self.type_manager.register_type(type_info.get('name'), type_info)
+        self.type_manager.merge_type_info({
+            'pointer_types': cached.get('pointer_types', []),
+            'macro_definitions': cached.get('macro_definitions', {})
+        })
+        # 函数式宏不登记到类型表，单独恢复，之后的 #ifdef 与重新解析时判定相同
+        if self.conditions is not None:
+            for name in cached.get('function_macros', []):
+                self.conditions.define_function_macro(name)
+        # 恢复头文件留下的 #pragma pack 状态，之后的结构体布局与重新解析时相同
+        if 'pack_state' in cached:
+            pack, stack = cached['pack_state']
+            self.set_pack_state((pack, tuple(stack)))
+
+    def _parse_declarations(self, source: Union[str, Path], tree=None) -> Dict[str, Any]:
+        """解析C语言声明（不经过缓存）"""
         try:
             self.logger.info(f"开始解析文件: {source}")
             
@@ -55,43 +221,60 @@ class CTypeParser:
             if isinstance(source, Path):
                 try:
                     self.current_file = str(source)
-                    text = source.read_text(encoding='utf-8')
-                    self.logger.debug(f"成功读取文件: {source}")
+                    content = self._read_ahead.pop(source.resolve(), None)
+                    if content is None:
+                        content = self.ts_util.read_source(source)
+                    text = content.decode('utf-8')
+                    if log_gate.debug:
+                        self.logger.debug(f"成功读取文件: {source}")
                 except Exception as e:
                     self.logger.error(f"读取文件失败: {source}, 错误: {e}")
                     return None
+                
+                # 先标记为已解析，循环包含时不会再次进入
+                self.include_resolver.mark_parsed(source, text)
                     
-                # 解析包含的头文件
-                includes = self._parse_includes(text)
-                self.logger.debug(f"发现包含文件: {includes}")
+                # 解析包含的头文件，每个头文件在会话中最多解析一次
+                includes = self.include_resolver.parse_include_directives(text)
+                if log_gate.debug:
+                    self.logger.debug(f"发现包含文件: {includes}")
                 
-                for include in includes:
+                for include, is_system in includes:
                     try:
-                        include_path = source.parent / include
-                        if include_path.exists():
-                            self.logger.info(f"解析包含文件: {include}")
-                            self.current_file = str(include_path)
-                            self.parse_declarations(include_path)
-                        else:
+                        include_path = self.include_resolver.resolve(include, source, is_system)
+                        if include_path is None:
                             self.logger.warning(f"包含文件不存在: {include}")
+                            continue
+                        self.include_resolver.add_edge(source, include_path)
+                        if self.include_resolver.should_skip(include_path, self.type_manager.get_macro_definition()):
+                            if log_gate.debug:
+                                self.logger.debug(f"跳过已解析或受保护的包含文件: {include}")
+                            continue
+                        self.logger.info(f"解析包含文件: {include}")
+                        self.parse_declarations(include_path)
                     except Exception as e:
                         self.logger.warning(f"解析包含文件失败: {include}, 错误: {e}")
+                self.current_file = str(source)
             else:
                 # 如果source是字符串，直接作为文件内容使用
                 text = source
+                content = None
                 self.current_file = "input_source"
-                self.logger.debug(f"使用字符串作为文件内容，长度: {len(text)}")
+                if log_gate.debug:
+                    self.logger.debug(f"使用字符串作为文件内容，长度: {len(text)}")
                 
             # 解析为AST
             if not tree:
-                self.logger.info("使用 TreeSitterUtil 解析文件")
+                if log_gate.debug:
+                    self.logger.debug("使用 TreeSitterUtil 解析文件")
                 try:
-                    # 直接传递文件内容，避免路径检查
-                    tree = self.ts_util.parse_source_code(text)
-                    if tree:
-                        self.logger.debug("语法树解析成功")
-                    else:
+                    # 文件直接解析读取到的字节，不再把解码后的文本重新编码
+                    tree = self.ts_util.parse_bytes(content) if content is not None \
+                        else self.ts_util.parse_text(text)
+                    if not tree:
                         self.logger.error("语法树解析失败")
+                    elif log_gate.debug:
+                        self.logger.debug("语法树解析成功")
                 except Exception as e:
                     self.logger.error(f"语法树解析出错: {e}")
                     return None
@@ -100,14 +283,12 @@ class CTypeParser:
                 self.logger.error(f"文件解析失败: {source}")
                 return None
             
-            self.logger.info("开始遍历语法树")
+            if log_gate.debug:
+                self.logger.debug("开始遍历语法树")
             try:
-                # 如果tree是Tree对象，获取其root_node
-                if hasattr(tree, 'root_node'):
-                    self._parse_tree(tree.root_node)
-                else:
-                    self._parse_tree(tree)
-                self.logger.debug("语法树遍历完成")
+                self.parse_tree(tree)
+                if log_gate.debug:
+                    self.logger.debug("语法树遍历完成")
             except Exception as e:
                 self.logger.exception(f"语法树遍历出错: {e}")
                 return None
@@ -116,7 +297,8 @@ class CTypeParser:
             try:
                 type_info = self.type_manager.export_types()
                 self.logger.info("=== Parsing completed ===")
-                self.logger.debug(f"解析结果: {json.dumps(type_info, indent=2)}")
+                if log_gate.debug:
+                    self.logger.debug(f"解析结果: {json.dumps(type_info, indent=2)}")
 
                 # 按类型分类
                 typedef_types = [t for t in type_info["types"] if t.get('kind') == 'typedef']
@@ -143,12 +325,26 @@ class CTypeParser:
             self.logger.exception(f"解析过程发生错误: {e}")
             return None
     
+    def parse_tree(self, node) -> None:
+        """解析已生成的语法树或其中的节点，登记其中的类型定义
+        
+        供已经持有语法树的调用方使用（例如CDataParser在一次遍历中同时
+        解析类型和变量），避免重复解析源码。
+        
+        Args:
+            node: Tree对象或AST节点
+        """
+        if hasattr(node, 'root_node'):
+            node = node.root_node
+        self._parse_tree(node)
+
     def _parse_tree(self, node):
         """递归解析语法树节点"""
-        self.logger.debug(f"解析节点: {node.type}")
+        if log_gate.debug:
+            self.logger.debug(f"解析节点: {node.type}")
         
         # 如果是translation_unit，显示其子节点
-        if node.type == 'translation_unit':
+        if node.type == 'translation_unit' and log_gate.debug:
             self.logger.debug(f"Translation unit children count: {len(node.children)}")
             for i, child in enumerate(node.children):
                 self.logger.debug(f"  Child {i}: {child.type} - {child.text.decode('utf8')[:50]}...")
@@ -163,20 +359,24 @@ class CTypeParser:
             self._parse_enum_definition(node)
         elif node.type == 'preproc_def':
             self._parse_macro_definition(node)
+        elif node.type == 'preproc_function_def':
+            if self.conditions is not None:
+                name = node.child_by_field_name('name')
+                if name is not None:
+                    self.conditions.define_function_macro(name.text.decode('utf8'))
+        elif node.type == 'preproc_call':
+            self._parse_preproc_call(node)
         elif node.type == 'declaration':
             # 处理声明节点，可能包含typedef
             self._parse_declaration_node(node)
-        elif node.type == 'translation_unit' or node.type == 'preproc_ifdef' or node.type == 'preproc_ifndef':
-            # 递归处理子节点
-            for child in node.children:
-                self._parse_tree(child)
-        elif node.type == 'preproc_if':
-            # 递归处理子节点
-            for child in node.children:
+        elif node.type in CONDITIONAL_NODES and self.conditions is not None:
+            # 只遍历条件成立的分支
+            for child in self.conditions.active_children(node):
                 self._parse_tree(child)
-        elif node.type == 'preproc_else':
-            # 递归处理子节点
-            for child in node.children:
+        elif node.type in ('translation_unit', 'preproc_ifdef', 'preproc_ifndef', 'preproc_if', 'preproc_elif',
+                           'preproc_elifdef', 'preproc_else'):
+            # 递归处理子节点，由TreeCursor逐个访问
+            for child in TreeSitterUtils.iter_children(node):
                 self._parse_tree(child)
         elif node.type == 'comment':
             # 跳过注释
@@ -190,16 +390,18 @@ class CTypeParser:
         elif node.type == '#ifndef' or node.type == '#define' or node.type == '#endif':
             # 跳过预处理指令
             pass
-        else:
+        elif log_gate.debug:
             self.logger.debug(f"Skipping node: {node.type} (text: {node.text.decode('utf8')})")
 
     def _parse_declaration_node(self, node):
         """解析声明节点，可能包含typedef"""
-        self.logger.debug(f"解析声明节点: {node.text.decode('utf8')}")
+        if log_gate.debug:
+            self.logger.debug(f"解析声明节点: {node.text.decode('utf8')}")
         
         # 检查是否是typedef声明
-        for child in node.children:
-            if child.type == 'storage_class_specifier' and child.text.decode('utf8') == 'typedef':
+        children = node.children
+        for child in children:
+            if child.type == 'storage_class_specifier' and child.text == b'typedef':
                 # 这是一个typedef声明
                 self._parse_typedef_declaration(node)
                 return
@@ -209,14 +411,15 @@ class CTypeParser:
                 return
         
         # 如果不是typedef，递归处理子节点
-        for child in node.children:
+        for child in children:
             self._parse_tree(child)
 
 
     def _parse_typedef_declaration(self, node):
         """解析typedef声明"""
-        self.logger.info("\n=== Parsing Typedef Declaration ===")
-        self.logger.debug(f"Node text: {node.text.decode('utf8')}")
+        if log_gate.debug:
+            self.logger.debug("=== Parsing Typedef Declaration ===")
+            self.logger.debug(f"Node text: {node.text.decode('utf8')}")
         
         # 收集所有类型定义
         typedef_infos = []
@@ -226,6 +429,7 @@ class CTypeParser:
         real_type = None
 
         declarators = []
+        array_dimensions = {}
         
         # 2. 遍历节点获取类型信息
         for child in node.children:
@@ -233,7 +437,8 @@ class CTypeParser:
                 if not base_type:  # 只取第一个类型标识符作为基类型
                     real_type = 'base'
                     base_type = child.text.decode('utf8')
-                    self.logger.debug(f"Found base type: {base_type}")
+                    if log_gate.debug:
+                        self.logger.debug(f"Found base type: {base_type}")
             
             # 处理结构体
             elif child.type == 'struct_specifier':
@@ -258,7 +463,8 @@ class CTypeParser:
                     # 如果还没有基础类型，这是基础类型
                     base_type = child.text.decode('utf8')
                     real_type = 'base'  # 假设是基本类型，之后会检查
-                    self.logger.debug(f"Found base type identifier: {base_type}")
+                    if log_gate.debug:
+                        self.logger.debug(f"Found base type identifier: {base_type}")
                 else:
                     # 如果已经有基础类型，这是声明器
                     declarators.append((child, False))
@@ -293,35 +499,29 @@ class CTypeParser:
                     
             elif child.type == 'function_declarator':
                 # 处理函数指针类型：typedef int (*FuncPtr)(int);
-                self.logger.debug(f"Processing function_declarator: {child.text.decode('utf8')}")
-                
-                # 在function_declarator中查找标识符
-                def find_identifier_in_function_declarator(node):
-                    """递归查找函数声明器中的标识符"""
-                    if node.type == 'type_identifier':
-                        return node
-                    
-                    for child_node in node.children:
-                        result = find_identifier_in_function_declarator(child_node)
-                        if result:
-                            return result
-                    return None
+                if log_gate.debug:
+                    self.logger.debug(f"Processing function_declarator: {child.text.decode('utf8')}")
                 
-                identifier = find_identifier_in_function_declarator(child)
+                # 函数声明器中按源码顺序的第一个类型名即为typedef名称
+                identifier = TreeSitterUtils.first_capture('type_names', child)
                 if identifier:
                     declarators.append((identifier, 'function'))
-                    self.logger.debug(f"Found function declarator: {identifier.text.decode('utf8')}")
+                    if log_gate.debug:
+                        self.logger.debug(f"Found function declarator: {identifier.text.decode('utf8')}")
                     
             elif child.type == 'array_declarator':
                 # 处理数组类型：typedef int Array[10];
-                self.logger.debug(f"Processing array_declarator: {child.text.decode('utf8')}")
+                if log_gate.debug:
+                    self.logger.debug(f"Processing array_declarator: {child.text.decode('utf8')}")
                 
-                # 查找数组声明器中的标识符
-                for array_child in child.children:
-                    if array_child.type == 'type_identifier':
-                        declarators.append((array_child, 'array'))
-                        self.logger.debug(f"Found array declarator: {array_child.text.decode('utf8')}")
-                        break
+                # 最内层声明器的类型名即为typedef名称（多维数组的名称在嵌套的声明器中）
+                dimensions, array_name = self._parse_array_dimensions(child)
+                identifier = TreeSitterUtils.first_capture('type_names', child) if array_name else None
+                if identifier is not None:
+                    declarators.append((identifier, 'array'))
+                    array_dimensions[array_name] = dimensions
+                    if log_gate.debug:
+                        self.logger.debug(f"Found array declarator: {array_name}")
         
         # 4. 为每个声明器创建类型信息
         for declarator, pointer_info in declarators:
@@ -345,13 +545,16 @@ class CTypeParser:
                     typedef_info['type'] = f"function_pointer"
                     typedef_info['real_type'] = 'function_pointer'
                     typedef_info['return_type'] = base_type
-                    self.logger.debug(f"Created function pointer typedef: {typedef_name}")
+                    if log_gate.debug:
+                        self.logger.debug(f"Created function pointer typedef: {typedef_name}")
                 elif pointer_info == 'array':
                     # 数组类型
                     typedef_info['type'] = f"array"
                     typedef_info['real_type'] = 'array'
                     typedef_info['element_type'] = base_type
-                    self.logger.debug(f"Created array typedef: {typedef_name}")
+                    typedef_info['array_size'] = array_dimensions.get(typedef_name)
+                    if log_gate.debug:
+                        self.logger.debug(f"Created array typedef: {typedef_name}")
             
             # 确保type字段不为None
             if typedef_info.get('type') is None:
@@ -359,7 +562,8 @@ class CTypeParser:
                 self.logger.warning(f"Had to set fallback type for {typedef_name}: {typedef_info['type']}")
             
             typedef_infos.append(typedef_info)
-            self.logger.info(f"Added typedef: {json.dumps(typedef_info, indent=2)}")
+            if log_gate.debug:
+                self.logger.debug(f"Added typedef: {json.dumps(typedef_info, indent=2)}")
         
             # 更新类型别名
             self._add_type_with_logging(typedef_name, typedef_info)
@@ -375,54 +579,56 @@ class CTypeParser:
         Returns:
             (struct_name, fields): 结构体名称和字段列表
         """
-        self.logger.info("\n=== Parsing Struct Definition ===")
-        self.logger.debug(f"Node text: {node.text.decode('utf8')}")
+        if log_gate.debug:
+            self.logger.debug("=== Parsing Struct Definition ===")
+            self.logger.debug(f"Node text: {node.text.decode('utf8')}")
         
         struct_name = None
         fields = []
         
         try:
             # 1. 获取结构体名称
-            for child in node.children:
-                if child.type == 'type_identifier':
-                    base_name = child.text.decode('utf8')
-                    # 检查是否已经包含 "struct" 前缀
-                    if not base_name.startswith('struct '):
-                        struct_name = f"struct {base_name}"
-                    else:
-                        struct_name = base_name
-                    self.logger.info(f"Found struct name: {struct_name}")
-                    break
+            name_node = node.child_by_field_name('name')
+            if name_node is not None:
+                base_name = name_node.text.decode('utf8')
+                # 检查是否已经包含 "struct" 前缀
+                if not base_name.startswith('struct '):
+                    struct_name = f"struct {base_name}"
+                else:
+                    struct_name = base_name
+                if log_gate.debug:
+                    self.logger.debug(f"Found struct name: {struct_name}")
 
             if not struct_name:
                 start_point = node.start_point
                 name_hash = hashlib.md5(node.text).hexdigest()[:6]
-                struct_name = f"__anon_struct_{start_point[0]}_{start_point[1]}_{name_hash}"
-                self.logger.debug(f"生成匿名结构体: {struct_name}")
+                struct_name = f"__anon_struct_{start_point[0] + self.line_offset}_{start_point[1]}_{name_hash}"
+                if log_gate.debug:
+                    self.logger.debug(f"生成匿名结构体: {struct_name}")
 
             # 2. 解析字段列表
-            for child in node.children:
-                if child.type == 'field_declaration_list':
-                    for field_node in child.children:
-                        if field_node.type == 'field_declaration':
-                            field_info = self._parse_field(field_node)
-                            if field_info:
-                                fields.append(field_info)
-                                self.logger.debug(f"Added field: {field_info['name']}, type: {field_info.get('type')}")
+            for field_node in self._iter_field_declarations(node):
+                field_info = self._parse_field(field_node)
+                if field_info:
+                    fields.append(field_info)
+                    if log_gate.debug:
+                        self.logger.debug(f"Added field: {field_info['name']}, type: {field_info.get('type')}")
             
             # 3. 检查字段有效性
             if fields:
-                self.logger.info(f"解析到 {len(fields)} 个字段")
-                for field in fields:
-                    if field.get('bit_field') is not None:
-                        self.logger.debug(f"字段 {field['name']} 是位域，大小: {field['bit_field']}")
-                    if field.get('array_size'):
-                        self.logger.debug(f"字段 {field['name']} 是数组，维度: {field['array_size']}")
-                    if field.get('nested_fields'):
-                        self.logger.debug(f"字段 {field['name']} 包含 {len(field['nested_fields'])} 个嵌套字段")
+                if log_gate.debug:
+                    self.logger.debug(f"解析到 {len(fields)} 个字段")
+                    for field in fields:
+                        if field.get('bit_field') is not None:
+                            self.logger.debug(f"字段 {field['name']} 是位域，大小: {field['bit_field']}")
+                        if field.get('array_size'):
+                            self.logger.debug(f"字段 {field['name']} 是数组，维度: {field['array_size']}")
+                        if field.get('nested_fields'):
+                            self.logger.debug(f"字段 {field['name']} 包含 {len(field['nested_fields'])} 个嵌套字段")
 
                 # 计算大小和对齐
-                size_info = self._calc_struct_layout(fields)
+                attributes = self._parse_layout_attributes(node)
+                size_info = self._calc_struct_layout(fields, attributes)
 
                 # 添加结构体类型并打印信息
                 type_info = {
@@ -432,6 +638,8 @@ class CTypeParser:
                     'size': size_info['size'],
                     'alignment': size_info['alignment'],
                 }
+                if attributes:
+                    type_info['attributes'] = attributes
             
                 self._add_type_with_logging(struct_name, type_info)
             else:
@@ -443,6 +651,16 @@ class CTypeParser:
             self.logger.exception(f"结构体解析错误: {str(e)}")
             return None, None
 
+    @staticmethod
+    def _iter_field_declarations(node):
+        """结构体/联合体定义体中的直接字段声明，嵌套类型的字段由 _parse_field 处理"""
+        body = node.child_by_field_name('body')
+        if body is None:
+            return
+        for child in TreeSitterUtils.iter_children(body):
+            if child.type == 'field_declaration':
+                yield child
+
     def _parse_union_definition(self, node):
         """解析联合体定义
         
@@ -452,57 +670,61 @@ class CTypeParser:
         Returns:
             (union_name, fields): 联合体名称和字段列表
         """
-        self.logger.info("\n=== Parsing Union Definition ===")
-        self.logger.debug(f"Node text: {node.text.decode('utf8')}")
+        if log_gate.debug:
+            self.logger.debug("=== Parsing Union Definition ===")
+            self.logger.debug(f"Node text: {node.text.decode('utf8')}")
         
         union_name = None
         fields = []
         
         try:
             # 1. 获取联合体名称
-            for child in node.children:
-                if child.type == 'type_identifier':
-                    base_name = child.text.decode('utf8')
-                    union_name = f"union {base_name}"
-                    self.logger.info(f"Found union name: {union_name}")
-                    break
+            name_node = node.child_by_field_name('name')
+            if name_node is not None:
+                union_name = f"union {name_node.text.decode('utf8')}"
+                if log_gate.debug:
+                    self.logger.debug(f"Found union name: {union_name}")
 
             if not union_name:
                 start_point = node.start_point
                 name_hash = hashlib.md5(node.text).hexdigest()[:6]
-                union_name = f"__anon_union_{start_point[0]}_{start_point[1]}_{name_hash}"
-                self.logger.debug(f"生成匿名联合体: {union_name}")
+                union_name = f"__anon_union_{start_point[0] + self.line_offset}_{start_point[1]}_{name_hash}"
+                if log_gate.debug:
+                    self.logger.debug(f"生成匿名联合体: {union_name}")
 
             # 2. 解析字段列表
-            for child in node.children:
-                if child.type == 'field_declaration_list':
-                    for field_node in child.children:
-                        if field_node.type == 'field_declaration':
-                            field_info = self._parse_field(field_node)
-                            if field_info and field_info['name']:
-                                fields.append(field_info)
-                                self.logger.debug(f"Added field: {field_info['name']}")
+            for field_node in self._iter_field_declarations(node):
+                field_info = self._parse_field(field_node)
+                if field_info and field_info['name']:
+                    fields.append(field_info)
+                    if log_gate.debug:
+                        self.logger.debug(f"Added field: {field_info['name']}")
             
             # 3. 检查字段有效性
             if fields:
-                self.logger.info(f"解析到 {len(fields)} 个字段")
-                for field in fields:
-                    if field.get('bit_field') is not None:
-                        self.logger.debug(f"字段 {field['name']} 是位域，大小: {field['bit_field']}")
-                    if field.get('array_size'):
-                        self.logger.debug(f"字段 {field['name']} 是数组，维度: {field['array_size']}")
-                    if field.get('nested_fields'):
-                        self.logger.debug(f"字段 {field['name']} 包含 {len(field['nested_fields'])} 个嵌套字段")
+                if log_gate.debug:
+                    self.logger.debug(f"解析到 {len(fields)} 个字段")
+                    for field in fields:
+                        if field.get('bit_field') is not None:
+                            self.logger.debug(f"字段 {field['name']} 是位域，大小: {field['bit_field']}")
+                        if field.get('array_size'):
+                            self.logger.debug(f"字段 {field['name']} 是数组，维度: {field['array_size']}")
+                        if field.get('nested_fields'):
+                            self.logger.debug(f"字段 {field['name']} 包含 {len(field['nested_fields'])} 个嵌套字段")
             else:
                 self.logger.warning("未找到任何字段")
 
+            attributes = self._parse_layout_attributes(node)
+            size_info = self._calc_union_layout(fields, attributes)
             union_info = {
                 'kind': 'union',
                 'name': union_name,
                 'fields': fields,
-                'size': self._calc_union_size(fields),
-                'alignment': self._calc_union_alignment(fields),
+                'size': size_info['size'],
+                'alignment': size_info['alignment'],
             }
+            if attributes:
+                union_info['attributes'] = attributes
 
             self._add_type_with_logging(union_name, union_info)
 
@@ -521,8 +743,9 @@ class CTypeParser:
         Returns:
             (enum_name, enum_values): 枚举名称和枚举值字典
         """
-        self.logger.info("\n=== Parsing Enum Definition ===")
-        self.logger.debug(f"Node text: {node.text.decode('utf8')}")
+        if log_gate.debug:
+            self.logger.debug("=== Parsing Enum Definition ===")
+            self.logger.debug(f"Node text: {node.text.decode('utf8')}")
         
         enum_name = None
         enum_values = {}
@@ -530,59 +753,64 @@ class CTypeParser:
         
         try:
             # 1. 获取枚举名称
-            for child in node.children:
-                if child.type == 'type_identifier':
-                    base_name = child.text.decode('utf8')
-                    enum_name = f"enum {base_name}"
-                    self.logger.info(f"Found enum name: {enum_name}")
-                    break
+            name_node = node.child_by_field_name('name')
+            if name_node is not None:
+                enum_name = f"enum {name_node.text.decode('utf8')}"
+                if log_gate.debug:
+                    self.logger.debug(f"Found enum name: {enum_name}")
             
-            # 2. 解析枚举值列表
-            for child in node.children:
-                if child.type == 'enumerator_list':
-                    for enumerator in child.children:
-                        if enumerator.type == 'enumerator':
-                            enumerator_name = None
-                            enumerator_value = current_value
-                            
-                            for enum_child in enumerator.children:
-                                if enum_child.type == 'identifier':
-                                    enumerator_name = enum_child.text.decode('utf8')
-                                elif enum_child.type == 'number_literal':
-                                    enumerator_value = int(enum_child.text.decode('utf8'))
-                                elif enum_child.type == 'binary_expression':
-                                    try:
-                                        value, value_type = ExpressionParser.parse(
-                                            enum_child.text.decode('utf8'),
-                                            self.type_manager.get_enum_values(),
-                                            self.type_manager.get_macro_definition()
-                                        )
-                                        if value_type == 'number' and isinstance(value, int):
-                                            enumerator_value = value
-                                        else:
-                                            self.logger.warning(f"Invalid enumerator value: {enum_child.text.decode('utf8')}")
-                                    except Exception as e:
-                                        self.logger.exception(f"Error parsing enumerator value: {e}")
-                            
-                            if enumerator_name:
-                                enum_values[enumerator_name] = enumerator_value
-                                self.logger.debug(f"Added enumerator: {enumerator_name} = {enumerator_value}")
-                                current_value = enumerator_value + 1
+            # 2. 解析枚举值列表：枚举项由预编译的查询捕获，名称和值按字段读取
+            body = node.child_by_field_name('body')
+            enumerators = TreeSitterUtils.captures('enumerators', body) if body is not None else []
+            for enumerator, _ in enumerators:
+                name_node = enumerator.child_by_field_name('name')
+                if name_node is None:
+                    continue
+                enumerator_name = name_node.text.decode('utf8')
+                enumerator_value = current_value
+                
+                value_node = enumerator.child_by_field_name('value')
+                if value_node is not None:
+                    value_text = value_node.text.decode('utf8')
+                    value = ExpressionParser.parse_number_literal(value_node.text) \
+                        if value_node.type == 'number_literal' else None
+                    if value_node.type == 'identifier' and value_text in enum_values:
+                        # 引用同一枚举中前面的枚举项
+                        enumerator_value = enum_values[value_text]
+                    elif isinstance(value, int):
+                        enumerator_value = value
+                    else:
+                        # 表达式、负数、宏和其他枚举的枚举项
+                        try:
+                            value, value_type = self.type_manager.evaluate_expression(value_text)
+                            if value_type == 'number' and isinstance(value, int):
+                                enumerator_value = value
+                            else:
+                                self.logger.warning(f"Invalid enumerator value: {value_text}")
+                        except Exception as e:
+                            self.logger.exception(f"Error parsing enumerator value: {e}")
+                
+                enum_values[enumerator_name] = enumerator_value
+                if log_gate.debug:
+                    self.logger.debug(f"Added enumerator: {enumerator_name} = {enumerator_value}")
+                current_value = enumerator_value + 1
             
             # 3. 检查枚举值有效性
             if enum_values:
-                self.logger.info(f"解析到 {len(enum_values)} 个枚举值")
+                if log_gate.debug:
+                    self.logger.debug(f"解析到 {len(enum_values)} 个枚举值")
             else:
                 self.logger.warning("未找到任何枚举值")
             
 
-            # 添加枚举类型并打印信息
+            # 添加枚举类型并打印信息，大小取决于目标ABI（通常为int大小）
+            enum_size = self.type_manager.get_layout_engine().abi.enum_size
             self._add_type_with_logging(enum_name, {
                 'kind': 'enum',
                 'name': enum_name,
                 'values': enum_values,
-                'size': 4,  # 通常枚举类型是int大小
-                'alignment': 4,
+                'size': enum_size,
+                'alignment': enum_size,
             })
 
             return enum_name, enum_values
@@ -600,8 +828,9 @@ class CTypeParser:
         Returns:
             (macro_name, macro_value): 宏名称和值
         """
-        self.logger.info("\n=== Parsing Macro Definition ===")
-        self.logger.debug(f"Node text: {node.text.decode('utf8')}")
+        if log_gate.debug:
+            self.logger.debug("=== Parsing Macro Definition ===")
+            self.logger.debug(f"Node text: {node.text.decode('utf8')}")
         
         macro_name = None
         macro_value = None
@@ -612,7 +841,8 @@ class CTypeParser:
                 if child.type == 'identifier':
                     if not macro_name:
                         macro_name = child.text.decode('utf8')
-                        self.logger.info(f"Found macro name: {macro_name}")
+                        if log_gate.debug:
+                            self.logger.debug(f"Found macro name: {macro_name}")
                         break
             
             # 2. 解析宏值
@@ -623,26 +853,21 @@ class CTypeParser:
                     'string_literal', 'char_literal'
                 ]:
                     text = child.text.decode('utf8').strip()
-                    self.logger.debug(f"Processing macro value: {text}")
-                    
-                    # 处理括号包围的表达式
-                    if text.startswith('(') and text.endswith(')'):
-                        text = text[1:-1].strip()
+                    if log_gate.debug:
+                        self.logger.debug(f"Processing macro value: {text}")
                     
                     try:
                         # 尝试解析表达式
-                        value, value_type = ExpressionParser.parse(
-                            text,
-                            self.type_manager.get_enum_values(),
-                            self.type_manager.get_macro_definition()
-                        )
+                        value, value_type = self.type_manager.evaluate_expression(text)
                         
                         if value_type == 'number':
                             macro_value = value
-                            self.logger.debug(f"Parsed numeric value: {value}")
+                            if log_gate.debug:
+                                self.logger.debug(f"Parsed numeric value: {value}")
                         elif value_type == 'string':
                             macro_value = text if text.startswith(("'", '"')) else f'"{text}"'
-                            self.logger.debug(f"Parsed string value: {macro_value}")
+                            if log_gate.debug:
+                                self.logger.debug(f"Parsed string value: {macro_value}")
                         else:
                             self.logger.error(f"Expression evaluation failed: {text}")
                             macro_value = text
@@ -651,14 +876,20 @@ class CTypeParser:
                         self.logger.exception(f"Error parsing macro value: {text}, error: {e}")
                         macro_value = text
             
+            if macro_name and macro_value is None and node.child_by_field_name('value') is None:
+                # 只定义不赋值（#define FEATURE），供 #ifdef / defined 判定
+                macro_value = ''
+            
             if macro_name and macro_value is not None:
-                self.logger.info(f"Successfully parsed macro: {macro_name} = {macro_value}")
+                if log_gate.debug:
+                    self.logger.debug(f"Successfully parsed macro: {macro_name} = {macro_value}")
             else:
                 self.logger.warning("Incomplete macro definition")
 
             if macro_name and macro_value is not None:
                 self.type_manager.add_macro_definition(macro_name, macro_value)
-                self.logger.debug(f"Added macro: {macro_name}")
+                if log_gate.debug:
+                    self.logger.debug(f"Added macro: {macro_name}")
 
             return macro_name, macro_value
             
@@ -679,21 +910,27 @@ class CTypeParser:
                 'nested_fields': None,
             }
             
-            # 1. 获取字段名称
+            # 子节点只访问一次，按种类分组后依次处理
+            type_nodes, pointer_nodes, array_nodes, bitfield_nodes = [], [], [], []
             for child in node.children:
-                if child.type == 'field_identifier':
-                    field_info['name'] = child.text.decode('utf8')
-                    break
+                child_type = child.type
+                if child_type == 'field_identifier':
+                    # 1. 获取字段名称
+                    if field_info['name'] is None:
+                        field_info['name'] = child.text.decode('utf8')
+                elif child_type in _FIELD_TYPE_NODES:
+                    type_nodes.append(child)
+                elif child_type == 'pointer_declarator':
+                    pointer_nodes.append(child)
+                elif child_type == 'array_declarator':
+                    array_nodes.append(child)
+                elif child_type == 'bitfield_clause':
+                    bitfield_nodes.append(child)
             
             # 2. 处理类型
-            for child in node.children:
-                if child.type in ['primitive_type', 'sized_type_specifier', 'type_identifier']:
-                    type_name = child.text.decode('utf8')
-                    field_info['type'] = type_name
-                    field_info['original_type'] = type_name
-                    
-                # 处理嵌套类型
-                elif child.type == 'struct_specifier':
+            for child in type_nodes:
+                if child.type == 'struct_specifier':
+                    # 处理嵌套类型
                     nested_name, nested_fields = self._parse_struct_definition(child)
                     field_info['nested_type'] = nested_name
                     field_info['type'] = nested_name
@@ -704,71 +941,71 @@ class CTypeParser:
                     field_info['type'] = nested_name
                     field_info['original_type'] = nested_name
                     field_info['nested_fields'] = nested_fields
+                else:
+                    type_name = child.text.decode('utf8')
+                    field_info['type'] = type_name
+                    field_info['original_type'] = type_name
             
-            # 3. 处理指针
-            for child in node.children:
-                if child.type == 'pointer_declarator':
-                    current = child
-                    pointer_count = 0
-                    
-                    while current:
-                        if current.type == 'pointer_declarator':
-                            pointer_count += 1
-                            next_ptr = None
-                            for ptr_child in current.children:
-                                if ptr_child.type == 'pointer_declarator':
-                                    next_ptr = ptr_child
-                                    break
-                            current = next_ptr
-                        else:
-                            break
-                    
-                    if pointer_count > 0:
-                        base_type = field_info['type']
-                        field_info['pointer_type'] = f"{base_type}{'*' * (pointer_count - 1)}"
-                        field_info['type'] = f"{base_type}{'*' * pointer_count}"
-                    
-                    for ptr_child in child.children:
-                        if ptr_child.type == 'field_identifier':
-                            field_info['name'] = ptr_child.text.decode('utf8')
-                            break
+            # 3. 处理指针：沿 declarator 字段数到最内层的字段名
+            for child in pointer_nodes:
+                current = child
+                pointer_count = 0
+                while current is not None and current.type == 'pointer_declarator':
+                    pointer_count += 1
+                    current = current.child_by_field_name('declarator')
+                
+                base_type = field_info['type']
+                field_info['pointer_type'] = f"{base_type}{'*' * (pointer_count - 1)}"
+                field_info['type'] = f"{base_type}{'*' * pointer_count}"
+                
+                if current is not None and current.type == 'field_identifier':
+                    field_info['name'] = current.text.decode('utf8')
             
             # 4. 处理数组
-            for child in node.children:
-                if child.type == 'array_declarator':
-                    array_sizes, array_name = self._parse_array_dimensions(child)
-                    if array_sizes:
-                        field_info['array_size'] = array_sizes
-                    if array_name:
-                        field_info['name'] = array_name
+            for child in array_nodes:
+                array_sizes, array_name = self._parse_array_dimensions(child)
+                if array_sizes:
+                    field_info['array_size'] = array_sizes
+                if array_name:
+                    field_info['name'] = array_name
             
-            # 5. 处理位域
-            for child in node.children:
-                if child.type == 'bitfield_clause':
-                    for bitfield_child in child.children:
-                        if bitfield_child.type == ':':
-                            continue
-                        elif bitfield_child.type in [
-                            'number_literal', 'hex_literal', 'octal_literal',
-                            'decimal_literal', 'binary_expression', 'identifier',
-                            'preproc_arg', 'unary_expression'
-                        ]:
-                            value, expression = self._parse_bitfield_value(bitfield_child)
-                            if value is not None:
-                                field_info['bit_field'] = value
+            # 5. 处理字段属性，例如 __attribute__((aligned(8)))
+            attributes = self._parse_layout_attributes(node)
+            if attributes:
+                field_info['attributes'] = attributes
+            
+            # 6. 处理位域
+            for child in bitfield_nodes:
+                for bitfield_child in child.children:
+                    if bitfield_child.type == ':':
+                        continue
+                    elif bitfield_child.type in [
+                        'number_literal', 'hex_literal', 'octal_literal',
+                        'decimal_literal', 'binary_expression', 'identifier',
+                        'preproc_arg', 'unary_expression'
+                    ]:
+                        value, expression = self._parse_bitfield_value(bitfield_child)
+                        if value is not None:
+                            field_info['bit_field'] = value
+                            if log_gate.debug:
                                 self.logger.debug(f"解析位域值: {value}")
-                            else:
-                                field_info['bit_field'] = expression
-                                self.logger.warning(f"使用原始表达式作为位域值: {expression}")
+                        else:
+                            field_info['bit_field'] = expression
+                            self.logger.warning(f"使用原始表达式作为位域值: {expression}")
             
-            self.logger.debug(f"解析字段: {field_info['name']} (类型: {field_info['type']})")
-            if field_info['array_size']:
-                self.logger.debug(f"- 数组大小: {field_info['array_size']}")
-            if field_info['bit_field']:
-                self.logger.debug(f"- 位域大小: {field_info['bit_field']}")
-            if field_info['nested_fields']:
-                self.logger.debug(f"- 嵌套字段数: {len(field_info['nested_fields'])}")
+            if log_gate.debug:
+                self.logger.debug(f"解析字段: {field_info['name']} (类型: {field_info['type']})")
+                if field_info['array_size']:
+                    self.logger.debug(f"- 数组大小: {field_info['array_size']}")
+                if field_info['bit_field']:
+                    self.logger.debug(f"- 位域大小: {field_info['bit_field']}")
+                if field_info['nested_fields']:
+                    self.logger.debug(f"- 嵌套字段数: {len(field_info['nested_fields'])}")
             
+            # 字段名和类型名在所有解析结果中共享
+            for key in ('name', 'type'):
+                if isinstance(field_info[key], str):
+                    field_info[key] = sys.intern(field_info[key])
             return field_info
             
         except Exception as e:
@@ -778,6 +1015,9 @@ class CTypeParser:
     def _parse_array_dimensions(self, declarator):
         """解析数组维度
         
+        沿 array_declarator 的 declarator 字段向内访问，每一层的 size 字段是一个维度，
+        最内层的标识符为数组名称。
+        
         Args:
             declarator: 数组声明节点
             
@@ -788,84 +1028,51 @@ class CTypeParser:
         name = None
         current = declarator
         
-        def find_identifier(node):
-            """递归查找标识符"""
-            if node.type in ['identifier', 'field_identifier']:
-                return node.text.decode('utf8')
-            for child in node.children:
-                if child.type in ['identifier', 'field_identifier']:
-                    return child.text.decode('utf8')
-                elif child.type == 'array_declarator':
-                    result = find_identifier(child)
-                    if result:
-                        return result
-            return None
-        
-        name = find_identifier(declarator)
-        self.logger.debug(f"Found array name: {name}")
-        
-        while current and current.type == 'array_declarator':
-            size_found = False
-            next_declarator = None
-            
-            for child in current.children:
-                if child.type == '[' or child.type == ']':
-                    continue
-                elif child.type == 'array_declarator':
-                    next_declarator = child
-                    continue
-                elif child.type in ['identifier', 'field_identifier']:
-                    continue
-                
-                # 处理数组大小表达式
-                if child.type in [
-                    'number_literal', 'hex_literal', 'octal_literal',
-                    'decimal_literal', 'binary_expression', 'identifier',
-                    'preproc_arg'
-                ]:
-                    try:
-                        value, value_type = ExpressionParser.parse(
-                            child.text.decode('utf8'),
-                            self.type_manager.get_enum_values(),
-                            self.type_manager.get_macro_definition()
-                        )
-                        
-                        if isinstance(value, (int, float)):
-                            array_sizes.append(int(value))
-                            size_found = True
-                            self.logger.debug(f"Found array size: {value}")
-                        else:
-                            self.logger.warning(f"Invalid array size value: {value}")
-                    except Exception as e:
-                        self.logger.exception(f"Error parsing array size: {e}")
-                        
-                # 处理变量大小数组
-                elif child.type == 'identifier' and child.text.decode('utf8') != name:
-                    size_var = child.text.decode('utf8')
-                    array_sizes.append(f"var({size_var})")
-                    size_found = True
-                    self.logger.debug(f"Found variable array size: {size_var}")
-            
-            # 处理动态数组
-            if not size_found:
-                array_sizes.append("dynamic")
-                self.logger.debug("Found dynamic array size")
-            
-            current = next_declarator
-        
-        # 反转维度列表以保持正确的顺序
+        while current is not None and current.type == 'array_declarator':
+            size_node = current.child_by_field_name('size')
+            size = self._evaluate_array_size(size_node) if size_node is not None else None
+            if size is None:
+                # 处理动态数组
+                size = "dynamic"
+                if log_gate.debug:
+                    self.logger.debug("Found dynamic array size")
+            array_sizes.append(size)
+            current = current.child_by_field_name('declarator')
+        
+        if current is not None and current.type in ('identifier', 'field_identifier', 'type_identifier'):
+            name = current.text.decode('utf8')
+            if log_gate.debug:
+                self.logger.debug(f"Found array name: {name}")
+        
+        # 外层的声明器是最后一维，反转维度列表以保持正确的顺序
         array_sizes.reverse()
-        self.logger.debug(f"Final array dimensions: {array_sizes}")
+        if log_gate.debug:
+            self.logger.debug(f"Final array dimensions: {array_sizes}")
         
         return array_sizes, name
 
+    def _evaluate_array_size(self, size_node) -> Optional[int]:
+        """求值数组维度表达式（字面量、宏、常量表达式），无法求值时返回None"""
+        text = size_node.text.decode('utf8')
+        try:
+            value, _ = self.type_manager.evaluate_expression(text)
+        except Exception as e:
+            self.logger.exception(f"Error parsing array size: {e}")
+            return None
+        if isinstance(value, (int, float)) and not isinstance(value, bool):
+            if log_gate.debug:
+                self.logger.debug(f"Found array size: {value}")
+            return int(value)
+        self.logger.warning(f"Invalid array size value: {value}")
+        return None
+
     def _get_node_location(self, node: Node) -> Dict:
         """获取节点位置信息"""
         try:
             line, col = node.start_point
             return {
                 'file': self.current_file,
-                'line': line + 1,
+                'line': line + 1 + self.line_offset,
                 'column': col
             }
         except Exception as e:
@@ -880,13 +1087,7 @@ class CTypeParser:
         Returns:
             包含文件路径列表
         """
-        includes = []
-        for line in text.splitlines():
-            if line.strip().startswith('#include'):
-                match = re.search(r'["<](.*?)[">]', line)
-                if match:
-                    includes.append(match.group(1))
-        return includes 
+        return [include for include, _ in self.include_resolver.parse_include_directives(text)]
 
     def _parse_function_pointer(self, node) -> Dict[str, Any]:
         """解析函数指针类型
@@ -982,15 +1183,9 @@ class CTypeParser:
         """
         try:
             text = node.text.decode('utf8').strip()
-            if text.startswith('(') and text.endswith(')'):
-                text = text[1:-1].strip()
             
             # 尝试解析表达式
-            value, value_type = ExpressionParser.parse(
-                text,
-                self.type_manager.get_enum_values(),
-                self.type_manager.get_macro_definition()
-            )
+            value, value_type = self.type_manager.evaluate_expression(text)
             
             # 检查值的有效性
             if value_type == 'number' and isinstance(value, int):
@@ -1008,7 +1203,7 @@ class CTypeParser:
             return None, text 
 
     def _print_type_info(self, type_name: str, type_info: Dict[str, Any], indent: int = 0):
-        """打印类型信息
+        """打印类型信息（debug级别）
         
         Args:
             type_name: 类型名称
@@ -1018,35 +1213,35 @@ class CTypeParser:
         prefix = "  " * indent
         kind = type_info.get('kind', 'unknown')
         
-        self.logger.info(f"\n{prefix}=== Type: {type_name} ({kind}) ===")
+        self.logger.debug(f"\n{prefix}=== Type: {type_name} ({kind}) ===")
         
         # 打印基本信息
         if 'size' in type_info:
-            self.logger.info(f"{prefix}Size: {type_info['size']} bytes")
+            self.logger.debug(f"{prefix}Size: {type_info['size']} bytes")
         if 'alignment' in type_info:
-            self.logger.info(f"{prefix}Alignment: {type_info['alignment']} bytes")
+            self.logger.debug(f"{prefix}Alignment: {type_info['alignment']} bytes")
         
         # 打印类型特定信息
         if kind == 'struct' or kind == 'union':
-            self.logger.info(f"{prefix}Fields:")
+            self.logger.debug(f"{prefix}Fields:")
             for field in type_info.get('fields', []):
                 field_type = field.get('type', 'unknown')
                 field_name = field.get('name', 'unnamed')
                 field_offset = field.get('offset', 0)
-                self.logger.info(f"{prefix}  - {field_name}: {field_type} (offset: {field_offset})")
+                self.logger.debug(f"{prefix}  - {field_name}: {field_type} (offset: {field_offset})")
                 
                 # 打印嵌套字段
                 if isinstance(field_type, dict):
                     self._print_type_info(field_name, field_type, indent + 2)
                 
         elif kind == 'enum':
-            self.logger.info(f"{prefix}Values:")
+            self.logger.debug(f"{prefix}Values:")
             for name, value in type_info.get('values', {}).items():
-                self.logger.info(f"{prefix}  - {name} = {value}")
+                self.logger.debug(f"{prefix}  - {name} = {value}")
                 
         elif kind == 'typedef':
             base_type = type_info.get('base_type', 'unknown')
-            self.logger.info(f"{prefix}Base type: {base_type}")
+            self.logger.debug(f"{prefix}Base type: {base_type}")
             
             # 如果基类型是复杂类型，递归打印
             if isinstance(base_type, dict):
@@ -1058,13 +1253,87 @@ class CTypeParser:
         self.type_manager.register_type(type_name, type_info)
         
         # 打印类型信息
-        self._print_type_info(type_name, type_info)
+        if log_gate.debug:
+            self._print_type_info(type_name, type_info)
 
-    def _calc_struct_layout(self, fields: List[Dict[str, Any]]) -> Dict[str, int]:
-        """计算结构体布局
+    def _parse_preproc_call(self, node) -> None:
+        """处理 #pragma pack(N) / pack(push, N) / pack(pop) / pack()，影响之后定义的结构体布局"""
+        directive = None
+        argument = ''
+        for child in node.children:
+            if child.type == 'preproc_directive':
+                directive = child.text.decode('utf8').strip()
+            elif child.type == 'preproc_arg':
+                argument = child.text.decode('utf8')
+        if directive != '#pragma':
+            return
+        match = _PRAGMA_PACK.match(argument)
+        if not match:
+            return
+        
+        args = [arg.strip() for arg in match.group(1).split(',') if arg.strip()]
+        value = None
+        for arg in args:
+            if arg == 'push':
+                self._pack_stack.append(self._pack)
+            elif arg == 'pop':
+                self._pack = self._pack_stack.pop() if self._pack_stack else None
+            else:
+                number, value_type = self.type_manager.evaluate_expression(arg)
+                if value_type == 'number' and isinstance(number, int) and number > 0:
+                    value = number
+        if value is not None:
+            self._pack = value
+        elif not args:
+            self._pack = None
+        if log_gate.debug:
+            self.logger.debug(f"#pragma pack({match.group(1)}) -> {self._pack}")
+
+    def _parse_layout_attributes(self, node) -> Dict[str, Any]:
+        """提取影响布局的属性：__attribute__((packed))、aligned(N) 和当前的 #pragma pack
+        
+        Args:
+            node: struct_specifier / union_specifier / field_declaration 节点
+            
+        Returns:
+            属性字典，可能包含 packed、aligned、pack
+        """
+        attributes = {}
+        nodes = list(node.children)
+        parent = getattr(node, 'parent', None)
+        if node.type in ('struct_specifier', 'union_specifier') and parent is not None \
+                and parent.type in ('type_definition', 'declaration'):
+            nodes.extend(parent.children)
+        
+        for child in nodes:
+            if child.type not in ('attribute_specifier', 'ms_declspec_modifier'):
+                continue
+            text = child.text.decode('utf8')
+            if _PACKED_ATTRIBUTE.search(text):
+                attributes['packed'] = True
+            match = _ALIGNED_ATTRIBUTE.search(text)
+            if match:
+                if match.group(1):
+                    value, value_type = self.type_manager.evaluate_expression(match.group(1))
+                    if value_type == 'number' and isinstance(value, int) and value > 0:
+                        attributes['aligned'] = value
+                    else:
+                        self.logger.warning(f"无法求值的对齐属性: {text}")
+                else:
+                    # 不带参数的 aligned 表示目标平台的最大对齐
+                    attributes['aligned'] = self.type_manager.get_layout_engine().abi.max_alignment
+        
+        if node.type in ('struct_specifier', 'union_specifier') and self._pack:
+            attributes['pack'] = self._pack
+        return attributes
+
+    def _calc_struct_layout(self, fields: List[Dict[str, Any]],
+                            attributes: Optional[Dict[str, Any]] = None) -> Dict[str, int]:
+        """计算结构体布局，并把字段偏移（位域还有位偏移）写回字段信息
         
         Args:
             fields: 字段列表
+            attributes: 结构体属性（packed、aligned、pack）
             
         Returns:
             包含size和alignment的字典
@@ -1072,33 +1341,36 @@ class CTypeParser:
         if not fields:
             return {'size': 0, 'alignment': 1}
         
-        current_offset = 0
-        max_alignment = 1
+        layout = self.type_manager.get_layout_engine().layout_fields('struct', fields, attributes=attributes)
+        for field_layout in layout.fields:
+            field = fields[field_layout.index]
+            field['offset'] = field_layout.offset
+            if field_layout.is_bitfield:
+                field['bit_offset'] = field_layout.bit_offset
         
-        for field in fields:
-            if not isinstance(field, dict):
-                continue
-                
-            field_type = field.get('type', '')
-            field_size = self._calc_field_size(field)
-            field_alignment = self._calc_field_alignment(field)
-            
-            # 更新最大对齐要求
-            max_alignment = max(max_alignment, field_alignment)
-            
-            # 计算当前字段的对齐后偏移量
-            current_offset = (current_offset + field_alignment - 1) & ~(field_alignment - 1)
-            field['offset'] = current_offset
-            
-            # 更新偏移量
-            current_offset += field_size
+        return {
+            'size': layout.size,
+            'alignment': layout.alignment
+        }
+    
+    def _calc_union_layout(self, fields: List[Dict[str, Any]],
+                           attributes: Optional[Dict[str, Any]] = None) -> Dict[str, int]:
+        """计算联合体的大小和对齐
         
-        # 结构体总大小需要对齐到最大对齐要求
-        total_size = (current_offset + max_alignment - 1) & ~(max_alignment - 1)
+        Args:
+            fields: 字段列表
+            attributes: 联合体属性（packed、aligned、pack）
+            
+        Returns:
+            包含size和alignment的字典
+        """
+        if not fields:
+            return {'size': 0, 'alignment': 1}
         
+        layout = self.type_manager.get_layout_engine().layout_fields('union', fields, attributes=attributes)
         return {
-            'size': total_size,
-            'alignment': max_alignment
+            'size': layout.size,
+            'alignment': layout.alignment
         }
     
     def _calc_union_size(self, fields: List[Dict[str, Any]]) -> int:
@@ -1110,15 +1382,7 @@ class CTypeParser:
         Returns:
             联合体大小
         """
-        if not fields:
-            return 0
-        
-        max_size = 0
-        for field in fields:
-            field_size = self._calc_field_size(field)
-            max_size = max(max_size, field_size)
-        
-        return max_size
+        return self._calc_union_layout(fields)['size']
     
     def _calc_union_alignment(self, fields: List[Dict[str, Any]]) -> int:
         """计算联合体对齐要求
@@ -1129,15 +1393,7 @@ class CTypeParser:
         Returns:
             联合体对齐要求
         """
-        if not fields:
-            return 1
-        
-        max_alignment = 1
-        for field in fields:
-            field_alignment = self._calc_field_alignment(field)
-            max_alignment = max(max_alignment, field_alignment)
-        
-        return max_alignment
+        return self._calc_union_layout(fields)['alignment']
     
     def _calc_field_size(self, field: Dict[str, Any]) -> int:
         """计算字段大小
@@ -1146,31 +1402,9 @@ class CTypeParser:
             field: 字段信息
             
         Returns:
-            字段大小（字节）
+            字段大小（字节），位域为其存储类型的大小
         """
-        field_type = field.get('type', '')
-        
-        # 处理位域
-        if field.get('bit_field') is not None:
-            # 位域按位计算，但至少占用1字节
-            bit_size = field['bit_field']
-            return max(1, (bit_size + 7) // 8)
-        
-        # 处理数组
-        array_size = field.get('array_size')
-        if array_size:
-            base_size = self.type_manager.get_type_size(field_type)
-            total_elements = 1
-            for size in array_size:
-                if isinstance(size, int):
-                    total_elements *= size
-                else:
-                    # 对于动态或变量大小，假设为1
-                    total_elements *= 1
-            return base_size * total_elements
-        
-        # 普通字段
-        return self.type_manager.get_type_size(field_type)
+        return self.type_manager.get_layout_engine().field_size(field)
     
     def _calc_field_alignment(self, field: Dict[str, Any]) -> int:
         """计算字段对齐要求
@@ -1181,16 +1415,4 @@ class CTypeParser:
         Returns:
             字段对齐要求（字节）
         """
-        field_type = field.get('type', '')
-        
-        # 处理位域
-        if field.get('bit_field') is not None:
-            # 位域通常按整型对齐
-            return 4
-        
-        # 处理数组 - 数组对齐与元素类型对齐相同
-        if field.get('array_size'):
-            return self.type_manager.get_type_alignment(field_type)
-        
-        # 普通字段
-        return self.type_manager.get_type_alignment(field_type) 
\ No newline at end of file
+        return self.type_manager.get_layout_engine().field_alignment(field)
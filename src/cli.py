@@ -1,29 +1,53 @@
+import time
+# 导入耗时也计入启动阶段，见 --timings
+_IMPORT_STARTED = time.perf_counter()
 import click
+import cProfile
+import io
+import pstats
+from contextlib import ExitStack
 from pathlib import Path
 from typing import List, Optional, Dict, Any
 from config import GeneratorConfig
-from c_parser import TypeManager,CTypeParser,CDataParser
-from utils.logger import logger 
+from c_parser import TypeManager,CTypeParser,CDataParser,ParseCache,IncludeResolver,BatchParser,IncrementalParser,ParseServer,TreeSitterUtils
+from c_parser.core import StreamingJsonWriter, TypeTable, json_default, ABI_PROFILES, BinaryDecoder, BinaryEncoder, StructColumns, write_columns, SourceChunker, TypeDatabase, write_type_database, SnapshotBuilder, diff_snapshots, format_diff
+from utils.logger import logger, configure_logging
+from utils.metrics import ParseMetrics, collect_metrics, timed_phase
 import json
 
+_IMPORT_MS = round((time.perf_counter() - _IMPORT_STARTED) * 1000, 3)
+
 @click.group()
 @click.option('--log-file', type=click.Path(), help='日志文件路径')
 @click.option('--log-level', 
               type=click.Choice(['DEBUG', 'INFO', 'WARNING', 'ERROR']),
               default='INFO',
               help='日志级别')
+@click.option('-q', '--quiet', is_flag=True, default=False, help='静默模式，只输出错误信息')
+@click.option('--timings', is_flag=True, default=False, help='退出时向stderr输出启动各阶段的耗时（毫秒）')
+@click.option('--stats', is_flag=True, default=False, help='退出时向stderr输出解析各阶段耗时、计数、缓存命中率和峰值RSS（JSON）')
+@click.option('--profile', is_flag=True, default=False, help='退出时向stderr输出阶段耗时报告和cProfile热点函数')
 @click.version_option(version='0.1.0')
-def cli(log_file: Optional[str], log_level: str):
+def cli(log_file: Optional[str], log_level: str, quiet: bool, timings: bool, stats: bool, profile: bool):
     """C结构体转换工具
     
     用于将C语言结构体转换为其他语言的数据结构。
     支持类型转换和代码生成。
     """
-    # 设置日志配置
+    # 设置日志配置，低于日志级别的调试信息不会被格式化
+    started = time.perf_counter()
+    configure_logging(log_level, quiet)
+    if timings:
+        phases = {'imports': _IMPORT_MS, 'configure_logging': round((time.perf_counter() - started) * 1000, 3)}
+        # 语言库在命令第一次创建解析器时加载，命令结束后再汇总
+        click.get_current_context().call_on_close(lambda: click.echo(
+            json.dumps({'startup_ms': {**phases, **TreeSitterUtils.get_startup_timings()}}), err=True))
+    if stats or profile:
+        _collect_command_metrics(click.get_current_context(), stats, profile)
     if log_file:
         logger.add(
             log_file,
-            log_level=log_level,
+            level=log_level,
             format="<green>{time:YYYY-MM-DD HH:mm:ss}</green> | <level>{level: <8}</level> | <cyan>{name}</cyan> | <level>{message}</level>",
             rotation="1 day",
             retention="7 days",
@@ -37,6 +61,28 @@ def cli(log_file: Optional[str], log_level: str):
             'type_manager': TypeManager(),
             'parser': None
         }
+def _collect_command_metrics(ctx: click.Context, stats: bool, profile: bool) -> None:
+    """在命令执行期间收集解析统计，命令结束后输出到stderr"""
+    metrics = ParseMetrics()
+    profiler = cProfile.Profile() if profile else None
+
+    def report():
+        if stats:
+            click.echo(json.dumps({'stats': metrics.to_dict()}), err=True)
+        if profiler is not None:
+            profiler.disable()
+            click.echo(metrics.format_report(), err=True)
+            text = io.StringIO()
+            pstats.Stats(profiler, stream=text).sort_stats('cumulative').print_stats(25)
+            click.echo(text.getvalue(), err=True)
+
+    # 退出顺序与注册顺序相反：先结束total阶段，再输出
+    ctx.call_on_close(report)
+    ctx.with_resource(collect_metrics(metrics))
+    ctx.with_resource(metrics.phase('total'))
+    if profiler is not None:
+        profiler.enable()
+
 @cli.command()
 @click.argument('config_file', type=click.Path())
 @click.option('--force/--no-force', default=False, help='强制覆盖已存在的配置文件')
@@ -65,18 +111,78 @@ def init_config(config_file: str, force: bool):
         raise click.ClickException(str(e))
 
 
+def _create_parse_cache(cache_dir: str, no_cache: bool) -> Optional[ParseCache]:
+    """根据命令行选项创建头文件解析缓存"""
+    if no_cache:
+        return None
+    return ParseCache(cache_dir)
+
+def _create_include_resolver(include_paths) -> IncludeResolver:
+    """根据命令行选项创建包含文件解析器"""
+    return IncludeResolver(list(include_paths))
+
+def _load_types(types_file: Optional[str]):
+    """读取 --types 指定的类型信息
+    
+    Returns:
+        (JSON类型信息, 类型库)：build-types 生成的类型库以mmap方式打开，不读取全部条目
+    """
+    if not types_file:
+        return None, None
+    if TypeDatabase.is_database(types_file):
+        return None, TypeDatabase(types_file)
+    with open(Path(types_file), "r") as f:
+        return json.load(f), None
+
+def _load_type_info(types_file: Optional[str]) -> Optional[Dict[str, Any]]:
+    """读取 --types 指定的类型信息为 export_types() 格式，用于分发给工作进程"""
+    type_info, type_database = _load_types(types_file)
+    if type_database is not None:
+        with type_database:
+            type_info = TypeManager(type_database=type_database).export_types()
+    return type_info
+
+# 目标ABI选项，决定结构体大小、对齐和字段偏移
+abi_option = click.option('--abi', type=click.Choice(list(ABI_PROFILES), case_sensitive=False), default='LP64',
+                          show_default=True, help='目标平台ABI')
+
+# 预定义宏选项，决定条件编译块中哪些分支被解析
+define_option = click.option('--define', '-D', 'defines', multiple=True,
+                             help='预定义宏，NAME 或 NAME=VALUE（NAME 等同于 NAME=1），可多次指定')
+
+def _parse_defines(defines) -> Dict[str, str]:
+    """把 -D 选项转换为 {宏名称: 值}，与编译器的 -D 规则一致"""
+    definitions = {}
+    for define in defines:
+        name, _, value = define.partition('=')
+        if not name.strip():
+            raise click.BadParameter(f"无效的宏定义: {define}", param_hint='--define')
+        definitions[name.strip()] = value if '=' in define else '1'
+    return definitions
+
 @cli.command()
 @click.argument('header_file', type=click.Path(exists=True), required=False)
-def parse(header_file):
+@click.option('--cache-dir', type=click.Path(), default=ParseCache.DEFAULT_DIR, help='头文件解析缓存目录')
+@click.option('--no-cache', is_flag=True, default=False, help='禁用头文件解析缓存')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@click.option('--show-includes', is_flag=True, default=False, help='输出包含关系图')
+@define_option
+@abi_option
+def parse(header_file, cache_dir, no_cache, include_paths, show_includes, defines, abi):
     """解析C头文件并显示类型信息。如果不提供头文件，则从缓存读取。"""
     try:
-        parser = CTypeParser()
+        type_manager = TypeManager(abi=abi)
+        type_manager.define_macros(_parse_defines(defines))
+        parser = CTypeParser(type_manager, parse_cache=_create_parse_cache(cache_dir, no_cache),
+                             include_resolver=_create_include_resolver(include_paths))
         
         if header_file:
             # 从头文件解析
             type_info = parser.parse_declarations(Path(header_file))
             with open(Path(header_file).stem + ".json", "w") as f:
                 json.dump(type_info, f, indent=4)
+            if show_includes:
+                click.echo(json.dumps(parser.get_include_graph(), indent=2, ensure_ascii=False))
         else:
             # 从缓存读取
             type_info = parser.get_type_info()
@@ -87,25 +193,89 @@ def parse(header_file):
         logger.exception(f"解析失败: {e}")
         raise click.ClickException(str(e))
 
+@cli.command('build-types')
+@click.argument('input_file', type=click.Path(exists=True, dir_okay=False))
+@click.option('--output', '-o', type=click.Path(), required=True, help='输出的类型库文件路径')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@define_option
+def build_types(input_file, output, include_paths, defines):
+    """把头文件或导出的类型信息JSON编译为二进制类型库
+    
+    类型库以mmap方式打开，按需查询，不在启动时加载全部类型，
+    通过 analyze --types 使用。
+    
+    示例：
+    \b
+    c-converter build-types sdk.h -I include -o sdk.stdb
+    c-converter analyze calib.c --types sdk.stdb
+    """
+    try:
+        if Path(input_file).suffix == '.json':
+            with open(Path(input_file), "r") as f:
+                type_info = json.load(f)
+        else:
+            type_manager = TypeManager()
+            type_manager.define_macros(_parse_defines(defines))
+            parser = CTypeParser(type_manager, include_resolver=_create_include_resolver(include_paths))
+            if parser.parse_declarations(Path(input_file)) is None:
+                raise click.ClickException(f"解析失败: {input_file}")
+            type_info = type_manager.export_types()
+        
+        counts = write_type_database(type_info, Path(output))
+        click.echo(f"类型库已保存到: {output}（{counts['types']} 个类型，{counts['macros']} 个宏）")
+            
+    except click.ClickException:
+        raise
+    except Exception as e:
+        logger.exception(f"生成类型库失败: {e}")
+        raise click.ClickException(str(e))
+
 @cli.command()
 @click.argument('source_file', type=click.Path(exists=True))
 @click.option('--header_file', type=click.Path(exists=True), help='头文件路径')
 @click.option('--output', '-o', type=click.Path(), help='输出文件路径')
 @click.option('--format', '-f', 
-              type=click.Choice(['text', 'json', 'json-simple']), 
+              type=click.Choice(['text', 'json', 'json-simple', 'ndjson']), 
               default='text',
-              help='输出格式：text(默认)、json(完整)或json-simple(精简)')
-def analyze(source_file, header_file, output, format):
+              help='输出格式：text(默认)、json(完整)、json-simple(精简)或ndjson(每行一个变量，流式输出)')
+@click.option('--types', 'types_file', type=click.Path(exists=True), help='预先导出的类型信息JSON文件或 build-types 生成的类型库')
+@click.option('--cache-dir', type=click.Path(), default=ParseCache.DEFAULT_DIR, help='头文件解析缓存目录')
+@click.option('--no-cache', is_flag=True, default=False, help='禁用头文件解析缓存')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@click.option('--stream', is_flag=True, default=False, help='边解析边输出变量，不在内存中保留解析结果')
+@click.option('--chunk-size', type=click.IntRange(min=1), default=SourceChunker.DEFAULT_CHUNK_SIZE >> 20,
+              help='流式输出时按顶层声明分块解析，每块的大小（MiB），默认4')
+@click.option('--typed-arrays', is_flag=True, default=False, help='一维数值数组使用紧凑的array.array保存')
+@click.option('--columnar', is_flag=True, default=False, help='一维结构体数组按字段列式保存，JSON中输出为columns对象')
+@click.option('--decode-jobs', type=click.IntRange(min=0), default=1,
+              help='大型数组初始化列表分段并行解码的进程数，0表示使用所有CPU核，默认1（不并行）')
+@click.option('--export-columns', type=click.Path(file_okay=False), help='将列式结构体数组导出到该目录，每个变量一个文件（隐含--columnar）')
+@click.option('--columns-format', type=click.Choice(['binary', 'parquet']), default='binary',
+              help='列式导出格式：binary(默认，紧凑二进制.scol)或parquet(需要pyarrow)')
+@click.option('--type-refs', type=click.Choice(['inline', 'reference']), default='inline',
+              help='变量类型信息的输出方式：inline(默认，每个变量带完整的类型定义)或reference(类型定义在type_table中只输出一次，变量通过info_ref引用)')
+@define_option
+@abi_option
+def analyze(source_file, header_file, output, format, types_file, cache_dir, no_cache, include_paths, stream, chunk_size,
+            typed_arrays, columnar, decode_jobs, export_columns, columns_format, type_refs, defines, abi):
     """解析C源文件中的变量定义"""
     try:
-        with open(Path("test_structs.json"), "r") as f:
-            type_info = json.load(f)
-        type_manager = TypeManager(type_info)      
-        parser = CDataParser(type_manager)
+        if export_columns and (stream or format == 'ndjson'):
+            raise click.ClickException("--export-columns 不能与流式输出同时使用")
+        type_info, type_database = _load_types(types_file)
+        type_manager = TypeManager(type_info, abi=abi, type_database=type_database)
+        type_manager.define_macros(_parse_defines(defines))
+        parser = CDataParser(type_manager, _create_parse_cache(cache_dir, no_cache),
+                             _create_include_resolver(include_paths), typed_arrays,
+                             columnar or bool(export_columns), decode_jobs)
         
-        # 如果提供了头文件，先解析头文件
+        # 如果提供了头文件，先解析头文件（命中缓存时不再调用tree-sitter）
         if header_file:
-            parser.type_parser.parse_declarations(header_file)
+            parser.type_parser.parse_declarations(Path(header_file))
+        
+        if stream or format == 'ndjson':
+            _analyze_streaming(parser, Path(source_file), output, format, chunk_size << 20, type_refs)
+            return
         
         # 解析源文件
         output_data = parser.parse_file(Path(source_file))
@@ -113,27 +283,419 @@ def analyze(source_file, header_file, output, format):
         if not output_data:
             raise click.ClickException("解析失败")
         
+        if export_columns:
+            _export_columns(output_data['variables'], Path(export_columns), columns_format)
+        
         # 格式化输出
+        default = json_default
         if format == 'json-simple':
             output_data = parser.get_simplified_output()
+        elif type_refs == 'reference':
+            # type_table 放在最后，编码变量时填充
+            type_table = TypeTable()
+            output_data = dict(output_data, type_table=type_table.types)
+            default = type_table.json_default
         
-        formatted = json.dumps(output_data, indent=2, ensure_ascii=False)
+        with timed_phase('export'):
+            formatted = json.dumps(output_data, indent=2, ensure_ascii=False, default=default)
+            
+            # 输出结果
+            if output:
+                Path(output).write_text(formatted, encoding='utf-8')
+                click.echo(f"解析结果已保存到: {output}")
+
+                simple_output = Path(output).stem + "_simple.json"
+
+                parser.export_simplified_json(simple_output)
+            else:
+                click.echo(formatted)
             
-        # 输出结果
+    except Exception as e:
+        logger.exception(f"解析失败: {e}")
+        raise click.ClickException(str(e))
+
+def _export_columns(variables: Dict[str, List[Dict[str, Any]]], directory: Path, columns_format: str) -> None:
+    """把列式保存的变量逐个导出为 <变量名>.scol 或 <变量名>.parquet"""
+    directory.mkdir(parents=True, exist_ok=True)
+    suffix = '.parquet' if columns_format == 'parquet' else '.scol'
+    count = 0
+    for var_list in variables.values():
+        for var in var_list:
+            if isinstance(var.get('parsed_value'), StructColumns):
+                write_columns(var['parsed_value'], directory / f"{var['name']}{suffix}")
+                count += 1
+    click.echo(f"已导出 {count} 个列式变量到: {directory}", err=True)
+
+def _analyze_streaming(parser: CDataParser, source_file: Path, output: Optional[str], format: str,
+                       chunk_size: int = SourceChunker.DEFAULT_CHUNK_SIZE, type_refs: str = 'inline') -> None:
+    """流式解析：文件按顶层声明分块解析，每个变量解析完成后立即写出，
+    内存占用与变量数量和文件大小无关"""
+    stream_format = 'ndjson' if format == 'ndjson' else 'json'
+    simplified = format == 'json-simple'
+    
+    with ExitStack() as stack:
+        if output:
+            out = stack.enter_context(open(output, 'w', encoding='utf-8'))
+        else:
+            out = click.get_text_stream('stdout')
+        type_table = TypeTable() if type_refs == 'reference' and not simplified else None
+        writer = StreamingJsonWriter(out, stream_format, simplified=simplified, type_table=type_table)
+        parser.add_output_writer(writer)
+        
+        # 与非流式输出一致，输出到文件时同时生成精简版本
+        simple_writer = None
+        if output and not simplified:
+            simple_output = Path(output).stem + "_simple.json"
+            simple_file = stack.enter_context(open(simple_output, 'w', encoding='utf-8'))
+            simple_writer = StreamingJsonWriter(simple_file, 'json', simplified=True)
+            parser.add_output_writer(simple_writer)
+        
+        result = parser.parse_file_chunked(source_file, chunk_size)
+        
+        types = None
+        if not simplified:
+            types = {key: result[key] for key in ('structs', 'unions', 'enums', 'typedefs')}
+        writer.close(types)
+        if simple_writer:
+            simple_writer.close()
+    
+    if output:
+        click.echo(f"解析结果已保存到: {output} ({writer.count} variables)")
+
+@cli.command()
+@click.argument('header_file', type=click.Path(exists=True))
+@click.option('--type', '-t', 'type_names', multiple=True, help='只输出指定类型的布局，可多次指定')
+@click.option('--output', '-o', type=click.Path(), help='输出文件路径')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@define_option
+@abi_option
+def layout(header_file, type_names, output, include_paths, defines, abi):
+    """输出头文件中结构体和联合体的布局表（字段偏移、位域、填充）
+    
+    示例：
+    \b
+    c-converter layout types.h --abi ARM_EABI -t "struct Packet"
+    """
+    try:
+        type_manager = TypeManager(abi=abi)
+        type_manager.define_macros(_parse_defines(defines))
+        parser = CTypeParser(type_manager, include_resolver=_create_include_resolver(include_paths))
+        if parser.parse_declarations(Path(header_file)) is None:
+            raise click.ClickException(f"解析失败: {header_file}")
+        
+        if not type_names:
+            type_names = [entry['name'] for entry in type_manager.export_types()['types']
+                          if entry.get('kind') in ('struct', 'union')]
+        layouts = []
+        for name in type_names:
+            type_layout = type_manager.get_type_layout(name)
+            if type_layout is None:
+                raise click.ClickException(f"不是结构体或联合体: {name}")
+            layouts.append(type_layout.to_dict())
+        
+        formatted = json.dumps({'abi': type_manager.abi, 'layouts': layouts}, indent=2, ensure_ascii=False)
         if output:
             Path(output).write_text(formatted, encoding='utf-8')
-            click.echo(f"解析结果已保存到: {output}")
+            click.echo(f"布局表已保存到: {output}")
+        else:
+            click.echo(formatted)
+            
+    except click.ClickException:
+        raise
+    except Exception as e:
+        logger.exception(f"布局计算失败: {e}")
+        raise click.ClickException(str(e))
 
-            simple_output = Path(output).stem + "_simple.json"
+@cli.command()
+@click.argument('old_file', type=click.Path(exists=True, dir_okay=False))
+@click.argument('new_file', type=click.Path(exists=True, dir_okay=False))
+@click.option('--header_file', type=click.Path(exists=True), help='两个版本共享的头文件')
+@click.option('--types', 'types_file', type=click.Path(exists=True), help='预先导出的类型信息JSON文件或 build-types 生成的类型库')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@click.option('--chunk', type=click.IntRange(min=1), default=SnapshotBuilder.CHUNK_SIZE, show_default=True,
+              help='数组每组的元素数量，变化范围按组对齐')
+@click.option('--format', '-f', type=click.Choice(['text', 'json']), default='text', help='输出格式')
+@click.option('--output', '-o', type=click.Path(), help='输出文件路径')
+@define_option
+@abi_option
+def diff(old_file, new_file, header_file, types_file, include_paths, chunk, format, output, defines, abi):
+    """比较同一数据文件的两个版本：变化的类型、布局和变量值范围
+    
+    两个版本分别解析并计算结构哈希（不保存变量值），从根摘要开始逐层比较，
+    相同的部分直接跳过。有差异时退出码为1。
+    
+    示例：
+    \b
+    c-converter diff release_1.c release_2.c --types sdk.stdb -f json
+    """
+    try:
+        type_info, type_database = _load_types(types_file)
+        base = TypeManager(type_info, abi=abi, type_database=type_database)
+        base.define_macros(_parse_defines(defines))
+        # 头文件只解析一次，两个版本通过 fork 共享
+        if header_file:
+            CTypeParser(base, include_resolver=_create_include_resolver(include_paths)).parse_declarations(
+                Path(header_file))
+        snapshots = []
+        for source_file in (old_file, new_file):
+            parser = CDataParser(base.fork(), include_resolver=_create_include_resolver(include_paths))
+            snapshots.append(parser.parse_snapshot(Path(source_file), chunk))
+        report = diff_snapshots(*snapshots)
+        
+        formatted = json.dumps(report, indent=2, ensure_ascii=False) if format == 'json' else format_diff(report)
+        if output:
+            Path(output).write_text(formatted, encoding='utf-8')
+            click.echo(f"差异报告已保存到: {output}")
+        else:
+            click.echo(formatted)
+            
+    except click.ClickException:
+        raise
+    except Exception as e:
+        logger.exception(f"比较失败: {e}")
+        raise click.ClickException(str(e))
+    if not report['identical']:
+        click.get_current_context().exit(1)
 
-            parser.export_simplified_json(simple_output)
+def _parse_int(ctx, param, value):
+    """解析十进制或0x开头的十六进制整数选项"""
+    if value is None:
+        return None
+    try:
+        return int(value, 0)
+    except ValueError:
+        raise click.BadParameter(f"不是整数: {value}")
+
+@cli.command()
+@click.argument('header_file', type=click.Path(exists=True))
+@click.argument('blob_file', type=click.Path(exists=True, dir_okay=False))
+@click.option('--type', '-t', 'type_name', required=True, help='记录的类型名称，例如 "struct Record"')
+@click.option('--offset', default='0', callback=_parse_int, help='起始偏移，支持0x前缀')
+@click.option('--count', '-n', default=None, callback=_parse_int, help='记录数量，默认解码到文件末尾')
+@click.option('--byte-order', type=click.Choice(['little', 'big']), default=None, help='字节序，默认取ABI的字节序')
+@click.option('--union-members', type=click.Choice(['first', 'all']), default='first', show_default=True,
+              help='联合体只解码第一个成员或解码所有成员')
+@click.option('--format', '-f', type=click.Choice(['json', 'ndjson']), default='json', help='输出格式')
+@click.option('--output', '-o', type=click.Path(), help='输出文件路径')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@abi_option
+def decode(header_file, blob_file, type_name, offset, count, byte_order, union_members, format, output,
+           include_paths, abi):
+    """按头文件中的结构体布局解码二进制数据（内存转储、Flash镜像）
+    
+    示例：
+    \b
+    c-converter decode types.h flash.bin -t "struct Record" --offset 0x1000 -n 512 --abi ARM_EABI
+    """
+    try:
+        type_manager = TypeManager(abi=abi)
+        parser = CTypeParser(type_manager, include_resolver=_create_include_resolver(include_paths))
+        if parser.parse_declarations(Path(header_file)) is None:
+            raise click.ClickException(f"解析失败: {header_file}")
+        
+        decoder = BinaryDecoder(type_manager, byte_order=byte_order, union_members=union_members)
+        if decoder.size_of(type_name) == 0:
+            raise click.ClickException(f"未知类型或大小为0: {type_name}")
+        
+        if format == 'ndjson':
+            with ExitStack() as stack:
+                out = stack.enter_context(open(output, 'w', encoding='utf-8')) if output else None
+                for record in decoder.iter_decode_file(blob_file, type_name, offset, count):
+                    click.echo(json.dumps(record, ensure_ascii=False, default=json_default), file=out)
+            return
+        
+        records = decoder.decode_file(blob_file, type_name, offset, count)
+        formatted = json.dumps({'type': type_name, 'offset': offset, 'count': len(records), 'records': records},
+                               indent=2, ensure_ascii=False, default=json_default)
+        if output:
+            Path(output).write_text(formatted, encoding='utf-8')
+            click.echo(f"解码结果已保存到: {output} ({len(records)} records)")
         else:
             click.echo(formatted)
             
+    except click.ClickException:
+        raise
     except Exception as e:
-        logger.exception(f"解析失败: {e}")
+        logger.exception(f"解码失败: {e}")
         raise click.ClickException(str(e))
 
+@cli.command()
+@click.argument('header_file', type=click.Path(exists=True))
+@click.argument('values_file', type=click.Path(exists=True, dir_okay=False))
+@click.option('--output', '-o', type=click.Path(), required=True, help='输出的二进制文件路径')
+@click.option('--map', 'map_file', type=click.Path(), help='输出变量偏移表（JSON）的文件路径')
+@click.option('--byte-order', type=click.Choice(['little', 'big']), default=None, help='字节序，默认取ABI的字节序')
+@click.option('--lenient', is_flag=True, default=False, help='无法求值的值（例如 &symbol）写入0，不报错')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@abi_option
+def encode(header_file, values_file, output, map_file, byte_order, lenient, include_paths, abi):
+    """把 analyze 输出的变量值按头文件中的布局编码为二进制镜像
+    
+    VALUES_FILE 可以是 json-simple / json 格式的输出，或每行一个变量的 ndjson。
+    
+    示例：
+    \b
+    c-converter encode types.h calib_simple.json -o calib.bin --map calib_map.json --abi ARM_EABI
+    """
+    try:
+        type_manager = TypeManager(abi=abi)
+        parser = CTypeParser(type_manager, include_resolver=_create_include_resolver(include_paths))
+        if parser.parse_declarations(Path(header_file)) is None:
+            raise click.ClickException(f"解析失败: {header_file}")
+        
+        text = Path(values_file).read_text(encoding='utf-8')
+        if values_file.endswith('.ndjson'):
+            values = [json.loads(line) for line in text.splitlines() if line.strip()]
+            values = [v for v in values if 'parsed_value' in v]
+        else:
+            values = json.loads(text)
+        
+        encoder = BinaryEncoder(type_manager, byte_order=byte_order, strict=not lenient)
+        image = encoder.encode_variables(values)
+        Path(output).write_bytes(image['data'])
+        if map_file:
+            Path(map_file).write_text(json.dumps({'abi': abi, 'symbols': image['symbols'], 'skipped': image['skipped']},
+                                                 indent=2, ensure_ascii=False), encoding='utf-8')
+        click.echo(f"编码结果已保存到: {output} ({len(image['symbols'])} variables, {len(image['data'])} bytes)")
+        
+    except click.ClickException:
+        raise
+    except Exception as e:
+        logger.exception(f"编码失败: {e}")
+        raise click.ClickException(str(e))
+
+@cli.command()
+@click.argument('source_files', nargs=-1, required=True, type=click.Path(exists=True, dir_okay=False))
+@click.option('--header_file', type=click.Path(exists=True), help='所有文件共享的头文件，在主进程中解析一次')
+@click.option('--types', 'types_file', type=click.Path(exists=True), help='预先导出的类型信息JSON文件或 build-types 生成的类型库')
+@click.option('--interval', type=float, default=0.5, show_default=True, help='检查文件修改的间隔（秒）')
+@click.option('--values/--no-values', default=True, help='是否在更新记录中输出重新解析的变量值')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@abi_option
+def watch(source_files, header_file, types_file, interval, values, include_paths, abi):
+    """监视C源文件，保存后增量重新解析，每次更新输出一行JSON
+    
+    只重新遍历修改过的顶层声明；按 Ctrl+C 退出。
+    
+    示例：
+    \b
+    c-converter watch calib.c params.c --header_file types.h
+    """
+    try:
+        type_info = _load_type_info(types_file)
+        if header_file:
+            type_manager = TypeManager(type_info, abi=abi)
+            CTypeParser(type_manager, include_resolver=_create_include_resolver(include_paths)) \
+                .parse_declarations(Path(header_file))
+            type_info = type_manager.export_types()
+        
+        watcher = IncrementalParser(type_info, include_paths, abi=abi)
+        
+        def emit(summary):
+            if values and summary['changed']:
+                simplified = watcher.get_parser(summary['file']).get_simplified_output()['variables']
+                changed = set(summary['changed'])
+                summary = dict(summary, variables=[var for var in simplified if var['name'] in changed])
+            click.echo(json.dumps(summary, ensure_ascii=False, default=json_default))
+        
+        for source_file in source_files:
+            emit(watcher.update(source_file))
+        while True:
+            time.sleep(interval)
+            for summary in watcher.poll():
+                emit(summary)
+                
+    except KeyboardInterrupt:
+        return
+    except Exception as e:
+        logger.exception(f"监视失败: {e}")
+        raise click.ClickException(str(e))
+
+@cli.command()
+@click.option('--socket', 'socket_path', type=click.Path(), help='Unix域套接字路径，默认使用标准输入输出')
+@click.option('--workers', type=int, default=None, help='处理请求的线程数，默认为CPU核数')
+@click.option('--cache-dir', type=click.Path(), default=ParseCache.DEFAULT_DIR, help='头文件解析缓存目录')
+@click.option('--no-cache', is_flag=True, default=False, help='禁用头文件解析缓存')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='默认的包含文件搜索路径，可多次指定')
+@abi_option
+def serve(socket_path, workers, cache_dir, no_cache, include_paths, abi):
+    """常驻解析服务（JSON-RPC 2.0，每行一个请求）
+    
+    语言库和头文件类型环境在请求之间复用，支持 parse、analyze、resolve_type 和 layout 方法。
+    
+    示例：
+    \b
+    c-converter -q serve --socket /tmp/struct-converter.sock
+    echo '{"jsonrpc": "2.0", "id": 1, "method": "layout", "params": {"header": "types.h"}}' | c-converter -q serve
+    """
+    server = ParseServer(include_paths, None if no_cache else cache_dir, abi, workers)
+    try:
+        if socket_path:
+            server.serve_unix(socket_path)
+        else:
+            server.serve_stdio(click.get_text_stream('stdin'), click.get_text_stream('stdout'))
+    except KeyboardInterrupt:
+        return
+    except Exception as e:
+        logger.exception(f"服务异常退出: {e}")
+        raise click.ClickException(str(e))
+    finally:
+        server.close()
+
+@cli.command('analyze-batch')
+@click.argument('directory', type=click.Path(exists=True, file_okay=False))
+@click.option('--pattern', default=BatchParser.DEFAULT_PATTERN, show_default=True, help='要解析的文件匹配模式')
+@click.option('--jobs', '-j', type=int, default=None, help='工作进程数量，默认为CPU核数')
+@click.option('--header_file', type=click.Path(exists=True), help='所有文件共享的头文件')
+@click.option('--types', 'types_file', type=click.Path(exists=True), help='预先导出的类型信息JSON文件或 build-types 生成的类型库')
+@click.option('--output', '-o', type=click.Path(), help='输出文件路径')
+@click.option('--cache-dir', type=click.Path(), default=ParseCache.DEFAULT_DIR, help='头文件解析缓存目录')
+@click.option('--no-cache', is_flag=True, default=False, help='禁用头文件解析缓存')
+@click.option('--include-path', '-I', 'include_paths', multiple=True, type=click.Path(), help='包含文件搜索路径，可多次指定')
+@define_option
+@abi_option
+def analyze_batch(directory, pattern, jobs, header_file, types_file, output, cache_dir, no_cache, include_paths,
+                  defines, abi):
+    """并行解析目录下的所有C源文件并合并结果
+    
+    示例：
+    \b
+    c-converter analyze-batch data/ -j 32 --header_file types.h -o result.json
+    
+    -I、--cache-dir 和 --no-cache 只作用于 --header_file 的解析，源文件中的 #include 不展开。
+    """
+    try:
+        type_info = _load_type_info(types_file)
+        macros = _parse_defines(defines)
+        
+        # 共享的头文件只在主进程中解析一次，结果分发给所有工作进程
+        if header_file:
+            type_manager = TypeManager(type_info, abi=abi)
+            type_manager.define_macros(macros)
+            parser = CTypeParser(type_manager, _create_parse_cache(cache_dir, no_cache),
+                                 _create_include_resolver(include_paths))
+            type_info = parser.parse_declarations(Path(header_file))
+            if type_info is None:
+                raise click.ClickException(f"解析失败: {header_file}")
+        
+        batch = BatchParser(type_info, jobs=jobs, abi=abi, macros=macros)
+        result = batch.parse_directory(Path(directory), pattern)
+        
+        formatted = json.dumps(result, indent=2, ensure_ascii=False, default=json_default)
+        if output:
+            Path(output).write_text(formatted, encoding='utf-8')
+            click.echo(f"解析结果已保存到: {output}")
+        else:
+            click.echo(formatted)
+        
+        if result['errors']:
+            raise click.ClickException(f"{len(result['errors'])} 个文件解析失败")
+            
+    except click.ClickException:
+        raise
+    except Exception as e:
+        logger.exception(f"解析失败: {e}")
+        raise click.ClickException(str(e))
 
 
 if __name__ == '__main__':
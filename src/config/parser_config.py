@@ -10,6 +10,8 @@ class ParserConfig(BaseConfig):
         self.macro_definitions: Dict[str, str] = {}
         self.enable_doc_comments: bool = True
         self.enable_location_tracking: bool = True
+        self.cache_dir: str = ".struct_converter_cache"
+        self.enable_parse_cache: bool = True
         
     def _validate_config(self) -> None:
         """验证解析器配置"""
@@ -22,4 +24,6 @@ class ParserConfig(BaseConfig):
         self.include_paths = self.config_data.get('include_paths', [])
         self.macro_definitions = self.config_data.get('macro_definitions', {})
         self.enable_doc_comments = self.config_data.get('enable_doc_comments', True)
-        self.enable_location_tracking = self.config_data.get('enable_location_tracking', True) 
\ No newline at end of file
+        self.enable_location_tracking = self.config_data.get('enable_location_tracking', True)
+        self.cache_dir = self.config_data.get('cache_dir', ".struct_converter_cache")
+        self.enable_parse_cache = self.config_data.get('enable_parse_cache', True)
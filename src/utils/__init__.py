@@ -1,8 +1,14 @@
 from .cache import cached
-from .logger import logger,log_execution
+from .logger import logger,log_execution,log_gate,set_log_level,set_quiet
+from .metrics import ParseMetrics,collect_metrics
 
 __all__ = [
     'cached',
     'logger',
-    'log_execution'
+    'log_execution',
+    'log_gate',
+    'set_log_level',
+    'set_quiet',
+    'ParseMetrics',
+    'collect_metrics'
 ]
@@ -1,9 +1,101 @@
 import functools
+import os
+import sys
 import time
-from typing import Callable, Any
+from typing import Callable, Any, Optional
 from loguru import logger
 
-__all__ = ['logger']
+__all__ = ['logger', 'log_gate', 'set_log_level', 'set_quiet', 'configure_logging']
+
+# 库内日志所在的包，静默模式下整体禁用
+LIBRARY_PACKAGES = ('c_parser', 'utils')
+
+
+class LogGate:
+    """热点路径的日志开关
+
+    loguru 只在记录时比较级别，调用方传入的 f-string、node.text.decode()
+    和 json.dumps() 在此之前就已经求值。热点路径在构造消息前先检查开关：
+
+    ```python
+    if log_gate.debug:
+        self.logger.debug(f"Node text: {node.text.decode('utf8')}")
+    ```
+
+    开关关闭时整条日志语句只剩一次属性读取。debug 开关默认关闭，
+    configure_logging / set_log_level 设置为 DEBUG 级别时打开，
+    作为库使用时也可以通过环境变量 STRUCT_CONVERTER_LOG_LEVEL=DEBUG 打开。
+    """
+
+    __slots__ = ('debug',)
+
+    def __init__(self):
+        self.debug = False
+
+
+log_gate = LogGate()
+
+_stderr_handler_id: Optional[int] = 0  # loguru 默认的 stderr 输出
+# set_log_level 最近设置的级别，静默模式关闭时恢复开启前的级别
+_log_level = 'INFO'
+_level_before_quiet: Optional[str] = None
+
+
+def set_log_level(level: str) -> None:
+    """设置热点路径日志开关的最低级别
+
+    只影响经过 log_gate 检查的日志语句，不修改loguru的输出配置。
+
+    Args:
+        level: 日志级别名称，例如 DEBUG、INFO、WARNING
+    """
+    global _log_level
+    level_no = logger.level(level.upper()).no
+    log_gate.debug = level_no <= logger.level('DEBUG').no
+    _log_level = level.upper()
+
+
+def set_quiet(quiet: bool = True) -> None:
+    """静默模式
+
+    开启后关闭所有热点路径日志开关，并禁用库内所有模块的日志输出；
+    嵌入到其他程序中使用时不产生任何日志开销。关闭后恢复开启前的级别
+    （未设置过级别时为 INFO），不会打开 debug 开关。
+
+    Args:
+        quiet: 是否开启静默模式
+    """
+    global _level_before_quiet
+    for package in LIBRARY_PACKAGES:
+        if quiet:
+            logger.disable(package)
+        else:
+            logger.enable(package)
+    if quiet:
+        if _level_before_quiet is None:
+            _level_before_quiet = _log_level
+        set_log_level('WARNING')
+    else:
+        set_log_level(_level_before_quiet or _log_level)
+        _level_before_quiet = None
+
+
+def configure_logging(level: str = 'INFO', quiet: bool = False) -> None:
+    """配置命令行程序的日志输出：stderr 只输出不低于 level 的日志
+
+    Args:
+        level: 日志级别
+        quiet: 是否开启静默模式（只保留错误信息）
+    """
+    global _stderr_handler_id
+    if _stderr_handler_id is not None:
+        try:
+            logger.remove(_stderr_handler_id)
+        except ValueError:
+            pass
+    level = 'ERROR' if quiet else level.upper()
+    _stderr_handler_id = logger.add(sys.stderr, level=level)
+    set_log_level(level)
 
 
 def log_execution(func: Callable) -> Callable:
@@ -14,12 +106,19 @@ def log_execution(func: Callable) -> Callable:
         try:
             result = func(*args, **kwargs)
             duration = time.time() - start_time
-            logger.debug(f"{func.__name__} completed in {duration:.3f}s")
+            if log_gate.debug:
+                logger.debug(f"{func.__name__} completed in {duration:.3f}s")
             return result
         except Exception as e:
             duration = time.time() - start_time
             logger.error(f"{func.__name__} failed after {duration:.3f}s: {e}")
             raise
-    return wrapper 
+    return wrapper
+
+logger.add("logs/debug.log", level="ERROR", mode='w')
 
-logger.add("logs/debug.log", level="ERROR", mode='w')
\ No newline at end of file
+# 作为库使用时可通过环境变量控制：STRUCT_CONVERTER_QUIET=1 或 STRUCT_CONVERTER_LOG_LEVEL=INFO
+if os.environ.get('STRUCT_CONVERTER_QUIET', '').lower() in ('1', 'true', 'yes'):
+    set_quiet(True)
+elif os.environ.get('STRUCT_CONVERTER_LOG_LEVEL'):
+    set_log_level(os.environ['STRUCT_CONVERTER_LOG_LEVEL'])
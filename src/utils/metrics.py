@@ -0,0 +1,169 @@
+import contextvars
+import time
+from contextlib import contextmanager, nullcontext
+from typing import Dict, Any, Optional, Iterator
+
+__all__ = ['ParseMetrics', 'collect_metrics', 'active_metrics', 'timed_phase', 'count', 'peak_rss']
+
+
+class ParseMetrics:
+    """解析各阶段的耗时、计数和内存统计
+
+    阶段耗时按名称累计（同一阶段可以多次进入），嵌套阶段的耗时同时计入外层阶段。
+    阶段结束时读取进程的峰值RSS（由内核记录，包含阶段内部的峰值），
+    读取间隔至少 SAMPLE_INTERVAL 秒，逐个变量计时的阶段不会每次都查询进程内存。
+
+    用法示例：
+    ```python
+    with collect_metrics() as metrics:
+        parser.parse_file(Path('calib.c'))
+    print(metrics.to_dict())
+    ```
+    """
+
+    SAMPLE_INTERVAL = 0.01
+
+    def __init__(self):
+        self._sampled_at = 0.0
+        self.phases: Dict[str, float] = {}
+        self.calls: Dict[str, int] = {}
+        self.counters: Dict[str, int] = {}
+        self.caches: Dict[str, Dict[str, Any]] = {}
+        self.peak_rss: Optional[int] = None
+
+    @contextmanager
+    def phase(self, name: str) -> Iterator[None]:
+        """统计一个阶段的耗时
+
+        Args:
+            name: 阶段名称，例如 read、parse、variable_walk
+        """
+        started = time.perf_counter()
+        try:
+            yield
+        finally:
+            now = time.perf_counter()
+            self.phases[name] = self.phases.get(name, 0.0) + now - started
+            self.calls[name] = self.calls.get(name, 0) + 1
+            if now - self._sampled_at >= self.SAMPLE_INTERVAL:
+                self._sampled_at = now
+                self.sample_memory()
+
+    def count(self, name: str, value: int = 1) -> None:
+        """累加计数器"""
+        self.counters[name] = self.counters.get(name, 0) + value
+
+    def record_cache(self, name: str, hits: int, misses: int) -> None:
+        """记录缓存命中情况，同名缓存重复记录时累加"""
+        entry = self.caches.setdefault(name, {'hits': 0, 'misses': 0})
+        entry['hits'] += hits
+        entry['misses'] += misses
+        total = entry['hits'] + entry['misses']
+        entry['hit_rate'] = round(entry['hits'] / total, 4) if total else None
+
+    def sample_memory(self) -> None:
+        """读取进程的峰值RSS并更新记录"""
+        rss = peak_rss()
+        if rss is not None and (self.peak_rss is None or rss > self.peak_rss):
+            self.peak_rss = rss
+
+    def merge(self, other: 'ParseMetrics') -> None:
+        """合并另一份统计（例如批量解析的各个文件）"""
+        for name, seconds in other.phases.items():
+            self.phases[name] = self.phases.get(name, 0.0) + seconds
+            self.calls[name] = self.calls.get(name, 0) + other.calls.get(name, 0)
+        for name, value in other.counters.items():
+            self.count(name, value)
+        for name, entry in other.caches.items():
+            self.record_cache(name, entry['hits'], entry['misses'])
+        if other.peak_rss is not None and (self.peak_rss is None or other.peak_rss > self.peak_rss):
+            self.peak_rss = other.peak_rss
+
+    def to_dict(self) -> Dict[str, Any]:
+        """转换为可JSON序列化的字典，耗时单位为毫秒"""
+        return {
+            'phases_ms': {name: round(seconds * 1000, 3) for name, seconds in self.phases.items()},
+            'calls': dict(self.calls),
+            'counters': dict(self.counters),
+            'caches': {name: dict(entry) for name, entry in self.caches.items()},
+            'peak_rss_bytes': self.peak_rss,
+        }
+
+    def format_report(self) -> str:
+        """生成按耗时排序的文本报告"""
+        lines = [f"{'phase':<24}{'calls':>8}{'ms':>12}"]
+        for name, seconds in sorted(self.phases.items(), key=lambda item: -item[1]):
+            lines.append(f"{name:<24}{self.calls.get(name, 0):>8}{seconds * 1000:>12.3f}")
+        for name, value in self.counters.items():
+            lines.append(f"{name:<24}{value:>20}")
+        for name, entry in self.caches.items():
+            rate = '-' if entry['hit_rate'] is None else f"{entry['hit_rate']:.1%}"
+            lines.append(f"{name + ' cache':<24}{entry['hits']:>8} hits {entry['misses']:>8} misses {rate:>7}")
+        if self.peak_rss is not None:
+            lines.append(f"{'peak rss':<24}{self.peak_rss / (1 << 20):>17.1f} MiB")
+        return '\n'.join(lines)
+
+
+# 当前线程/上下文正在收集的统计，未收集时为None，埋点只做一次读取
+_active: contextvars.ContextVar = contextvars.ContextVar('parse_metrics', default=None)
+
+
+def active_metrics() -> Optional[ParseMetrics]:
+    """获取当前正在收集的统计，未开启时返回None"""
+    return _active.get()
+
+
+@contextmanager
+def collect_metrics(metrics: Optional[ParseMetrics] = None) -> Iterator[ParseMetrics]:
+    """在with块内收集解析统计
+
+    Args:
+        metrics: 累加到已有的统计，默认新建
+
+    Yields:
+        ParseMetrics
+    """
+    metrics = metrics if metrics is not None else ParseMetrics()
+    token = _active.set(metrics)
+    try:
+        yield metrics
+    finally:
+        _active.reset(token)
+
+
+def timed_phase(name: str):
+    """统计当前上下文中一个阶段的耗时，未收集统计时不做任何事
+
+    Args:
+        name: 阶段名称
+    """
+    metrics = _active.get()
+    return metrics.phase(name) if metrics is not None else nullcontext()
+
+
+def count(name: str, value: int = 1) -> None:
+    """累加当前上下文的计数器，未收集统计时不做任何事"""
+    metrics = _active.get()
+    if metrics is not None:
+        metrics.count(name, value)
+
+
+def peak_rss() -> Optional[int]:
+    """当前进程自启动以来的峰值RSS（字节）
+
+    使用 resource 的 ru_maxrss；没有 resource 模块时（Windows）使用psutil的
+    峰值工作集。都不可用时返回None，不用当前RSS代替峰值。
+    """
+    try:
+        import resource
+        import sys
+        usage = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        # Linux 单位为KB，macOS 为字节
+        return usage if sys.platform == 'darwin' else usage * 1024
+    except (ImportError, OSError):
+        pass
+    try:
+        import psutil
+        return getattr(psutil.Process().memory_info(), 'peak_wset', None)
+    except ImportError:
+        return None
@@ -94,6 +94,34 @@ def type_manager():
     return TypeManager()
 
 
+def make_field(name, type_name, array_size=None, bit_field=None, **extra):
+    """创建结构体/联合体的字段条目"""
+    field = {'name': name, 'type': type_name, 'array_size': array_size, 'bit_field': bit_field}
+    field.update(extra)
+    return field
+
+
+def register_struct(manager, name, fields, kind='struct', **extra):
+    """注册结构体/联合体"""
+    info = {'kind': kind, 'name': name, 'fields': fields}
+    info.update(extra)
+    manager.register_type(name, info)
+
+
+def pos_struct(field_type='short'):
+    """各测试共用的 struct Pos { field_type x; field_type y; }"""
+    return {'kind': 'struct', 'name': 'struct Pos',
+            'fields': [make_field('x', field_type), make_field('y', field_type)]}
+
+
+@pytest.fixture
+def pos_type_manager():
+    """只包含 struct Pos { short x; short y; } 的TypeManager，测试在其上登记各自的类型"""
+    manager = TypeManager()
+    manager.register_type('struct Pos', pos_struct())
+    return manager
+
+
 @pytest.fixture
 def data_manager(type_manager):
     """创建DataManager实例"""
@@ -148,6 +176,32 @@ class MockNode:
     
     def __iter__(self):
         return iter(self.children)
+    
+    def walk(self):
+        """模拟TreeCursor"""
+        return MockTreeCursor(self)
+
+
+class MockTreeCursor:
+    """模拟TreeCursor，只支持访问子节点"""
+    def __init__(self, node):
+        self._parent = node
+        self._index = -1
+        self.node = node
+    
+    def goto_first_child(self):
+        if not self._parent.children:
+            return False
+        self._index = 0
+        self.node = self._parent.children[0]
+        return True
+    
+    def goto_next_sibling(self):
+        if self._index < 0 or self._index + 1 >= len(self._parent.children):
+            return False
+        self._index += 1
+        self.node = self._parent.children[self._index]
+        return True
 
 
 def create_mock_node(node_type, text="", children=None, field_name=None):
@@ -0,0 +1,100 @@
+import pytest
+from pathlib import Path
+from unittest.mock import patch
+
+from c_parser.batch_parser import BatchParser
+from c_parser.core.type_manager import TypeManager
+from c_parser.data_parser import CDataParser
+
+
+def _file_result(path, types, macros=None, variables=None):
+    """构造单个文件的解析结果"""
+    return (path, {'types': types, 'pointer_types': [], 'macro_definitions': macros or {}},
+            variables or {'variables': []}, None)
+
+
+class TestMergeTypeInfo:
+    """merge_type_info冲突处理测试"""
+
+    def test_identical_definitions_are_not_conflicts(self):
+        """测试相同定义重复合并不产生冲突"""
+        tm = TypeManager()
+        point = {'name': 'struct Point', 'kind': 'struct', 'fields': [{'name': 'x', 'type': 'int'}]}
+        assert tm.merge_type_info({'types': [dict(point)]}) == []
+        assert tm.merge_type_info({'types': [dict(point)]}) == []
+        assert len(tm._current_types) == 1
+
+    def test_conflict_keep_existing(self):
+        """测试overwrite=False时保留已有定义并报告冲突"""
+        tm = TypeManager()
+        tm.merge_type_info({'types': [{'name': 'u8', 'kind': 'typedef', 'base_type': 'unsigned char'}],
+                            'macro_definitions': {'N': 1}})
+        conflicts = tm.merge_type_info({'types': [{'name': 'u8', 'kind': 'typedef', 'base_type': 'char'}],
+                                        'macro_definitions': {'N': 2}}, overwrite=False)
+
+        assert [(c['kind'], c['name']) for c in conflicts] == [('typedef', 'u8'), ('macro', 'N')]
+        assert tm.find_type_by_name('u8')['base_type'] == 'unsigned char'
+        assert tm.get_macro_definition()['N'] == 1
+
+
+class TestBatchParser:
+    """BatchParser测试类"""
+
+    def test_merge_is_order_independent(self):
+        """测试合并结果只取决于文件路径顺序"""
+        batch = BatchParser(jobs=1)
+        a = _file_result('a.c', [{'name': 'T', 'kind': 'typedef', 'base_type': 'int'}])
+        b = _file_result('b.c', [{'name': 'T', 'kind': 'typedef', 'base_type': 'long'},
+                                 {'name': 'struct S', 'kind': 'struct', 'fields': []}])
+
+        result = batch._merge_results([a, b])
+
+        assert [t['name'] for t in result['typedefs']] == ['T']
+        assert result['typedefs'][0]['base_type'] == 'int'
+        assert [t['name'] for t in result['structs']] == ['struct S']
+        assert result['conflicts'][0]['file'] == 'b.c'
+        assert list(result['variables']) == ['a.c', 'b.c']
+
+    def test_parse_files_sequential(self, tmp_path):
+        """测试jobs=1时在当前进程中按路径顺序解析，并隔离各文件的状态"""
+        for name in ('b.c', 'a.c'):
+            (tmp_path / name).write_text('int x;')
+        seen = []
+
+        def fake_parse_file(parser, source):
+            seen.append(Path(source).name)
+            assert parser.type_manager._current_types == []
+            parser.type_manager.register_type(f"struct {Path(source).stem}", {'kind': 'struct', 'fields': []})
+            return parser.data_manager.get_all_data()
+
+        with patch.object(CDataParser, 'parse_file', autospec=True, side_effect=fake_parse_file):
+            result = BatchParser(jobs=1).parse_files(BatchParser.collect_files(tmp_path))
+
+        assert seen == ['a.c', 'b.c']
+        assert [s['name'] for s in result['structs']] == ['struct a', 'struct b']
+        assert result['errors'] == {}
+
+    def test_abi_and_macros_reach_workers(self, tmp_path):
+        """测试ABI和预定义宏传给每个文件的解析器，结果与单文件 analyze 一致"""
+        (tmp_path / 'a.c').write_text('int x;')
+        seen = []
+
+        def fake_parse_file(parser, source):
+            manager = parser.type_manager
+            seen.append((manager.abi, manager.get_macro_definition('USE_FAST'), manager.get_macro_definition('N')))
+            return parser.data_manager.get_all_data()
+
+        with patch.object(CDataParser, 'parse_file', autospec=True, side_effect=fake_parse_file):
+            BatchParser(jobs=1, abi='ARM_EABI', macros={'USE_FAST': '1', 'N': '4 * 2'}).parse_directory(tmp_path)
+
+        assert seen == [('ARM_EABI', 1, 8)]
+
+    def test_errors_are_collected(self):
+        """测试单个文件失败不影响其他文件"""
+        batch = BatchParser(jobs=1)
+        failed = ('bad.c', None, None, 'syntax error')
+
+        result = batch._merge_results([failed, _file_result('good.c', [])])
+
+        assert result['errors'] == {'bad.c': 'syntax error'}
+        assert list(result['variables']) == ['good.c']
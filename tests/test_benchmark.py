@@ -0,0 +1,202 @@
+"""性能基准测试
+
+使用 pytest-benchmark 测量解析器主要入口的吞吐量，运行方式：
+
+    make bench          # 运行并保存基线到 .benchmarks/
+    make bench-compare  # 与最近一次基线比较，均值退化超过阈值时失败
+
+合成输入的规模可通过环境变量 STRUCT_CONVERTER_BENCH_SCALE 缩放（默认1.0），
+例如 STRUCT_CONVERTER_BENCH_SCALE=0.01 可在本地快速验证。
+"""
+import os
+from pathlib import Path
+
+import pytest
+
+pytest.importorskip('pytest_benchmark')
+
+from utils.logger import set_quiet
+from c_parser.core.type_manager import TypeManager
+from c_parser.core.expression_parser import ExpressionParser
+from c_parser.type_parser import CTypeParser
+from c_parser.data_parser import CDataParser
+
+pytestmark = [pytest.mark.benchmark, pytest.mark.slow]
+
+FIXTURES_DIR = Path(__file__).parent / "fixtures" / "c_files"
+SCALE = float(os.environ.get('STRUCT_CONVERTER_BENCH_SCALE', '1.0'))
+
+
+def _scaled(count: int) -> int:
+    """按规模系数缩放合成输入的大小"""
+    return max(1, int(count * SCALE))
+
+
+STRUCT_COUNT = _scaled(10_000)
+ARRAY_LENGTH = _scaled(1_000_000)
+TYPEDEF_DEPTH = _scaled(200)
+INCLUDE_COUNT = _scaled(200)
+TYPEDEFS_PER_INCLUDE = 50
+
+
+@pytest.fixture(scope='module', autouse=True)
+def quiet_logging():
+    """基准测试期间关闭日志，只测量解析本身"""
+    set_quiet(True)
+    yield
+    set_quiet(False)
+
+
+@pytest.fixture(scope='module')
+def fixture_type_info():
+    """test_structs.h 解析得到的类型信息"""
+    parser = CTypeParser(TypeManager())
+    return parser.parse_declarations(FIXTURES_DIR / "test_structs.h")
+
+
+@pytest.fixture(scope='module')
+def many_structs_header(tmp_path_factory):
+    """包含 STRUCT_COUNT 个结构体的头文件"""
+    path = tmp_path_factory.mktemp('bench') / 'many_structs.h'
+    lines = []
+    for i in range(STRUCT_COUNT):
+        lines.append(f"typedef struct S{i} {{ int a; unsigned char b[4]; float c; }} S{i}_t;")
+    path.write_text('\n'.join(lines) + '\n')
+    return path
+
+
+@pytest.fixture(scope='module')
+def large_array_source(tmp_path_factory):
+    """包含 ARRAY_LENGTH 个元素初始化器的源文件"""
+    path = tmp_path_factory.mktemp('bench') / 'large_array.c'
+    values = ', '.join(str(i % 1000 - 500) for i in range(ARRAY_LENGTH))
+    path.write_text(f"int big_table[{ARRAY_LENGTH}] = {{{values}}};\n")
+    return path
+
+
+@pytest.fixture(scope='module')
+def wide_include_header(tmp_path_factory):
+    """包含 INCLUDE_COUNT 个头文件的顶层头文件，每个头文件带包含保护"""
+    directory = tmp_path_factory.mktemp('bench_includes')
+    includes = []
+    for i in range(INCLUDE_COUNT):
+        name = f"part_{i}.h"
+        body = '\n'.join(f"typedef unsigned int p{i}_t{j};" for j in range(TYPEDEFS_PER_INCLUDE))
+        (directory / name).write_text(f"#ifndef PART_{i}_H\n#define PART_{i}_H\n{body}\n#endif\n")
+        includes.append(f'#include "{name}"')
+    top = directory / 'top.h'
+    top.write_text('\n'.join(includes) + '\n')
+    return top
+
+
+@pytest.fixture(scope='module')
+def deep_typedef_manager():
+    """包含 TYPEDEF_DEPTH 层typedef链的类型管理器：T0 -> int, Tn -> Tn-1"""
+    manager = TypeManager()
+    previous = 'int'
+    for i in range(TYPEDEF_DEPTH):
+        manager.register_type(f"T{i}", {
+            'kind': 'typedef', 'type': previous, 'base_type': previous, 'real_type': 'base'
+        })
+        previous = f"T{i}"
+    return manager
+
+
+def _new_type_parser():
+    """每轮使用新的解析器，避免已解析文件被跳过"""
+    return (CTypeParser(TypeManager()),), {}
+
+
+class TestTypeParserBenchmark:
+    """CTypeParser.parse_declarations 基准测试"""
+
+    def test_fixture_header(self, benchmark):
+        """测试 test_structs.h 的解析速度"""
+        header = FIXTURES_DIR / "test_structs.h"
+        result = benchmark.pedantic(lambda parser: parser.parse_declarations(header),
+                                    setup=_new_type_parser, rounds=20)
+        assert result['types']
+
+    def test_many_structs(self, benchmark, many_structs_header):
+        """测试大量结构体定义的解析速度"""
+        result = benchmark.pedantic(lambda parser: parser.parse_declarations(many_structs_header),
+                                    setup=_new_type_parser, rounds=3)
+        assert len(result['types']) >= STRUCT_COUNT
+
+    def test_wide_include_graph(self, benchmark, wide_include_header):
+        """测试大量包含文件的解析速度"""
+        result = benchmark.pedantic(lambda parser: parser.parse_declarations(wide_include_header),
+                                    setup=_new_type_parser, rounds=3)
+        assert len(result['types']) >= INCLUDE_COUNT * TYPEDEFS_PER_INCLUDE
+
+
+class TestDataParserBenchmark:
+    """CDataParser.parse_file 基准测试"""
+
+    def test_fixture_source(self, benchmark, fixture_type_info):
+        """测试 test_data.c 的解析速度"""
+        source = FIXTURES_DIR / "test_data.c"
+
+        def setup():
+            return (CDataParser(TypeManager(fixture_type_info)),), {}
+
+        result = benchmark.pedantic(lambda parser: parser.parse_file(source), setup=setup, rounds=10)
+        assert any(result['variables'].values())
+
+    def test_large_array(self, benchmark, large_array_source):
+        """测试大数组初始化器的解析速度"""
+        def setup():
+            return (CDataParser(TypeManager()),), {}
+
+        result = benchmark.pedantic(lambda parser: parser.parse_file(large_array_source),
+                                    setup=setup, rounds=3)
+        array_vars = result['variables']['array_vars']
+        assert len(array_vars[0]['parsed_value']) == ARRAY_LENGTH
+
+
+class TestTypeManagerBenchmark:
+    """TypeManager 类型解析基准测试"""
+
+    def test_resolve_type_fixture(self, benchmark, fixture_type_info):
+        """测试fixture中所有类型的resolve_type速度"""
+        manager = TypeManager(fixture_type_info)
+        names = [entry['name'] for entry in fixture_type_info['types']]
+
+        def resolve_all():
+            return [manager.resolve_type(name) for name in names]
+
+        assert len(benchmark(resolve_all)) == len(names)
+
+    def test_resolve_deep_typedef_chain(self, benchmark, deep_typedef_manager):
+        """测试深层typedef链的resolve_type速度"""
+        last = f"T{TYPEDEF_DEPTH - 1}"
+        result = benchmark(deep_typedef_manager.resolve_type, last)
+        assert result['original_type'] == last
+
+    def test_get_type_size_deep_typedef_chain(self, benchmark, deep_typedef_manager):
+        """测试深层typedef链的get_type_size速度"""
+        last = f"T{TYPEDEF_DEPTH - 1}"
+        benchmark(deep_typedef_manager.get_type_size, last)
+
+
+class TestExpressionParserBenchmark:
+    """ExpressionParser.parse 基准测试"""
+
+    EXPRESSIONS = [
+        '42', '0x1F', '(1 << 8) - 1', 'MAX_SIZE * 2 + 1', 'BUFFER_LEN / ALIGN',
+        '(FLAG_A | FLAG_B) & ~FLAG_C', 'RED + BLUE', 'MAX_SIZE > 10 ? MAX_SIZE : 10',
+        '3.14159 * 2', "'A'",
+    ]
+    MACROS = {'MAX_SIZE': 100, 'BUFFER_LEN': 4096, 'ALIGN': 8, 'FLAG_A': 1, 'FLAG_B': 2, 'FLAG_C': 4}
+    ENUMS = {'Color': {'RED': 0, 'GREEN': 1, 'BLUE': 2}}
+
+    def test_parse_expressions(self, benchmark):
+        """测试常见常量表达式的求值速度"""
+        parser = ExpressionParser()
+
+        def parse_all():
+            return [parser.parse(expr, self.ENUMS, self.MACROS) for expr in self.EXPRESSIONS]
+
+        results = benchmark(parse_all)
+        assert results[0] == (42, 'number')
+        assert results[6] == (2, 'number')
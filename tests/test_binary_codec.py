@@ -0,0 +1,231 @@
+import ctypes
+import struct
+
+import pytest
+
+from conftest import make_field, register_struct
+
+from c_parser.core.binary_codec import BinaryDecoder, BinaryEncoder
+from c_parser.core.type_manager import TypeManager
+
+
+@pytest.fixture
+def manager():
+    """包含嵌套结构体、联合体、数组和位域的类型管理器"""
+    manager = TypeManager()
+    register_struct(manager, 'struct Inner', [make_field('s', 'short'), make_field('v', 'int')])
+    register_struct(manager, 'union Value', [make_field('i', 'int'), make_field('f', 'float')], kind='union')
+    register_struct(manager, 'struct Record', [
+        make_field('c', 'char'),
+        make_field('d', 'double'),
+        make_field('name', 'char', [8]),
+        make_field('table', 'unsigned short', [2, 3]),
+        make_field('inner', 'struct Inner'),
+        make_field('items', 'struct Inner', [2]),
+        make_field('value', 'union Value'),
+        make_field('a', 'unsigned int', bit_field=3),
+        make_field('b', 'int', bit_field=5),
+        make_field('ptr', 'void*'),
+    ])
+    return manager
+
+
+@pytest.fixture
+def encoder():
+    """包含结构体和枚举的编码器"""
+    manager = TypeManager()
+    register_struct(manager, 'struct P', [make_field('a', 'char'), make_field('b', 'int', [3]),
+                                          make_field('c', 'short')])
+    manager.register_type('Mode', {'kind': 'enum', 'name': 'Mode', 'values': {'MODE_A': 0, 'MODE_B': 7}})
+    return BinaryEncoder(manager)
+
+
+class _Inner(ctypes.Structure):
+    _fields_ = [('s', ctypes.c_short), ('v', ctypes.c_int)]
+
+
+class _Value(ctypes.Union):
+    _fields_ = [('i', ctypes.c_int), ('f', ctypes.c_float)]
+
+
+class _Record(ctypes.Structure):
+    _fields_ = [('c', ctypes.c_char), ('d', ctypes.c_double), ('name', ctypes.c_char * 8),
+                ('table', (ctypes.c_ushort * 3) * 2), ('inner', _Inner), ('items', _Inner * 2),
+                ('value', _Value), ('a', ctypes.c_uint, 3), ('b', ctypes.c_int, 5), ('ptr', ctypes.c_void_p)]
+
+
+def _record_bytes(index=0):
+    """用ctypes生成与本机（LP64）布局一致的记录"""
+    record = _Record()
+    record.c = b'A'
+    record.d = 2.5 + index
+    record.name = b'rec%d' % index
+    record.table[1][2] = 7
+    record.inner.v = -3
+    record.items[1].s = 9
+    record.value.i = 42
+    record.a = 5
+    record.b = -3
+    record.ptr = 0x1234
+    return bytes(record)
+
+
+@pytest.mark.skipif(ctypes.sizeof(ctypes.c_void_p) != 8, reason="需要64位平台生成LP64数据")
+class TestBinaryDecoder:
+    """BinaryDecoder测试类"""
+
+    def test_single_record(self, manager):
+        """测试嵌套结构体、联合体、多维数组、字符串和位域的解码"""
+        decoder = BinaryDecoder(manager)
+        value = decoder.decode('struct Record', _record_bytes())
+
+        assert decoder.size_of('struct Record') == ctypes.sizeof(_Record)
+        assert value == {
+            'c': 65, 'd': 2.5, 'name': 'rec0', 'table': [[0, 0, 0], [0, 0, 7]],
+            'inner': {'s': 0, 'v': -3}, 'items': [{'s': 0, 'v': 0}, {'s': 9, 'v': 0}],
+            'value': {'i': 42}, 'a': 5, 'b': -3, 'ptr': 0x1234,
+        }
+
+    def test_record_array_with_offset(self, manager):
+        """测试从偏移处解码记录数组"""
+        decoder = BinaryDecoder(manager)
+        blob = b'\xff' * 16 + b''.join(_record_bytes(i) for i in range(3))
+
+        records = decoder.decode_array('struct Record', blob, offset=16)
+        assert [r['name'] for r in records] == ['rec0', 'rec1', 'rec2']
+        assert decoder.decode_array('struct Record', blob, offset=16, count=1)[0]['d'] == 2.5
+        with pytest.raises(ValueError):
+            decoder.decode_array('struct Record', blob, offset=16, count=4)
+
+    def test_decode_file_uses_mmap(self, manager, tmp_path):
+        """测试通过mmap解码文件"""
+        path = tmp_path / 'dump.bin'
+        path.write_bytes(b''.join(_record_bytes(i) for i in range(4)))
+        decoder = BinaryDecoder(manager)
+
+        assert len(decoder.decode_file(path, 'struct Record')) == 4
+        assert [r['d'] for r in decoder.iter_decode_file(path, 'struct Record', count=2)] == [2.5, 3.5]
+
+    def test_compiled_once(self, manager):
+        """测试解码计划按类型缓存"""
+        decoder = BinaryDecoder(manager)
+        assert decoder.compile('struct Record') is decoder.compile('struct Record')
+
+
+@pytest.mark.skipif(ctypes.sizeof(ctypes.c_void_p) != 8, reason="需要64位平台生成LP64数据")
+class TestBinaryEncoder:
+    """BinaryEncoder测试类"""
+
+    def test_round_trip_matches_compiler_layout(self, manager):
+        """测试解码结果重新编码后与ctypes生成的字节完全一致"""
+        raw = _record_bytes()
+        value = BinaryDecoder(manager).decode('struct Record', raw)
+
+        assert BinaryEncoder(manager).encode('struct Record', value) == raw
+
+    def test_encode_variables_into_one_image(self, manager):
+        """测试批量编码变量：按类型对齐存放，动态数组维度按值推断"""
+        records = BinaryDecoder(manager).decode_array('struct Record', _record_bytes(0) + _record_bytes(1))
+        image = BinaryEncoder(manager).encode_variables({'variables': [
+            {'name': 'flag', 'type': 'char', 'parsed_value': 1},
+            {'name': 'records', 'type': 'struct Record', 'array_size': ['dynamic'], 'parsed_value': records},
+            {'name': 'missing', 'type': 'struct Unknown', 'parsed_value': {}},
+        ]})
+
+        size = ctypes.sizeof(_Record)
+        assert image['symbols'][1] == {'name': 'records', 'type': 'struct Record', 'offset': 8, 'size': 2 * size}
+        assert bytes(image['data'][8:]) == _record_bytes(0) + _record_bytes(1)
+        assert image['skipped'] == ['missing']
+
+
+class TestEncoderValues:
+    """初始化值形式测试类"""
+
+    def test_positional_designated_and_partial(self, encoder):
+        """测试按位置、指定初始化和部分初始化（其余补0）"""
+        assert encoder.encode('struct P', [1, [2, 3], {'c': -1}]) == struct.pack('<b3x3ih2x', 1, 2, 3, 0, -1)
+        assert encoder.encode('struct P', {'b': [{2: 9}]}) == struct.pack('<4x3ih2x', 0, 0, 9, 0)
+        assert encoder.encode('struct P', None) == bytes(20)
+
+    def test_multidimensional_and_brace_elision(self, encoder):
+        """测试多维数组和省略内层花括号"""
+        assert encoder.encode('short', [[1], [2, 3]], [2, 2]) == struct.pack('<4h', 1, 0, 2, 3)
+        assert encoder.encode('short', [1, 2, 3], [2, 2]) == struct.pack('<4h', 1, 2, 3, 0)
+
+    def test_c_conversions(self, encoder):
+        """测试整数截断、字符串和char数组"""
+        assert encoder.encode('unsigned char', -1) == b'\xff'
+        assert encoder.encode('int', 2.9) == struct.pack('<i', 2)
+        assert encoder.encode('char', 'hi', [4]) == b'hi\0\0'
+        assert encoder.encode('char', ['ab', 'c'], [2, 3]) == b'ab\0c\0\0'
+        assert encoder.encode('Mode', 'MODE_B') == struct.pack('<i', 7)
+
+    def test_unresolved_value(self, encoder):
+        """测试无法求值的指针初始化值"""
+        with pytest.raises(ValueError):
+            encoder.encode('void*', '&table')
+        lenient = BinaryEncoder(encoder.type_manager, strict=False)
+        assert lenient.encode('void*', '&table') == bytes(8)
+
+    def test_bitfields_union_and_big_endian(self):
+        """测试位域、按成员名选择的联合体和大端编码"""
+        manager = TypeManager()
+        register_struct(manager, 'union Value', [make_field('i', 'int'), make_field('f', 'float')], kind='union')
+        register_struct(manager, 'struct Header', [make_field('flags', 'unsigned char', bit_field=3),
+                                                   make_field('kind', 'int', bit_field=5),
+                                                   make_field('value', 'union Value')])
+        value = {'flags': 0b101, 'kind': -1, 'value': {'f': 1.0}}
+
+        little = BinaryEncoder(manager).encode('struct Header', value)
+        assert little == bytes([0b11111101, 0, 0, 0]) + struct.pack('<f', 1.0)
+        big = BinaryEncoder(manager, byte_order='big').encode('struct Header', value)
+        assert big == bytes([0b10111111, 0, 0, 0]) + struct.pack('>f', 1.0)
+        assert BinaryDecoder(manager, byte_order='big').decode('struct Header', big) == \
+            {'flags': 0b101, 'kind': -1, 'value': {'i': 0x3f800000}}
+
+
+class TestDecoderOptions:
+    """字节序、ABI和联合体选项测试类"""
+
+    def test_big_endian(self):
+        """测试大端数据和大端位域"""
+        manager = TypeManager()
+        register_struct(manager, 'struct Header', [make_field('magic', 'uint32_t'),
+                                                   make_field('version', 'uint16_t'),
+                                                   make_field('flags', 'unsigned char', bit_field=3),
+                                                   make_field('kind', 'unsigned char', bit_field=5)])
+        decoder = BinaryDecoder(manager, byte_order='big')
+        blob = struct.pack('>IHB', 0xCAFEBABE, 2, (0b101 << 5) | 0b10001) + b'\0'
+
+        assert decoder.decode('struct Header', blob) == {'magic': 0xCAFEBABE, 'version': 2,
+                                                          'flags': 0b101, 'kind': 0b10001}
+
+    def test_abi_layout(self):
+        """测试按ILP32布局解码：double按4字节对齐，指针为4字节"""
+        manager = TypeManager()
+        register_struct(manager, 'struct S', [make_field('c', 'char'), make_field('d', 'double'),
+                                              make_field('p', 'int*')])
+        decoder = BinaryDecoder(manager, abi='ILP32')
+
+        blob = struct.pack('<b3xdI', 1, 0.5, 0xdeadbeef)
+        assert decoder.size_of('struct S') == 16
+        assert decoder.decode('struct S', blob) == {'c': 1, 'd': 0.5, 'p': 0xdeadbeef}
+
+    def test_union_all_members(self):
+        """测试解码联合体的所有成员"""
+        manager = TypeManager()
+        register_struct(manager, 'union Value', [make_field('i', 'int'), make_field('f', 'float')], kind='union')
+
+        decoder = BinaryDecoder(manager, union_members='all')
+        assert decoder.decode('union Value', struct.pack('<f', 1.0)) == {'i': 0x3f800000, 'f': 1.0}
+
+    def test_typedef_array_and_flexible_member(self):
+        """测试数组typedef和柔性数组成员"""
+        manager = TypeManager()
+        manager.register_type('Vec3', {'kind': 'typedef', 'name': 'Vec3', 'type': 'array', 'base_type': 'float',
+                                       'real_type': 'array', 'element_type': 'float', 'array_size': [3]})
+        register_struct(manager, 'struct Packet', [make_field('pos', 'Vec3'),
+                                                   make_field('data', 'unsigned char', ['dynamic'])])
+        decoder = BinaryDecoder(manager)
+
+        assert decoder.decode('struct Packet', struct.pack('<3f', 1, 2, 3)) == {'pos': [1.0, 2.0, 3.0], 'data': []}
@@ -0,0 +1,96 @@
+import array
+import json
+
+import pytest
+
+from conftest import make_field, register_struct
+
+from c_parser.core.columnar import ColumnBuilder, StructColumns, write_columns, read_columns
+from c_parser.core.output_writer import json_default
+from c_parser.data_parser import CDataParser
+
+
+@pytest.fixture
+def type_manager(pos_type_manager):
+    """包含嵌套结构体、定长数组和指针字段的类型"""
+    register_struct(pos_type_manager, 'struct Cal', [
+        make_field('id', 'unsigned char'), make_field('gain', 'float', [2]), make_field('pos', 'struct Pos'),
+        make_field('name', 'char', [8]), make_field('next', 'struct Cal *'),
+    ])
+    return pos_type_manager
+
+
+def _variable(type_manager, length):
+    return {'name': 'table', 'type': 'struct Cal', 'array_size': [length],
+            'typeinfo': type_manager.resolve_type('struct Cal', {'array_size': [length], 'pointer_level': 0})}
+
+
+class TestColumnBuilder:
+    """列展开和构建测试类"""
+
+    def test_flattened_columns(self, type_manager):
+        """测试嵌套字段按路径展开、数值列使用array"""
+        builder = ColumnBuilder(type_manager, type_manager.get_type_info('struct Cal'))
+        builder.append({'id': 1, 'gain': [0.5, 1.5], 'pos': {'x': -1, 'y': 2}, 'name': 'a', 'next': None})
+        builder.append({'id': 2, 'pos': {'x': 3}})
+        columns = builder.build()
+
+        assert list(columns.columns) == ['id', 'gain[0]', 'gain[1]', 'pos.x', 'pos.y', 'name', 'next']
+        assert columns.column('id') == array.array('B', [1, 2])
+        assert columns.column('pos.x').typecode == 'h'
+        assert columns.column('name') == ['a', None]
+        assert columns[0] == {'id': 1, 'gain': [0.5, 1.5], 'pos': {'x': -1, 'y': 2}, 'name': 'a', 'next': None}
+        # 未初始化的数值字段按C语义为0
+        assert columns[-1]['pos'] == {'x': 3, 'y': 0}
+
+    def test_non_numeric_value_converts_column(self, type_manager):
+        """测试数值列遇到表达式字符串时改为对象列"""
+        builder = ColumnBuilder(type_manager, type_manager.get_type_info('struct Pos'))
+        builder.append({'x': 1, 'y': 2})
+        builder.append({'x': 'OFFSET + 1', 'y': 3})
+        columns = builder.build()
+        assert columns.column('x') == [1, 'OFFSET + 1']
+        assert isinstance(columns.column('y'), array.array)
+
+
+class TestColumnarParsing:
+    """CDataParser 列式模式测试类"""
+
+    def test_struct_array_as_columns(self, type_manager):
+        """测试一维结构体数组保存为列，与行式结果相等"""
+        raw = [[index, [0.5, 1.0], [index, -index], 'n', 0] for index in range(5)]
+        rows = CDataParser(type_manager)._wapper_raw_data(raw, _variable(type_manager, 5))
+        columns = CDataParser(type_manager, columnar=True)._wapper_raw_data(raw, _variable(type_manager, 5))
+
+        assert isinstance(columns, StructColumns)
+        assert len(columns) == 5
+        assert columns == rows
+
+        encoded = json.loads(json.dumps({'parsed_value': columns}, default=json_default))['parsed_value']
+        assert encoded['length'] == 5
+        assert encoded['columns']['pos.y'] == [0, -1, -2, -3, -4]
+
+
+class TestColumnExport:
+    """列式导出测试类"""
+
+    def test_binary_round_trip(self, type_manager, tmp_path):
+        """测试紧凑二进制格式写出后读回相等"""
+        builder = ColumnBuilder(type_manager, type_manager.get_type_info('struct Cal'))
+        for index in range(100):
+            builder.append({'id': index, 'gain': [index / 2, 1.0], 'pos': {'x': index, 'y': -index}, 'name': f'c{index}'})
+        columns = builder.build()
+
+        path = tmp_path / 'table.scol'
+        write_columns(columns, path)
+        loaded = read_columns(path)
+        assert loaded == columns
+        assert loaded.column('gain[0]').typecode == 'f'
+        assert loaded[99]['name'] == 'c99'
+
+    def test_rejects_other_files(self, tmp_path):
+        """测试读取非列式文件时报错"""
+        path = tmp_path / 'other.scol'
+        path.write_bytes(b'\0' * 16)
+        with pytest.raises(ValueError):
+            read_columns(path)
@@ -0,0 +1,151 @@
+from conftest import create_mock_node
+
+from c_parser.core.conditional_evaluator import ConditionalEvaluator
+from c_parser.core.type_manager import TypeManager
+from c_parser.type_parser import CTypeParser
+
+
+def _define(name, value=None):
+    """#define 节点，value 为None时只定义不赋值"""
+    children = [create_mock_node('#define', '#define'), create_mock_node('identifier', name, field_name='name')]
+    if value is not None:
+        children.append(create_mock_node('preproc_arg', value, field_name='value'))
+    return create_mock_node('preproc_def', f'#define {name} {value or ""}', children)
+
+
+def _else(*body):
+    return create_mock_node('preproc_else', '#else', [create_mock_node('#else', '#else')] + list(body))
+
+
+def _if(condition, body, alternative=None, directive='if'):
+    """#if / #elif 节点"""
+    children = [create_mock_node(f'#{directive}', f'#{directive}'),
+                create_mock_node('binary_expression', condition, field_name='condition')] + list(body)
+    if alternative is not None:
+        children.append(alternative)
+    node_type = 'preproc_if' if directive == 'if' else 'preproc_elif'
+    return create_mock_node(node_type, condition, children)
+
+
+def _ifdef(name, body, alternative=None, directive='#ifdef'):
+    children = [create_mock_node(directive, directive),
+                create_mock_node('identifier', name, field_name='name')] + list(body)
+    if alternative is not None:
+        children.append(alternative)
+    return create_mock_node('preproc_ifdef', name, children)
+
+
+def _registered(manager, *names):
+    return [name for name in names if manager.has_macro(name)]
+
+
+class TestConditionalEvaluator:
+    """条件编译判定测试类"""
+
+    def test_conditions(self):
+        """测试 #if 表达式、defined 和未定义标识符的求值"""
+        manager = TypeManager()
+        manager.define_macros({'CONFIG_LEVEL': '2', 'USE_FPU': None})
+        evaluator = ConditionalEvaluator(manager)
+
+        assert evaluator.evaluate_condition('CONFIG_LEVEL >= 2 && defined(USE_FPU)') is True
+        assert evaluator.evaluate_condition('defined USE_FPU') is True
+        assert evaluator.evaluate_condition('UNDEFINED_MACRO') is False
+        assert evaluator.evaluate_condition('!defined(UNDEFINED_MACRO) && \\\n CONFIG_LEVEL == 2') is True
+        # 函数式宏调用、只定义不赋值的宏参与运算：无法判定
+        assert evaluator.evaluate_condition('__has_include(<stdio.h>)') is None
+        assert evaluator.evaluate_condition('USE_FPU + 1') is None
+
+    def test_enums_are_not_macros(self):
+        """测试枚举常量在条件中按未定义处理"""
+        manager = TypeManager()
+        manager.register_type('Mode', {'kind': 'enum', 'name': 'Mode', 'values': {'MODE_A': 1}})
+        assert ConditionalEvaluator(manager).evaluate_condition('MODE_A') is False
+
+    def test_cache_keyed_by_macro_values(self):
+        """测试判定结果按引用的宏的值缓存，宏变化后重新求值"""
+        manager = TypeManager()
+        manager.define_macros({'N': 1})
+        evaluator = ConditionalEvaluator(manager)
+
+        assert evaluator.evaluate_condition('N == 1') is True
+        assert evaluator.evaluate_condition('N == 1') is True
+        assert len(evaluator._results) == 1
+        manager.add_macro_definition('N', 2)
+        assert evaluator.evaluate_condition('N == 1') is False
+        assert len(evaluator._results) == 2
+
+        # 宏的值引用其他宏时不缓存
+        manager.add_macro_definition('M', 'N + 1')
+        assert evaluator.evaluate_condition('M == 3') is True
+        assert len(evaluator._results) == 2
+
+    def test_active_children(self):
+        """测试只产生成立分支中的节点"""
+        manager = TypeManager()
+        manager.define_macros({'TARGET': '2'})
+        evaluator = ConditionalEvaluator(manager)
+        a, b, c = _define('A', '1'), _define('B', '1'), _define('C', '1')
+        node = _if('TARGET == 1', [a], _if('TARGET == 2', [b], _else(c), directive='elif'))
+
+        assert [child for child in evaluator.active_children(node) if child.type == 'preproc_def'] == [b]
+
+    def test_undecidable_keeps_remaining_branches(self):
+        """测试条件无法判定时保留该分支及之后的所有分支"""
+        evaluator = ConditionalEvaluator(TypeManager())
+        a, b, c = _define('A', '1'), _define('B', '1'), _define('C', '1')
+        node = _if('0', [a], _if('FEATURE(1)', [b], _else(c), directive='elif'))
+
+        assert [child for child in evaluator.active_children(node) if child.type == 'preproc_def'] == [b, c]
+
+
+class TestTypeParserConditions:
+    """类型解析器只遍历成立分支的测试类"""
+
+    def test_ifdef_and_ifndef(self):
+        """测试 #ifdef / #ifndef 按已解析的 #define 和配置的宏判定"""
+        manager = TypeManager()
+        manager.define_macros({'PLATFORM_ARM': None})
+        parser = CTypeParser(manager)
+        unit = create_mock_node('translation_unit', '', [
+            _define('HAS_FEATURE'),
+            _ifdef('HAS_FEATURE', [_define('FEATURE_ON', '1')], _else(_define('FEATURE_OFF', '1'))),
+            _ifdef('PLATFORM_ARM', [_define('NOT_ARM', '1')], _else(_define('IS_ARM', '1')), directive='#ifndef'),
+        ])
+        parser.parse_tree(unit)
+
+        assert manager.get_macro_definition('HAS_FEATURE') == ''
+        assert _registered(manager, 'FEATURE_ON', 'FEATURE_OFF', 'NOT_ARM', 'IS_ARM') == ['FEATURE_ON', 'IS_ARM']
+
+    def test_nested_and_defines_inside_branches(self):
+        """测试嵌套条件和分支内的 #define 影响之后的判定"""
+        manager = TypeManager()
+        parser = CTypeParser(manager)
+        unit = create_mock_node('translation_unit', '', [
+            _if('1', [_define('LEVEL', '3'), _if('LEVEL > 2', [_define('HIGH', '1')], _else(_define('LOW', '1')))]),
+            _if('LEVEL == 3', [_define('SEEN', '1')]),
+        ])
+        parser.parse_tree(unit)
+
+        assert _registered(manager, 'LEVEL', 'HIGH', 'LOW', 'SEEN') == ['LEVEL', 'HIGH', 'SEEN']
+
+    def test_evaluation_disabled(self):
+        """测试关闭条件判定时遍历所有分支"""
+        manager = TypeManager()
+        parser = CTypeParser(manager, evaluate_conditions=False)
+        parser.parse_tree(create_mock_node('translation_unit', '', [
+            _if('0', [_define('A', '1')], _else(_define('B', '1'))),
+        ]))
+
+        assert _registered(manager, 'A', 'B') == ['A', 'B']
+
+    def test_define_macros_and_fork(self):
+        """测试配置的宏按表达式求值，fork时传入的宏同样处理"""
+        manager = TypeManager()
+        manager.define_macros({'SIZE': '4 * 4', 'NAME': '"rtos"', 'FLAG': None})
+        assert manager.get_macro_definition('SIZE') == 16
+        assert manager.get_macro_definition('NAME') == '"rtos"'
+        assert manager.has_macro('FLAG')
+
+        child = manager.fork({'SIZE': '8'})
+        assert child.get_macro_definition('SIZE') == 8
@@ -298,3 +298,16 @@ class TestDataManager:
             mock_export_global.assert_called_once()
             mock_export_current.assert_called_once()
             mock_find.assert_called()
+    
+    def test_add_variable_with_writer(self):
+        """测试设置流式输出后变量直接写出而不保存"""
+        dm = DataManager()
+        writer = Mock()
+        dm.add_writer(writer)
+        
+        var_info = {'name': 'table', 'type': 'int', 'is_pointer': False, 'array_size': [4]}
+        dm.add_variable(var_info)
+        
+        writer.write_variable.assert_called_once_with(var_info, 'array_vars')
+        assert dm.variables['array_vars'] == []
+        assert dm.variable_counts['array_vars'] == 1
@@ -367,15 +367,79 @@ class TestCDataParser:
                 
                 result = parser.parse_file(source_code)
                 
-                # 验证类型解析器被调用
-                mock_parse_decls.assert_called_once_with(source_code)
+                # 类型定义在同一次遍历中解析，不再单独解析源码
+                mock_parse_decls.assert_not_called()
                 
-                # 验证TreeSitterUtils被调用
+                # 验证TreeSitterUtils只被调用一次
                 mock_ts_instance.parse.assert_called_once_with(source_code)
                 
                 # 验证返回结果
                 assert result == mock_result
     
+    def test_single_pass_dispatch(self):
+        """测试单次遍历同时分发类型定义和变量声明"""
+        from conftest import create_mock_node
+        
+        parser = CDataParser()
+        typedef_node = create_mock_node('type_definition', 'typedef int my_int;')
+        declaration_node = create_mock_node('declaration', 'int value = 1;')
+        root = create_mock_node('translation_unit', children=[typedef_node, declaration_node])
+        
+        calls = []
+        with patch.object(parser.type_parser, 'parse_tree', side_effect=lambda n: calls.append(('type', n.type))), \
+             patch.object(parser, '_is_variable_declaration', return_value=True), \
+             patch.object(parser, '_parse_variable_declaration', side_effect=lambda n: calls.append(('var', n.type))):
+            parser._parse_global_variables(root)
+        
+        # 每个顶层节点先登记类型，再解析变量，按源码顺序处理
+        assert calls == [
+            ('type', 'type_definition'),
+            ('type', 'declaration'),
+            ('var', 'declaration'),
+        ]
+    
+    def test_numeric_initializer_fast_path(self):
+        """测试数值初始化列表跳过表达式求值，无法快速解析的元素回退到通用路径"""
+        from conftest import create_mock_node
+        
+        parser = CDataParser()
+        negative = create_mock_node('unary_expression', '-5', [
+            create_mock_node('-', '-'), create_mock_node('number_literal', '5')
+        ])
+        node = create_mock_node('initializer_list', children=[
+            create_mock_node('{', '{'),
+            create_mock_node('number_literal', '0x10'),
+            create_mock_node(',', ','),
+            negative,
+            create_mock_node(',', ','),
+            create_mock_node('identifier', 'MAX'),
+            create_mock_node('}', '}'),
+        ])
+        
+        with patch.object(parser.type_manager, 'evaluate_expression', return_value=(7, 'number')) as mock_parse:
+            result = parser._parse_raw_initializer(node)
+        
+        assert result == [16, -5, 7]
+        # 只有标识符走通用路径
+        mock_parse.assert_called_once()
+    
+    def test_typed_arrays(self):
+        """测试typed_arrays模式下一维数值数组保存为array.array"""
+        import array
+        
+        parser = CDataParser(typed_arrays=True)
+        typeinfo = parser.type_manager.resolve_type('uint16_t')
+        variable_info = {'name': 'table', 'type': 'uint16_t', 'array_size': [3], 'typeinfo': typeinfo}
+        
+        result = parser._wapper_raw_data([1, 2, 3, 4], variable_info)
+        assert isinstance(result, array.array)
+        assert result.itemsize == 2
+        assert result.tolist() == [1, 2, 3]
+        
+        # 无法放入类型的值保持为列表
+        assert parser._wapper_raw_data([1, 'MAX', 3], variable_info) == [1, 'MAX', 3]
+        assert CDataParser()._wapper_raw_data([1, 2, 3, 4], variable_info) == [1, 2, 3]
+    
     def test_parse_file_with_complex_data(self):
         """测试解析复杂数据结构"""
         parser = CDataParser()
@@ -553,3 +617,64 @@ class TestCDataParser:
                     
                     # 验证类型解析器被正确调用
                     assert isinstance(result, dict)
+
+
+class TestSourceHandling:
+    """源码读取与节点文本测试"""
+    
+    @staticmethod
+    def _parser():
+        """语法树为空的解析器，返回 (parser, parse mock)"""
+        parser = CDataParser()
+        root = Mock(spec=Node)
+        root.type = "translation_unit"
+        root.children = []
+        parser._parse_global_variables = Mock()
+        parse = patch.object(parser.tree_sitter, 'parse', return_value=root)
+        return parser, parse
+    
+    def test_parse_path_passes_file_bytes(self, tmp_path):
+        """测试文件按原始字节读取一次后直接交给tree-sitter"""
+        path = tmp_path / 'data.c'
+        path.write_bytes('int 数值 = 1;\n'.encode('utf-8'))
+        parser, parse = self._parser()
+        
+        with parse as mock_parse:
+            parser.parse_path(path)
+        
+        mock_parse.assert_called_once_with(path.read_bytes())
+        assert parser.current_file == str(path)
+        # 解析结束后不再持有源码
+        assert parser._source is None
+    
+    def test_parse_text_never_reads_files(self, sample_c_file):
+        """测试 parse_text 不把看起来像路径的字符串当作文件"""
+        parser, parse = self._parser()
+        
+        with parse as mock_parse:
+            parser.parse_text(sample_c_file)
+        
+        mock_parse.assert_called_once_with(sample_c_file)
+        assert parser.current_file is None
+    
+    def test_long_source_string(self):
+        """测试超长的源代码字符串不进行文件系统检查"""
+        parser, parse = self._parser()
+        source = "int x;" * 2000
+        
+        with parse as mock_parse, patch.object(Path, 'exists', side_effect=AssertionError), \
+                patch.object(Path, 'is_file', side_effect=AssertionError):
+            parser.parse_file(source)
+        
+        mock_parse.assert_called_once_with(source)
+    
+    def test_node_text_from_source(self):
+        """测试解析期间节点文本从源码字节中按范围解码"""
+        parser = CDataParser()
+        node = Mock(spec=Node)
+        node.start_byte = 4
+        node.end_byte = 10
+        node.text = None
+        parser._source = memoryview('int 数值 = 1;'.encode('utf-8'))
+        
+        assert parser._node_text(node) == "数值"
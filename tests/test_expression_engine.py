@@ -0,0 +1,123 @@
+import pytest
+
+from c_parser.core.expression_engine import (
+    CompiledExpression, EvaluationError, SymbolTable, dict_symbols, INT, UINT, LONG, ULONG
+)
+from c_parser.core.type_manager import TypeManager
+
+
+def _eval(text, macros=None, enums=None):
+    """使用字典符号表求值，返回 (值, C类型)"""
+    symbols = dict_symbols(enums, macros)
+    return symbols.compile(text).evaluate(symbols)
+
+
+class TestCompiledExpression:
+    """CompiledExpression测试类"""
+
+    def test_literal_types(self):
+        """测试整数常量的类型推断"""
+        assert _eval('1') == (1, INT)
+        assert _eval('0xFFFFFFFF') == (0xFFFFFFFF, UINT)
+        assert _eval('4294967295') == (4294967295, LONG)
+        assert _eval('1u') == (1, UINT)
+        assert _eval('1UL') == (1, ULONG)
+        assert _eval("'A'") == (65, INT)
+
+    def test_integer_semantics(self):
+        """测试C整数语义：截断除法、无符号回绕、有符号溢出"""
+        assert _eval('7 / 2')[0] == 3
+        assert _eval('-7 / 2')[0] == -3
+        assert _eval('-7 % 3')[0] == -1
+        assert _eval('0u - 1')[0] == 0xFFFFFFFF
+        assert _eval('-1 < 0u')[0] == 0
+        assert _eval('1 << 31')[0] == -2147483648
+        assert _eval('1UL << 40')[0] == 1 << 40
+        assert _eval('~0u')[0] == 0xFFFFFFFF
+
+    def test_casts_and_sizeof(self):
+        """测试类型转换和sizeof"""
+        assert _eval('(unsigned char)0x1FF')[0] == 0xFF
+        assert _eval('(signed char)200')[0] == -56
+        assert _eval('(int)3.9')[0] == 3
+        assert _eval('sizeof(unsigned short)')[0] == 2
+        # 括号内不是类型名时按普通括号处理
+        assert _eval('(N) - 1', {'N': 10})[0] == 9
+
+    def test_operators(self):
+        """测试逻辑、比较和条件运算"""
+        assert _eval('1 && 0 || 2')[0] == 1
+        assert _eval('3 > 2 ? 10 : 20')[0] == 10
+        assert _eval('!0 + !5')[0] == 1
+        assert _eval('defined(A) && !defined B', {'A': 1})[0] == 1
+
+    def test_constant_folding(self):
+        """测试不含标识符的表达式在编译时折叠"""
+        assert CompiledExpression('(1 << 4) | 3').is_constant
+        assert not CompiledExpression('A + 1').is_constant
+
+    def test_errors(self):
+        """测试无法求值的表达式"""
+        for text in ['1 / 0', '(1 + 2', 'FOO(1)', '"str" + 1', '1 << 40', '09', '']:
+            with pytest.raises(EvaluationError):
+                _eval(text)
+        with pytest.raises(EvaluationError):
+            _eval('UNKNOWN + 1')
+
+
+class TestSymbolTable:
+    """SymbolTable测试类"""
+
+    def test_macro_chain_and_memo(self):
+        """测试宏链只解析一次"""
+        calls = []
+        macros = {'A': 'B + 1', 'B': '(C << 2)', 'C': 3}
+
+        def lookup(name):
+            calls.append(name)
+            return macros.get(name)
+
+        symbols = SymbolTable(lookup, lambda: {})
+        assert symbols.evaluate('A * 2') == 26
+        count = len(calls)
+        assert symbols.evaluate('A + B') == 25
+        assert len(calls) == count
+
+    def test_recursive_macro(self):
+        """测试循环引用的宏无法求值"""
+        symbols = dict_symbols(macro_values={'A': 'B', 'B': 'A'})
+        with pytest.raises(EvaluationError):
+            symbols.evaluate('A')
+
+    def test_enum_constants_take_precedence(self):
+        """测试枚举常量优先于宏"""
+        symbols = dict_symbols({'Color': {'RED': 1}}, {'RED': 5})
+        assert symbols.evaluate('RED') == 1
+
+
+class TestTypeManagerSymbols:
+    """TypeManager符号表集成测试"""
+
+    def test_evaluate_with_macros_and_enums(self):
+        """测试使用TypeManager中的宏和枚举求值"""
+        tm = TypeManager()
+        tm.add_macro_definition('BASE', 0x100)
+        tm.add_macro_definition('SIZE', 'BASE * 2')
+        tm.register_type('enum Mode', {'kind': 'enum', 'values': {'MODE_FAST': 4}})
+
+        assert tm.evaluate_expression('SIZE + MODE_FAST') == (516, 'number')
+        assert tm.evaluate_expression('(uint8_t)SIZE') == (0, 'number')
+        assert tm.evaluate_expression('MISSING + 1') == ('MISSING + 1', 'expression')
+
+    def test_redefinition_invalidates(self):
+        """测试重新定义宏后缓存的值失效"""
+        tm = TypeManager()
+        tm.add_macro_definition('A', 1)
+        tm.add_macro_definition('B', 'A + 1')
+        assert tm.evaluate_expression('B') == (2, 'number')
+
+        tm.add_macro_definition('A', 10)
+        assert tm.evaluate_expression('B') == (11, 'number')
+
+        tm.reset_current_type_info()
+        assert tm.evaluate_expression('B')[1] == 'expression'
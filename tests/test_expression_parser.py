@@ -7,6 +7,15 @@ from c_parser.core.expression_parser import ExpressionParser
 class TestExpressionParser:
     """ExpressionParser测试类"""
     
+    def test_parse_number_literal_fast_path(self):
+        """测试快速字面量解析与 _parse_number 结果一致"""
+        for text in ['0', '42', '0xFFu', '0b1010', '077', '3.14', '1e3', '.5f', '100UL']:
+            assert ExpressionParser.parse_number_literal(text.encode()) == ExpressionParser._parse_number(text)
+        
+        # 无法识别的文本返回None，由调用方回退到通用解析
+        for text in [b'09', b'0x', b'MAX_SIZE', b'1 + 2', b'0x1.8p3']:
+            assert ExpressionParser.parse_number_literal(text) is None
+    
     def test_parse_string_literal(self):
         """测试解析字符串字面量"""
         # 测试单引号字符串
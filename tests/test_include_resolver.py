@@ -0,0 +1,132 @@
+import pytest
+from pathlib import Path
+from unittest.mock import patch
+
+from c_parser.core.include_resolver import IncludeResolver
+from c_parser.core.parse_cache import ParseCache
+from c_parser.core.type_manager import TypeManager
+from c_parser.type_parser import CTypeParser
+
+
+class TestIncludeResolver:
+    """IncludeResolver测试类"""
+
+    def test_detect_guard(self):
+        """测试识别包含保护"""
+        assert IncludeResolver.detect_guard('#pragma once\ntypedef int a;\n') == IncludeResolver.PRAGMA_ONCE
+        assert IncludeResolver.detect_guard('#ifndef A_H\n#define A_H\ntypedef int a;\n#endif\n') == 'A_H'
+        assert IncludeResolver.detect_guard('/* x */\n#if !defined(B_H)\n#define B_H\n#endif // B_H\n') == 'B_H'
+
+    def test_detect_guard_rejects_partial_guard(self):
+        """测试不覆盖整个文件的条件块不视为包含保护"""
+        partial = '#ifndef A_H\n#define A_H\n#endif\n#ifdef X\n#endif\n'
+        mismatched = '#ifndef A_H\n#define B_H\n#endif\n'
+        assert IncludeResolver.detect_guard(partial) is None
+        assert IncludeResolver.detect_guard(mismatched) is None
+        assert IncludeResolver.detect_guard('typedef int a;\n') is None
+
+    def test_parse_include_directives(self):
+        """测试提取 #include 指令"""
+        text = '#include <stdint.h>\n  #  include "local.h"\n// #include "comment.h" 不在行首\n'
+        assert IncludeResolver.parse_include_directives(text) == [('stdint.h', True), ('local.h', False)]
+
+    def test_resolve_searches_include_paths(self, tmp_path):
+        """测试引号形式先查当前目录，尖括号形式只查include_paths"""
+        (tmp_path / 'src').mkdir()
+        (tmp_path / 'sdk').mkdir()
+        (tmp_path / 'src' / 'common.h').write_text('')
+        (tmp_path / 'sdk' / 'common.h').write_text('')
+        including = tmp_path / 'src' / 'app.h'
+        resolver = IncludeResolver([tmp_path / 'sdk'])
+
+        assert resolver.resolve('common.h', including) == (tmp_path / 'src' / 'common.h').resolve()
+        assert resolver.resolve('common.h', including, is_system=True) == (tmp_path / 'sdk' / 'common.h').resolve()
+        assert resolver.resolve('missing.h', including) is None
+        assert resolver.get_include_graph()['unresolved'] == [
+            {'file': str(including.resolve()), 'include': 'missing.h'}
+        ]
+
+    def test_should_skip_parsed_and_guarded(self, tmp_path):
+        """测试已解析文件和保护宏已定义的文件被跳过"""
+        first = tmp_path / 'a' / 'types.h'
+        copy = tmp_path / 'b' / 'types.h'
+        for path in (first, copy):
+            path.parent.mkdir()
+            path.write_text('#ifndef TYPES_H\n#define TYPES_H\n#endif\n')
+        resolver = IncludeResolver()
+
+        assert not resolver.should_skip(first)
+        resolver.mark_parsed(first)
+        assert resolver.should_skip(first)
+        # 另一份拷贝使用同一保护宏
+        assert resolver.should_skip(copy)
+        assert not IncludeResolver().should_skip(copy)
+        assert IncludeResolver().should_skip(copy, {'TYPES_H': 1})
+
+
+class TestTypeParserIncludes:
+    """CTypeParser包含文件去重测试"""
+
+    def _parse_count(self, header):
+        """解析头文件，返回每个文件实际被tree-sitter解析的次数"""
+        parser = CTypeParser(TypeManager())
+        counts = {}
+
+        def fake_parse(content):
+            text = content.decode('utf-8')
+            counts[text] = counts.get(text, 0) + 1
+            return None
+
+        with patch.object(parser.ts_util, 'parse_bytes', side_effect=fake_parse):
+            parser.parse_declarations(header)
+        return parser, counts
+
+    def test_diamond_include_parsed_once(self, tmp_path):
+        """测试菱形包含中共同依赖只解析一次"""
+        (tmp_path / 'base.h').write_text('typedef int base_t;\n')
+        (tmp_path / 'left.h').write_text('#include "base.h"\n')
+        (tmp_path / 'right.h').write_text('#include "base.h"\n')
+        top = tmp_path / 'top.h'
+        top.write_text('#include "left.h"\n#include "right.h"\n')
+
+        parser, counts = self._parse_count(top)
+
+        assert counts['typedef int base_t;\n'] == 1
+        graph = parser.get_include_graph()
+        assert len(graph['files']) == 4
+        assert str((tmp_path / 'base.h').resolve()) in graph['skipped']
+
+    def test_include_cycle_terminates(self, tmp_path):
+        """测试循环包含不会无限递归"""
+        (tmp_path / 'a.h').write_text('#include "b.h"\n')
+        (tmp_path / 'b.h').write_text('#include "a.h"\n')
+
+        parser, counts = self._parse_count(tmp_path / 'a.h')
+
+        assert all(count == 1 for count in counts.values())
+        assert len(parser.get_include_graph()['files']) == 2
+
+    def test_session_reset_per_top_level_parse(self, tmp_path):
+        """测试每次顶层解析开始新会话，包含关系图只包含本次解析的文件"""
+        (tmp_path / 'a.h').write_text('typedef int a_t;\n')
+        (tmp_path / 'b.h').write_text('typedef int b_t;\n')
+        parser = CTypeParser(TypeManager())
+
+        with patch.object(parser.ts_util, 'parse_bytes', return_value=None):
+            parser.parse_declarations(tmp_path / 'a.h')
+            parser.parse_declarations(tmp_path / 'b.h')
+
+        assert parser.get_include_graph()['files'] == [str((tmp_path / 'b.h').resolve())]
+
+    def test_unresolved_recorded_once_with_cache(self, tmp_path):
+        """测试计算缓存键时预先遍历包含闭包，找不到的包含文件只记录一次"""
+        header = tmp_path / 'app.h'
+        header.write_text('#include "missing.h"\n')
+        parser = CTypeParser(TypeManager(), parse_cache=ParseCache(tmp_path / 'cache'))
+
+        with patch.object(parser.ts_util, 'parse_bytes', return_value=None):
+            parser.parse_declarations(header)
+
+        assert parser.get_include_graph()['unresolved'] == [
+            {'file': str(header.resolve()), 'include': 'missing.h'}
+        ]
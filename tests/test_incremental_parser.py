@@ -0,0 +1,140 @@
+import os
+
+import pytest
+
+from c_parser.incremental_parser import IncrementalParser
+from c_parser.core.tree_sitter_utils import TreeSitterUtils
+from c_parser.core.type_manager import TypeManager
+
+
+SOURCE = (
+    "#define SCALE 3\n"
+    "typedef int my_int;\n"
+    "int a = 1;\n"
+    "my_int b = SCALE;\n"
+    "int c[2] = {1, 2};\n"
+)
+
+
+def _values(watcher, path='a.c'):
+    """变量名 -> (值, 行号)"""
+    data = watcher.get_parser(path).data_manager.variables
+    return {var['name']: (var['parsed_value'], var['location']['line'])
+            for items in data.values() for var in items}
+
+
+class TestComputeEdit:
+    """编辑区间计算测试类"""
+
+    def test_identical(self):
+        """测试内容相同时不产生编辑"""
+        assert TreeSitterUtils.compute_edit(b'int a;', b'int a;') is None
+
+    def test_replace_in_middle(self):
+        """测试去掉公共前缀和后缀后的编辑区间及行列"""
+        edit = TreeSitterUtils.compute_edit(b'int a = 1;\nint b = 2;\n', b'int a = 1;\nint b = 20;\n')
+        assert edit['start_byte'] == 20
+        assert edit['old_end_byte'] == 20
+        assert edit['new_end_byte'] == 21
+        assert edit['start_point'] == (1, 9)
+        assert edit['new_end_point'] == (1, 10)
+
+    def test_insert_lines(self):
+        """测试插入行时结束位置的行号"""
+        edit = TreeSitterUtils.compute_edit(b'int a;\n', b'int a;\nint b;\nint c;\n')
+        assert (edit['start_byte'], edit['old_end_byte'], edit['new_end_byte']) == (7, 7, 21)
+        assert edit['old_end_point'] == (1, 0)
+        assert edit['new_end_point'] == (3, 0)
+
+
+class TestTypeManagerChanges:
+    """TypeManager修改记录与回退测试类"""
+
+    def test_revert_types_and_macros(self):
+        """测试回退新增的类型和修改过的宏"""
+        manager = TypeManager()
+        manager.add_macro_definition('SIZE', 4)
+
+        journal = manager.begin_changes()
+        manager.add_macro_definition('SIZE', 8)
+        manager.add_macro_definition('EXTRA', 1)
+        manager.register_type('my_int', {'kind': 'typedef', 'name': 'my_int', 'type': 'int', 'base_type': 'int'})
+        changes = manager.end_changes(journal)
+
+        assert changes['macros'] == {'SIZE': 4, 'EXTRA': None}
+        assert [entry['name'] for entry in changes['types']] == ['my_int']
+        assert manager.get_type_info('my_int')
+
+        manager.revert_changes([changes])
+        assert not manager.get_type_info('my_int')
+        assert manager.evaluate_expression('SIZE')[0] == 4
+        assert 'EXTRA' not in manager._current_macro_definitions
+
+    def test_revert_order(self):
+        """测试多次修改按相反顺序回退"""
+        manager = TypeManager()
+        changes = []
+        for value in (1, 2, 3):
+            journal = manager.begin_changes()
+            manager.add_macro_definition('LEVEL', value)
+            changes.append(manager.end_changes(journal))
+
+        manager.revert_changes(changes[1:])
+        assert manager.evaluate_expression('LEVEL')[0] == 1
+
+
+class TestIncrementalParser:
+    """IncrementalParser测试类"""
+
+    def test_value_edit_reparses_one_declaration(self):
+        """测试修改一个变量的值只重新遍历该声明"""
+        watcher = IncrementalParser()
+        watcher.parse('a.c', text=SOURCE)
+
+        summary = watcher.update('a.c', text=SOURCE.replace('int a = 1;', 'int a = 10;'))
+        assert summary['full'] is False
+        assert summary['reparsed'] == 1
+        assert summary['changed'] == ['a']
+        assert summary['types_changed'] is False
+        assert _values(watcher)['a'] == (10, 3)
+        assert _values(watcher)['b'] == (3, 4)
+
+    def test_macro_change_rewalks_following(self):
+        """测试宏修改后其后的声明都重新求值"""
+        watcher = IncrementalParser()
+        watcher.parse('a.c', text=SOURCE)
+
+        summary = watcher.update('a.c', text=SOURCE.replace('SCALE 3', 'SCALE 7'))
+        assert summary['types_changed'] is True
+        assert 'b' in summary['changed']
+        assert _values(watcher)['b'][0] == 7
+
+    def test_insert_and_remove_shift_lines(self):
+        """测试插入和删除声明后行号与删除列表"""
+        watcher = IncrementalParser()
+        watcher.parse('a.c', text=SOURCE)
+
+        inserted = SOURCE.replace('int a = 1;\n', 'int a = 1;\nint z = 5;\n')
+        watcher.update('a.c', text=inserted)
+        assert _values(watcher)['z'] == (5, 4)
+        assert _values(watcher)['c'][1] == 6
+
+        summary = watcher.update('a.c', text=inserted.replace('int a = 1;\n', ''))
+        assert summary['removed'] == ['a']
+        assert _values(watcher)['c'][1] == 5
+        fresh = IncrementalParser()
+        fresh.parse('a.c', text=inserted.replace('int a = 1;\n', ''))
+        assert _values(watcher) == _values(fresh)
+
+    def test_poll_detects_file_change(self, tmp_path):
+        """测试按修改时间检测文件变化"""
+        path = tmp_path / 'data.c'
+        path.write_text(SOURCE)
+        watcher = IncrementalParser()
+        watcher.parse(path)
+        assert watcher.poll() == []
+
+        path.write_text(SOURCE.replace('int a = 1;', 'int a = 2;'))
+        os.utime(path, ns=(1, 1))
+        summaries = watcher.poll()
+        assert [s['changed'] for s in summaries] == [['a']]
@@ -0,0 +1,254 @@
+import pytest
+
+from conftest import make_field, register_struct
+
+from c_parser.core.layout_engine import get_abi_profile, canonical_basic_type
+from c_parser.core.type_manager import TypeManager
+from c_parser.type_parser import CTypeParser
+
+
+class TestAbiProfile:
+    """ABI配置测试类"""
+
+    def test_profile_lookup_and_aliases(self):
+        """测试按名称和别名查找ABI"""
+        assert get_abi_profile('lp64').name == 'LP64'
+        assert get_abi_profile('x86_64').name == 'LP64'
+        assert get_abi_profile('win64').name == 'LLP64'
+        assert get_abi_profile('arm').name == 'ARM_EABI'
+        assert get_abi_profile(None).name == 'LP64'
+        with pytest.raises(ValueError):
+            get_abi_profile('PDP11')
+
+    @pytest.mark.parametrize('abi, long_size, pointer_size, long_long_alignment', [
+        ('ILP32', 4, 4, 4),
+        ('LP64', 8, 8, 8),
+        ('LLP64', 4, 8, 8),
+        ('ARM_EABI', 4, 4, 8),
+    ])
+    def test_basic_type_sizes(self, abi, long_size, pointer_size, long_long_alignment):
+        """测试各ABI的基本类型大小"""
+        engine = TypeManager().get_layout_engine(abi)
+        assert engine.size_of('unsigned long') == long_size
+        assert engine.size_of('char*') == pointer_size
+        assert engine.size_of('size_t') == pointer_size
+        assert engine.alignment_of('long long') == long_long_alignment
+        assert engine.size_of('uint16_t') == 2
+
+    def test_canonical_basic_type(self):
+        """测试基本类型名称规范化"""
+        assert canonical_basic_type('unsigned long int') == 'long'
+        assert canonical_basic_type('long long int') == 'long long'
+        assert canonical_basic_type('const unsigned char') == 'char'
+        assert canonical_basic_type('unsigned') == 'int'
+        assert canonical_basic_type('uint64_t') == 'long long'
+        assert canonical_basic_type('MyType') is None
+
+
+class TestStructLayout:
+    """结构体布局测试类"""
+
+    def test_offsets_and_padding(self):
+        """测试字段偏移和填充空洞"""
+        manager = TypeManager()
+        register_struct(manager, 'struct A', [make_field('c', 'char'), make_field('i', 'int'),
+                                              make_field('d', 'double')])
+
+        layout = manager.get_type_layout('struct A')
+        assert [f.offset for f in layout.fields] == [0, 4, 8]
+        assert (layout.size, layout.alignment) == (16, 8)
+        assert layout.padding == [{'offset': 1, 'size': 3}]
+
+    def test_layout_depends_on_abi(self):
+        """测试double对齐随ABI变化"""
+        manager = TypeManager()
+        register_struct(manager, 'struct B', [make_field('c', 'char'), make_field('d', 'double')])
+
+        assert manager.get_type_layout('struct B', 'ILP32').field('d').offset == 4
+        assert manager.get_layout_engine('ILP32').size_of('struct B') == 12
+        assert manager.get_layout_engine('ARM_EABI').size_of('struct B') == 16
+
+    def test_default_abi_of_type_manager(self):
+        """测试TypeManager的默认ABI决定get_type_size的结果"""
+        manager = TypeManager(abi='ILP32')
+        register_struct(manager, 'struct Node', [make_field('next', 'struct Node*'), make_field('value', 'long')])
+
+        assert manager.get_type_size('struct Node') == 8
+        assert manager.get_type_alignment('struct Node') == 4
+
+    def test_nested_offset_of(self):
+        """测试嵌套字段的偏移"""
+        manager = TypeManager()
+        register_struct(manager, 'struct Inner', [make_field('s', 'short'), make_field('v', 'int')])
+        register_struct(manager, 'struct Outer', [make_field('c', 'char'), make_field('in', 'struct Inner')])
+
+        assert manager.calculate_field_offset('struct Outer', 'in') == 4
+        assert manager.calculate_field_offset('struct Outer', 'in.v') == 8
+        assert manager.get_layout_engine().offset_of('struct Outer', 'missing') is None
+
+    def test_arrays_and_flexible_array(self):
+        """测试数组字段和柔性数组"""
+        manager = TypeManager()
+        register_struct(manager, 'struct Buf', [make_field('n', 'int'), make_field('data', 'char', [3]),
+                                                make_field('tail', 'char', ['dynamic'])])
+
+        layout = manager.get_type_layout('struct Buf')
+        assert layout.field('data').size == 3
+        assert layout.size == 8
+
+    def test_typedef_and_late_definition(self):
+        """测试typedef引用稍后定义的结构体时布局缓存失效"""
+        manager = TypeManager()
+        manager.register_type('Late_t', {'kind': 'typedef', 'name': 'Late_t', 'type': 'struct Late',
+                                         'base_type': 'struct Late', 'real_type': 'struct'})
+        assert manager.get_type_size('Late_t') == 0
+
+        register_struct(manager, 'struct Late', [make_field('a', 'int'), make_field('b', 'char')])
+        assert manager.get_type_size('Late_t') == 8
+        assert manager.get_type_layout('Late_t').name == 'struct Late'
+
+    def test_union_layout(self):
+        """测试联合体大小和结尾填充"""
+        manager = TypeManager()
+        register_struct(manager, 'union U', [make_field('c', 'char', [5]), make_field('i', 'int')], kind='union')
+
+        layout = manager.get_type_layout('union U')
+        assert all(f.offset == 0 for f in layout.fields)
+        assert (layout.size, layout.alignment) == (8, 4)
+        assert layout.padding == [{'offset': 5, 'size': 3}]
+
+
+class TestAttributes:
+    """packed/aligned/#pragma pack 测试类"""
+
+    def test_packed(self):
+        """测试packed结构体没有填充"""
+        manager = TypeManager()
+        register_struct(manager, 'struct P', [make_field('c', 'char'), make_field('i', 'int')],
+                        attributes={'packed': True})
+
+        layout = manager.get_type_layout('struct P')
+        assert layout.field('i').offset == 1
+        assert (layout.size, layout.alignment) == (5, 1)
+        assert manager.is_packed_type('struct P')
+
+    def test_pragma_pack(self):
+        """测试#pragma pack限制字段对齐"""
+        manager = TypeManager()
+        register_struct(manager, 'struct Q', [make_field('c', 'char'), make_field('i', 'int')],
+                        attributes={'pack': 2})
+
+        assert manager.get_type_layout('struct Q').field('i').offset == 2
+        assert manager.get_type_size('struct Q') == 6
+
+    def test_aligned(self):
+        """测试结构体和字段的aligned属性"""
+        manager = TypeManager()
+        register_struct(manager, 'struct S', [make_field('i', 'int')], attributes={'aligned': 16})
+        register_struct(manager, 'struct T', [make_field('c', 'char'),
+                                              make_field('i', 'int', attributes={'aligned': 8})])
+
+        assert manager.get_type_size('struct S') == 16
+        assert manager.get_type_layout('struct T').field('i').offset == 8
+        assert manager.get_type_size('struct T') == 16
+
+
+class TestBitfields:
+    """位域布局测试类"""
+
+    def test_sysv_packing(self):
+        """测试System V规则：相邻位域共享存储单元，跨越边界时换到下一个单元"""
+        manager = TypeManager()
+        register_struct(manager, 'struct F', [make_field('a', 'unsigned int', bit_field=3),
+                                              make_field('b', 'unsigned int', bit_field=5),
+                                              make_field('c', 'unsigned int', bit_field=30)])
+
+        layout = manager.get_type_layout('struct F')
+        a, b, c = layout.fields
+        assert (a.offset, a.bit_offset, a.bit_size) == (0, 0, 3)
+        assert (b.offset, b.bit_offset) == (0, 3)
+        assert (c.offset, c.bit_offset) == (4, 0)
+        assert layout.size == 8
+
+    def test_sysv_bitfield_after_char(self):
+        """测试位域与前面的普通字段共享存储单元"""
+        manager = TypeManager()
+        register_struct(manager, 'struct G', [make_field('x', 'char'), make_field('y', 'int', bit_field=8)])
+
+        y = manager.get_type_layout('struct G').field('y')
+        assert (y.offset, y.bit_offset) == (0, 8)
+        assert manager.get_type_size('struct G') == 4
+
+    def test_zero_width_bitfield(self):
+        """测试零宽位域对齐到下一个存储单元"""
+        manager = TypeManager()
+        register_struct(manager, 'struct Z', [make_field('a', 'char', bit_field=3),
+                                              make_field(None, 'int', bit_field=0),
+                                              make_field('b', 'char', bit_field=2)])
+
+        layout = manager.get_type_layout('struct Z')
+        assert [f.name for f in layout.fields] == ['a', 'b']
+        assert layout.field('b').offset == 4
+
+    @pytest.mark.parametrize('pack, fields, size, offsets', [
+        (1, [('c', 'char', None), ('b', 'int', 20), ('d', 'int', 20)], 6, {'b': (1, 0), 'd': (3, 4)}),
+        (2, [('c', 'char', None), ('b', 'int', 20), ('d', 'int', 20), ('e', 'double', None)], 14,
+         {'d': (2, 12), 'e': (6, None)}),
+        (4, [('c', 'char', None), ('s', 'short', 12), ('t', 'short', 8)], 4, {'s': (0, 8), 't': (2, 4)}),
+    ])
+    def test_pragma_pack_bitfields_not_realigned(self, pack, fields, size, offsets):
+        """测试#pragma pack下跨越存储单元的位域不移动到下一个单元（与GCC一致）"""
+        manager = TypeManager()
+        register_struct(manager, 'struct K',
+                        [make_field(name, type_name, bit_field=width) for name, type_name, width in fields],
+                        attributes={'pack': pack})
+
+        layout = manager.get_type_layout('struct K')
+        assert layout.size == size
+        for name, (offset, bit_offset) in offsets.items():
+            assert (layout.field(name).offset, layout.field(name).bit_offset) == (offset, bit_offset)
+
+    def test_ms_bitfields(self):
+        """测试LLP64（MSVC）规则：不同大小类型的位域不共享存储单元"""
+        manager = TypeManager()
+        register_struct(manager, 'struct H', [make_field('a', 'char', bit_field=4),
+                                              make_field('b', 'int', bit_field=4)])
+        register_struct(manager, 'struct G', [make_field('x', 'char'), make_field('y', 'int', bit_field=8)])
+
+        assert manager.get_type_layout('struct H', 'LP64').field('b').offset == 0
+        assert manager.get_type_layout('struct H', 'LLP64').field('b').offset == 4
+        assert manager.get_layout_engine('LLP64').size_of('struct H') == 8
+        assert manager.get_layout_engine('LLP64').size_of('struct G') == 8
+
+
+class TestParsedLayout:
+    """CTypeParser解析结果的布局测试类"""
+
+    def test_parsed_bitfields_and_attributes(self):
+        """测试解析时写入字段偏移、位偏移和属性"""
+        manager = TypeManager()
+        parser = CTypeParser(manager)
+        parser.parse_declarations(
+            "struct Flags { unsigned int a : 3; unsigned int b : 5; };\n"
+            "#pragma pack(push, 1)\n"
+            "struct Packed { char c; int i; };\n"
+            "#pragma pack(pop)\n"
+            "struct Plain { char c; int i; };\n"
+            "typedef int Vec3[3];\n"
+        )
+
+        flags = manager.get_struct_info('struct Flags')
+        assert flags['size'] == 4
+        assert flags['fields'][1]['bit_offset'] == 3
+        assert manager.get_struct_info('struct Packed')['size'] == 5
+        assert manager.get_struct_info('struct Plain')['size'] == 8
+        assert manager.get_type_size('Vec3') == 12
+
+    def test_parse_with_abi(self):
+        """测试按目标ABI解析结构体大小"""
+        manager = TypeManager(abi='ILP32')
+        parser = CTypeParser(manager)
+        parser.parse_declarations("struct P { char c; void *p; long l; };\n")
+
+        assert parser.pointer_size == 4
+        assert manager.get_struct_info('struct P')['size'] == 12
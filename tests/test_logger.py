@@ -0,0 +1,61 @@
+import pytest
+from unittest.mock import patch
+
+from utils.logger import LogGate, log_gate, configure_logging, set_log_level, set_quiet
+from c_parser.core.type_manager import TypeManager
+
+
+class TestLogGate:
+    """日志开关测试类"""
+
+    def teardown_method(self):
+        set_quiet(False)
+        set_log_level('INFO')
+
+    def test_debug_closed_by_default(self):
+        """测试debug开关默认关闭，日志级别为DEBUG时打开"""
+        assert not LogGate().debug
+
+        configure_logging('INFO')
+        assert not log_gate.debug
+        configure_logging('DEBUG')
+        assert log_gate.debug
+
+    def test_set_log_level(self):
+        """测试日志级别控制热点路径开关"""
+        set_log_level('INFO')
+        assert not log_gate.debug
+
+        set_log_level('WARNING')
+        assert not log_gate.debug
+
+        set_log_level('DEBUG')
+        assert log_gate.debug
+
+    def test_quiet_mode(self):
+        """测试静默模式关闭所有开关，关闭静默模式后恢复之前的级别"""
+        set_log_level('INFO')
+        set_quiet(True)
+        assert not log_gate.debug
+        set_quiet(False)
+        assert not log_gate.debug
+
+        set_log_level('DEBUG')
+        set_quiet(True)
+        set_quiet(True)
+        assert not log_gate.debug
+        set_quiet(False)
+        assert log_gate.debug
+
+    def test_disabled_debug_skips_message_formatting(self):
+        """测试debug关闭时不再序列化类型信息"""
+        manager = TypeManager()
+        set_log_level('INFO')
+        with patch('c_parser.core.type_manager.json.dumps') as mock_dumps:
+            manager.resolve_type('int', {'pointer_level': 0})
+            mock_dumps.assert_not_called()
+
+        set_log_level('DEBUG')
+        with patch('c_parser.core.type_manager.json.dumps', return_value='') as mock_dumps:
+            manager.resolve_type('int', {'pointer_level': 0})
+            assert mock_dumps.called
@@ -0,0 +1,111 @@
+import json
+import time
+
+import pytest
+
+from utils.metrics import ParseMetrics, collect_metrics, active_metrics, timed_phase, count, peak_rss
+from c_parser.core.type_manager import TypeManager
+from c_parser.data_parser import CDataParser
+
+
+class _Root:
+    """只有顶层子节点的语法树根节点"""
+
+    def __init__(self, children):
+        self.children = children
+        self.descendant_count = len(children) + 1
+
+
+class _Node:
+    def __init__(self, node_type):
+        self.type = node_type
+        self.children = []
+
+
+class TestParseMetrics:
+    """ParseMetrics 统计测试类"""
+
+    def test_phases_counters_and_caches(self):
+        """测试阶段耗时累计、计数器和缓存命中率"""
+        metrics = ParseMetrics()
+        for _ in range(2):
+            with metrics.phase('parse'):
+                time.sleep(0.001)
+        metrics.count('variables', 3)
+        metrics.record_cache('type_resolution', 3, 1)
+
+        result = metrics.to_dict()
+        assert result['calls']['parse'] == 2
+        assert result['phases_ms']['parse'] >= 2
+        assert result['counters'] == {'variables': 3}
+        assert result['caches']['type_resolution']['hit_rate'] == 0.75
+        assert result['peak_rss_bytes'] is None or result['peak_rss_bytes'] > 0
+        json.dumps(result)
+        assert 'parse' in metrics.format_report()
+
+    def test_peak_rss_includes_peak_inside_phase(self):
+        """测试阶段内部分配并释放的内存计入峰值RSS"""
+        before = peak_rss()
+        if before is None:
+            pytest.skip('峰值RSS不可用')
+        size = before + (64 << 20)
+        metrics = ParseMetrics()
+        with metrics.phase('decode'):
+            block = b'\x01' * size
+            del block
+
+        assert metrics.peak_rss >= size
+
+    def test_merge(self):
+        """测试合并多份统计"""
+        first, second = ParseMetrics(), ParseMetrics()
+        first.count('variables', 1)
+        second.count('variables', 2)
+        second.record_cache('layout', 1, 1)
+        with second.phase('read'):
+            pass
+        first.merge(second)
+        assert first.counters['variables'] == 3
+        assert first.calls['read'] == 1
+        assert first.caches['layout']['hits'] == 1
+
+
+class TestCollectMetrics:
+    """统计上下文测试类"""
+
+    def test_inactive_is_noop(self):
+        """测试未收集统计时埋点不记录"""
+        assert active_metrics() is None
+        with timed_phase('read'):
+            count('variables')
+
+    def test_nested_collection(self):
+        """测试嵌套收集时内层结束后恢复外层"""
+        with collect_metrics() as outer:
+            with collect_metrics() as inner:
+                with timed_phase('parse'):
+                    count('variables')
+            assert active_metrics() is outer
+        assert active_metrics() is None
+        assert inner.counters == {'variables': 1} and 'parse' in inner.phases
+        assert not outer.counters
+
+
+class TestParserMetrics:
+    """CDataParser 统计测试类"""
+
+    def test_parse_file_with_metrics(self, monkeypatch):
+        """测试解析结果和统计一起返回，包含阶段、节点计数和缓存"""
+        parser = CDataParser(TypeManager())
+        root = _Root([_Node('comment'), _Node('comment')])
+        monkeypatch.setattr(parser.tree_sitter, 'parse', lambda text: root)
+
+        result, metrics = parser.parse_file_with_metrics('int a;')
+        stats = metrics.to_dict()
+        assert 'variables' in result
+        assert {'total', 'read', 'parse', 'type_walk'} <= set(stats['phases_ms'])
+        assert stats['calls']['type_walk'] == 2
+        assert stats['counters']['top_level_nodes'] == 2
+        assert stats['counters']['syntax_nodes'] == 3
+        assert 'type_resolution' in stats['caches']
+        assert parser._metrics is None
@@ -0,0 +1,60 @@
+import io
+import json
+import pytest
+
+from c_parser.core.output_writer import StreamingJsonWriter
+
+
+class TestStreamingJsonWriter:
+    """StreamingJsonWriter测试类"""
+
+    def test_ndjson(self):
+        """测试ndjson格式每行一个变量"""
+        out = io.StringIO()
+        writer = StreamingJsonWriter(out, 'ndjson')
+        writer.write_variable({'name': 'a', 'type': 'int', 'parsed_value': 1}, 'variables')
+        writer.write_variable({'name': 'b', 'type': 'int', 'parsed_value': [1, 2]}, 'array_vars')
+        writer.close()
+
+        lines = [json.loads(line) for line in out.getvalue().splitlines()]
+        assert [line['name'] for line in lines] == ['a', 'b']
+        assert lines[1]['category'] == 'array_vars'
+
+    def test_incremental_json_with_extra(self):
+        """测试增量JSON格式输出合法的JSON对象"""
+        out = io.StringIO()
+        writer = StreamingJsonWriter(out, 'json')
+        writer.write_variable({'name': 'a', 'type': 'int'})
+        # 变量写出后立即可见
+        assert '"a"' in out.getvalue()
+        writer.write_variable({'name': 'b', 'type': 'int'})
+        writer.close({'structs': [{'name': 'struct S'}]})
+
+        data = json.loads(out.getvalue())
+        assert [var['name'] for var in data['variables']] == ['a', 'b']
+        assert data['structs'] == [{'name': 'struct S'}]
+
+    def test_empty_json(self):
+        """测试没有变量时输出空列表"""
+        out = io.StringIO()
+        writer = StreamingJsonWriter(out, 'json')
+        writer.close()
+
+        assert json.loads(out.getvalue()) == {'variables': []}
+
+    def test_simplified(self):
+        """测试精简模式只保留核心字段"""
+        out = io.StringIO()
+        writer = StreamingJsonWriter(out, 'ndjson', simplified=True)
+        writer.write_variable({'name': 'a', 'type': 'int', 'array_size': [], 'parsed_value': 3,
+                               'location': {'line': 1}}, 'variables')
+        writer.write_variable({'name': None, 'type': 'int'})
+        writer.close()
+
+        assert json.loads(out.getvalue()) == {'name': 'a', 'type': 'int', 'parsed_value': 3}
+        assert writer.count == 1
+
+    def test_invalid_format(self):
+        """测试不支持的格式"""
+        with pytest.raises(ValueError):
+            StreamingJsonWriter(io.StringIO(), 'xml')
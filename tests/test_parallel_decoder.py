@@ -0,0 +1,140 @@
+import array
+from concurrent.futures import ThreadPoolExecutor
+from unittest.mock import patch
+
+import pytest
+
+from c_parser import parallel_decoder
+from c_parser.parallel_decoder import ParallelDecoder
+from c_parser.core.columnar import StructColumns
+from c_parser.core.type_manager import TypeManager
+from c_parser.data_parser import CDataParser
+
+
+def _node(node_type, start, end, children=None):
+    from conftest import create_mock_node
+    node = create_mock_node(node_type, children=children)
+    node.start_byte, node.end_byte = start, end
+    return node
+
+
+def _initializer(values, element_type='number_literal'):
+    """按 {v0, v1, ...} 生成源码和带字节范围的 initializer_list 节点"""
+    source = b'{'
+    children = [_node('{', 0, 1)]
+    for index, value in enumerate(values):
+        if index:
+            children.append(_node(',', len(source), len(source) + 1))
+            source += b', '
+        text = str(value).encode()
+        children.append(_node(element_type, len(source), len(source) + len(text)))
+        source += text
+    children.append(_node('}', len(source), len(source) + 1))
+    source += b'}'
+    return source, _node('initializer_list', 0, len(source), children)
+
+
+def _fake_decode(parser, span, element_info):
+    """代替tree-sitter解码：每个元素为逗号分隔的整数"""
+    values = [int(text) for text in span.split(b',')]
+    if element_info['typeinfo'].get('is_struct'):
+        return [parser.struct_values.build(element_info['typeinfo']['info'], {'id': value, 'gain': value * 2})
+                for value in values]
+    return values
+
+
+@pytest.fixture
+def in_process_pool():
+    """工作进程替换为线程，工作解析器使用测试中的解析器"""
+    def init(*args):
+        parallel_decoder._worker_parser = init.parser
+
+    with patch.object(parallel_decoder, 'ProcessPoolExecutor', ThreadPoolExecutor), \
+            patch.object(parallel_decoder, '_init_worker', side_effect=init), \
+            patch.object(CDataParser, 'decode_element_span', autospec=True, side_effect=_fake_decode):
+        yield init
+
+
+class TestPartition:
+    """元素切分测试"""
+
+    def test_contiguous_slices(self):
+        """测试切分为覆盖所有元素的连续段"""
+        decoder = ParallelDecoder(jobs=3)
+        slices = decoder.partition(list(range(100)))
+
+        assert len(slices) == 3 * ParallelDecoder.SLICES_PER_JOB
+        assert slices[0][0] == 0 and slices[-1][1] == 99
+        assert all(end + 1 == start for (_, end), (start, _) in zip(slices, slices[1:]))
+
+    def test_fewer_elements_than_slices(self):
+        """测试元素少于段数时每段一个元素"""
+        assert ParallelDecoder(jobs=4).partition([1, 2]) == [(0, 0), (1, 1)]
+
+    def test_designated_initializer_not_split(self):
+        """测试含指定初始化的列表不分段"""
+        _, node = _initializer([1, 2, 3])
+        node.children[3].type = 'initializer_pair'
+
+        assert ParallelDecoder.split_elements(node) is None
+
+
+class TestParallelDecode:
+    """分段解码测试"""
+
+    def _parser(self, **kwargs):
+        parser = CDataParser(TypeManager(), decode_jobs=2, **kwargs)
+        parser.parallel_decoder.min_elements = 1
+        return parser
+
+    def _variable(self, parser, type_name, array_size, node):
+        info = {'name': 'table', 'type': type_name, 'array_size': array_size, 'initializer_node': node}
+        info['typeinfo'] = parser.type_manager.resolve_type(type_name, {'array_size': array_size})
+        return info
+
+    def test_slices_stitched_in_order(self, in_process_pool):
+        """测试各段的结果按元素顺序拼接，动态维度按元素数量推断"""
+        parser = self._parser()
+        in_process_pool.parser = parser
+        source, node = _initializer(range(50))
+        parser._source = memoryview(source)
+        variable = self._variable(parser, 'int', ['dynamic'], node)
+
+        assert parser._parse_initializer_direct(node, variable) == list(range(50))
+        assert variable['array_size'] == [50]
+        assert 'initializer_node' not in variable
+
+    def test_typed_array_and_truncation(self, in_process_pool):
+        """测试拼接后按声明长度截取并转换为 array.array"""
+        parser = self._parser(typed_arrays=True)
+        in_process_pool.parser = parser
+        source, node = _initializer(range(20))
+        parser._source = memoryview(source)
+
+        value = parser._parse_initializer_direct(node, self._variable(parser, 'int', [10], node))
+
+        assert isinstance(value, array.array) and list(value) == list(range(10))
+
+    def test_struct_columns(self, in_process_pool):
+        """测试结构体元素在工作进程中填充，列式模式下写入列"""
+        parser = self._parser(columnar=True)
+        in_process_pool.parser = parser
+        parser.type_manager.register_type('struct Cal', {'kind': 'struct', 'name': 'struct Cal', 'fields': [
+            {'name': 'id', 'type': 'int', 'array_size': None, 'bit_field': None},
+            {'name': 'gain', 'type': 'int', 'array_size': None, 'bit_field': None},
+        ]})
+        source, node = _initializer(range(8), 'initializer_list')
+        parser._source = memoryview(source)
+
+        value = parser._parse_initializer_direct(node, self._variable(parser, 'struct Cal', [8], node))
+
+        assert isinstance(value, StructColumns)
+        assert list(value.column('gain')) == [i * 2 for i in range(8)]
+
+    def test_small_list_decoded_serially(self):
+        """测试元素数量不足时不启动工作进程"""
+        parser = CDataParser(TypeManager(), decode_jobs=4)
+        _, node = _initializer(range(10))
+
+        with patch.object(parallel_decoder, 'ProcessPoolExecutor', side_effect=AssertionError):
+            assert parser.parallel_decoder.decode(parser, node, {'typeinfo': {}}) is None
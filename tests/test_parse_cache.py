@@ -0,0 +1,174 @@
+import pytest
+from pathlib import Path
+from unittest.mock import Mock, patch
+
+from conftest import make_field
+
+from c_parser.core.parse_cache import ParseCache
+from c_parser.core.type_manager import TypeManager
+from c_parser.type_parser import CTypeParser
+
+
+class TestParseCache:
+    """ParseCache测试类"""
+
+    def test_make_key_depends_on_content_and_macros(self, tmp_path):
+        """测试缓存键由内容、宏定义和条件编译的判定方式决定"""
+        cache = ParseCache(tmp_path)
+
+        key = cache.make_key([b'typedef int a;'], {'N': 1})
+        assert key == cache.make_key([b'typedef int a;'], {'N': 1})
+        assert key != cache.make_key([b'typedef int b;'], {'N': 1})
+        assert key != cache.make_key([b'typedef int a;'], {'N': 2})
+        assert key != cache.make_key([b'typedef int a;'], {'N': 1}, evaluate_conditions=False)
+        assert key != cache.make_key([b'typedef int a;'], {'N': 1}, function_macros=['F'])
+        assert key != cache.make_key([b'typedef int a;'], {'N': 1}, pack_state=(1, (None,)))
+        # 内容边界参与计算，拼接结果相同的不同文件不会冲突
+        assert cache.make_key([b'ab', b'c']) != cache.make_key([b'a', b'bc'])
+
+    def test_store_and_load(self, tmp_path):
+        """测试写入和读取缓存条目"""
+        cache = ParseCache(tmp_path)
+        payload = {
+            'types': [{'kind': 'typedef', 'name': 'u8', 'type': 'uint8_t'}],
+            'pointer_types': [],
+            'macro_definitions': {'MAX': 10}
+        }
+        key = cache.make_key([b'content'])
+
+        assert cache.load(key) is None
+        assert cache.store(key, payload)
+        assert cache.load(key) == payload
+        assert cache.hits == 1
+        assert cache.misses == 1
+
+    def test_load_ignores_corrupted_entry(self, tmp_path):
+        """测试损坏的缓存条目被忽略"""
+        cache = ParseCache(tmp_path)
+        key = cache.make_key([b'content'])
+        cache.store(key, {'types': []})
+
+        entry = next(Path(tmp_path).glob('*/*.bin'))
+        entry.write_bytes(b'garbage')
+
+        assert cache.load(key) is None
+
+    def test_clear(self, tmp_path):
+        """测试清空缓存"""
+        cache = ParseCache(tmp_path)
+        key = cache.make_key([b'content'])
+        cache.store(key, {'types': []})
+        cache.clear()
+
+        assert cache.load(key) is None
+
+
+class TestTypeParserCache:
+    """CTypeParser缓存集成测试"""
+
+    def test_warm_parse_skips_tree_sitter(self, tmp_path):
+        """测试缓存命中时不再解析头文件"""
+        header = tmp_path / 'types.h'
+        header.write_text('typedef unsigned char u8;\n#define MAX 10\n')
+        cache = ParseCache(tmp_path / 'cache')
+
+        def fake_parse(parser):
+            def parse(source, tree=None):
+                parser.type_manager.register_type('u8', {'kind': 'typedef', 'type': 'unsigned char',
+                                                         'base_type': 'unsigned char', 'real_type': 'base'})
+                parser.type_manager.add_macro_definition('MAX', 10)
+                return parser.type_manager.export_types()
+            return parse
+
+        cold = CTypeParser(TypeManager(), parse_cache=cache)
+        with patch.object(cold, '_parse_declarations', side_effect=fake_parse(cold)) as mock_parse:
+            cold.parse_declarations(header)
+            assert mock_parse.call_count == 1
+
+        warm = CTypeParser(TypeManager(), parse_cache=cache)
+        with patch.object(warm, '_parse_declarations') as mock_parse:
+            result = warm.parse_declarations(header)
+            mock_parse.assert_not_called()
+
+        assert result['macro_definitions'] == {'MAX': 10}
+        assert warm.type_manager.find_type_by_name('u8', kind='typedef')['type'] == 'unsigned char'
+
+    def test_include_change_invalidates_cache(self, tmp_path):
+        """测试包含文件变化后缓存失效"""
+        included = tmp_path / 'common.h'
+        included.write_text('typedef int a;\n')
+        header = tmp_path / 'top.h'
+        header.write_text('#include "common.h"\n')
+
+        parser = CTypeParser(TypeManager(), parse_cache=ParseCache(tmp_path / 'cache'))
+        before = parser.parse_cache.make_key(parser._collect_dependencies(header)[1])
+        included.write_text('typedef long a;\n')
+        after = parser.parse_cache.make_key(parser._collect_dependencies(header)[1])
+
+        assert before != after
+
+    def test_conditions_survive_cache_hit(self, tmp_path):
+        """测试缓存命中与重新解析后条件编译的判定相同，判定方式不同的解析器不共享缓存条目"""
+        header = tmp_path / 'config.h'
+        header.write_text('#define FEATURE(x) (x)\n#define LEVEL 2\n')
+        cache = ParseCache(tmp_path / 'cache')
+
+        def fake_parse(parser):
+            def parse(source, tree=None):
+                if parser.conditions is not None:
+                    parser.conditions.define_function_macro('FEATURE')
+                parser.type_manager.add_macro_definition('LEVEL', 2)
+                return parser.type_manager.export_types()
+            return parse
+
+        def parse(evaluate_conditions=True):
+            parser = CTypeParser(TypeManager(), parse_cache=cache, evaluate_conditions=evaluate_conditions)
+            with patch.object(parser, '_parse_declarations', side_effect=fake_parse(parser)) as mock_parse:
+                parser.parse_declarations(header)
+            return parser, mock_parse.call_count
+
+        cold, cold_calls = parse()
+        warm, warm_calls = parse()
+        unevaluated, unevaluated_calls = parse(evaluate_conditions=False)
+
+        assert (cold_calls, warm_calls, unevaluated_calls) == (1, 0, 1)
+        for condition in ('defined(FEATURE)', 'defined(FEATURE) && LEVEL == 2'):
+            assert warm.conditions.evaluate_condition(condition) is cold.conditions.evaluate_condition(condition)
+        assert warm.conditions.evaluate_condition('defined(FEATURE)') is True
+        assert unevaluated.conditions is None
+
+    def test_pack_state_survives_cache_hit(self, tmp_path):
+        """测试缓存命中后恢复头文件留下的 #pragma pack 状态，之后的结构体布局与冷启动相同"""
+        header = tmp_path / 'pshpack1.h'
+        header.write_text('#pragma pack(push, 1)\n')
+        cache = ParseCache(tmp_path / 'cache')
+
+        def fake_parse(parser):
+            def parse(source, tree=None):
+                # 等同于 #pragma pack(push, 1)
+                pack, stack = parser.get_pack_state()
+                parser.set_pack_state((1, stack + (pack,)))
+                return parser.type_manager.export_types()
+            return parse
+
+        def parse(pack_state=(None, ())):
+            parser = CTypeParser(TypeManager(), parse_cache=cache)
+            parser.set_pack_state(pack_state)
+            with patch.object(parser, '_parse_declarations', side_effect=fake_parse(parser)) as mock_parse:
+                parser.parse_declarations(header)
+            # 包含文件之后定义的 struct { char a; int b; }
+            node = Mock(type='struct_specifier', children=[], parent=None)
+            parser.type_manager.register_type('struct Later', {
+                'kind': 'struct', 'name': 'struct Later', 'attributes': parser._parse_layout_attributes(node),
+                'fields': [make_field('a', 'char'), make_field('b', 'int')]})
+            return parser, mock_parse.call_count
+
+        cold, cold_calls = parse()
+        warm, warm_calls = parse()
+        nested, nested_calls = parse((2, ()))
+
+        assert (cold_calls, warm_calls, nested_calls) == (1, 0, 1)
+        assert warm.get_pack_state() == cold.get_pack_state() == (1, (None,))
+        assert nested.get_pack_state() == (1, (2,))
+        for parser in (cold, warm):
+            assert parser.type_manager.get_layout_engine().size_of('struct Later') == 5
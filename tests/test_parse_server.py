@@ -0,0 +1,130 @@
+import json
+import os
+import threading
+
+import pytest
+
+from c_parser.parse_server import ParseServer, METHOD_NOT_FOUND, INVALID_PARAMS, PARSE_ERROR, INVALID_REQUEST
+from c_parser.core.type_manager import TypeManager
+
+
+def _request(method, request_id=1, **params):
+    """创建JSON-RPC请求"""
+    return {'jsonrpc': '2.0', 'id': request_id, 'method': method, 'params': params}
+
+
+@pytest.fixture
+def types_file(tmp_path):
+    """导出的类型信息文件：一个结构体和一个typedef"""
+    manager = TypeManager()
+    manager.register_type('struct Point', {'kind': 'struct', 'name': 'struct Point', 'fields': [
+        {'name': 'x', 'type': 'char', 'array_size': None, 'bit_field': None},
+        {'name': 'y', 'type': 'int', 'array_size': None, 'bit_field': None},
+    ]})
+    manager.register_type('Point', {'kind': 'typedef', 'name': 'Point', 'type': 'struct Point',
+                                    'base_type': 'struct Point'})
+    path = tmp_path / 'types.json'
+    path.write_text(json.dumps(manager.export_types()))
+    return str(path)
+
+
+@pytest.fixture
+def server():
+    """两个工作线程的服务"""
+    server = ParseServer(workers=2)
+    yield server
+    server.close()
+
+
+class TestProtocol:
+    """JSON-RPC协议处理测试类"""
+
+    def test_errors(self, server):
+        """测试格式错误、无效请求、未知方法和无效参数"""
+        assert json.loads(server.handle_text('{'))['error']['code'] == PARSE_ERROR
+        assert server.handle({'id': 1})['error']['code'] == INVALID_REQUEST
+        assert server.handle(_request('missing'))['error']['code'] == METHOD_NOT_FOUND
+        assert server.handle(_request('resolve_type'))['error']['code'] == INVALID_PARAMS
+        assert server.handle(_request('analyze', text='int a;', source='a.c'))['error']['code'] == INVALID_PARAMS
+
+    def test_batch_and_notification(self, server, types_file):
+        """测试批量请求，通知不返回响应"""
+        notification = {'jsonrpc': '2.0', 'method': 'resolve_type', 'params': {'type': 'int'}}
+        assert server.handle(notification) is None
+
+        responses = server.handle([_request('resolve_type', 1, type='Point', types=types_file),
+                                   notification, _request('missing', 2)])
+        assert [response['id'] for response in responses] == [1, 2]
+        assert 'result' in responses[0] and 'error' in responses[1]
+
+
+class TestMethods:
+    """方法和类型环境测试类"""
+
+    def test_layout_and_resolve(self, server, types_file):
+        """测试布局和类型解析结果"""
+        layout = server.handle(_request('layout', types=types_file, type='struct Point'))['result']
+        assert layout['abi'] == 'LP64'
+        assert layout['layouts'][0]['size'] == 8
+
+        ilp32 = server.handle(_request('layout', types=types_file, abi='ILP32'))['result']
+        assert [entry['name'] for entry in ilp32['layouts']] == ['struct Point']
+
+        resolved = server.handle(_request('resolve_type', types=types_file, type='Point'))['result']
+        assert resolved == TypeManager(json.load(open(types_file))).resolve_type('Point')
+
+    def test_environment_reused_until_modified(self, server, types_file):
+        """测试类型环境跨请求复用，文件修改后重新加载"""
+        params = {'types': types_file}
+        first = server._environment(params)
+        assert server._environment(params) is first
+
+        os.utime(types_file, ns=(1, 1))
+        assert server._environment(params) is not first
+
+    def test_environment_per_macro_set(self, server, types_file):
+        """测试不同的预定义宏得到不同的类型环境"""
+        first = server._environment({'types': types_file, 'defines': {'TARGET_A': 1}})
+        assert server._environment({'types': types_file, 'defines': {'TARGET_A': 1}}) is first
+        second = server._environment({'types': types_file, 'defines': {'TARGET_B': '2'}})
+        assert second is not first
+        assert second.manager.get_macro_definition('TARGET_B') == 2
+        assert not first.manager.has_macro('TARGET_B')
+
+        error = server.handle(_request('parse', types=types_file, defines=['X']))['error']
+        assert error['code'] == INVALID_PARAMS
+
+    def test_fork_shares_global_types(self, types_file):
+        """测试fork共享全局类型表，当前文件层互不影响"""
+        manager = TypeManager(json.load(open(types_file)))
+        forked = manager.fork()
+        forked.register_type('Local', {'kind': 'typedef', 'name': 'Local', 'type': 'int', 'base_type': 'int'})
+
+        assert forked.get_type_info('Point')
+        assert forked.get_type_info('Local')
+        assert not manager.get_type_info('Local')
+
+    def test_analyze_text(self, server, types_file):
+        """测试使用已加载的类型环境解析源码"""
+        result = server.handle(_request('analyze', types=types_file, text='Point p = {1, 2};\n'))['result']
+        assert result['variables'][0]['name'] == 'p'
+
+
+class TestServe:
+    """请求流处理测试类"""
+
+    def test_concurrent_stream(self, server, types_file):
+        """测试请求流并发处理，每个请求都有一行响应"""
+        lines = [json.dumps(_request('resolve_type', index, types=types_file, type='Point')) + '\n'
+                 for index in range(20)]
+        output = []
+        lock = threading.Lock()
+
+        def write(text):
+            with lock:
+                output.append(text)
+
+        server.serve(lines + ['\n'], write)
+        responses = [json.loads(text) for text in output]
+        assert sorted(response['id'] for response in responses) == list(range(20))
+        assert all(text.endswith('\n') for text in output)
@@ -0,0 +1,114 @@
+import pytest
+
+from c_parser.core.resolution_cache import ResolutionCache
+from c_parser.core.type_manager import TypeManager
+
+
+def _typedef(name, base):
+    """创建typedef类型条目"""
+    return {'kind': 'typedef', 'name': name, 'type': base, 'base_type': base, 'real_type': 'base'}
+
+
+class TestResolutionCache:
+    """ResolutionCache测试类"""
+
+    def test_put_and_get(self):
+        """测试缓存结果，包括None结果"""
+        cache = ResolutionCache()
+        cache.put('kind', 'a', None, {'a'})
+
+        assert cache.get('kind', 'a') is None
+        assert cache.get('kind', 'b') is ResolutionCache.MISSING
+        assert cache.hits == 1
+        assert cache.misses == 1
+
+    def test_invalidate_only_dependents(self):
+        """测试只失效依赖变化类型的结果"""
+        cache = ResolutionCache()
+        cache.put('resolve', 'T2', 'int', {'T2', 'T1', 'int'})
+        cache.put('resolve', 'Other', 'char', {'Other', 'char'})
+
+        assert cache.invalidate(['T1']) == 1
+        assert ('resolve', 'T2') not in cache
+        assert cache.get('resolve', 'Other') == 'char'
+
+    def test_replace_entry_updates_dependencies(self):
+        """测试覆盖结果时旧的依赖不再生效"""
+        cache = ResolutionCache()
+        cache.put('kind', 'a', 'typedef', {'a', 'b'})
+        cache.put('kind', 'a', 'basic', {'a'})
+
+        assert cache.invalidate(['b']) == 0
+        assert cache.get('kind', 'a') == 'basic'
+
+
+class TestTypeManagerResolution:
+    """TypeManager类型解析缓存测试"""
+
+    def _chain_manager(self, depth=5):
+        """T0 -> int, Tn -> Tn-1"""
+        manager = TypeManager()
+        previous = 'int'
+        for i in range(depth):
+            manager.register_type(f"T{i}", _typedef(f"T{i}", previous))
+            previous = f"T{i}"
+        return manager
+
+    def test_resolve_deep_typedef_chain(self):
+        """测试typedef链被完整解析"""
+        manager = self._chain_manager()
+
+        info = manager.resolve_type('T4')
+        assert info['base_type'] == 'int'
+        assert info['is_basic']
+        assert manager.get_type_size('T4') == 4
+
+    def test_resolve_pointer_through_chain(self):
+        """测试typedef链上的指针级别被累计"""
+        manager = TypeManager()
+        manager.register_type('IntPtr', _typedef('IntPtr', 'int*'))
+        manager.register_type('Handle', _typedef('Handle', 'IntPtr'))
+
+        info = manager.resolve_type('Handle*')
+        assert info['base_type'] == 'int'
+        assert info['pointer_level'] == 2
+        assert manager.get_type_size('Handle') == 8
+
+    def test_repeated_resolve_hits_cache(self):
+        """测试重复解析直接命中缓存"""
+        manager = self._chain_manager()
+        manager.resolve_type('T4')
+        hits = manager._resolution_cache.hits
+
+        manager.resolve_type('T4')
+        assert manager._resolution_cache.hits == hits + 1
+
+    def test_merge_invalidates_dependent_chain(self):
+        """测试链上的类型更新后依赖它的结果失效"""
+        manager = self._chain_manager()
+        manager.resolve_type('T4')
+        manager.resolve_type('int')
+
+        manager.merge_type_info({'types': [_typedef('T0', 'unsigned char')]})
+
+        assert ('resolve', 'T4') not in manager._resolution_cache
+        assert ('resolve', 'int') in manager._resolution_cache
+        assert manager.resolve_type('T4')['base_type'] == 'unsigned char'
+        assert manager.get_type_size('T4') == 1
+
+    def test_register_invalidates_unresolved_name(self):
+        """测试之前未定义的类型注册后重新解析"""
+        manager = TypeManager()
+        manager.register_type('Alias', _typedef('Alias', 'Later'))
+        assert manager.resolve_type('Alias')['base_type'] == 'Later'
+
+        manager.register_type('Later', _typedef('Later', 'short'))
+        assert manager.resolve_type('Alias')['base_type'] == 'short'
+
+    def test_direct_list_change_clears_cache(self):
+        """测试绕过TypeManager修改类型列表时缓存被清空"""
+        manager = self._chain_manager()
+        manager.resolve_type('T4')
+
+        manager._current_types = [_typedef('T4', 'double')]
+        assert manager.resolve_type('T4')['base_type'] == 'double'
@@ -0,0 +1,139 @@
+import io
+from unittest.mock import Mock, patch
+
+import pytest
+from tree_sitter import Node
+
+from c_parser.core import source_chunker
+from c_parser.core.source_chunker import SourceChunker
+from c_parser.data_parser import CDataParser
+
+
+SOURCE = (b'#include "types.h"\n'
+          b'/* header; { comment */\n'
+          b'typedef struct { int a; int b; } Pair;\n'
+          b'const Pair table[] = { {1, 2}, {3, 4} }; // trailing; comment\n'
+          b'#if ENABLE\n'
+          b'int x = 1;\n'
+          b'#endif\n'
+          b'const char *s = "a;b{";\n'
+          b"char c = ';';\n"
+          b'int f(void) { return 1; }\n'
+          b'int y = 2;\n')
+
+
+def _chunks(source, chunk_size=1, read_size=None):
+    return list(SourceChunker(io.BytesIO(source), chunk_size, read_size))
+
+
+class TestSourceChunker:
+    """SourceChunker测试"""
+
+    @pytest.mark.parametrize('read_size', [1, 3, 16, None])
+    def test_chunks_reassemble_source(self, read_size):
+        """测试任意读取大小下各块按顺序拼接为原文件，偏移和行号正确"""
+        chunks = _chunks(SOURCE * 3, 40, read_size)
+
+        assert b''.join(chunk.data for chunk in chunks) == SOURCE * 3
+        for chunk in chunks:
+            assert (SOURCE * 3)[chunk.offset:chunk.offset + len(chunk.data)] == chunk.data
+            assert (SOURCE * 3)[:chunk.offset].count(b'\n') == chunk.line
+
+    @pytest.mark.parametrize('read_size', [1, 5, None])
+    def test_cuts_only_at_top_level(self, read_size):
+        """测试只在顶层声明之间切分，注释、字符串、括号和预处理条件内部不切分"""
+        chunks = [chunk.data.strip() for chunk in _chunks(SOURCE, 1, read_size)]
+
+        assert chunks == [
+            b'#include "types.h"',
+            b'/* header; { comment */\ntypedef struct { int a; int b; } Pair;',
+            b'const Pair table[] = { {1, 2}, {3, 4} };',
+            b'// trailing; comment\n#if ENABLE\nint x = 1;\n#endif',
+            b'const char *s = "a;b{";',
+            b"char c = ';';",
+            b'int f(void) { return 1; }\nint y = 2;',
+            # 最后一个切分点之后剩余的换行
+            b'',
+        ]
+
+    def test_chunk_size(self):
+        """测试块在达到目标大小后的第一个切分点结束"""
+        declaration = b'const int t[] = {1, 2, 3, 4};\n'
+        chunks = _chunks(declaration * 100, 10 * len(declaration))
+
+        assert 1 < len(chunks) <= 10
+        for chunk in chunks[:-1]:
+            assert chunk.data.endswith(b';')
+            # 超出目标大小的部分不超过一次预读
+            assert 10 * len(declaration) <= len(chunk.data) < 20 * len(declaration)
+
+    @pytest.mark.parametrize('entries', [4096, 16384, 65536])
+    def test_flat_initializer_scanned_once(self, entries):
+        """测试大的一维初始化列表只扫描一遍，扫描量与输入大小成正比"""
+        source = b'const int t[] = {' + b', '.join(b'%d' % i for i in range(entries)) + b'};\n'
+        pattern = source_chunker._TOKENS
+        scanned = []
+
+        class CountingTokens:
+            """记录每次扫描的字节数"""
+            def finditer(self, buffer, pos):
+                scanned.append(len(buffer) - pos)
+                return pattern.finditer(buffer, pos)
+
+        with patch.object(source_chunker, '_TOKENS', CountingTokens()):
+            chunks = _chunks(source, len(source) + 1, 1024)
+
+        assert b''.join(chunk.data for chunk in chunks) == source
+        assert sum(scanned) < 2 * len(source)
+
+    def test_trailing_slash_and_directive_across_reads(self):
+        """测试跳过未扫描部分时，读取边界处的 // 和行首的预处理指令仍被识别"""
+        source = b'int a[] = {1, 2};  // x; y\n  #if X\nint b;\n#endif\nint c;\n'
+        cuts = {source.index(b'};') + 2, source.index(b'#endif') + 6, source.index(b'int c;') + 6, len(source)}
+        for read_size in range(1, len(source) + 1):
+            chunks = _chunks(source, 1, read_size)
+            assert b''.join(chunk.data for chunk in chunks) == source
+            assert {chunk.offset + len(chunk.data) for chunk in chunks} <= cuts
+
+    def test_unbalanced_conditional_is_one_chunk(self):
+        """测试没有安全切分点时整个文件作为一个块"""
+        source = b'#ifndef GUARD\n#define GUARD\nint a;\nint b;\n'
+
+        assert [chunk.data for chunk in _chunks(source)] == [source]
+
+    def test_invalid_chunk_size(self):
+        """测试无效的块大小"""
+        with pytest.raises(ValueError):
+            SourceChunker(io.BytesIO(SOURCE), 0)
+
+
+class TestChunkedParsing:
+    """CDataParser分块解析测试"""
+
+    def test_chunks_walked_in_order(self, tmp_path):
+        """测试各块依次生成语法树并遍历，节点文本和行号相对整个文件"""
+        path = tmp_path / 'data.c'
+        path.write_bytes(SOURCE)
+        parser = CDataParser()
+        walked = []
+
+        def parse(data):
+            root = Mock(spec=Node)
+            root.children = []
+            return root
+
+        def walk(root):
+            walked.append((bytes(parser._source), parser._line_offset, parser.type_parser.line_offset))
+
+        with patch.object(parser.tree_sitter, 'parse', side_effect=parse), \
+                patch.object(parser, '_process_ast_node', side_effect=walk):
+            result = parser.parse_file_chunked(path, chunk_size=1)
+
+        assert b''.join(data for data, _, _ in walked) == SOURCE
+        offset = 0
+        for data, line, type_line in walked:
+            assert line == type_line == SOURCE[:offset].count(b'\n')
+            offset += len(data)
+        assert parser.current_file == str(path)
+        assert parser._source is None and parser._line_offset == 0
+        assert set(result) >= {'structs', 'variables'}
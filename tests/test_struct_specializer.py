@@ -0,0 +1,74 @@
+import pytest
+
+from conftest import make_field, register_struct
+
+from c_parser.core.struct_specializer import StructSpecializer
+from c_parser.core.value_records import StructValue
+from c_parser.data_parser import CDataParser
+
+
+@pytest.fixture
+def type_manager(pos_type_manager):
+    """包含嵌套结构体、结构体数组、联合体和指针字段的类型"""
+    register_struct(pos_type_manager, 'union Raw', [make_field('word', 'int'), make_field('half', 'short', [2])],
+                    kind='union')
+    register_struct(pos_type_manager, 'struct Cal', [
+        make_field('id', 'unsigned char'), make_field('gain', 'float', [2]), make_field('pos', 'struct Pos'),
+        make_field('path', 'struct Pos', [2]), make_field('raw', 'union Raw'), make_field('next', 'struct Cal *'),
+    ])
+    return pos_type_manager
+
+
+def _variable(type_manager, type_name='struct Cal'):
+    return {'name': 'cal', 'type': type_name, 'array_size': None,
+            'typeinfo': type_manager.resolve_type(type_name)}
+
+
+RAW = [1, [0.5, 1.5], [-1, 2], [[1, 2], [3, 4]], [{'half': [5, 6]}], 0]
+
+
+class TestStructSpecializer:
+    """生成的填充函数测试类"""
+
+    def test_same_result_as_generic(self, type_manager):
+        """测试嵌套结构体、结构体数组、联合体和指定初始化的结果与通用流程相同"""
+        specialized = CDataParser(type_manager)._fill_field_data(RAW, _variable(type_manager))
+        generic = CDataParser(type_manager, specialize=False)._fill_field_data(RAW, _variable(type_manager))
+
+        assert isinstance(specialized, StructValue)
+        assert specialized == generic
+        assert specialized['path'] == [{'x': 1, 'y': 2}, {'x': 3, 'y': 4}]
+        assert specialized['raw'] == {'half': [5, 6]}
+
+    def test_partial_and_designated(self, type_manager):
+        """测试初始化列表短于字段数量和 {.field = value} 形式"""
+        parser = CDataParser(type_manager)
+        generic = CDataParser(type_manager, specialize=False)
+        for raw in ([7], [{'id': 3}, {'gain': [1.0, 2.0]}], []):
+            assert parser._fill_field_data(raw, _variable(type_manager)) == \
+                generic._fill_field_data(raw, _variable(type_manager))
+
+    def test_decoder_cached_per_type(self, type_manager):
+        """测试同一类型只生成一次，联合体按成员分别生成"""
+        specializer = StructSpecializer(type_manager)
+        info = type_manager.get_type_info('struct Cal')
+        assert specializer.decoder(info) is specializer.decoder(info)
+
+        union = type_manager.get_type_info('union Raw')
+        word = specializer.decoder(union, union['fields'][:1])
+        half = specializer.decoder(union, union['fields'][1:])
+        assert word is not half
+        assert "'half'" in specializer.source(union, union['fields'][1:])
+
+    def test_invalidated_when_field_type_changes(self, type_manager):
+        """测试字段类型注册后重新生成"""
+        register_struct(type_manager, 'struct Sample', [make_field('id', 'int'), make_field('at', 'Point')])
+        parser = CDataParser(type_manager)
+        info = type_manager.get_type_info('struct Sample')
+        before = parser.specializer.decoder(info)
+        assert parser._fill_field_data([1, [3, 4]], _variable(type_manager, 'struct Sample'))['at'] == [3, 4]
+
+        type_manager.register_type('Point', {'kind': 'typedef', 'name': 'Point', 'base_type': 'struct Pos'})
+        assert parser.specializer.decoder(info) is not before
+        value = parser._fill_field_data([1, [3, 4]], _variable(type_manager, 'struct Sample'))
+        assert value['at'] == {'x': 3, 'y': 4}
@@ -0,0 +1,169 @@
+import array
+from unittest.mock import patch
+
+import pytest
+
+from conftest import make_field, pos_struct, register_struct
+
+from c_parser.core import structural_diff
+from c_parser.core.structural_diff import SnapshotBuilder, diff_snapshots, format_diff
+from c_parser.core.type_manager import TypeManager
+from c_parser.core.value_records import StructValueFactory
+
+
+def _type_manager(pos_field_type='short'):
+    """struct Pos、引用它的 struct Cal 和 typedef Cal"""
+    manager = TypeManager()
+    manager.register_type('struct Pos', pos_struct(pos_field_type))
+    register_struct(manager, 'struct Cal', [make_field('id', 'char'), make_field('pos', 'struct Pos')])
+    manager.register_type('Cal', {'kind': 'typedef', 'name': 'Cal', 'base_type': 'struct Cal'})
+    manager.register_type('Mode', {'kind': 'enum', 'name': 'Mode', 'values': {'MODE_A': 0}})
+    return manager
+
+
+def _snapshot(variables, manager=None, chunk_size=SnapshotBuilder.CHUNK_SIZE):
+    builder = SnapshotBuilder(chunk_size)
+    for name, type_name, value in variables:
+        builder.write_variable({'name': name, 'type': type_name, 'array_size': None, 'parsed_value': value},
+                               'variables')
+    return builder.finish(manager or _type_manager())
+
+
+TABLE = list(range(10000))
+CAL = {'id': 1, 'pos': {'x': 1, 'y': 2}}
+
+
+class TestStructuralDiff:
+    """结构哈希和快照比较测试类"""
+
+    def test_identical(self):
+        """测试相同的解析结果摘要相同，报告为空"""
+        old = _snapshot([('table', 'int', list(TABLE)), ('cal', 'Cal', dict(CAL))])
+        new = _snapshot([('cal', 'Cal', dict(CAL)), ('table', 'int', list(TABLE))])
+
+        report = diff_snapshots(old, new)
+        assert old.digest == new.digest
+        assert report['identical']
+        assert report['variables']['changed'] == [] and report['types']['changed'] == []
+        assert format_diff(report) == "无差异"
+
+    def test_value_representations_hash_equal(self):
+        """测试typed array与列表、StructValue与dict的摘要相同"""
+        factory = StructValueFactory()
+        info = pos_struct()
+        old = _snapshot([('table', 'int', list(TABLE)), ('pos', 'struct Pos', {'x': 1, 'y': 2})])
+        new = _snapshot([('table', 'int', array.array('i', TABLE)),
+                         ('pos', 'struct Pos', factory.build(info, {'x': 1, 'y': 2}))])
+        assert old.digest == new.digest
+
+    def test_changed_array_ranges(self):
+        """测试数组只报告变化的组，范围按组对齐并合并相邻的组"""
+        table = list(TABLE)
+        table[100] = -1
+        table[5000] = table[5064] = -1
+        report = diff_snapshots(_snapshot([('table', 'int', TABLE)]), _snapshot([('table', 'int', table)]))
+
+        change, = report['variables']['changed']
+        assert change['name'] == 'table'
+        assert change['changes'] == [{'path': 'table', 'ranges': [[64, 128], [4992, 5120]]}]
+        assert report['types']['changed'] == []
+
+    def test_array_length_change(self):
+        """测试数组长度变化时报告长度和末尾新增的范围"""
+        report = diff_snapshots(_snapshot([('table', 'int', TABLE)]),
+                                _snapshot([('table', 'int', TABLE + [1, 2])]))
+        change, = report['variables']['changed'][0]['changes']
+        assert change['length'] == [10000, 10002]
+        assert change['ranges'] == [[9984, 10002]]
+
+    def test_struct_fields(self):
+        """测试结构体变量报告变化的字段路径和新旧值"""
+        changed = {'id': 1, 'pos': {'x': 5, 'y': 2}, 'extra': 3}
+        report = diff_snapshots(_snapshot([('cal', 'Cal', CAL)]), _snapshot([('cal', 'Cal', changed)]))
+
+        assert report['variables']['changed'][0]['changes'] == [
+            {'path': 'cal.pos.x', 'old': 1, 'new': 5},
+            {'path': 'cal.extra', 'old': None, 'new': 3},
+        ]
+        assert "~ cal.pos.x: 1 -> 5" in format_diff(report)
+
+    def test_added_and_removed_variables(self):
+        """测试新增和删除的变量，声明类型变化"""
+        report = diff_snapshots(_snapshot([('a', 'int', 1), ('b', 'int', 2)]),
+                                _snapshot([('b', 'long', 2), ('c', 'int', 3)]))
+        variables = report['variables']
+        assert variables['added'] == ['c']
+        assert variables['removed'] == ['a']
+        assert variables['changed'][0]['type'] == ['int', 'long']
+        assert variables['changed'][0]['changes'] == []
+
+    def test_type_changes_propagate(self):
+        """测试类型定义变化时引用它的类型标记为affected，并报告布局变化"""
+        report = diff_snapshots(_snapshot([], _type_manager('short')), _snapshot([], _type_manager('int')))
+        types = report['types']
+
+        assert types['changed'] == [{'kind': 'struct', 'name': 'struct Pos'}]
+        assert {entry['name'] for entry in types['affected']} == {'struct Cal', 'Cal'}
+        layouts = {entry['name']: entry for entry in types['layout']}
+        assert layouts['struct Pos']['size'] == [4, 8]
+        assert layouts['struct Pos']['fields'] == {'y': [2, 4]}
+        assert layouts['struct Cal']['size'] == [6, 12]
+        assert report['variables']['changed'] == []
+
+    def test_added_type_and_location_ignored(self):
+        """测试新增类型；只有位置信息变化的定义不视为变化"""
+        old_manager, new_manager = _type_manager(), _type_manager()
+        old_manager.register_type('Flags', {'kind': 'typedef', 'name': 'Flags', 'base_type': 'int',
+                                            'location': {'file': 'a.h', 'line': 3}})
+        new_manager.register_type('Flags', {'kind': 'typedef', 'name': 'Flags', 'base_type': 'int',
+                                            'location': {'file': 'a.h', 'line': 9}})
+        new_manager.register_type('Extra', {'kind': 'typedef', 'name': 'Extra', 'base_type': 'int'})
+
+        types = diff_snapshots(_snapshot([], old_manager), _snapshot([], new_manager))['types']
+        assert types['added'] == [{'kind': 'typedef', 'name': 'Extra'}]
+        assert types['changed'] == [] and types['affected'] == []
+
+    def test_anonymous_struct_line_shift_ignored(self):
+        """测试在匿名结构体的typedef上方插入空行后，名称中的行号变化不视为定义变化"""
+        def manager(line):
+            # 与类型解析器为 typedef struct { short x; short y; } Point; 登记的条目相同
+            name = f"__anon_struct_{line}_8_1a2b3c"
+            manager = TypeManager()
+            register_struct(manager, name, [make_field('x', 'short'), make_field('y', 'short')],
+                            location={'file': 'a.h', 'line': line})
+            manager.register_type('Point', {'kind': 'typedef', 'name': 'Point', 'base_type': name,
+                                            'location': {'file': 'a.h', 'line': line}})
+            return manager, name
+
+        (old_manager, old_name), (new_manager, new_name) = manager(3), manager(4)
+        old = _snapshot([('origin', 'Point', {'x': 0, 'y': 0}), ('raw', old_name, {'x': 1, 'y': 2})], old_manager)
+        new = _snapshot([('origin', 'Point', {'x': 0, 'y': 0}), ('raw', new_name, {'x': 1, 'y': 2})], new_manager)
+
+        assert set(old.types) == {('typedef', 'Point'), ('struct', '__anon_struct_1a2b3c')}
+        assert old.types[('struct', '__anon_struct_1a2b3c')]['layout']['size'] == 4
+        report = diff_snapshots(old, new)
+        assert report['identical']
+        assert report['types']['added'] == [] and report['types']['removed'] == []
+
+    def test_shared_base_types_not_hashed(self):
+        """测试fork自同一底层时只计算自身的类型和变量引用的类型"""
+        base = _type_manager()
+        register_struct(base, 'struct Unused', [make_field('a', 'int')])
+        old_manager, new_manager = base.fork(), base.fork()
+        new_manager.register_type('Extra', {'kind': 'typedef', 'name': 'Extra', 'base_type': 'int'})
+
+        with patch.object(structural_diff, '_layout_summary', wraps=structural_diff._layout_summary) as layout:
+            old = _snapshot([('cal', 'const Cal', dict(CAL))], old_manager)
+            new = _snapshot([('cal', 'const Cal', dict(CAL))], new_manager)
+
+        assert set(old.types) == {('typedef', 'Cal'), ('struct', 'struct Cal'), ('struct', 'struct Pos')}
+        assert set(new.types) - set(old.types) == {('typedef', 'Extra')}
+        assert {call[0][1] for call in layout.call_args_list} == {'struct Cal', 'struct Pos'}
+        report = diff_snapshots(old, new)
+        assert report['types']['added'] == [{'kind': 'typedef', 'name': 'Extra'}]
+        assert report['types']['changed'] == [] and report['variables']['changed'] == []
+
+    def test_chunk_size_mismatch(self):
+        """测试分组大小不同的快照不能比较"""
+        with pytest.raises(ValueError):
+            diff_snapshots(_snapshot([], chunk_size=16), _snapshot([], chunk_size=32))
@@ -6,6 +6,31 @@ from unittest.mock import Mock, patch, MagicMock
 from tree_sitter import Node, Language, Parser
 
 from c_parser.core.tree_sitter_utils import TreeSitterUtils
+from config import TreeSitterConfig
+
+
+def _grammar_config(root, library=False, source=False):
+    """在临时目录中创建编译好的库和/或语法源码，返回对应的配置"""
+    config = TreeSitterConfig()
+    config.c_parser_path = str(root / 'tree-sitter-c')
+    config.build_dir = str(root / 'build')
+    if library:
+        (root / 'build').mkdir()
+        (root / 'build' / 'c.so').write_bytes(b'')
+    if source:
+        (root / 'tree-sitter-c' / 'src').mkdir(parents=True)
+        (root / 'tree-sitter-c' / 'src' / 'parser.c').write_text('')
+    return config
+
+
+@pytest.fixture
+def fresh_language():
+    """重置已加载的语言库，测试结束后恢复"""
+    saved = (TreeSitterUtils._instance, TreeSitterUtils._parser, TreeSitterUtils._language)
+    TreeSitterUtils._instance = TreeSitterUtils._parser = TreeSitterUtils._language = None
+    TreeSitterUtils._startup_timings.clear()
+    yield
+    TreeSitterUtils._instance, TreeSitterUtils._parser, TreeSitterUtils._language = saved
 
 
 class TestTreeSitterUtils:
@@ -28,7 +53,7 @@ class TestTreeSitterUtils:
     
     @patch('c_parser.core.tree_sitter_utils.Language')
     @patch('c_parser.core.tree_sitter_utils.Parser')
-    def test_initialization(self, mock_parser_class, mock_language_class):
+    def test_initialization(self, mock_parser_class, mock_language_class, tmp_path):
         """测试初始化过程"""
         # 重置单例
         TreeSitterUtils._instance = None
@@ -41,13 +66,13 @@ class TestTreeSitterUtils:
         mock_parser_class.return_value = mock_parser
         mock_language_class.return_value = mock_language
         
-        # 创建实例
-        utils = TreeSitterUtils()
+        # 创建实例：只有编译好的库，没有语法源码
+        utils = TreeSitterUtils(_grammar_config(tmp_path, library=True))
         
         # 验证初始化调用
         mock_parser_class.assert_called_once()
-        mock_language.build_library.assert_called_once()
-        mock_language_class.assert_called_once()
+        mock_language_class.build_library.assert_not_called()
+        mock_language_class.assert_called_once_with(str(tmp_path / 'build' / 'c.so'), 'c')
         mock_parser.set_language.assert_called_once_with(mock_language)
     
     @patch('c_parser.core.tree_sitter_utils.Language')
@@ -109,11 +134,11 @@ class TestTreeSitterUtils:
         utils = TreeSitterUtils()
         
         # 测试解析文件路径
-        result = TreeSitterUtils.parse(sample_c_file)
+        result = TreeSitterUtils.parse_path(sample_c_file)
         
-        # 验证结果
-        assert result is mock_node
-        mock_parser.parse.assert_called_once()
+        # 验证结果：直接传入读取到的原始字节
+        assert result is mock_tree
+        mock_parser.parse.assert_called_once_with(Path(sample_c_file).read_bytes())
     
     @patch('c_parser.core.tree_sitter_utils.Language')
     @patch('c_parser.core.tree_sitter_utils.Parser')
@@ -147,34 +172,43 @@ class TestTreeSitterUtils:
         assert result is mock_node
         mock_parser.parse.assert_called_once()
     
-    def test_looks_like_file_path(self):
-        """测试文件路径判断逻辑"""
-        # 测试C代码字符串（应该返回False）
-        assert not TreeSitterUtils._looks_like_file_path("int main() { return 0; }")
-        assert not TreeSitterUtils._looks_like_file_path("struct Point { int x; int y; };")
-        assert not TreeSitterUtils._looks_like_file_path("#include <stdio.h>")
-        
-        # 测试长字符串（应该返回False）
-        long_string = "a" * 300
-        assert not TreeSitterUtils._looks_like_file_path(long_string)
-        
-        # 测试包含换行符的字符串（应该返回False）
-        assert not TreeSitterUtils._looks_like_file_path("file.c\n")
-        assert not TreeSitterUtils._looks_like_file_path("file.c\r\n")
-        
-        # 测试文件路径（应该返回True）
-        assert TreeSitterUtils._looks_like_file_path("test.c")
-        assert TreeSitterUtils._looks_like_file_path("test.h")
-        assert TreeSitterUtils._looks_like_file_path("test.cpp")
-        assert TreeSitterUtils._looks_like_file_path("test.hpp")
-        assert TreeSitterUtils._looks_like_file_path("test.cc")
-        assert TreeSitterUtils._looks_like_file_path("test.cxx")
-        assert TreeSitterUtils._looks_like_file_path("/path/to/file.c")
-        assert TreeSitterUtils._looks_like_file_path("C:\\path\\to\\file.c")
-        
-        # 测试包含路径分隔符但不包含C语法的字符串
-        assert TreeSitterUtils._looks_like_file_path("/usr/include/test.h")
-        assert TreeSitterUtils._looks_like_file_path("src\\main.c")
+    @patch('c_parser.core.tree_sitter_utils.Language')
+    @patch('c_parser.core.tree_sitter_utils.Parser')
+    def test_string_is_source_text(self, mock_parser_class, mock_language_class, sample_c_file):
+        """测试字符串始终按源代码解析，不检查文件系统"""
+        TreeSitterUtils._instance = None
+        TreeSitterUtils._parser = None
+        TreeSitterUtils._language = None
+        
+        mock_parser = Mock()
+        mock_parser_class.return_value = mock_parser
+        mock_language_class.return_value = Mock()
+        utils = TreeSitterUtils()
+        
+        TreeSitterUtils.parse(sample_c_file)
+        TreeSitterUtils.parse(b"int x;")
+        
+        assert mock_parser.parse.call_args_list[0][0][0] == sample_c_file.encode('utf8')
+        assert mock_parser.parse.call_args_list[1][0][0] == b"int x;"
+    
+    def test_read_source(self, tmp_path):
+        """测试按原始字节读取源文件"""
+        path = tmp_path / 'data.c'
+        path.write_bytes('int 数值 = 1;\n'.encode('utf-8'))
+        
+        assert TreeSitterUtils.read_source(path) == 'int 数值 = 1;\n'.encode('utf-8')
+        assert TreeSitterUtils.read_source(str(path)) == path.read_bytes()
+    
+    def test_get_node_text_from_source(self):
+        """测试从源码memoryview按字节范围解码节点文本"""
+        source = memoryview('int 数值 = 1;'.encode('utf-8'))
+        mock_node = Mock(spec=Node)
+        mock_node.start_byte = 4
+        mock_node.end_byte = 10
+        # 传入源码时不使用 node.text
+        mock_node.text = None
+        
+        assert TreeSitterUtils.get_node_text(mock_node, source) == "数值"
     
     def test_get_node_text(self):
         """测试获取节点文本"""
@@ -250,7 +284,9 @@ class TestTreeSitterUtils:
         
         # 测试不存在的文件
         with pytest.raises(Exception):
-            TreeSitterUtils.parse("nonexistent_file.c")
+            TreeSitterUtils.parse(Path("nonexistent_file.c"))
+        with pytest.raises(OSError):
+            TreeSitterUtils.parse_path("nonexistent_file.c")
     
     @patch('c_parser.core.tree_sitter_utils.Language')
     @patch('c_parser.core.tree_sitter_utils.Parser')
@@ -276,3 +312,104 @@ class TestTreeSitterUtils:
         # 测试解析错误
         with pytest.raises(Exception, match="Parser error"):
             TreeSitterUtils.parse("int main() { return 0; }")
+
+
+@pytest.mark.usefixtures('fresh_language')
+class TestLanguageLoading:
+    """语言库加载测试类"""
+
+    @patch('c_parser.core.tree_sitter_utils.Language')
+    @patch('c_parser.core.tree_sitter_utils.Parser')
+    def test_up_to_date_library_is_not_rebuilt(self, mock_parser_class, mock_language_class, tmp_path):
+        """测试库比语法源码新时直接加载，不重新编译"""
+        config = _grammar_config(tmp_path, source=True)
+        _grammar_config(tmp_path, library=True)
+        source = tmp_path / 'tree-sitter-c' / 'src' / 'parser.c'
+        os.utime(source, (1, 1))
+
+        TreeSitterUtils(config)
+        mock_language_class.build_library.assert_not_called()
+        assert 'load_library' in TreeSitterUtils.get_startup_timings()
+        assert 'build_library' not in TreeSitterUtils.get_startup_timings()
+
+    @patch('c_parser.core.tree_sitter_utils.Language')
+    @patch('c_parser.core.tree_sitter_utils.Parser')
+    def test_newer_source_is_rebuilt(self, mock_parser_class, mock_language_class, tmp_path):
+        """测试语法源码比库新时重新编译"""
+        config = _grammar_config(tmp_path, library=True, source=True)
+        os.utime(tmp_path / 'build' / 'c.so', (1, 1))
+
+        TreeSitterUtils(config)
+        mock_language_class.build_library.assert_called_once_with(
+            str(tmp_path / 'build' / 'c.so'), [str(tmp_path / 'tree-sitter-c')])
+
+    @patch('c_parser.core.tree_sitter_utils.Language')
+    @patch('c_parser.core.tree_sitter_utils.Parser')
+    def test_build_failure_uses_existing_library(self, mock_parser_class, mock_language_class, tmp_path):
+        """测试编译失败（例如没有编译器）时使用已有的库"""
+        config = _grammar_config(tmp_path, library=True, source=True)
+        os.utime(tmp_path / 'build' / 'c.so', (1, 1))
+        mock_language_class.build_library.side_effect = OSError('no compiler')
+
+        TreeSitterUtils(config)
+        mock_language_class.assert_called_once_with(str(tmp_path / 'build' / 'c.so'), 'c')
+
+    @patch('c_parser.core.tree_sitter_utils.Language')
+    @patch('c_parser.core.tree_sitter_utils.Parser')
+    def test_wheel_without_library(self, mock_parser_class, mock_language_class, tmp_path):
+        """测试没有库和语法源码时使用 tree_sitter_c wheel"""
+        wheel = Mock()
+        wheel.language.return_value = 1234
+        with patch.dict('sys.modules', {'tree_sitter_c': wheel}):
+            TreeSitterUtils(_grammar_config(tmp_path))
+        mock_language_class.assert_called_once_with(1234)
+        assert 'load_wheel' in TreeSitterUtils.get_startup_timings()
+
+    @patch('c_parser.core.tree_sitter_utils.Language')
+    @patch('c_parser.core.tree_sitter_utils.Parser')
+    def test_no_grammar_available(self, mock_parser_class, mock_language_class, tmp_path):
+        """测试没有任何语言来源时报错"""
+        with patch.dict('sys.modules', {'tree_sitter_c': None}):
+            with pytest.raises(RuntimeError):
+                TreeSitterUtils(_grammar_config(tmp_path))
+
+
+class TestQueries:
+    """预编译查询和TreeCursor遍历测试类"""
+
+    def _node(self, start_byte):
+        node = Mock()
+        node.start_byte = start_byte
+        return node
+
+    def test_query_compiled_once(self):
+        """测试同一查询只编译一次"""
+        language = Mock()
+        with patch.object(TreeSitterUtils, '_language', language), \
+             patch.object(TreeSitterUtils, '_queries', {}), \
+             patch.object(TreeSitterUtils, 'get_instance'), \
+             patch('c_parser.core.tree_sitter_utils.tree_sitter.Query', side_effect=TypeError, create=True):
+            first = TreeSitterUtils.get_query('enumerators')
+            assert TreeSitterUtils.get_query('enumerators') is first
+        language.query.assert_called_once_with(TreeSitterUtils.QUERIES['enumerators'])
+
+    def test_captures_in_source_order(self):
+        """测试列表和按捕获名分组两种结果都按源码顺序返回"""
+        second, first = self._node(10), self._node(2)
+        grouped = Mock(spec=['captures'])
+        grouped.captures.return_value = {'name': [second, first]}
+        listed = Mock(spec=['captures'])
+        listed.captures.return_value = [(second, 'name'), (first, 'name')]
+
+        for query in (grouped, listed):
+            with patch.object(TreeSitterUtils, 'get_query', return_value=query):
+                assert TreeSitterUtils.captures('type_names', Mock()) == [(first, 'name'), (second, 'name')]
+                assert TreeSitterUtils.first_capture('type_names', Mock()) is first
+
+    def test_iter_children(self):
+        """测试通过TreeCursor按顺序访问子节点"""
+        from conftest import create_mock_node
+        children = [create_mock_node('comment'), create_mock_node('declaration')]
+        root = create_mock_node('translation_unit', children=children)
+        assert list(TreeSitterUtils.iter_children(root)) == children
+        assert list(TreeSitterUtils.iter_children(create_mock_node('comment'))) == []
@@ -0,0 +1,110 @@
+import pytest
+
+from conftest import make_field, register_struct
+
+from c_parser.core.type_database import TypeDatabase, write_type_database
+from c_parser.core.type_manager import TypeManager
+
+
+TYPE_INFO = {
+    'types': [
+        {'kind': 'struct', 'name': 'struct Pos', 'size': 4,
+         'fields': [make_field('x', 'short'), make_field('y', 'short')]},
+        {'kind': 'struct', 'name': 'struct Cal', 'attributes': {'packed': True},
+         'fields': [make_field('id', 'unsigned char'), make_field('pos', 'struct Pos'),
+                    make_field('gain', 'float', [4])]},
+        {'kind': 'typedef', 'name': 'Cal', 'base_type': 'struct Cal'},
+        {'kind': 'enum', 'name': 'Mode', 'values': {'MODE_A': 0, 'MODE_B': 1}},
+        {'kind': 'struct', 'name': 'struct Pos', 'size': 6, 'fields': [make_field('x', 'short')]},
+    ],
+    'pointer_types': ['PosPtr'],
+    'macro_definitions': {'TABLE_SIZE': 16, 'NAME': '"sdk"', 'EMPTY': ''},
+}
+
+
+@pytest.fixture
+def database(tmp_path):
+    """由 TYPE_INFO 生成的类型库"""
+    path = tmp_path / 'sdk.stdb'
+    write_type_database(TYPE_INFO, path)
+    with TypeDatabase(path) as database:
+        yield database
+
+
+class TestTypeDatabase:
+    """类型库读写测试类"""
+
+    def test_queries_match_type_index(self, database):
+        """测试各个查询与TypeIndex的结果相同"""
+        assert len(database) == 5
+        assert database.get('struct', 'struct Pos') == TYPE_INFO['types'][0]
+        assert database.get('struct', 'struct Missing') is None
+        assert [entry['size'] for entry in database.by_name('struct Pos')] == [4, 6]
+        assert [entry['name'] for entry in database.by_kind('struct')] == ['struct Pos', 'struct Cal', 'struct Pos']
+        assert [entry['name'] for entry in database.by_field('pos')] == ['struct Cal']
+        assert [entry['name'] for entry in database.by_attribute('packed')] == ['struct Cal']
+        assert [entry['size'] for entry in database.by_size(6)] == [6]
+        assert database.pointer_types == {'PosPtr'}
+
+    def test_entries_decoded_once(self, database):
+        """测试同一条目多次查询返回同一个对象"""
+        assert database.get('struct', 'struct Cal') is database.by_field('id')[0]
+
+    def test_macros(self, database):
+        """测试宏查询"""
+        assert database.macro('TABLE_SIZE') == 16
+        assert database.has_macro('EMPTY')
+        assert database.macro('UNDEFINED') is None
+        assert database.macros() == TYPE_INFO['macro_definitions']
+
+    def test_not_a_database(self, tmp_path):
+        """测试非类型库文件"""
+        path = tmp_path / 'types.json'
+        path.write_text('{"types": []}')
+        assert not TypeDatabase.is_database(path)
+        with pytest.raises(ValueError):
+            TypeDatabase(path)
+
+
+class TestTypeManagerWithDatabase:
+    """TypeManager 使用类型库测试类"""
+
+    def test_same_results_as_json(self, database):
+        """测试类型解析、查询和导出与直接加载JSON相同"""
+        loaded = TypeManager(TYPE_INFO)
+        lazy = TypeManager(type_database=database)
+
+        assert lazy.get_struct_info('Pos') == loaded.get_struct_info('Pos')
+        assert lazy.resolve_type('Cal') == loaded.resolve_type('Cal')
+        assert lazy.get_type_size('struct Cal') == loaded.get_type_size('struct Cal')
+        assert lazy.find_types_by_field('x') == loaded.find_types_by_field('x')
+        assert lazy.evaluate_expression('TABLE_SIZE * 2') == loaded.evaluate_expression('TABLE_SIZE * 2')
+        assert lazy.is_pointer_type('PosPtr')
+        assert lazy.export_types() == loaded.export_types()
+        assert lazy.type_statistics() == {'types': 5, 'pointer_types': 1, 'macro_definitions': 3}
+
+    def test_current_types_layer_on_top(self, database):
+        """测试当前文件的类型和宏与类型库共存"""
+        manager = TypeManager(type_database=database)
+        register_struct(manager, 'struct Local', [make_field('cal', 'Cal')])
+        manager.add_macro_definition('TABLE_SIZE', 32)
+
+        assert manager.resolve_type('struct Local')['is_struct']
+        assert manager.get_macro_definition('TABLE_SIZE') == 32
+        assert manager.get_macro_definition('NAME') == '"sdk"'
+        assert manager.fork().get_struct_info('Cal') is database.get('struct', 'struct Cal')
+
+    def test_merge_into_global_with_database(self, database):
+        """测试连接类型库后合并到全局：写入自身的全局类型表，类型库不变，查询能找到新类型"""
+        manager = TypeManager(type_database=database)
+        conflicts = manager.merge_type_info({'types': [{'kind': 'typedef', 'name': 'Flags', 'base_type': 'int'}],
+                                             'macro_definitions': {'EXTRA': 1}}, to_global=True)
+        manager.update_type_info({'types': [{'kind': 'typedef', 'name': 'Local', 'base_type': 'struct Pos'}]},
+                                 to_global=True)
+
+        assert conflicts == []
+        assert [entry['name'] for entry in manager._global_types] == ['Flags', 'Local']
+        assert database.get('typedef', 'Flags') is None
+        assert manager._get_type_kind('Flags') == 'typedef'
+        assert manager.resolve_type('Local')['is_struct']
+        assert manager.get_macro_definition('EXTRA') == 1
@@ -0,0 +1,107 @@
+import pytest
+
+from c_parser.core.type_index import TypeIndex
+from c_parser.core.type_manager import TypeManager
+
+
+class TestTypeIndex:
+    """TypeIndex测试类"""
+
+    def test_lookup_by_key_and_name(self):
+        """测试按 (kind, name) 和名称查找"""
+        point = {'name': 'struct Point', 'kind': 'struct', 'fields': [{'name': 'x'}], 'size': 8}
+        alias = {'name': 'Point', 'kind': 'typedef', 'base_type': 'struct Point'}
+        index = TypeIndex([point, alias])
+
+        assert len(index) == 2
+        assert index.get('struct', 'struct Point') is point
+        assert index.get('typedef', 'Point') is alias
+        assert index.get('struct', 'Point') is None
+        assert index.by_name('Point') == [alias]
+        assert index.by_kind('struct') == [point]
+
+    def test_secondary_indexes(self):
+        """测试属性、大小和字段索引"""
+        packed = {'name': 'A', 'kind': 'struct', 'size': 4,
+                  'attributes': {'packed': True}, 'fields': [{'name': 'a'}, {'name': 'a'}]}
+        plain = {'name': 'B', 'kind': 'struct', 'size': 4, 'fields': [{'name': 'b'}]}
+        index = TypeIndex([packed, plain])
+
+        assert index.by_attribute('packed') == [packed]
+        assert index.by_size(4) == [packed, plain]
+        # 同一类型中重复的字段名只索引一次
+        assert index.by_field('a') == [packed]
+        assert index.by_field('missing') == []
+
+    def test_first_registered_entry_wins(self):
+        """测试同键条目保留最先注册的条目"""
+        first = {'name': 'S', 'kind': 'struct'}
+        second = {'name': 'S', 'kind': 'struct'}
+        index = TypeIndex([first, second])
+
+        assert index.get('struct', 'S') is first
+
+        index.discard(first)
+        assert index.get('struct', 'S') is second
+        assert len(index) == 1
+
+    def test_is_stale(self):
+        """测试过期检查"""
+        types = [{'name': 'S', 'kind': 'struct'}]
+        index = TypeIndex(types)
+
+        assert not index.is_stale(types)
+        types.append({'name': 'T', 'kind': 'struct'})
+        assert index.is_stale(types)
+        assert index.is_stale(list(types))
+
+
+class TestTypeManagerIndexing:
+    """TypeManager索引同步测试"""
+
+    def test_register_type_updates_index(self):
+        """测试register_type更新索引"""
+        tm = TypeManager()
+        tm.register_type('struct Point', {'kind': 'struct', 'fields': [{'name': 'x', 'type': 'int'}], 'size': 4})
+
+        assert tm.get_struct_info('Point')['name'] == 'struct Point'
+        assert tm.find_types_by_field('x')[0]['name'] == 'struct Point'
+        assert tm.find_types_by_size(4)[0]['name'] == 'struct Point'
+
+    def test_merge_type_info_reindexes_existing(self):
+        """测试merge_type_info更新已有类型后重新索引"""
+        tm = TypeManager()
+        tm.register_type('struct S', {'kind': 'struct', 'fields': [{'name': 'old', 'type': 'int'}]})
+        tm.merge_type_info({'types': [
+            {'name': 'struct S', 'kind': 'struct', 'fields': [{'name': 'new', 'type': 'int'}]}
+        ]})
+
+        assert len(tm._current_types) == 1
+        assert tm.find_types_by_field('old') == []
+        assert tm.find_types_by_field('new')[0]['name'] == 'struct S'
+
+    def test_reset_current_type_info_clears_index(self):
+        """测试重置当前类型信息后索引同步"""
+        tm = TypeManager({'types': [{'name': 'struct G', 'kind': 'struct', 'fields': []}]})
+        tm.register_type('struct C', {'kind': 'struct', 'fields': []})
+        tm.reset_current_type_info()
+
+        assert tm.get_struct_info('C') == {}
+        assert tm.get_struct_info('G')['name'] == 'struct G'
+
+    def test_direct_list_mutation_is_detected(self):
+        """测试直接修改类型列表后索引自动重建"""
+        tm = TypeManager()
+        tm._current_types.append({'name': 'Color', 'kind': 'enum', 'values': {'RED': 0}})
+
+        assert tm.get_enum_value('Color', 'RED') == 0
+        assert tm.get_enum_values() == {'Color': {'RED': 0}}
+
+    def test_find_type_by_name_prefers_current(self):
+        """测试find_type_by_name优先返回当前文件的定义"""
+        tm = TypeManager({'types': [{'name': 'T', 'kind': 'typedef', 'base_type': 'int'}]})
+        tm.register_type('T', {'kind': 'typedef', 'base_type': 'short'})
+
+        assert tm.find_type_by_name('T')['base_type'] == 'short'
+        assert tm.find_type_by_name('T', kind='typedef')['base_type'] == 'short'
+        assert tm.find_type_by_name('T', kind='struct') is None
@@ -0,0 +1,126 @@
+import pytest
+
+from conftest import make_field, pos_struct, register_struct
+
+from c_parser.core.type_database import TypeDatabase, write_type_database
+from c_parser.core.type_layer import TypeLayer
+from c_parser.core.type_manager import TypeManager
+
+
+POS = pos_struct()
+
+
+@pytest.fixture
+def type_manager():
+    """全局层包含一个结构体和宏，当前文件层包含一个typedef"""
+    manager = TypeManager()
+    manager.merge_type_info({'types': [dict(POS)], 'pointer_types': ['PosPtr'],
+                             'macro_definitions': {'TABLE_SIZE': 16}}, to_global=True)
+    manager.register_type('Pos', {'kind': 'typedef', 'name': 'Pos', 'base_type': 'struct Pos'})
+    return manager
+
+
+class TestTypeLayers:
+    """冻结类型层和fork测试类"""
+
+    def test_freeze_keeps_lookups(self, type_manager):
+        """测试冻结前后的查询结果和导出内容相同"""
+        before = type_manager.export_types()
+        resolved = type_manager.resolve_type('Pos')
+        type_manager.freeze()
+
+        assert len(type_manager._layers) == 2
+        assert all(isinstance(layer, TypeLayer) for layer in type_manager._layers)
+        assert type_manager._global_types == [] and type_manager._current_types == []
+        assert type_manager.export_types() == before
+        assert type_manager.resolve_type('Pos') == resolved
+        assert type_manager.get_macro_definition('TABLE_SIZE') == 16
+        assert type_manager.is_pointer_type('PosPtr')
+
+    def test_freeze_moves_current_scope(self, type_manager):
+        """测试冻结后当前文件层为空，冻结前的当前文件类型只能按全部范围查到"""
+        assert [entry['name'] for entry in type_manager.export_types(scope='current')['types']] == ['Pos']
+        type_manager.freeze()
+
+        assert type_manager.export_types(scope='current')['types'] == []
+        assert type_manager.export_current_type_info()['types'] == []
+        assert [entry['name'] for entry in type_manager.export_types()['types']] == ['struct Pos', 'Pos']
+
+        type_manager.register_type('Later', {'kind': 'typedef', 'name': 'Later', 'base_type': 'int'})
+        assert [entry['name'] for entry in type_manager.export_current_type_info()['types']] == ['Later']
+
+    def test_freeze_empty_is_noop(self, type_manager):
+        """测试没有新类型时再次冻结不增加层"""
+        type_manager.freeze()
+        type_manager.freeze()
+        assert len(type_manager._layers) == 2
+
+    def test_fork_isolated(self, type_manager):
+        """测试fork出的对象之间以及与原对象之间互不影响"""
+        first = type_manager.fork()
+        second = type_manager.fork()
+        register_struct(first, 'struct Cal', [make_field('pos', 'struct Pos')])
+
+        assert first.get_struct_info('struct Cal')['name'] == 'struct Cal'
+        assert second.get_struct_info('struct Cal') == {}
+        assert type_manager.get_struct_info('struct Cal') == {}
+        # 冻结的层是共享的，不复制
+        assert first._layers[0] is second._layers[0] is type_manager._layers[0]
+        assert first.resolve_type('Pos')['is_struct']
+
+    def test_fork_redefinition_shadows_layers(self, type_manager):
+        """测试fork中重新定义的类型覆盖冻结层中的同名类型，其他fork和原对象不受影响"""
+        base_size = type_manager.get_layout_engine().size_of('struct Pos')
+        fork = type_manager.fork()
+        fork.register_type('struct Pos', pos_struct('int'))
+        fork.register_type('Pos', {'kind': 'typedef', 'name': 'Pos', 'base_type': 'int'})
+
+        assert fork.get_struct_info('struct Pos')['fields'][0]['type'] == 'int'
+        assert fork.get_layout_engine().size_of('struct Pos') == 2 * base_size
+        assert not fork.resolve_type('Pos')['is_struct']
+        assert type_manager.fork().get_struct_info('struct Pos')['fields'][0]['type'] == 'short'
+        assert type_manager.get_layout_engine().size_of('struct Pos') == base_size
+
+    def test_nested_fork(self, type_manager):
+        """测试嵌套fork能看到中间层的类型"""
+        target = type_manager.fork()
+        target.register_type('Cal', {'kind': 'typedef', 'name': 'Cal', 'base_type': 'Pos'})
+        leaf = target.fork()
+
+        assert leaf.resolve_type('Cal')['is_struct']
+        assert len(leaf._layers) == 3
+        assert type_manager.get_type_info('Cal') == {}
+
+    def test_fork_macro_definitions(self, type_manager):
+        """测试fork时传入的宏覆盖底层同名宏"""
+        child = type_manager.fork({'TABLE_SIZE': 32, 'TARGET_B': 1})
+
+        assert child.get_macro_definition('TABLE_SIZE') == 32
+        assert child.has_macro('TARGET_B')
+        assert type_manager.get_macro_definition('TABLE_SIZE') == 16
+        assert not type_manager.has_macro('TARGET_B')
+        assert child.evaluate_expression('TABLE_SIZE * 2')[0] == 64
+
+    def test_reset_current_after_freeze(self, type_manager):
+        """测试冻结后重置当前文件层不影响已冻结的类型"""
+        child = type_manager.fork()
+        child.register_type('struct Tmp', {'kind': 'struct', 'name': 'struct Tmp', 'fields': []})
+        child.reset_current_type_info()
+
+        assert child.get_struct_info('struct Tmp') == {}
+        assert child.resolve_type('Pos')['is_struct']
+
+    def test_fork_over_database(self, tmp_path):
+        """测试以类型库为底层时的fork和合并"""
+        path = tmp_path / 'sdk.stdb'
+        write_type_database({'types': [dict(POS)], 'macro_definitions': {'TABLE_SIZE': 16}}, path)
+        with TypeDatabase(path) as database:
+            manager = TypeManager(type_database=database)
+            manager.merge_type_info({'types': [{'kind': 'typedef', 'name': 'Pos', 'base_type': 'struct Pos'}]},
+                                    to_global=True)
+            assert manager._global_types[0]['name'] == 'Pos'
+
+            child = manager.fork()
+            assert child._layers[0] is database
+            assert child.resolve_type('Pos')['is_struct']
+            assert child.get_macro_definition('TABLE_SIZE') == 16
@@ -257,19 +257,18 @@ class TestTypeManager:
         tm = TypeManager()
         
         # 模拟缓存被填充
-        tm._kind_cache['test'] = 'value'
-        tm._find_cache['test'] = 'value'
+        tm._resolution_cache.put('kind', 'test', 'value', {'test'})
+        tm._resolution_cache.put('find', 'test', 'value', {'test'})
         
         # 验证缓存存在
-        assert 'test' in tm._kind_cache
-        assert 'test' in tm._find_cache
+        assert ('kind', 'test') in tm._resolution_cache
+        assert ('find', 'test') in tm._resolution_cache
         
         # 清理缓存
         tm._clear_cache()
         
         # 验证缓存被清空
-        assert len(tm._kind_cache) == 0
-        assert len(tm._find_cache) == 0
+        assert len(tm._resolution_cache) == 0
     
     def test_load_type_info_error_handling(self):
         """测试加载类型信息的错误处理"""
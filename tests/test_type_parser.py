@@ -421,3 +421,63 @@ class TestCTypeParser:
             
             # 验证解析被调用
             mock_ts_instance.parse.assert_called_once_with(preprocessor_source)
+
+
+class TestDeclaratorFields:
+    """按语法字段提取声明器测试类"""
+
+    def test_array_dimensions(self):
+        """测试多维数组按declarator字段取维度，宏维度求值，空维度为dynamic"""
+        from conftest import create_mock_node
+        manager = TypeManager()
+        manager.add_macro_definition('N', 4)
+        parser = CTypeParser(manager)
+
+        name = create_mock_node('field_identifier', 'data', field_name='declarator')
+        inner = create_mock_node('array_declarator', 'data[2]', field_name='declarator', children=[
+            name, create_mock_node('number_literal', '2', field_name='size')])
+        middle = create_mock_node('array_declarator', 'data[2][N]', field_name='declarator', children=[
+            inner, create_mock_node('identifier', 'N', field_name='size')])
+        outer = create_mock_node('array_declarator', 'data[2][N][]', children=[middle])
+
+        assert parser._parse_array_dimensions(outer) == ([2, 4, 'dynamic'], 'data')
+
+    def test_pointer_field(self):
+        """测试多级指针字段的名称和类型"""
+        from conftest import create_mock_node
+        parser = CTypeParser(TypeManager())
+        name = create_mock_node('field_identifier', 'next', field_name='declarator')
+        inner = create_mock_node('pointer_declarator', '*next', field_name='declarator', children=[name])
+        outer = create_mock_node('pointer_declarator', '**next', field_name='declarator', children=[inner])
+        field = create_mock_node('field_declaration', 'int **next;', children=[
+            create_mock_node('primitive_type', 'int', field_name='type'), outer])
+
+        info = parser._parse_field(field)
+        assert info['name'] == 'next'
+        assert info['type'] == 'int**'
+        assert info['pointer_type'] == 'int*'
+
+    def test_enum_values(self):
+        """测试枚举项的值：字面量、引用前面的枚举项和隐式递增"""
+        from conftest import create_mock_node
+        manager = TypeManager()
+        parser = CTypeParser(manager)
+
+        def enumerator(name, value=None):
+            children = [create_mock_node('identifier', name, field_name='name')]
+            if value is not None:
+                children.append(value)
+            return create_mock_node('enumerator', name, children=children)
+
+        enumerators = [
+            enumerator('A', create_mock_node('number_literal', '0x10', field_name='value')),
+            enumerator('B'),
+            enumerator('C', create_mock_node('identifier', 'A', field_name='value')),
+        ]
+        body = create_mock_node('enumerator_list', field_name='body', children=enumerators)
+        node = create_mock_node('enum_specifier', 'enum E {...}', children=[
+            create_mock_node('type_identifier', 'E', field_name='name'), body])
+
+        with patch('c_parser.type_parser.TreeSitterUtils.captures',
+                   return_value=[(item, 'enumerator') for item in enumerators]):
+            assert parser._parse_enum_definition(node) == ('enum E', {'A': 16, 'B': 17, 'C': 16})
@@ -0,0 +1,85 @@
+import io
+import json
+import pickle
+from unittest.mock import Mock
+
+import pytest
+
+from c_parser.core.output_writer import StreamingJsonWriter, TypeTable, json_default
+from c_parser.core.type_ref import TypeRef
+
+
+@pytest.fixture
+def type_manager(pos_type_manager):
+    """包含一个结构体和指向它的typedef"""
+    pos_type_manager.register_type('Pos', {'kind': 'typedef', 'name': 'Pos', 'base_type': 'struct Pos'})
+    return pos_type_manager
+
+
+CONTEXT = {'is_const': True, 'pointer_level': 0, 'array_size': [4]}
+
+
+class TestTypeRef:
+    """类型引用测试类"""
+
+    def test_resolved_on_access(self):
+        """测试第一次访问时才解析，release 后重新解析"""
+        manager = Mock()
+        manager.resolve_type.return_value = {'is_struct': True}
+        typeinfo = TypeRef(manager, 'struct Pos', CONTEXT)
+        manager.resolve_type.assert_not_called()
+
+        assert typeinfo['is_struct'] and typeinfo.get('info') is None
+        manager.resolve_type.assert_called_once_with('struct Pos', CONTEXT)
+        typeinfo.release()
+        assert not typeinfo.is_resolved
+        assert 'is_struct' in typeinfo
+        assert manager.resolve_type.call_count == 2
+
+    def test_equals_resolved_dict(self, type_manager):
+        """测试与 resolve_type 的结果相等，pickle 后为dict"""
+        typeinfo = TypeRef(type_manager, 'Pos', CONTEXT)
+        expected = type_manager.resolve_type('Pos', CONTEXT)
+        assert typeinfo == expected
+        assert typeinfo['info'] is expected['info']
+
+        restored = pickle.loads(pickle.dumps(typeinfo))
+        assert type(restored) is dict and restored == expected
+        assert json.loads(json.dumps(typeinfo, default=json_default)) == \
+            json.loads(json.dumps(expected, default=json_default))
+
+
+class TestTypeTable:
+    """reference 输出模式测试类"""
+
+    def test_definitions_emitted_once(self, type_manager):
+        """测试同一定义只输出一次，变量通过 info_ref 引用"""
+        table = TypeTable()
+        variables = [{'name': f'p{index}', 'typeinfo': TypeRef(type_manager, 'Pos', CONTEXT)} for index in range(3)]
+        variables.append({'name': 'n', 'typeinfo': TypeRef(type_manager, 'int')})
+        data = json.loads(json.dumps({'variables': variables, 'type_table': table.types},
+                                     default=table.json_default))
+
+        assert list(data['type_table']) == ['struct Pos']
+        assert data['type_table']['struct Pos']['fields'][0]['name'] == 'x'
+        assert all(var['typeinfo']['info_ref'] == 'struct Pos' for var in data['variables'][:3])
+        assert 'info' not in data['variables'][0]['typeinfo']
+        assert 'info_ref' not in data['variables'][3]['typeinfo']
+
+    def test_same_name_different_definitions(self):
+        """测试不同定义同名时使用不同的键"""
+        table = TypeTable()
+        first, second = {'name': 'struct S'}, {'name': 'struct S'}
+        assert (table.add(first), table.add(second), table.add(first)) == ('struct S', 'struct S#2', 'struct S')
+
+    def test_streaming_writer(self, type_manager):
+        """测试流式输出在结尾写出类型表"""
+        out = io.StringIO()
+        writer = StreamingJsonWriter(out, 'ndjson', type_table=TypeTable())
+        for name in ('a', 'b'):
+            writer.write_variable({'name': name, 'typeinfo': TypeRef(type_manager, 'Pos', CONTEXT)})
+        writer.close()
+
+        lines = [json.loads(line) for line in out.getvalue().splitlines()]
+        assert lines[0]['typeinfo']['info_ref'] == 'struct Pos'
+        assert list(lines[-1]['type_table']) == ['struct Pos']
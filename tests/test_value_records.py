@@ -0,0 +1,77 @@
+import copy
+import json
+import pickle
+
+import pytest
+
+from conftest import make_field
+
+from c_parser.core.value_records import StructValue, StructValueFactory, to_plain
+from c_parser.core.output_writer import json_default
+from c_parser.core.type_manager import TypeManager
+
+
+@pytest.fixture
+def info():
+    """包含嵌套结构体字段的定义"""
+    return {'kind': 'struct', 'name': 'struct Rec',
+            'fields': [make_field('a', 'int'), make_field('b', 'float'), make_field('in', 'struct In')]}
+
+
+class TestStructValue:
+    """StructValue 映射行为测试类"""
+
+    def test_mapping_interface(self, info):
+        """测试索引、get、迭代顺序和与dict相等"""
+        value = StructValueFactory().build(info, {'b': 1.5, 'a': 1})
+        assert isinstance(value, StructValue)
+        assert value['a'] == 1 and value.get('b') == 1.5
+        assert value.get('in') is None and 'in' not in value
+        assert list(value) == ['a', 'b']
+        assert value == {'a': 1, 'b': 1.5}
+        assert len(value) == 2
+        with pytest.raises(KeyError):
+            value['missing']
+
+    def test_shared_record_class(self, info):
+        """测试同一定义的元素共享记录类且不带__dict__"""
+        factory = StructValueFactory()
+        first = factory.build(info, {'a': 1})
+        second = factory.build(info, {'a': 2})
+        assert type(first) is type(second)
+        assert not hasattr(first, '__dict__')
+
+    def test_unknown_field_keeps_dict(self, info):
+        """测试定义之外的字段名返回原dict"""
+        values = {'a': 1, 'zz': 2}
+        assert StructValueFactory().build(info, values) is values
+
+    def test_serialization(self, info):
+        """测试JSON输出、pickle、deepcopy和to_plain"""
+        factory = StructValueFactory()
+        nested = factory.build({'name': 'struct In', 'fields': [make_field('u', 'int')]}, {'u': 3})
+        value = factory.build(info, {'a': 1, 'b': 2.0, 'in': nested})
+        expected = {'a': 1, 'b': 2.0, 'in': {'u': 3}}
+
+        assert json.loads(json.dumps([value], default=json_default)) == [expected]
+        assert pickle.loads(pickle.dumps(value)) == expected
+        assert type(pickle.loads(pickle.dumps(value))) is type(value)
+        assert copy.deepcopy(value) == expected
+
+        plain = to_plain({'parsed_value': [value]})
+        assert type(plain['parsed_value'][0]) is dict
+        assert type(plain['parsed_value'][0]['in']) is dict
+
+
+class TestSharedResolution:
+    """共享类型解析结果测试类"""
+
+    def test_resolve_type_shared(self):
+        """测试重复解析返回同一对象，注册新类型后失效"""
+        manager = TypeManager()
+        manager.register_type('T', {'kind': 'typedef', 'name': 'T', 'type': 'int', 'base_type': 'int'})
+        first = manager.resolve_type_shared('T')
+        assert manager.resolve_type_shared('T') is first
+
+        manager.register_type('T', {'kind': 'typedef', 'name': 'T', 'type': 'short', 'base_type': 'short'})
+        assert manager.resolve_type_shared('T') is not first